@@ -0,0 +1,169 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Read throughput of ConcurrentSlotNVM and the lock-free SnapshotSlotNVM from 1 to N reader threads,
+ * compared with one exclusive mutex for all accesses.
+ * With --writer one extra thread rewrites slots all the time.
+ *
+ * Usage: slotnvm_concurrency_bench [--quick] [--threads N] [--writer]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "SlotNVM.h"
+#include "ConcurrentSlotNVM.h"
+#include "SnapshotSlotNVM.h"
+#include "NVMRAMMock.h"
+
+namespace {
+
+typedef SlotNVM<NVMRAMMock<4096>, 64> NVM_t;
+
+const uint8_t SLOTS = 16;
+const nvm_size_t SLOT_LEN = 100;
+
+/// Shared mutex interface on top of std::mutex, every reader gets exclusive access.
+class ExclusiveMutex {
+public:
+    void lock() { m_mutex.lock(); }
+    void unlock() { m_mutex.unlock(); }
+    void lock_shared() { m_mutex.lock(); }
+    void unlock_shared() { m_mutex.unlock(); }
+
+private:
+    std::mutex m_mutex;
+};
+
+struct Result {
+    double      readsPerSec;
+    unsigned    writes;
+};
+
+template <class CONCURRENT>
+Result run(CONCURRENT &concurrent, unsigned readers, bool writer, double seconds) {
+    concurrent.begin();
+    uint8_t data[SLOT_LEN];
+    for (uint8_t slot = 1; slot <= SLOTS; ++slot) {
+        memset(data, slot, sizeof(data));
+        concurrent.writeSlot(slot, data, sizeof(data));
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<unsigned> writes(0);
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < readers; ++t) {
+        threads.push_back(std::thread([&, t]() {
+            uint8_t buf[SLOT_LEN];
+            uint64_t cnt = 0;
+            uint8_t slot = 1 + t % SLOTS;
+            while (!stop.load(std::memory_order_relaxed)) {
+                nvm_size_t len = sizeof(buf);
+                concurrent.readSlot(slot, buf, len);
+                ++cnt;
+                if (++slot > SLOTS) slot = 1;
+            }
+            reads += cnt;
+        }));
+    }
+    if (writer) {
+        threads.push_back(std::thread([&]() {
+            uint8_t buf[SLOT_LEN];
+            unsigned cnt = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                memset(buf, cnt, sizeof(buf));
+                concurrent.writeSlot(1 + cnt % SLOTS, buf, sizeof(buf));
+                ++cnt;
+            }
+            writes = cnt;
+        }));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result res;
+    res.readsPerSec = reads / sec;
+    res.writes = writes;
+    return res;
+}
+
+void usage() {
+    fprintf(stderr, "Usage: slotnvm_concurrency_bench [--quick] [--threads N] [--writer]\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    unsigned maxThreads = std::thread::hardware_concurrency();
+    bool writer = false;
+    double seconds = 0.5;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            seconds = 0.02;
+        } else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc)) {
+            maxThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--writer") == 0) {
+            writer = true;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (maxThreads < 1) maxThreads = 1;
+
+    printf("%u slots with %u bytes, %s writer, %u cores\n", (unsigned)SLOTS, (unsigned)SLOT_LEN,
+           writer ? "one" : "no", std::thread::hardware_concurrency());
+    printf("%8s %16s %9s %8s %16s %9s %8s %16s %9s %8s\n", "readers", "shared reads/s", "scaling", "writes",
+           "snapshot reads/s", "scaling", "writes", "mutex reads/s", "scaling", "writes");
+
+    std::vector<unsigned> readerCnts;
+    for (unsigned readers = 1; readers < maxThreads; readers *= 2) {
+        readerCnts.push_back(readers);
+    }
+    readerCnts.push_back(maxThreads);
+
+    double sharedBase = 0;
+    double snapshotBase = 0;
+    double mutexBase = 0;
+    for (unsigned readers : readerCnts) {
+        NVM_t nvm;
+        ConcurrentSlotNVM<NVM_t> concurrent(nvm);
+        Result shared = run(concurrent, readers, writer, seconds);
+        SnapshotSlotNVM<NVM_t> snapshotNVM;
+        Result snapshot = run(snapshotNVM, readers, writer, seconds);
+        NVM_t nvm2;
+        ConcurrentSlotNVM<NVM_t, ExclusiveMutex> exclusiveNVM(nvm2);
+        Result exclusive = run(exclusiveNVM, readers, writer, seconds);
+        if (readers == 1) {
+            sharedBase = shared.readsPerSec;
+            snapshotBase = snapshot.readsPerSec;
+            mutexBase = exclusive.readsPerSec;
+        }
+        printf("%8u %16.0f %8.2fx %8u %16.0f %8.2fx %8u %16.0f %8.2fx %8u\n", readers,
+               shared.readsPerSec, shared.readsPerSec / sharedBase, shared.writes,
+               snapshot.readsPerSec, snapshot.readsPerSec / snapshotBase, snapshot.writes,
+               exclusive.readsPerSec, exclusive.readsPerSec / mutexBase, exclusive.writes);
+    }
+
+    return 0;
+}
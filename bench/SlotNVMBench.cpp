@@ -0,0 +1,624 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Benchmark of SlotNVM operations against NVMRAMMock.
+ * Build with SLOTNVM_STATS defined to get the NVM access counts per operation.
+ * With --model the NVM is a SimulatedNVM and the simulated device time per operation is printed too.
+ * At the end the decode cost of the ECC cluster format is printed, see SlotNVM template parameter ECC,
+ * writeSlot()/readSlot() of JSON like records with and without compression, see template parameter COMPRESS,
+ * slots as cluster chains and as extents, see template parameter EXTENTS, also a 4 byte field read by readSlotRange(),
+ * a counter written again and again with SlotNVM, LogSlotNVM and CounterNVM
+ * and sensor samples logged with SlotNVM rotating over slots and with RingLogNVM.
+ *
+ * Usage: slotnvm_bench [--quick] [--model ram|eeprom|i2c|fram|nor|all]
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for benchmarking
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "LogSlotNVM.h"
+#include "CounterNVM.h"
+#include "RingLogNVM.h"
+#include "NVMRAMMock.h"
+#include "SimulatedNVM.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+const nvm_size_t NVM_SIZE = 4096;
+
+unsigned g_iterations = 200;
+
+uint8_t crc8(uint8_t crc, uint8_t data) {
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; ++i) {
+        crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+    }
+    return crc;
+}
+
+struct Result {
+    double      nsPerOp;
+    double      deviceNsPerOp;
+    double      readsPerOp;
+    double      bytesReadPerOp;
+    double      writesPerOp;
+    double      bytesWrittenPerOp;
+};
+
+class Timer {
+public:
+    Timer() : m_start(std::chrono::steady_clock::now()) {}
+
+    double elapsedNs() const {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+void printHeader() {
+    printf("%-22s %7s %5s %12s %9s %11s %9s %11s %14s\n",
+           "operation", "cluster", "len", "ns/op", "reads/op", "rbytes/op", "writes/op", "wbytes/op", "device ms/op");
+}
+
+void printResult(const char *op, nvm_size_t clusterSize, nvm_size_t len, const Result &res) {
+    printf("%-22s %7u %5u %12.0f %9.1f %11.1f %9.1f %11.1f %14.3f\n",
+           op, (unsigned)clusterSize, (unsigned)len, res.nsPerOp, res.readsPerOp, res.bytesReadPerOp,
+           res.writesPerOp, res.bytesWrittenPerOp, res.deviceNsPerOp / 1e6);
+}
+
+// simulated time of the NVM, 0 if it is not a SimulatedNVM
+template <class T>
+uint64_t deviceTime(const T &nvm) {
+    return 0;
+}
+
+template <nvm_size_t SIZE, class MODEL, MODEL (*MODEL_FUNC)()>
+uint64_t deviceTime(const SimulatedNVM<SIZE, MODEL, MODEL_FUNC> &nvm) {
+    return nvm.getTime();
+}
+
+template <class T>
+Result makeResult(const T &nvm, double ns, uint64_t deviceNs, unsigned ops) {
+    Result res = Result();
+    res.nsPerOp = ns / ops;
+    res.deviceNsPerOp = double(deviceNs) / ops;
+#ifdef SLOTNVM_STATS
+    const SlotNVMStats &stats = nvm.getStats();
+    res.readsPerOp = double(stats.reads) / ops;
+    res.bytesReadPerOp = double(stats.bytesRead) / ops;
+    res.writesPerOp = double(stats.writes) / ops;
+    res.bytesWrittenPerOp = double(stats.bytesWritten) / ops;
+#endif
+    return res;
+}
+
+void fillData(std::vector<uint8_t> &data, unsigned seed) {
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = uint8_t(seed + i * 7);
+    }
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE>
+class ClusterBench {
+public:
+    typedef SlotNVM<BASE, CLUSTER_SIZE, 0, 0, &crc8> NVM_t;
+
+    static void run() {
+        benchBegin("begin empty", std::vector<uint8_t>(NVM_SIZE, 0xFF));
+        benchBegin("begin full", makeFull());
+        benchBegin("begin fragmented", makeFragmented());
+
+        static const nvm_size_t lens[] = { 1, 16, 64, 256 };
+        for (nvm_size_t len : lens) {
+            if (!fits(len)) continue;
+            benchWrite(len);
+            benchRead(len);
+            benchErase(len);
+        }
+    }
+
+private:
+    static uint64_t deviceTime(const NVM_t &nvm) {
+        return ::deviceTime(static_cast<const BASE &>(nvm));
+    }
+
+    static bool fits(nvm_size_t len) {
+        // the slot must be writable twice for overwriting
+        return (2 * ((len - 1) / NVM_t::S_USER_DATA_PER_CLUSTER + 1)) <= NVM_t::S_CLUSTER_CNT;
+    }
+
+    // all clusters used by small slots
+    static std::vector<uint8_t> makeFull() {
+        NVM_t nvm;
+        nvm.begin();
+        std::vector<uint8_t> data(NVM_t::S_USER_DATA_PER_CLUSTER);
+        for (uint8_t slot = NVM_t::S_FIRST_SLOT; slot <= NVM_t::S_LAST_SLOT; ++slot) {
+            fillData(data, slot);
+            if (!nvm.writeSlot(slot, &data[0], data.size())) break;
+        }
+        return nvm.m_memory;
+    }
+
+    // slots of random size, some erased and rewritten, so chains are scattered
+    static std::vector<uint8_t> makeFragmented() {
+        NVM_t nvm;
+        nvm.begin();
+        std::vector<uint8_t> data(256);
+        fillData(data, 0);
+        srand(1);
+        for (unsigned i = 0; i < 4 * NVM_t::S_LAST_SLOT; ++i) {
+            uint8_t slot = NVM_t::S_FIRST_SLOT + rand() % NVM_t::S_LAST_SLOT;
+            if ((rand() % 4) == 0) {
+                nvm.eraseSlot(slot);
+            } else {
+                nvm.writeSlot(slot, &data[0], 1 + rand() % (3 * NVM_t::S_USER_DATA_PER_CLUSTER));
+            }
+        }
+        return nvm.m_memory;
+    }
+
+    static void benchBegin(const char *name, const std::vector<uint8_t> &memory) {
+        double ns = 0;
+        NVM_t *nvm = NULL;
+        for (unsigned i = 0; i < g_iterations; ++i) {
+            delete nvm;
+            nvm = new NVM_t;
+            nvm->m_memory = memory;
+            Timer timer;
+            nvm->begin();
+            ns += timer.elapsedNs();
+        }
+        // every begin() does the same accesses, so the stats of the last one are the stats per call
+        Result res = makeResult(*nvm, ns, deviceTime(*nvm), 1);
+        res.nsPerOp = ns / g_iterations;
+        printResult(name, CLUSTER_SIZE, 0, res);
+        delete nvm;
+    }
+
+    // half of the NVM is used by other slots
+    static void prepareHalfFull(NVM_t &nvm) {
+        nvm.begin();
+        std::vector<uint8_t> data(NVM_t::S_USER_DATA_PER_CLUSTER);
+        for (uint8_t slot = NVM_t::S_FIRST_SLOT + 1; slot <= NVM_t::S_LAST_SLOT; slot += 2) {
+            fillData(data, slot);
+            if (nvm.getFree() < (nvm.getSize() / 2)) break;
+            nvm.writeSlot(slot, &data[0], data.size());
+        }
+    }
+
+    static void benchWrite(nvm_size_t len) {
+        NVM_t nvm;
+        prepareHalfFull(nvm);
+        std::vector<uint8_t> data(len);
+        fillData(data, len);
+#ifdef SLOTNVM_STATS
+        nvm.resetStats();
+#endif
+        uint64_t deviceStart = deviceTime(nvm);
+        Timer timer;
+        for (unsigned i = 0; i < g_iterations; ++i) {
+            data[0] = uint8_t(i);
+            nvm.writeSlot(NVM_t::S_FIRST_SLOT, &data[0], len);
+        }
+        double ns = timer.elapsedNs();
+        printResult("writeSlot", CLUSTER_SIZE, len, makeResult(nvm, ns, deviceTime(nvm) - deviceStart, g_iterations));
+    }
+
+    static void benchRead(nvm_size_t len) {
+        NVM_t nvm;
+        prepareHalfFull(nvm);
+        std::vector<uint8_t> data(len);
+        fillData(data, len);
+        nvm.writeSlot(NVM_t::S_FIRST_SLOT, &data[0], len);
+#ifdef SLOTNVM_STATS
+        nvm.resetStats();
+#endif
+        uint64_t deviceStart = deviceTime(nvm);
+        Timer timer;
+        for (unsigned i = 0; i < g_iterations; ++i) {
+            nvm_size_t readLen = len;
+            nvm.readSlot(NVM_t::S_FIRST_SLOT, &data[0], readLen);
+        }
+        double ns = timer.elapsedNs();
+        printResult("readSlot", CLUSTER_SIZE, len, makeResult(nvm, ns, deviceTime(nvm) - deviceStart, g_iterations));
+    }
+
+    static void benchErase(nvm_size_t len) {
+        NVM_t nvm;
+        prepareHalfFull(nvm);
+        std::vector<uint8_t> data(len);
+        fillData(data, len);
+        double ns = 0;
+        uint64_t deviceNs = 0;
+        unsigned ops = 0;
+#ifdef SLOTNVM_STATS
+        SlotNVMStats stats = SlotNVMStats();
+#endif
+        for (unsigned i = 0; i < g_iterations; ++i) {
+            nvm.writeSlot(NVM_t::S_FIRST_SLOT, &data[0], len);
+#ifdef SLOTNVM_STATS
+            nvm.resetStats();
+#endif
+            uint64_t deviceStart = deviceTime(nvm);
+            Timer timer;
+            bool res = nvm.eraseSlot(NVM_t::S_FIRST_SLOT);
+            ns += timer.elapsedNs();
+            deviceNs += deviceTime(nvm) - deviceStart;
+            if (res) ++ops;
+#ifdef SLOTNVM_STATS
+            stats.reads += nvm.getStats().reads;
+            stats.bytesRead += nvm.getStats().bytesRead;
+            stats.writes += nvm.getStats().writes;
+            stats.bytesWritten += nvm.getStats().bytesWritten;
+#endif
+        }
+        if (ops == 0) return;
+#ifdef SLOTNVM_STATS
+        nvm.m_stats = stats;
+#endif
+        printResult("eraseSlot", CLUSTER_SIZE, len, makeResult(nvm, ns, deviceNs, ops));
+    }
+};
+
+template <class BASE>
+void runAllClusterSizes(const char *name) {
+    printf("\nNVM %s, size %u bytes, %u iterations\n", name, (unsigned)NVM_SIZE, g_iterations);
+    printHeader();
+    ClusterBench<BASE, 16>::run();
+    ClusterBench<BASE, 32>::run();
+    ClusterBench<BASE, 64>::run();
+    ClusterBench<BASE, 128>::run();
+    ClusterBench<BASE, 256>::run();
+}
+
+// decode cost of one cluster in RAM, without NVM access
+template <nvm_size_t CLUSTER_SIZE>
+void benchECCDecode() {
+    typedef SlotNVM<NVMRAMMock<NVM_SIZE>, CLUSTER_SIZE, 0, 0, &crc8, int, &rand, true> NVM_t;
+
+    NVM_t nvm;
+    nvm.begin();
+    std::vector<uint8_t> data(NVM_t::S_USER_DATA_PER_CLUSTER);
+    fillData(data, CLUSTER_SIZE);
+    nvm.writeSlot(1, data.data(), data.size());
+    uint8_t startCluster;
+    nvm.findStartCluser(1, startCluster);
+    uint8_t cluster[CLUSTER_SIZE];
+    memcpy(cluster, &nvm.m_memory[startCluster * CLUSTER_SIZE], CLUSTER_SIZE);
+
+    const unsigned ops = g_iterations * 100;
+    for (int error = 0; error < 2; ++error) {
+        unsigned corrected = 0;
+        Timer timer;
+        for (unsigned i = 0; i < ops; ++i) {
+            uint8_t offset;
+            if (error) cluster[4 + i % NVM_t::S_USER_DATA_PER_CLUSTER] ^= 0x04;
+            if (NVM_t::eccCorrect(cluster, offset) == SlotNVMECC::CORRECTED) ++corrected;
+        }
+        double ns = timer.elapsedNs();
+        if (corrected != (error ? ops : 0)) {
+            printf("ECC decode failed\n");
+        }
+        printf("%-22s %7u %12.1f %12.2f\n", error ? "ecc decode 1 bit error" : "ecc decode clean",
+               (unsigned)CLUSTER_SIZE, ns / ops, ns / ops / (NVM_t::S_ECC_CNT));
+    }
+}
+
+void runECCDecode() {
+    printf("\nECC decode, %u iterations\n", g_iterations * 100);
+    printf("%-22s %7s %12s %12s\n", "operation", "cluster", "ns/cluster", "ns/byte");
+    benchECCDecode<16>();
+    benchECCDecode<32>();
+    benchECCDecode<64>();
+    benchECCDecode<128>();
+    benchECCDecode<256>();
+}
+
+// JSON like configuration record
+void fillRecord(std::vector<uint8_t> &data) {
+    static const char record[] = "{\"name\":\"sensor\",\"ip\":\"192.168.0.10\",\"mask\":\"255.255.255.0\","
+                                 "\"gw\":\"192.168.0.1\",\"dns\":\"192.168.0.1\",\"interval\":60,\"enabled\":true}";
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = record[i % (sizeof(record) - 1)];
+    }
+}
+
+template <nvm_size_t CLUSTER_SIZE, bool COMPRESS>
+void benchCompressedSlot(nvm_size_t len) {
+    typedef SlotNVM<NVMRAMMock<NVM_SIZE>, CLUSTER_SIZE, 0, 0, &crc8, int, &rand, false, COMPRESS> NVM_t;
+    std::vector<uint8_t> data(len);
+    fillRecord(data);
+
+    NVM_t nvm;
+    nvm.begin();
+#ifdef SLOTNVM_STATS
+    nvm.resetStats();
+#endif
+    Timer timer;
+    for (unsigned i = 0; i < g_iterations; ++i) {
+        nvm.writeSlot(NVM_t::S_FIRST_SLOT, &data[0], len);
+    }
+    double ns = timer.elapsedNs();
+    printResult(COMPRESS ? "writeSlot compressed" : "writeSlot", CLUSTER_SIZE, len, makeResult(nvm, ns, 0, g_iterations));
+
+#ifdef SLOTNVM_STATS
+    nvm.resetStats();
+#endif
+    Timer readTimer;
+    for (unsigned i = 0; i < g_iterations; ++i) {
+        nvm_size_t readLen = len;
+        nvm.readSlot(NVM_t::S_FIRST_SLOT, &data[0], readLen);
+    }
+    ns = readTimer.elapsedNs();
+    printResult(COMPRESS ? "readSlot compressed" : "readSlot", CLUSTER_SIZE, len, makeResult(nvm, ns, 0, g_iterations));
+}
+
+void runCompression() {
+    printf("\nJSON like records with and without compression, %u iterations\n", g_iterations);
+    printHeader();
+    static const nvm_size_t lens[] = { 32, 128, 256 };
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+        benchCompressedSlot<16, false>(lens[i]);
+        benchCompressedSlot<16, true>(lens[i]);
+        benchCompressedSlot<64, false>(lens[i]);
+        benchCompressedSlot<64, true>(lens[i]);
+    }
+}
+
+// slot of many clusters as chain or extent on the I2C EEPROM model, where every call costs a transfer
+template <nvm_size_t CLUSTER_SIZE, bool EXTENTS>
+void benchExtentSlot(nvm_size_t len) {
+    typedef SimulatedNVM<NVM_SIZE, PageLatencyModel, &PageLatencyModel::i2cEEPROM24LC256> BASE_t;
+    typedef SlotNVM<BASE_t, CLUSTER_SIZE, 0, 0, &crc8, int, &rand, false, false, EXTENTS> NVM_t;
+    std::vector<uint8_t> data(len);
+    fillData(data, len);
+
+    NVM_t nvm;
+    nvm.begin();
+#ifdef SLOTNVM_STATS
+    nvm.resetStats();
+#endif
+    uint64_t deviceStart = deviceTime(static_cast<const BASE_t &>(nvm));
+    Timer timer;
+    for (unsigned i = 0; i < g_iterations; ++i) {
+        nvm.writeSlot(NVM_t::S_FIRST_SLOT, &data[0], len);
+    }
+    double ns = timer.elapsedNs();
+    printResult(EXTENTS ? "writeSlot extent" : "writeSlot chain", CLUSTER_SIZE, len,
+                makeResult(nvm, ns, deviceTime(static_cast<const BASE_t &>(nvm)) - deviceStart, g_iterations));
+
+#ifdef SLOTNVM_STATS
+    nvm.resetStats();
+#endif
+    deviceStart = deviceTime(static_cast<const BASE_t &>(nvm));
+    Timer readTimer;
+    for (unsigned i = 0; i < g_iterations; ++i) {
+        nvm_size_t readLen = len;
+        nvm.readSlot(NVM_t::S_FIRST_SLOT, &data[0], readLen);
+    }
+    ns = readTimer.elapsedNs();
+    printResult(EXTENTS ? "readSlot extent" : "readSlot chain", CLUSTER_SIZE, len,
+                makeResult(nvm, ns, deviceTime(static_cast<const BASE_t &>(nvm)) - deviceStart, g_iterations));
+
+    // a 4 byte field near the end, e.g. offset 200 of 256 bytes
+#ifdef SLOTNVM_STATS
+    nvm.resetStats();
+#endif
+    deviceStart = deviceTime(static_cast<const BASE_t &>(nvm));
+    Timer rangeTimer;
+    for (unsigned i = 0; i < g_iterations; ++i) {
+        uint32_t field;
+        nvm.readSlotRange(NVM_t::S_FIRST_SLOT, len - 56, field);
+    }
+    ns = rangeTimer.elapsedNs();
+    printResult(EXTENTS ? "readSlotRange extent" : "readSlotRange chain", CLUSTER_SIZE, len,
+                makeResult(nvm, ns, deviceTime(static_cast<const BASE_t &>(nvm)) - deviceStart, g_iterations));
+}
+
+void runExtents() {
+    printf("\nI2C EEPROM 24LC256, chains and extents, %u iterations\n", g_iterations);
+    printHeader();
+    static const nvm_size_t lens[] = { 64, 256 };
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+        benchExtentSlot<16, false>(lens[i]);
+        benchExtentSlot<16, true>(lens[i]);
+        benchExtentSlot<32, false>(lens[i]);
+        benchExtentSlot<32, true>(lens[i]);
+    }
+}
+
+// one counter update, SlotNVM and LogSlotNVM write the value to a slot
+template <class NVM_t>
+bool updateCounter(NVM_t &nvm, uint32_t i) {
+    return nvm.writeSlot(1, i);
+}
+
+template <class BASE, nvm_size_t BLOCK_SIZE, uint8_t COUNTER_CNT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool updateCounter(CounterNVM<BASE, BLOCK_SIZE, COUNTER_CNT, CRC_FUNC> &nvm, uint32_t i) {
+    return nvm.increment(0);
+}
+
+// counter updated every iteration, SlotNVM against LogSlotNVM and CounterNVM on the I2C EEPROM model
+template <class NVM_t, class BASE_t>
+void benchCounter(const char *name, nvm_size_t size) {
+    NVM_t nvm;
+    nvm.begin();
+#ifdef SLOTNVM_STATS
+    nvm.resetStats();
+#endif
+    uint64_t deviceStart = deviceTime(static_cast<const BASE_t &>(nvm));
+    Timer timer;
+    for (uint32_t i = 0; i < g_iterations; ++i) {
+        updateCounter(nvm, i);
+    }
+    double ns = timer.elapsedNs();
+    std::string op = std::string("counter ") + name;
+    printResult(op.c_str(), size, sizeof(uint32_t),
+                makeResult(nvm, ns, deviceTime(static_cast<const BASE_t &>(nvm)) - deviceStart, g_iterations));
+
+    NVM_t restarted;
+    restarted.m_memory = nvm.m_memory;
+#ifdef SLOTNVM_STATS
+    restarted.resetStats();
+#endif
+    deviceStart = deviceTime(static_cast<const BASE_t &>(restarted));
+    Timer beginTimer;
+    restarted.begin();
+    ns = beginTimer.elapsedNs();
+    op = std::string("begin ") + name;
+    printResult(op.c_str(), size, 0,
+                makeResult(restarted, ns, deviceTime(static_cast<const BASE_t &>(restarted)) - deviceStart, 1));
+}
+
+void runLog() {
+    typedef SimulatedNVM<NVM_SIZE, PageLatencyModel, &PageLatencyModel::i2cEEPROM24LC256> BASE_t;
+    printf("\nI2C EEPROM 24LC256, SlotNVM, LogSlotNVM and CounterNVM, %u iterations\n", g_iterations);
+    printHeader();
+    benchCounter<SlotNVM<BASE_t, 32, 0, 0, &crc8>, BASE_t>("SlotNVM", 32);
+    benchCounter<LogSlotNVM<BASE_t, 256, 64, &crc8>, BASE_t>("LogSlotNVM", 256);
+    benchCounter<CounterNVM<BASE_t, 32, 4, &crc8>, BASE_t>("CounterNVM", 32);
+}
+
+const uint8_t SAMPLE_SLOTS = 50;
+
+// one sample of 8 bytes, SlotNVM rotates over slots
+template <class NVM_t>
+bool logSample(NVM_t &nvm, uint32_t i, const uint8_t *data) {
+    return nvm.writeSlot(1 + i % SAMPLE_SLOTS, data, 8);
+}
+
+template <class BASE, nvm_size_t RECORD_SIZE, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool logSample(RingLogNVM<BASE, RECORD_SIZE, CRC_FUNC> &nvm, uint32_t i, const uint8_t *data) {
+    return nvm.append(data);
+}
+
+// sensor samples logged every iteration on the I2C EEPROM model
+template <class NVM_t, class BASE_t>
+void benchSamples(const char *name, nvm_size_t size) {
+    NVM_t nvm;
+    nvm.begin();
+    std::vector<uint8_t> data(8);
+    for (uint32_t i = 0; i < SAMPLE_SLOTS; ++i) {            // every slot or the ring is used once
+        fillData(data, i);
+        logSample(nvm, i, data.data());
+    }
+#ifdef SLOTNVM_STATS
+    nvm.resetStats();
+#endif
+    uint64_t deviceStart = deviceTime(static_cast<const BASE_t &>(nvm));
+    Timer timer;
+    for (uint32_t i = 0; i < g_iterations; ++i) {
+        fillData(data, i);
+        logSample(nvm, i, data.data());
+    }
+    double ns = timer.elapsedNs();
+    std::string op = std::string("sample ") + name;
+    printResult(op.c_str(), size, data.size(),
+                makeResult(nvm, ns, deviceTime(static_cast<const BASE_t &>(nvm)) - deviceStart, g_iterations));
+
+    NVM_t restarted;
+    restarted.m_memory = nvm.m_memory;
+#ifdef SLOTNVM_STATS
+    restarted.resetStats();
+#endif
+    deviceStart = deviceTime(static_cast<const BASE_t &>(restarted));
+    Timer beginTimer;
+    restarted.begin();
+    ns = beginTimer.elapsedNs();
+    op = std::string("begin ") + name;
+    printResult(op.c_str(), size, 0,
+                makeResult(restarted, ns, deviceTime(static_cast<const BASE_t &>(restarted)) - deviceStart, 1));
+}
+
+void runRing() {
+    typedef SimulatedNVM<NVM_SIZE, PageLatencyModel, &PageLatencyModel::i2cEEPROM24LC256> BASE_t;
+    printf("\nI2C EEPROM 24LC256, SlotNVM with %u slots and RingLogNVM, %u iterations\n", SAMPLE_SLOTS, g_iterations);
+    printHeader();
+    benchSamples<SlotNVM<BASE_t, 32, 0, 0, &crc8>, BASE_t>("SlotNVM", 32);
+    benchSamples<RingLogNVM<BASE_t, 8, &crc8>, BASE_t>("RingLogNVM", 11);
+}
+
+void usage() {
+    fprintf(stderr, "Usage: slotnvm_bench [--quick] [--model ram|eeprom|i2c|fram|nor|all]\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::string model = "ram";
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            g_iterations = 5;
+        } else if ((strcmp(argv[i], "--model") == 0) && (i + 1 < argc)) {
+            model = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    bool all = (model == "all");
+    bool found = false;
+#ifndef SLOTNVM_STATS
+    printf("Build with SLOTNVM_STATS to get NVM access counts.\n");
+#endif
+    if (all || (model == "ram")) {
+        runAllClusterSizes< NVMRAMMock<NVM_SIZE> >("RAM mock");
+        found = true;
+    }
+    if (all || (model == "eeprom")) {
+        runAllClusterSizes< SimulatedNVM<NVM_SIZE, LinearLatencyModel, &LinearLatencyModel::avrEEPROM> >("AVR EEPROM");
+        found = true;
+    }
+    if (all || (model == "i2c")) {
+        runAllClusterSizes< SimulatedNVM<NVM_SIZE, PageLatencyModel, &PageLatencyModel::i2cEEPROM24LC256> >("I2C EEPROM 24LC256");
+        found = true;
+    }
+    if (all || (model == "fram")) {
+        runAllClusterSizes< SimulatedNVM<NVM_SIZE, LinearLatencyModel, &LinearLatencyModel::spiFRAM> >("SPI FRAM");
+        found = true;
+    }
+    if (all || (model == "nor")) {
+        runAllClusterSizes< SimulatedNVM<NVM_SIZE, NORFlashModel, &NORFlashModel::spiNOR25Q> >("SPI NOR flash");
+        found = true;
+    }
+    if (!found) {
+        usage();
+        return 1;
+    }
+    runECCDecode();
+    runCompression();
+    runExtents();
+    runLog();
+    runRing();
+
+    return 0;
+}
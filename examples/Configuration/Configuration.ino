@@ -44,13 +44,14 @@ void setup() {
   }
 
   // Use other slots for your business
-  for (uint8_t slot = 1; slot < CFG_SLOT; ++slot) {
-    if (slotNVM.isSlotAvailable(slot)) {
-      // Do something with this slot
-      Serial.print(F("Slot "));
-      Serial.print(slot);
-      Serial.println(F(" has some data."));
-    }
+  for (auto info : slotNVM.slots()) {
+    if (info.slot == CFG_SLOT) continue;
+    // Do something with this slot
+    Serial.print(F("Slot "));
+    Serial.print(info.slot);
+    Serial.print(F(" has "));
+    Serial.print(info.len);
+    Serial.println(F(" bytes of data."));
   }
 }
 
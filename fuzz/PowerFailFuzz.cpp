@@ -0,0 +1,102 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * libFuzzer entry point, the input is an operation stream, see decodeNVMOperations().
+ * Every stream is run by PowerFailHarness with a power cut before every written byte.
+ * The first input byte selects the SlotNVM configuration.
+ *
+ * Build with clang and -fsanitize=fuzzer, or define SLOTNVM_FUZZ_MAIN to get a main()
+ * which runs all files given as arguments, e.g. to reproduce a crash with an other compiler.
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <string>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "NVMRAMMock.h"
+#include "PowerFailHarness.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const size_t MAX_OPS = 16;
+
+uint8_t crc8(uint8_t crc, uint8_t data) {
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; ++i) {
+        crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+    }
+    return crc;
+}
+
+typedef uint8_t (*CRC_t)(uint8_t, uint8_t);
+
+template <class T>
+void fuzz(const uint8_t *data, size_t size) {
+    std::vector<NVMOperation> ops;
+    decodeNVMOperations(data, size, T::S_LAST_SLOT, 256, MAX_OPS, ops);
+
+    PowerFailHarness<T> harness(1);
+    if (!harness.run(ops)) {
+        fprintf(stderr, "Power fail at operation %u cut %u: %s\n", (unsigned)harness.getFailure().op,
+                harness.getFailure().cut, harness.getFailure().msg.c_str());
+        abort();
+    }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 1) return 0;
+    switch (data[0] % 4) {
+    case 0: fuzz< SlotNVM<NVMRAMMock<256>, 16, 0, 0, (CRC_t)NULL, int, &powerFailRandom> >(data + 1, size - 1); break;
+    case 1: fuzz< SlotNVM<NVMRAMMock<256>, 16, 0, 0, &crc8, int, &powerFailRandom> >(data + 1, size - 1); break;
+    case 2: fuzz< SlotNVM<NVMRAMMock<1024>, 32, 64, 0, &crc8, int, &powerFailRandom> >(data + 1, size - 1); break;
+    case 3: fuzz< SlotNVM<NVMRAMMock<1024>, 64, 0, 8, (CRC_t)NULL, int, &powerFailRandom> >(data + 1, size - 1); break;
+    }
+    return 0;
+}
+
+#ifdef SLOTNVM_FUZZ_MAIN
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            fprintf(stderr, "can not open %s\n", argv[i]);
+            return 1;
+        }
+        std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        printf("%s: OK\n", argv[i]);
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,183 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_CONCURRENTSLOTNVM_H_
+#define _SLOTNVM_CONCURRENTSLOTNVM_H_
+
+#ifndef __AVR_ARCH__
+
+#include <stdint.h>
+#include <mutex>
+#include <shared_mutex>
+#include "NVMBase.h"
+
+/**
+ * Thread-safe access to a SlotNVM for hosts like a Linux gateway (needs C++14).
+ * Readers share the lock, so several threads can read at the same time,
+ * writers get exclusive access.
+ * Do not access the SlotNVM directly while using this class.
+ *
+ * The NVM access class must allow concurrent reads, e.g. use pread() for a file.
+ * Statistics (SLOTNVM_STATS) are counted atomically, resetStats() must not be called while other threads access the NVM.
+ *
+ * @tparam NVM      SlotNVM class to protect.
+ * @tparam MUTEX    Shared mutex class with lock(), unlock(), lock_shared() and unlock_shared().
+ */
+template <class NVM, class MUTEX = std::shared_timed_mutex>
+class ConcurrentSlotNVM {
+public:
+    /**
+     * @param nvm   SlotNVM to protect.
+     */
+    explicit ConcurrentSlotNVM(NVM &nvm) : m_nvm(nvm) {}
+
+    /**
+     * Initialize SlotNVM.
+     * See SlotNVM::begin().
+     */
+    bool begin() {
+        std::lock_guard<MUTEX> lock(m_mutex);
+        return m_nvm.begin();
+    }
+
+    /**
+     * Check if begin is called before and returns true.
+     * See SlotNVM::isValid().
+     */
+    bool isValid() const {
+        std::shared_lock<MUTEX> lock(m_mutex);
+        return m_nvm.isValid();
+    }
+
+    /**
+     * Check if data is stored for a given slot.
+     * See SlotNVM::isSlotAvailable().
+     */
+    bool isSlotAvailable(uint8_t slot) const {
+        std::shared_lock<MUTEX> lock(m_mutex);
+        return m_nvm.isSlotAvailable(slot);
+    }
+
+    /**
+     * Write data, other readers and writers wait until it is done.
+     * See SlotNVM::writeSlot().
+     */
+    bool writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+        std::lock_guard<MUTEX> lock(m_mutex);
+        return m_nvm.writeSlot(slot, data, len);
+    }
+
+    /**
+     * Write data, other readers and writers wait until it is done.
+     * See SlotNVM::writeSlot().
+     */
+    template <class T>
+    bool writeSlot(uint8_t slot, T &data) {
+      return writeSlot(slot, (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Append data, other readers and writers wait until it is done.
+     * See SlotNVM::appendSlot().
+     */
+    bool appendSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+        std::lock_guard<MUTEX> lock(m_mutex);
+        return m_nvm.appendSlot(slot, data, len);
+    }
+
+    /**
+     * Read data, can run parallel to other reads.
+     * See SlotNVM::readSlot().
+     */
+    bool readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) const {
+        std::shared_lock<MUTEX> lock(m_mutex);
+        return m_nvm.readSlot(slot, data, len);
+    }
+
+    /**
+     * Read data, can run parallel to other reads.
+     * Size check and read are done under the same lock.
+     * See SlotNVM::readSlot().
+     */
+    template <class T>
+    bool readSlot(uint8_t slot, T &data) const {
+        std::shared_lock<MUTEX> lock(m_mutex);
+        return m_nvm.readSlot(slot, data);
+    }
+
+    /**
+     * Read a part of slot data, can run parallel to other reads.
+     * See SlotNVM::readSlotRange().
+     */
+    bool readSlotRange(uint8_t slot, nvm_size_t offset, uint8_t *data, nvm_size_t len) const {
+        std::shared_lock<MUTEX> lock(m_mutex);
+        return m_nvm.readSlotRange(slot, offset, data, len);
+    }
+
+    /**
+     * Read data of several slots, all slots are read under the same lock.
+     * See SlotNVM::readSlots().
+     */
+    bool readSlots(uint8_t cnt, const uint8_t slots[], uint8_t *data[], nvm_size_t len[]) const {
+        std::shared_lock<MUTEX> lock(m_mutex);
+        return m_nvm.readSlots(cnt, slots, data, len);
+    }
+
+    /**
+     * Delete slot data, other readers and writers wait until it is done.
+     * See SlotNVM::eraseSlot().
+     */
+    bool eraseSlot(uint8_t slot) {
+        std::lock_guard<MUTEX> lock(m_mutex);
+        return m_nvm.eraseSlot(slot);
+    }
+
+    /**
+     * Get amount of total available user data.
+     * See SlotNVM::getSize().
+     */
+    nvm_size_t getSize() const {
+        return m_nvm.getSize();
+    }
+
+    /**
+     * Get amount of total usable user data.
+     * See SlotNVM::getUsableSize().
+     */
+    nvm_size_t getUsableSize() const {
+        return m_nvm.getUsableSize();
+    }
+
+    /**
+     * Get amount of free user data.
+     * See SlotNVM::getFree().
+     */
+    nvm_size_t getFree() const {
+        std::shared_lock<MUTEX> lock(m_mutex);
+        return m_nvm.getFree();
+    }
+
+    /**
+     * Call func for every stored slot, writers wait until all slots are visited.
+     * @param func  Function or lambda called with a const NVM::SlotInfo &, see SlotNVM::slots().
+     */
+    template <class FUNC>
+    void forEachSlot(FUNC func) const {
+        std::shared_lock<MUTEX> lock(m_mutex);
+        for (const typename NVM::SlotInfo &info : m_nvm.slots()) {
+            func(info);
+        }
+    }
+
+private:
+    NVM             &m_nvm;
+    mutable MUTEX   m_mutex;
+};
+
+#endif // __AVR_ARCH__
+
+#endif // _SLOTNVM_CONCURRENTSLOTNVM_H_
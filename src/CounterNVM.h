@@ -0,0 +1,291 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_COUNTERNVM_H_
+#define _SLOTNVM_COUNTERNVM_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "NVMBase.h"
+#include "SlotNVMStats.h"
+
+/*
+ * The NVM is split into blocks, every counter gets S_BLOCKS_PER_COUNTER blocks in a row used as ring.
+ * The newest valid block of a counter holds its value.
+ *
+ * Block
+ *  0       Magic 0xC5, other values mark an unused block
+ *  1/2     Sequence number (little endian), increased by one for every new block of a counter
+ *  3..6    Base value (little endian)
+ *  7       CRC-8 of byte 0..6
+ *  8..     Unary area, every increment clears one more bit from bit 0 of byte 8 up to bit 7 of the last byte
+ *
+ * The value is the base value plus the count of cleared bits. An increment writes the one byte with the next
+ * cleared bit. If all bits are cleared the next block is written with the new value as base value and all bits
+ * of the unary area set. Its magic is cleared first and written last, so the old block stays the newest one
+ * until the new one is complete.
+ */
+
+/**
+ * Persistent counters with cheap increments, e.g. to count starts or operating hours.
+ *
+ * Writing a counter with SlotNVM::writeSlot() allocates and writes a new cluster for every increment.
+ * Here an increment clears one bit in the unary area of the current block, a single byte write.
+ * Only every (BLOCK_SIZE - 8) * 8 increments the next block is written. So the writes are spread over
+ * all blocks of a counter. get() needs no NVM access, the values are kept in RAM.
+ *
+ * The blocks take all of the NVM of BASE. An increment rewrites a byte of the unary area in place, so BASE must
+ * write single bytes without erase, like an EEPROM or FRAM.
+ * Needs 10 bytes RAM per counter, writing a new block needs BLOCK_SIZE bytes of stack.
+ *
+ * @tparam BASE             Base class handling NVM read and write, see NVMBase as example.
+ * @tparam BLOCK_SIZE       Size of a block in bytes, 16 .. 256. Typical values are 16, 32, 64.
+ * @tparam COUNTER_CNT      Count of counters 1 .. 250, at least 2 blocks are needed per counter.
+ * @tparam CRC_FUNC         Function to calculate a 8 bit CRC, see SlotNVM.
+ */
+template <class BASE, nvm_size_t BLOCK_SIZE, uint8_t COUNTER_CNT, uint8_t (*CRC_FUNC)(uint8_t crc, uint8_t data)>
+class CounterNVM : private CountingNVM<BASE> {
+public:
+    /// Count of blocks of one counter.
+    static const uint16_t S_BLOCKS_PER_COUNTER = (BASE::S_SIZE / BLOCK_SIZE) / COUNTER_CNT;
+    /// Count of increments written to one block before the next block is used.
+    static const uint16_t S_STEPS_PER_BLOCK = (BLOCK_SIZE - 8) * 8;
+private:
+    static const uint8_t S_MAGIC = 0xC5;
+    static const uint8_t S_HEADER = 8;
+
+    static_assert(CRC_FUNC != NULL, "CounterNVM needs a CRC_FUNC.");
+    static_assert((BLOCK_SIZE >= 16) && (BLOCK_SIZE <= 256), "BLOCK_SIZE must be 16 .. 256.");
+    static_assert((COUNTER_CNT >= 1) && (COUNTER_CNT <= 250), "COUNTER_CNT must be 1 .. 250.");
+    static_assert((S_BLOCKS_PER_COUNTER >= 2) && (S_BLOCKS_PER_COUNTER <= 256), "2 .. 256 blocks per counter are supported.");
+
+public:
+    CounterNVM();
+
+    /**
+     * Initialize CounterNVM.
+     * Call this once before every other call. Reads the block headers of all counters
+     * and the unary area of the newest block of every counter.
+     * @return  true if NVM data is readable, false if not or begin() is called twice.
+     */
+    bool begin();
+
+    /**
+     * Check if begin is called before and returns true.
+     * @return  true if CounterNVM is ready for use.
+     */
+    bool isValid() const {
+        return m_initDone;
+    }
+
+    /**
+     * Get the value of a counter, no NVM access.
+     * A counter never written is 0.
+     * @param       counter Counter number 0 .. COUNTER_CNT - 1
+     * @param[out]  value   Value of the counter
+     * @return      true on success else false
+     */
+    bool get(uint8_t counter, uint32_t &value) const;
+
+    /**
+     * Increment a counter by one, a single byte write most of the times.
+     * This is power fail safe, after a power loss the counter has the old or the new value.
+     * @param counter   Counter number 0 .. COUNTER_CNT - 1
+     * @return          true on success else false
+     */
+    bool increment(uint8_t counter);
+
+    /**
+     * Set a counter to any value, e.g. 0 to reset it. The next block is written.
+     * This is power fail safe, after a power loss the counter has the old or the new value.
+     * @param counter   Counter number 0 .. COUNTER_CNT - 1
+     * @param value     New value
+     * @return          true on success else false
+     */
+    bool set(uint8_t counter, uint32_t value);
+
+#ifdef SLOTNVM_STATS
+    /**
+     * Get statistics of NVM access, see SlotNVM::getStats().
+     * Only reads, writes, bytesRead, bytesWritten and crcErrors are counted,
+     * crcErrors counts blocks with magic but wrong CRC found by begin().
+     */
+    using CountingNVM<BASE>::getStats;
+
+    /**
+     * Set all statistics to 0.
+     */
+    using CountingNVM<BASE>::resetStats;
+#endif
+
+private:
+    struct Counter {
+        uint32_t    base;                           // base value of the newest block
+        uint16_t    seq;                            // sequence number of the newest block
+        uint16_t    steps;                          // cleared bits in the newest block
+        uint8_t     block;                          // newest block, index inside the blocks of the counter
+        bool        used;                           // false if no block is written
+    };
+
+    bool            m_initDone;
+    Counter         m_counters[COUNTER_CNT];
+    inline static nvm_address_t blockAddr(uint8_t counter, uint8_t block) {
+        return (counter * S_BLOCKS_PER_COUNTER + block) * BLOCK_SIZE;
+    }
+
+    inline static uint8_t crc_buf(uint8_t crc, const uint8_t *data, nvm_size_t len) {
+        for (nvm_size_t i = 0; i < len; ++i) {
+            crc = CRC_FUNC(crc, data[i]);
+        }
+        return crc;
+    }
+
+    // count of cleared bits
+    inline static uint8_t clearedBits(uint8_t d) {
+        uint8_t cnt = 0;
+        for (d = ~d; d != 0; d &= d - 1) {
+            ++cnt;
+        }
+        return cnt;
+    }
+
+    bool readBlock(uint8_t counter, uint8_t block, bool &valid, uint16_t &seq, uint32_t &base) const;
+
+    bool writeBlock(uint8_t counter, uint32_t base);
+};
+
+
+template <class BASE, nvm_size_t BLOCK_SIZE, uint8_t COUNTER_CNT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+CounterNVM<BASE, BLOCK_SIZE, COUNTER_CNT, CRC_FUNC>::CounterNVM()
+    : m_initDone(false)
+    , m_counters()
+{
+}
+
+template <class BASE, nvm_size_t BLOCK_SIZE, uint8_t COUNTER_CNT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool CounterNVM<BASE, BLOCK_SIZE, COUNTER_CNT, CRC_FUNC>::begin() {
+    if (m_initDone) return false;
+
+    for (uint8_t counter = 0; counter < COUNTER_CNT; ++counter) {
+        Counter &c = m_counters[counter];
+
+        // the newest block holds the value
+        for (uint16_t block = 0; block < S_BLOCKS_PER_COUNTER; ++block) {
+            bool valid;
+            uint16_t seq;
+            uint32_t base;
+            bool res = readBlock(counter, block, valid, seq, base);
+            if (!res) return false;
+            if (!valid) continue;
+            if (!c.used || ((int16_t)(seq - c.seq) > 0)) {
+                c.base = base;
+                c.seq = seq;
+                c.block = block;
+                c.used = true;
+            }
+        }
+
+        // count the cleared bits
+        if (c.used) {
+            uint8_t unary[BLOCK_SIZE - S_HEADER];
+            bool res = this->read(blockAddr(counter, c.block) + S_HEADER, unary, sizeof(unary));
+            if (!res) return false;
+            for (nvm_size_t i = 0; i < sizeof(unary); ++i) {
+                c.steps += clearedBits(unary[i]);
+            }
+        }
+    }
+
+    m_initDone = true;
+
+    return m_initDone;
+}
+
+template <class BASE, nvm_size_t BLOCK_SIZE, uint8_t COUNTER_CNT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool CounterNVM<BASE, BLOCK_SIZE, COUNTER_CNT, CRC_FUNC>::get(uint8_t counter, uint32_t &value) const {
+    if (!m_initDone) return false;
+    if (counter >= COUNTER_CNT) return false;
+    const Counter &c = m_counters[counter];
+    value = c.base + c.steps;
+    return true;
+}
+
+template <class BASE, nvm_size_t BLOCK_SIZE, uint8_t COUNTER_CNT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool CounterNVM<BASE, BLOCK_SIZE, COUNTER_CNT, CRC_FUNC>::increment(uint8_t counter) {
+    if (!m_initDone) return false;
+    if (counter >= COUNTER_CNT) return false;
+    Counter &c = m_counters[counter];
+    if (!c.used || (c.steps >= S_STEPS_PER_BLOCK)) {
+        return writeBlock(counter, c.base + c.steps + 1);
+    }
+
+    // clear the next bit, all lower bits of this byte are already cleared
+    nvm_address_t addr = blockAddr(counter, c.block) + S_HEADER + c.steps / 8;
+    bool res = this->write(addr, (uint8_t)(0xFF << (c.steps % 8 + 1)));
+    if (!res) return false;
+    ++c.steps;
+    return true;
+}
+
+template <class BASE, nvm_size_t BLOCK_SIZE, uint8_t COUNTER_CNT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool CounterNVM<BASE, BLOCK_SIZE, COUNTER_CNT, CRC_FUNC>::set(uint8_t counter, uint32_t value) {
+    if (!m_initDone) return false;
+    if (counter >= COUNTER_CNT) return false;
+    return writeBlock(counter, value);
+}
+
+template <class BASE, nvm_size_t BLOCK_SIZE, uint8_t COUNTER_CNT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool CounterNVM<BASE, BLOCK_SIZE, COUNTER_CNT, CRC_FUNC>::readBlock(uint8_t counter, uint8_t block, bool &valid, uint16_t &seq, uint32_t &base) const {
+    uint8_t header[S_HEADER];
+    bool res = this->read(blockAddr(counter, block), header, S_HEADER);
+    if (!res) return false;
+    valid = (header[0] == S_MAGIC) && (header[S_HEADER - 1] == crc_buf(0, header, S_HEADER - 1));
+    if ((header[0] == S_MAGIC) && !valid) {
+        _SLOTNVM_STATS_ADD_(crcErrors, 1);
+    }
+    seq = header[1] | (header[2] << 8);
+    base = (uint32_t)header[3] | ((uint32_t)header[4] << 8) | ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 24);
+    return true;
+}
+
+template <class BASE, nvm_size_t BLOCK_SIZE, uint8_t COUNTER_CNT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool CounterNVM<BASE, BLOCK_SIZE, COUNTER_CNT, CRC_FUNC>::writeBlock(uint8_t counter, uint32_t base) {
+    Counter &c = m_counters[counter];
+    uint8_t block = c.used ? (c.block + 1) % S_BLOCKS_PER_COUNTER : 0;
+    uint16_t seq = c.used ? c.seq + 1 : 0;
+    nvm_address_t addr = blockAddr(counter, block);
+
+    // an old block at this position must not be found while it is written
+    bool res = this->write(addr, 0x00);
+    if (!res) return false;
+
+    uint8_t buf[BLOCK_SIZE];
+    buf[0] = S_MAGIC;
+    buf[1] = seq;
+    buf[2] = seq >> 8;
+    buf[3] = base;
+    buf[4] = base >> 8;
+    buf[5] = base >> 16;
+    buf[6] = base >> 24;
+    buf[7] = crc_buf(0, buf, S_HEADER - 1);
+    memset(buf + S_HEADER, 0xFF, BLOCK_SIZE - S_HEADER);
+    res = this->write(addr + 1, buf + 1, BLOCK_SIZE - 1);
+    if (!res) return false;
+
+    // now make block valid
+    res = this->write(addr, buf[0]);
+    if (!res) return false;
+
+    c.base = base;
+    c.seq = seq;
+    c.steps = 0;
+    c.block = block;
+    c.used = true;
+    return true;
+}
+
+#endif // _SLOTNVM_COUNTERNVM_H_
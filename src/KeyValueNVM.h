@@ -0,0 +1,347 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_KEYVALUENVM_H_
+#define _SLOTNVM_KEYVALUENVM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "NVMBase.h"
+
+/**
+ * Values addressed by string or 32 bit keys instead of slot numbers, stored in slots of a SlotNVM.
+ *
+ * Every key gets a data slot of the SlotNVM, the mapping of keys to data slots is stored in a directory.
+ * A string key is mapped to a 32 bit key by hashKey() (FNV-1a), different keys must have different hashes.
+ * Key k uses directory slot k % DIR_CNT, so a new key rewrites only one directory slot.
+ * A directory slot holds 5 bytes per key:
+ *  0..3    Key (little endian)
+ *  4       Data slot
+ * A new key writes its data slot first and then the directory, erasing a key removes it from the directory first.
+ * So after a power loss a key has the old or the new state. A data slot which is not in the directory
+ * is left by a power loss and is erased by begin().
+ *
+ * begin() reads the directory once and builds a hash table in RAM, so finding the data slot of a key
+ * needs no NVM access. RAM usage is about 6 * DATA_CNT bytes.
+ *
+ * The SlotNVM slots DIR_FIRST .. DIR_FIRST + DIR_CNT - 1 are used for the directory and
+ * DATA_FIRST .. DATA_FIRST + DATA_CNT - 1 for the data, all other slots can be used directly,
+ * but call begin() of this class instead of SlotNVM::begin().
+ *
+ * @tparam NVM          SlotNVM class.
+ * @tparam DIR_FIRST    First SlotNVM slot used for the directory.
+ * @tparam DIR_CNT      Count of SlotNVM slots used for the directory, one holds up to 51 keys.
+ * @tparam DATA_FIRST   First SlotNVM slot used for data.
+ * @tparam DATA_CNT     Count of SlotNVM slots used for data, this is the max. count of keys.
+ */
+template <class NVM, uint8_t DIR_FIRST, uint8_t DIR_CNT, uint8_t DATA_FIRST, uint8_t DATA_CNT>
+class KeyValueNVM {
+    static_assert(DIR_CNT > 0, "At least one directory slot is needed.");
+    static_assert(DATA_CNT > 0, "At least one data slot is needed.");
+    static_assert((DIR_FIRST >= NVM::S_FIRST_SLOT) && (DIR_FIRST + DIR_CNT - 1 <= NVM::S_LAST_SLOT), "Directory must be valid slots of NVM.");
+    static_assert((DATA_FIRST >= NVM::S_FIRST_SLOT) && (DATA_FIRST + DATA_CNT - 1 <= NVM::S_LAST_SLOT), "Data must be valid slots of NVM.");
+    static_assert((DIR_FIRST + DIR_CNT <= DATA_FIRST) || (DATA_FIRST + DATA_CNT <= DIR_FIRST), "Directory and data slots must not overlap.");
+
+private:
+    static const uint8_t S_ENTRY_SIZE = 5;
+    static const nvm_size_t S_DIR_SIZE = (256 / S_ENTRY_SIZE) * S_ENTRY_SIZE;
+    static const uint16_t S_TABLE_SIZE = 2 * DATA_CNT;     // at most half used, so probing stays short
+
+public:
+    /// Max. count of keys.
+    static const uint8_t S_MAX_KEYS = DATA_CNT;
+
+    /**
+     * @param nvm   SlotNVM storing directory and data.
+     */
+    explicit KeyValueNVM(NVM &nvm) : m_nvm(nvm), m_keyCnt(0) {
+        memset(m_keys, 0, sizeof(m_keys));
+        memset(m_used, 0, sizeof(m_used));
+        memset(m_table, 0, sizeof(m_table));
+    }
+
+    /**
+     * Hash of a string key, 32 bit FNV-1a.
+     * @param key   Zero terminated string
+     * @return      32 bit key
+     */
+    static uint32_t hashKey(const char *key) {
+        uint32_t hash = 2166136261UL;
+        while (*key != '\0') {
+            hash ^= (uint8_t)*key++;
+            hash *= 16777619UL;
+        }
+        return hash;
+    }
+
+    /**
+     * Initialize the SlotNVM, read the directory and erase data slots left by a power loss.
+     * If a directory slot can not be read, false is returned and nothing is erased,
+     * because the data slots of its keys can not be told from the ones left by a power loss.
+     * See SlotNVM::begin().
+     */
+    bool begin() {
+        if (!m_nvm.begin()) return false;
+        uint8_t dir[S_DIR_SIZE];
+        for (uint8_t d = 0; d < DIR_CNT; ++d) {
+            if (!m_nvm.isSlotAvailable(DIR_FIRST + d)) continue;         // no key in this directory
+            nvm_size_t len = sizeof(dir);
+            if (!m_nvm.readSlot(DIR_FIRST + d, dir, len)) return false;
+            for (nvm_size_t pos = 0; pos + S_ENTRY_SIZE <= len; pos += S_ENTRY_SIZE) {
+                uint32_t key = getKey(dir + pos);
+                uint8_t slot = dir[pos + 4];
+                if ((slot < DATA_FIRST) || (slot >= DATA_FIRST + DATA_CNT)) continue;
+                if ((dirOf(key) != d) || isUsed(slot - DATA_FIRST)) continue;
+                uint8_t idx;
+                if (findKey(key, idx)) continue;
+                addKey(key, slot - DATA_FIRST);
+            }
+        }
+
+        for (uint8_t idx = 0; idx < DATA_CNT; ++idx) {
+            if (!isUsed(idx) && m_nvm.isSlotAvailable(DATA_FIRST + idx)) {
+                m_nvm.eraseSlot(DATA_FIRST + idx);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Check if begin is called before and returns true.
+     * See SlotNVM::isValid().
+     */
+    bool isValid() const {
+        return m_nvm.isValid();
+    }
+
+    /**
+     * Get count of stored keys, no NVM access.
+     */
+    uint8_t getKeyCount() const {
+        return m_keyCnt;
+    }
+
+    /**
+     * Check if a value is stored for a key, no NVM access.
+     * @param key   32 bit key
+     * @return      true if there is a value for this key.
+     */
+    bool isKeyAvailable(uint32_t key) const {
+        uint8_t idx;
+        return findKey(key, idx);
+    }
+
+    /**
+     * Check if a value is stored for a key, see isKeyAvailable().
+     */
+    bool isKeyAvailable(const char *key) const {
+        return isKeyAvailable(hashKey(key));
+    }
+
+    /**
+     * Write the value of a key.
+     * An existing key just rewrites its data slot, a new key also rewrites one directory slot.
+     * See SlotNVM::writeSlot().
+     * @return false if there is no free data slot or no space in the directory slot anymore
+     */
+    bool writeValue(uint32_t key, const uint8_t *data, nvm_size_t len) {
+        if (!isValid()) return false;
+        if ((data == NULL) || (len < 1)) return false;
+        uint8_t idx;
+        if (findKey(key, idx)) {
+            return m_nvm.writeSlot(DATA_FIRST + idx, data, len);
+        }
+
+        // data first, a power loss before the directory is written leaves an unused data slot
+        if (!findFreeIndex(idx)) return false;
+        uint8_t dir[S_DIR_SIZE];
+        nvm_size_t dirLen;
+        if (!readDir(key, dir, dirLen)) return false;
+        if (dirLen + S_ENTRY_SIZE > S_DIR_SIZE) return false;
+        if (!m_nvm.writeSlot(DATA_FIRST + idx, data, len)) return false;
+
+        dir[dirLen] = key;
+        dir[dirLen + 1] = key >> 8;
+        dir[dirLen + 2] = key >> 16;
+        dir[dirLen + 3] = key >> 24;
+        dir[dirLen + 4] = DATA_FIRST + idx;
+        if (!m_nvm.writeSlot(DIR_FIRST + dirOf(key), dir, dirLen + S_ENTRY_SIZE)) {
+            m_nvm.eraseSlot(DATA_FIRST + idx);
+            return false;
+        }
+        addKey(key, idx);
+        return true;
+    }
+
+    /**
+     * Write the value of a key, see writeValue().
+     */
+    bool writeValue(const char *key, const uint8_t *data, nvm_size_t len) {
+        return writeValue(hashKey(key), data, len);
+    }
+
+    /**
+     * Write the value of a key, see writeValue().
+     */
+    template <class T>
+    bool writeValue(uint32_t key, T &data) {
+      return writeValue(key, (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Write the value of a key, see writeValue().
+     */
+    template <class T>
+    bool writeValue(const char *key, T &data) {
+      return writeValue(hashKey(key), (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Read the value of a key, only its data slot is read.
+     * See SlotNVM::readSlot().
+     */
+    bool readValue(uint32_t key, uint8_t *data, nvm_size_t &len) const {
+        uint8_t idx;
+        if (!findKey(key, idx)) return false;
+        return m_nvm.readSlot(DATA_FIRST + idx, data, len);
+    }
+
+    /**
+     * Read the value of a key, see readValue().
+     */
+    bool readValue(const char *key, uint8_t *data, nvm_size_t &len) const {
+        return readValue(hashKey(key), data, len);
+    }
+
+    /**
+     * Read the value of a key, see readValue().
+     */
+    template <class T>
+    bool readValue(uint32_t key, T &data) const {
+      nvm_size_t len = sizeof(T);
+      return readValue(key, (uint8_t *)&data, len) && (len == sizeof(T));
+    }
+
+    /**
+     * Read the value of a key, see readValue().
+     */
+    template <class T>
+    bool readValue(const char *key, T &data) const {
+      return readValue(hashKey(key), data);
+    }
+
+    /**
+     * Delete a key and its value, the directory slot is rewritten or erased if it gets empty.
+     * See SlotNVM::eraseSlot().
+     */
+    bool eraseKey(uint32_t key) {
+        uint8_t idx;
+        if (!findKey(key, idx)) return false;
+        uint8_t dir[S_DIR_SIZE];
+        nvm_size_t dirLen;
+        if (!readDir(key, dir, dirLen)) return false;
+
+        for (nvm_size_t pos = 0; pos + S_ENTRY_SIZE <= dirLen; pos += S_ENTRY_SIZE) {
+            if (getKey(dir + pos) == key) {
+                memmove(dir + pos, dir + pos + S_ENTRY_SIZE, dirLen - pos - S_ENTRY_SIZE);
+                dirLen -= S_ENTRY_SIZE;
+                break;
+            }
+        }
+        bool res;
+        if (dirLen == 0) {
+            res = m_nvm.eraseSlot(DIR_FIRST + dirOf(key));
+        } else {
+            res = m_nvm.writeSlot(DIR_FIRST + dirOf(key), dir, dirLen);
+        }
+        if (!res) return false;
+        removeKey(idx);
+
+        // ignore the result, a data slot not in the directory is erased by begin()
+        m_nvm.eraseSlot(DATA_FIRST + idx);
+        return true;
+    }
+
+    /**
+     * Delete a key and its value, see eraseKey().
+     */
+    bool eraseKey(const char *key) {
+        return eraseKey(hashKey(key));
+    }
+
+private:
+    NVM         &m_nvm;
+    uint8_t     m_keyCnt;
+    uint32_t    m_keys[DATA_CNT];                   // key of every used data slot
+    uint8_t     m_used[(DATA_CNT + 7) / 8];         // one bit per used data slot
+    uint8_t     m_table[S_TABLE_SIZE];              // index of data slot + 1, 0 if empty, linear probing
+
+    static inline uint8_t dirOf(uint32_t key) {
+        return key % DIR_CNT;
+    }
+
+    static inline uint32_t getKey(const uint8_t *entry) {
+        return (uint32_t)entry[0] | ((uint32_t)entry[1] << 8) | ((uint32_t)entry[2] << 16) | ((uint32_t)entry[3] << 24);
+    }
+
+    inline bool isUsed(uint8_t idx) const {
+        return (m_used[idx / 8] & (1 << (idx % 8))) != 0;
+    }
+
+    bool findKey(uint32_t key, uint8_t &idx) const {
+        for (uint16_t i = key % S_TABLE_SIZE; m_table[i] != 0; i = (i + 1) % S_TABLE_SIZE) {
+            if (m_keys[m_table[i] - 1] == key) {
+                idx = m_table[i] - 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool findFreeIndex(uint8_t &idx) const {
+        if (m_keyCnt >= DATA_CNT) return false;
+        for (idx = 0; idx < DATA_CNT; ++idx) {
+            if (!isUsed(idx)) return true;
+        }
+        return false;
+    }
+
+    void addKey(uint32_t key, uint8_t idx) {
+        m_keys[idx] = key;
+        m_used[idx / 8] |= 1 << (idx % 8);
+        uint16_t i = key % S_TABLE_SIZE;
+        while (m_table[i] != 0) {
+            i = (i + 1) % S_TABLE_SIZE;
+        }
+        m_table[i] = idx + 1;
+        ++m_keyCnt;
+    }
+
+    // remove and insert all other keys again, so no probing sequence is broken
+    void removeKey(uint8_t idx) {
+        m_used[idx / 8] &= ~(1 << (idx % 8));
+        memset(m_table, 0, sizeof(m_table));
+        m_keyCnt = 0;
+        for (uint8_t i = 0; i < DATA_CNT; ++i) {
+            if (isUsed(i)) {
+                addKey(m_keys[i], i);
+            }
+        }
+    }
+
+    // read the directory slot of a key, an empty directory slot is no error
+    bool readDir(uint32_t key, uint8_t dir[S_DIR_SIZE], nvm_size_t &dirLen) const {
+        uint8_t nvmSlot = DIR_FIRST + dirOf(key);
+        dirLen = 0;
+        if (!m_nvm.isSlotAvailable(nvmSlot)) return m_nvm.isValid();
+        dirLen = S_DIR_SIZE;
+        return m_nvm.readSlot(nvmSlot, dir, dirLen);
+    }
+};
+
+#endif // _SLOTNVM_KEYVALUENVM_H_
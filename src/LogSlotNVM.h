@@ -0,0 +1,579 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_LOGSLOTNVM_H_
+#define _SLOTNVM_LOGSLOTNVM_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "NVMBase.h"
+#include "SlotNVMStats.h"
+
+/*
+ * The NVM is split into segments used as ring, the used segments go from the oldest (tail) to the newest (head).
+ *
+ * Segment
+ *  0       Magic 0x5B, other values mark a free segment
+ *  1/2     Sequence number (little endian), increased by one for every new head
+ *  3       CRC-8 of byte 0..2
+ *  4..     Records
+ *
+ * Record
+ *  0       Slot No. (1 .. LAST_SLOT), other values end the records of a segment
+ *  1       Bit 7   - slot is erased, set in the latest record by eraseSlot(), not part of the CRC
+ *          Bit 0-6 - version, increased every time the slot is written
+ *  2       Size of data - 1
+ *  3..n-2  Data
+ *  n-1     CRC-8 of byte 0..n-2 with bit 7 of byte 1 as 0
+ *
+ * A record is written behind the last one, where the end marker 0x00 of the last one is. Byte 1..n-1 are
+ * written first together with a new end marker behind them, so old records of an earlier use of the segment
+ * are never found. The slot number is written last into the old end marker and makes the record valid,
+ * a single byte write, so a partially written record is never taken even if its CRC matches by chance.
+ * The magic of a segment header is written last the same way.
+ */
+
+/**
+ * Log-structured alternative to SlotNVM for write heavy slots like counters.
+ *
+ * Every write appends a record to the head segment, nothing is rewritten in place, so writes are sequential
+ * and spread over the whole NVM. begin() reads all records once from the oldest to the newest segment and
+ * keeps the address of the latest record of every slot in RAM, so readSlot() needs no search.
+ *
+ * One segment is always kept free. If the head segment is full and only this one is left,
+ * the oldest segment is compacted: its latest records are copied to the head and the segment becomes free.
+ * So one write copies at most one segment. A write fails if the latest records of all slots do not fit anymore,
+ * eraseSlot() needs no free space.
+ *
+ * The erased flag of a record and the end marker are written in place, so BASE must write single bytes
+ * without erase, like an EEPROM or FRAM. Needs 2 bytes RAM per slot.
+ *
+ * @tparam BASE             Base class handling NVM read and write, see NVMBase as example.
+ * @tparam SEGMENT_SIZE     Size of a segment in bytes, at least 16. Typical values are 128, 256, 512.
+ *                          The max. slot size is SEGMENT_SIZE - 8, but not more than 256.
+ * @tparam LAST_SLOT        Number of last usable slot, 1 .. 250.
+ * @tparam CRC_FUNC         Function to calculate a 8 bit CRC, see SlotNVM.
+ */
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t crc, uint8_t data)>
+class LogSlotNVM : private CountingNVM<BASE> {
+public:
+    /// Count of segments.
+    static const uint16_t S_SEGMENT_CNT = BASE::S_SIZE / SEGMENT_SIZE;
+    /// First allowed slot number.
+    static const uint8_t S_FIRST_SLOT = 1;
+    /// Last allowed slot number.
+    static const uint8_t S_LAST_SLOT = LAST_SLOT;
+    /// Max. data size of one slot.
+    static const nvm_size_t S_MAX_LEN = (SEGMENT_SIZE - 8 > 256) ? 256 : SEGMENT_SIZE - 8;
+private:
+    static const uint8_t S_MAGIC = 0x5B;
+    static const uint8_t S_SEGMENT_HEADER = 4;
+    static const uint8_t S_RECORD_OVERHEAD = 4;
+    static const uint8_t S_ERASED_FLAG = 0x80;
+    static const uint8_t S_VERSION_MASK = 0x7F;
+    static const nvm_size_t S_BLOCK_SIZE = 16;                  // stack buffer for reading and writing records
+
+    static_assert(CRC_FUNC != NULL, "LogSlotNVM needs a CRC_FUNC.");
+    static_assert((LAST_SLOT >= 1) && (LAST_SLOT <= 250), "LAST_SLOT must be 1 .. 250.");
+    static_assert(SEGMENT_SIZE >= 16, "SEGMENT_SIZE must be at least 16.");
+    static_assert((S_SEGMENT_CNT >= 2) && (S_SEGMENT_CNT <= 256), "2 .. 256 segments are supported.");
+
+public:
+    LogSlotNVM();
+
+    /**
+     * Initialize LogSlotNVM.
+     * Call this once before every other call. Reads all records and builds the index of latest records.
+     * @return  true if NVM data is readable, false if not or begin() is called twice.
+     */
+    bool begin();
+
+    /**
+     * Check if begin is called before and returns true.
+     * @return  true if LogSlotNVM is ready for use.
+     */
+    bool isValid() const {
+        return m_initDone;
+    }
+
+    /**
+     * Check if data is stored for a given slot, no NVM access.
+     * @param slot  Slot number to check,
+     * @return      true if there is data for this slot.
+     */
+    bool isSlotAvailable(uint8_t slot) const {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        return m_index[slot - S_FIRST_SLOT] != 0;
+    }
+
+    /**
+     * Write data by appending a record, see SlotNVM::writeSlot().
+     * @param slot  Slot number
+     * @param data  Data to write
+     * @param len   Lenght of data to write, 1 .. S_MAX_LEN
+     * @return      true on success else false
+     */
+    bool writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len);
+
+    /**
+     * Write data by appending a record, see SlotNVM::writeSlot().
+     */
+    template <class T>
+    bool writeSlot(uint8_t slot, T &data) {
+      return writeSlot(slot, (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Read data of the latest record, see SlotNVM::readSlot().
+     */
+    bool readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) const;
+
+    /**
+     * Read data of the latest record, see SlotNVM::readSlot().
+     */
+    template <class T>
+    bool readSlot(uint8_t slot, T &data) const {
+      nvm_size_t len = sizeof(T);
+      return readSlot(slot, (uint8_t *)&data, len) && (len == sizeof(T));
+    }
+
+    /**
+     * Delete slot data by marking the latest record as erased, one written byte.
+     * @param slot  Slot number
+     * @return      true on success else false
+     */
+    bool eraseSlot(uint8_t slot);
+
+    /**
+     * Get the version of a slot, increased by every write, 0 .. 127 and wraps around.
+     * @param       slot    Slot number
+     * @param[out]  version Version of the latest record
+     * @return      true if the slot is available
+     */
+    bool getVersion(uint8_t slot, uint8_t &version) const;
+
+    /**
+     * Get amount of bytes writable without compaction, including the record overhead of 4 bytes.
+     * @return  Free bytes
+     */
+    nvm_size_t getFree() const {
+        nvm_size_t free = (S_SEGMENT_CNT - 1 - m_usedSegments) * (SEGMENT_SIZE - S_SEGMENT_HEADER);
+        if (m_usedSegments > 0) free += SEGMENT_SIZE - m_headOffset;
+        return free;
+    }
+
+#ifdef SLOTNVM_STATS
+    /**
+     * Get statistics of NVM access, see SlotNVM::getStats().
+     * Only reads, writes, bytesRead, bytesWritten and crcErrors are counted,
+     * crcErrors counts records with wrong CRC found by begin(), they end the records of a segment.
+     */
+    using CountingNVM<BASE>::getStats;
+
+    /**
+     * Set all statistics to 0.
+     */
+    using CountingNVM<BASE>::resetStats;
+#endif
+
+private:
+    bool            m_initDone;
+    uint8_t         m_tail;                         // oldest used segment
+    uint8_t         m_head;                         // newest used segment, records are appended here
+    uint16_t        m_usedSegments;
+    uint16_t        m_headSeq;
+    nvm_size_t      m_headOffset;                   // offset of next record in head segment
+    nvm_address_t   m_index[LAST_SLOT];             // address of latest record of every slot, 0 if none
+    inline static nvm_address_t segmentAddr(uint8_t segment) {
+        return segment * SEGMENT_SIZE;
+    }
+
+    inline static nvm_size_t recordLen(const uint8_t header[3]) {
+        return header[2] + 1 + S_RECORD_OVERHEAD;
+    }
+
+    // bytes to write for a record at the head, the end marker is not needed if the record fills the segment
+    inline nvm_size_t recordEnd(nvm_size_t recLen) const {
+        return (m_headOffset + recLen < SEGMENT_SIZE) ? recLen + 1 : recLen;
+    }
+
+    inline static uint8_t headerCRC(const uint8_t header[3]) {
+        uint8_t crc = CRC_FUNC(0, header[0]);
+        crc = CRC_FUNC(crc, header[1] & ~S_ERASED_FLAG);
+        return CRC_FUNC(crc, header[2]);
+    }
+
+    inline static uint8_t crc_buf(uint8_t crc, const uint8_t *data, nvm_size_t len) {
+        for (nvm_size_t i = 0; i < len; ++i) {
+            crc = CRC_FUNC(crc, data[i]);
+        }
+        return crc;
+    }
+
+    bool readSegmentHeader(uint8_t segment, bool &valid, uint16_t &seq) const;
+
+    bool readRecordHeader(nvm_address_t addr, nvm_size_t offset, uint8_t header[3], bool &valid) const;
+
+    bool scanSegment(uint8_t segment, nvm_size_t &end);
+
+    bool openSegment();
+
+    bool compact();
+
+    bool reserve(nvm_size_t recLen);
+
+    bool appendRecord(const uint8_t header[3], const uint8_t *data);
+
+    bool copyRecord(nvm_address_t from, nvm_size_t recLen);
+
+    bool nextVersion(uint8_t slot, uint8_t &version) const;
+};
+
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::LogSlotNVM()
+    : m_initDone(false)
+    , m_tail(0)
+    , m_head(0)
+    , m_usedSegments(0)
+    , m_headSeq(0)
+    , m_headOffset(0)
+    , m_index{0}
+{
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::begin() {
+    if (m_initDone) return false;
+
+    // the newest segment is the head
+    bool found = false;
+    for (uint16_t segment = 0; segment < S_SEGMENT_CNT; ++segment) {
+        bool valid;
+        uint16_t seq;
+        bool res = readSegmentHeader(segment, valid, seq);
+        if (!res) return false;
+        if (!valid) continue;
+        if (!found || ((int16_t)(seq - m_headSeq) > 0)) {
+            m_head = segment;
+            m_headSeq = seq;
+            found = true;
+        }
+    }
+
+    // the used segments are the ring before the head with decreasing sequence numbers
+    if (found) {
+        m_tail = m_head;
+        m_usedSegments = 1;
+        while (m_usedSegments < S_SEGMENT_CNT) {
+            uint8_t prev = (m_tail + S_SEGMENT_CNT - 1) % S_SEGMENT_CNT;
+            bool valid;
+            uint16_t seq;
+            bool res = readSegmentHeader(prev, valid, seq);
+            if (!res) return false;
+            if (!valid || (seq != (uint16_t)(m_headSeq - m_usedSegments))) break;
+            m_tail = prev;
+            ++m_usedSegments;
+        }
+
+        // replay all records from the oldest to the newest
+        for (uint16_t i = 0; i < m_usedSegments; ++i) {
+            bool res = scanSegment((m_tail + i) % S_SEGMENT_CNT, m_headOffset);
+            if (!res) return false;
+        }
+    }
+
+    m_initDone = true;
+
+    return m_initDone;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+    if (!m_initDone) return false;
+    if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+    if ((data == NULL) || (len < 1) || (len > S_MAX_LEN)) return false;
+
+    uint8_t header[3];
+    header[0] = slot;
+    bool res = nextVersion(slot, header[1]);
+    if (!res) return false;
+    header[2] = len - 1;
+
+    res = reserve(len + S_RECORD_OVERHEAD);
+    if (!res) return false;
+    return appendRecord(header, data);
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) const {
+    if (!m_initDone) return false;
+    if (!isSlotAvailable(slot)) return false;
+    nvm_address_t addr = m_index[slot - S_FIRST_SLOT];
+    uint8_t d;
+
+    bool res = this->read(addr + 2, d);             // read length
+    if (!res) return false;
+    nvm_size_t lenToCopy = d + 1;
+    if (lenToCopy > len) {
+        len = lenToCopy;
+        return false;
+    }
+    len = lenToCopy;
+    if (data == NULL) return false;
+
+    return this->read(addr + 3, data, lenToCopy);
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::eraseSlot(uint8_t slot) {
+    if (!m_initDone) return false;
+    if (!isSlotAvailable(slot)) return false;
+
+    nvm_address_t addr = m_index[slot - S_FIRST_SLOT];
+    uint8_t version;
+    bool res = this->read(addr + 1, version);
+    if (!res) return false;
+    res = this->write(addr + 1, version | S_ERASED_FLAG);
+    if (!res) return false;
+    m_index[slot - S_FIRST_SLOT] = 0;
+    return true;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::getVersion(uint8_t slot, uint8_t &version) const {
+    if (!m_initDone) return false;
+    if (!isSlotAvailable(slot)) return false;
+    bool res = this->read(m_index[slot - S_FIRST_SLOT] + 1, version);
+    version &= S_VERSION_MASK;
+    return res;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::readSegmentHeader(uint8_t segment, bool &valid, uint16_t &seq) const {
+    uint8_t header[S_SEGMENT_HEADER];
+    bool res = this->read(segmentAddr(segment), header, S_SEGMENT_HEADER);
+    if (!res) return false;
+    valid = (header[0] == S_MAGIC) && (header[3] == crc_buf(0, header, 3));
+    seq = header[1] | (header[2] << 8);
+    return true;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::readRecordHeader(nvm_address_t addr, nvm_size_t offset, uint8_t header[3], bool &valid) const {
+    valid = false;
+    if (offset + S_RECORD_OVERHEAD > SEGMENT_SIZE) return true;                 // no space for another record
+    bool res = this->read(addr + offset, header, 3);
+    if (!res) return false;
+    if ((header[0] < S_FIRST_SLOT) || (header[0] > S_LAST_SLOT)) return true;  // end of records
+    valid = (offset + recordLen(header) <= SEGMENT_SIZE);
+    return true;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::scanSegment(uint8_t segment, nvm_size_t &end) {
+    nvm_address_t sAddr = segmentAddr(segment);
+    nvm_size_t offset = S_SEGMENT_HEADER;
+
+    while (true) {
+        uint8_t header[3];
+        bool valid;
+        bool res = readRecordHeader(sAddr, offset, header, valid);
+        if (!res) return false;
+        if (!valid) break;
+
+        // check CRC, the data is read in small blocks to save stack
+        nvm_size_t recLen = recordLen(header);
+        uint8_t crc = headerCRC(header);
+        uint8_t buf[S_BLOCK_SIZE];
+        for (nvm_size_t pos = 3; pos < recLen - 1; pos += S_BLOCK_SIZE) {
+            nvm_size_t cnt = (recLen - 1 - pos > S_BLOCK_SIZE) ? S_BLOCK_SIZE : recLen - 1 - pos;
+            res = this->read(sAddr + offset + pos, buf, cnt);
+            if (!res) return false;
+            crc = crc_buf(crc, buf, cnt);
+        }
+        res = this->read(sAddr + offset + recLen - 1, buf[0]);
+        if (!res) return false;
+        if (buf[0] != crc) {                                    // incomplete written, end of records
+            _SLOTNVM_STATS_ADD_(crcErrors, 1);
+            break;
+        }
+
+        m_index[header[0] - S_FIRST_SLOT] = ((header[1] & S_ERASED_FLAG) != 0) ? 0 : sAddr + offset;
+        offset += recLen;
+    }
+
+    end = offset;
+    return true;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::openSegment() {
+    if (m_usedSegments >= S_SEGMENT_CNT) return false;
+    uint8_t segment = (m_usedSegments == 0) ? 0 : (m_head + 1) % S_SEGMENT_CNT;
+    uint16_t seq = (m_usedSegments == 0) ? 0 : m_headSeq + 1;
+    nvm_address_t sAddr = segmentAddr(segment);
+
+    // records of an earlier use must not be found
+    bool res = this->write(sAddr + S_SEGMENT_HEADER, 0x00);
+    if (!res) return false;
+
+    uint8_t header[S_SEGMENT_HEADER];
+    header[0] = S_MAGIC;
+    header[1] = seq;
+    header[2] = seq >> 8;
+    header[3] = crc_buf(0, header, 3);
+    res = this->write(sAddr + 1, header + 1, S_SEGMENT_HEADER - 1);
+    if (!res) return false;
+    res = this->write(sAddr, header[0]);
+    if (!res) return false;
+
+    if (m_usedSegments == 0) {
+        m_tail = segment;
+    }
+    m_head = segment;
+    m_headSeq = seq;
+    m_headOffset = S_SEGMENT_HEADER;
+    ++m_usedSegments;
+    return true;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::compact() {
+    if (m_usedSegments == 0) return false;
+    if (m_tail == m_head) {                                     // never copy into the compacted segment
+        bool res = openSegment();
+        if (!res) return false;
+    }
+
+    // copy all latest records, erased ones are not needed anymore as there is no older segment
+    nvm_address_t sAddr = segmentAddr(m_tail);
+    nvm_size_t offset = S_SEGMENT_HEADER;
+    while (true) {
+        uint8_t header[3];
+        bool valid;
+        bool res = readRecordHeader(sAddr, offset, header, valid);
+        if (!res) return false;
+        if (!valid) break;
+
+        nvm_size_t recLen = recordLen(header);
+        if (m_index[header[0] - S_FIRST_SLOT] == sAddr + offset) {
+            if (m_headOffset + recLen > SEGMENT_SIZE) {
+                res = openSegment();
+                if (!res) return false;
+            }
+            nvm_address_t to = segmentAddr(m_head) + m_headOffset;
+            res = copyRecord(sAddr + offset, recLen);
+            if (!res) return false;
+            m_index[header[0] - S_FIRST_SLOT] = to;
+        }
+        offset += recLen;
+    }
+
+    // a power loss before this point keeps both copies, the newer one wins in begin()
+    bool res = this->write(sAddr, 0x00);
+    if (!res) return false;
+    m_tail = (m_tail + 1) % S_SEGMENT_CNT;
+    --m_usedSegments;
+    return true;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::reserve(nvm_size_t recLen) {
+    if (m_usedSegments == 0) {
+        bool res = openSegment();
+        if (!res) return false;
+    }
+
+    uint16_t compactions = 0;
+    while (m_headOffset + recLen > SEGMENT_SIZE) {
+        if (S_SEGMENT_CNT - m_usedSegments > 1) {               // keep one free segment for compaction
+            bool res = openSegment();
+            if (!res) return false;
+        } else {
+            if (compactions >= S_SEGMENT_CNT) return false;     // every segment is compacted, NVM is full
+            ++compactions;
+            bool res = compact();
+            if (!res) return false;
+        }
+    }
+    return true;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::appendRecord(const uint8_t header[3], const uint8_t *data) {
+    nvm_size_t recLen = recordLen(header);
+    nvm_address_t addr = segmentAddr(m_head) + m_headOffset;
+    nvm_size_t end = recordEnd(recLen);
+    uint8_t crc = crc_buf(headerCRC(header), data, recLen - S_RECORD_OVERHEAD);
+
+    // all but the slot number in small blocks, with the end marker behind the record
+    uint8_t buf[S_BLOCK_SIZE];
+    for (nvm_size_t pos = 1; pos < end; pos += S_BLOCK_SIZE) {
+        nvm_size_t cnt = (end - pos > S_BLOCK_SIZE) ? S_BLOCK_SIZE : end - pos;
+        for (nvm_size_t i = 0; i < cnt; ++i) {
+            nvm_size_t bytePos = pos + i;
+            if (bytePos < 3) {
+                buf[i] = header[bytePos];
+            } else if (bytePos < recLen - 1) {
+                buf[i] = data[bytePos - 3];
+            } else if (bytePos == recLen - 1) {
+                buf[i] = crc;
+            } else {
+                buf[i] = 0x00;
+            }
+        }
+        bool res = this->write(addr + pos, buf, cnt);
+        if (!res) return false;
+    }
+
+    // now make record valid
+    bool res = this->write(addr, header[0]);
+    if (!res) return false;
+
+    m_index[header[0] - S_FIRST_SLOT] = addr;
+    m_headOffset += recLen;
+    return true;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::copyRecord(nvm_address_t from, nvm_size_t recLen) {
+    nvm_address_t to = segmentAddr(m_head) + m_headOffset;
+    nvm_size_t end = recordEnd(recLen);
+
+    // copy all but the slot number in small blocks, with the end marker behind the record
+    uint8_t buf[S_BLOCK_SIZE];
+    for (nvm_size_t pos = 1; pos < end; pos += S_BLOCK_SIZE) {
+        nvm_size_t cnt = (end - pos > S_BLOCK_SIZE) ? S_BLOCK_SIZE : end - pos;
+        nvm_size_t cntRead = (recLen - pos > cnt) ? cnt : recLen - pos;
+        bool res = this->read(from + pos, buf, cntRead);
+        if (!res) return false;
+        if (cntRead < cnt) buf[cntRead] = 0x00;
+        res = this->write(to + pos, buf, cnt);
+        if (!res) return false;
+    }
+
+    // the slot number makes the copy valid
+    bool res = this->read(from, buf[0]);
+    if (!res) return false;
+    res = this->write(to, buf[0]);
+    if (!res) return false;
+
+    m_headOffset += recLen;
+    return true;
+}
+
+template <class BASE, nvm_size_t SEGMENT_SIZE, uint8_t LAST_SLOT, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool LogSlotNVM<BASE, SEGMENT_SIZE, LAST_SLOT, CRC_FUNC>::nextVersion(uint8_t slot, uint8_t &version) const {
+    version = 0;
+    if (!isSlotAvailable(slot)) return true;
+    bool res = this->read(m_index[slot - S_FIRST_SLOT] + 1, version);
+    version = (version + 1) & S_VERSION_MASK;
+    return res;
+}
+
+#endif // _SLOTNVM_LOGSLOTNVM_H_
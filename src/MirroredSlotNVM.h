@@ -0,0 +1,330 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_MIRROREDSLOTNVM_H_
+#define _SLOTNVM_MIRROREDSLOTNVM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "NVMBase.h"
+
+#ifndef __AVR_ARCH__
+#include <chrono>
+#include <thread>
+#endif
+
+/**
+ * Two copies of every slot on two SlotNVM instances, e.g. on two EEPROM chips.
+ *
+ * Every change is done at first on replica A and after that on replica B, so A is never older than B.
+ * On hosts the write to B runs in a background thread, parallel to the next write to A,
+ * writeSlot() returns when A is written. Use flush() to wait until B is written, too.
+ * On AVR both replicas are written one after the other.
+ *
+ * readSlot() uses the healthy replica with the lower measured read time (on AVR replica A) and
+ * falls back to the other replica if reading fails, e.g. because begin() found a CRC error.
+ * begin() repairs differences: a slot which is stored only in one replica is copied to the other one,
+ * if both replicas have different data the data of A is copied to B.
+ *
+ * eraseSlot() writes the slot number to the erase slot of A (the last slot of both replicas, it can not be used)
+ * before it erases the slot in A and B, and erases the erase slot at last. begin() finishes an erase interrupted
+ * by a power loss, so an erased slot is never copied back from B.
+ *
+ * @tparam NVM_A    SlotNVM class of replica A.
+ * @tparam NVM_B    SlotNVM class of replica B.
+ */
+template <class NVM_A, class NVM_B = NVM_A>
+class MirroredSlotNVM {
+public:
+    /// First allowed slot number.
+    static const uint8_t S_FIRST_SLOT = 1;
+    /// Last allowed slot number, the smaller S_LAST_SLOT of both replicas without the erase slot.
+    static const uint8_t S_LAST_SLOT = ((NVM_A::S_LAST_SLOT < NVM_B::S_LAST_SLOT) ? NVM_A::S_LAST_SLOT : NVM_B::S_LAST_SLOT) - 1;
+
+    static_assert(S_LAST_SLOT >= S_FIRST_SLOT, "Both replicas need at least 2 slots.");
+
+    /**
+     * @param nvmA  Replica A, always written first.
+     * @param nvmB  Replica B.
+     */
+    MirroredSlotNVM(NVM_A &nvmA, NVM_B &nvmB)
+        : m_nvmA(nvmA)
+        , m_nvmB(nvmB)
+        , m_repairs(0)
+        , m_reads(0) {
+        m_healthy[0] = false;
+        m_healthy[1] = false;
+        m_readNs[0] = 0;
+        m_readNs[1] = 0;
+#ifndef __AVR_ARCH__
+        m_pendingSlot = 0;
+        m_pendingRes = true;
+#endif
+    }
+
+    ~MirroredSlotNVM() {
+        flush();
+    }
+
+    /**
+     * Initialize both replicas and repair differences.
+     * @return true if both replicas are valid and all differences are repaired
+     */
+    bool begin() {
+        flush();
+        m_healthy[0] = m_nvmA.begin();
+        m_healthy[1] = m_nvmB.begin();
+        if (!m_healthy[0] || !m_healthy[1]) return false;
+
+        bool ret = true;
+        uint8_t erased;
+        if (m_nvmA.readSlot(S_ERASE_SLOT, erased)) {   // finish erase interrupted by power loss
+            if ((erased >= S_FIRST_SLOT) && (erased <= S_LAST_SLOT)) {
+                m_nvmA.eraseSlot(erased);
+                m_nvmB.eraseSlot(erased);
+                ++m_repairs;
+            }
+            if (!m_nvmA.eraseSlot(S_ERASE_SLOT)) ret = false;
+        }
+
+        uint8_t bufA[256];
+        uint8_t bufB[256];
+        for (uint16_t slot = S_FIRST_SLOT; slot <= S_LAST_SLOT; ++slot) {
+            nvm_size_t lenA = sizeof(bufA);
+            nvm_size_t lenB = sizeof(bufB);
+            bool availA = m_nvmA.readSlot(slot, bufA, lenA);
+            bool availB = m_nvmB.readSlot(slot, bufB, lenB);
+            bool res = true;
+            if (availA) {
+                if (!availB || (lenA != lenB) || (memcmp(bufA, bufB, lenA) != 0)) {
+                    res = m_nvmB.writeSlot(slot, bufA, lenA);
+                    ++m_repairs;
+                }
+            } else if (availB) {
+                res = m_nvmA.writeSlot(slot, bufB, lenB);
+                ++m_repairs;
+            }
+            if (!res) ret = false;
+        }
+        return ret;
+    }
+
+    /**
+     * Check if begin is called before and both replicas are valid.
+     */
+    bool isValid() const {
+        return m_nvmA.isValid() && m_nvmB.isValid();
+    }
+
+    /**
+     * Check if data is stored for a given slot.
+     * See SlotNVM::isSlotAvailable().
+     */
+    bool isSlotAvailable(uint8_t slot) const {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        return m_nvmA.isSlotAvailable(slot) || (!isPending() && m_nvmB.isSlotAvailable(slot));
+    }
+
+    /**
+     * Write data to both replicas.
+     * On hosts it returns after replica A is written, B is written in background.
+     * See SlotNVM::writeSlot().
+     * @return true if replica A is written
+     */
+    bool writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        bool res = m_nvmA.writeSlot(slot, data, len);   // parallel to the pending write of B
+        flush();
+        if (!res) return false;
+
+#ifndef __AVR_ARCH__
+        memcpy(m_pendingData, data, len);
+        m_pendingSlot = slot;
+        m_pendingLen = len;
+        m_pendingThread = std::thread([this]() {
+            m_pendingRes = m_nvmB.writeSlot(m_pendingSlot, m_pendingData, m_pendingLen);
+        });
+#else
+        if (!m_nvmB.writeSlot(slot, data, len)) m_healthy[1] = false;
+#endif
+        return true;
+    }
+
+    /**
+     * Write data to both replicas.
+     * See SlotNVM::writeSlot().
+     */
+    template <class T>
+    bool writeSlot(uint8_t slot, T &data) {
+      return writeSlot(slot, (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Read data from the faster healthy replica, fall back to the other one if reading fails.
+     * See SlotNVM::readSlot().
+     */
+    bool readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) const {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        uint8_t first = readReplica();
+        nvm_size_t lenFirst = len;
+        if (readSlot(first, slot, data, lenFirst)) {
+            len = lenFirst;
+            return true;
+        }
+        if (lenFirst > len) {               // slot available but buffer too small
+            len = lenFirst;
+            return false;
+        }
+
+        uint8_t second = 1 - first;
+        if (!m_healthy[second] || ((second == 1) && isPending())) return false;
+        return readSlot(second, slot, data, len);
+    }
+
+    /**
+     * Read data from the faster healthy replica, fall back to the other one if reading fails.
+     * See SlotNVM::readSlot().
+     */
+    template <class T>
+    bool readSlot(uint8_t slot, T &data) const {
+      nvm_size_t len = 0;
+      readSlot(slot, NULL, len);
+      if (len == sizeof(T)) {
+        return readSlot(slot, (uint8_t *)&data, len);
+      } else {
+        return false;
+      }
+    }
+
+    /**
+     * Delete slot data in both replicas, returns after both are done.
+     * The slot number is stored in the erase slot of A until both are done, so it is power fail safe,
+     * unless A has no free cluster for it.
+     * See SlotNVM::eraseSlot().
+     * @return true if the slot was erased at least in one replica
+     */
+    bool eraseSlot(uint8_t slot) {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        flush();                                        // B must not write the slot again after its erase
+        if (!isSlotAvailable(slot)) return false;
+        bool marked = m_nvmA.writeSlot(S_ERASE_SLOT, slot);    // fails only without a free cluster in A
+        bool resA = m_nvmA.eraseSlot(slot);
+        bool resB = m_nvmB.eraseSlot(slot);
+        if (marked) m_nvmA.eraseSlot(S_ERASE_SLOT);
+        return resA || resB;
+    }
+
+    /**
+     * Wait until a pending write to replica B is done.
+     * A failed write marks replica B as unhealthy until the next begin().
+     */
+    void flush() {
+#ifndef __AVR_ARCH__
+        if (m_pendingThread.joinable()) {
+            m_pendingThread.join();
+            if (!m_pendingRes) m_healthy[1] = false;
+        }
+#endif
+    }
+
+    /**
+     * Get amount of total available user data, the smaller value of both replicas.
+     */
+    nvm_size_t getSize() const {
+        nvm_size_t a = m_nvmA.getSize();
+        nvm_size_t b = m_nvmB.getSize();
+        return (a < b) ? a : b;
+    }
+
+    /**
+     * Get amount of total usable user data, the smaller value of both replicas.
+     */
+    nvm_size_t getUsableSize() const {
+        nvm_size_t a = m_nvmA.getUsableSize();
+        nvm_size_t b = m_nvmB.getUsableSize();
+        return (a < b) ? a : b;
+    }
+
+    /**
+     * Get amount of free user data, the smaller value of both replicas.
+     * Waits until a pending write to replica B is done.
+     */
+    nvm_size_t getFree() {
+        flush();
+        nvm_size_t a = m_nvmA.getFree();
+        nvm_size_t b = m_nvmB.getFree();
+        return (a < b) ? a : b;
+    }
+
+    /**
+     * Check if a replica had no write error since begin().
+     * @param replica   0 for A, 1 for B
+     */
+    bool isReplicaHealthy(uint8_t replica) const {
+        return (replica < 2) && m_healthy[replica];
+    }
+
+    /**
+     * Count of slots repaired by begin().
+     */
+    uint16_t getRepairs() const {
+        return m_repairs;
+    }
+
+private:
+    /// Every x-th read uses the slower replica to update its read time.
+    static const uint8_t S_PROBE_INTERVAL = 16;
+    /// Slot of A holding the number of the slot erased by eraseSlot().
+    static const uint8_t S_ERASE_SLOT = S_LAST_SLOT + 1;
+
+    NVM_A           &m_nvmA;
+    NVM_B           &m_nvmB;
+    bool            m_healthy[2];
+    uint16_t        m_repairs;
+    mutable uint8_t m_reads;
+    mutable uint32_t m_readNs[2];           // smoothed read time per replica
+#ifndef __AVR_ARCH__
+    std::thread     m_pendingThread;
+    uint8_t         m_pendingSlot;
+    nvm_size_t      m_pendingLen;
+    bool            m_pendingRes;
+    uint8_t         m_pendingData[256];
+#endif
+
+    bool isPending() const {
+#ifndef __AVR_ARCH__
+        return m_pendingThread.joinable();
+#else
+        return false;
+#endif
+    }
+
+    uint8_t readReplica() const {
+        if (!m_healthy[1] || isPending()) return 0;
+        if (!m_healthy[0]) return 1;
+        uint8_t fastest = (m_readNs[1] < m_readNs[0]) ? 1 : 0;
+        if ((++m_reads % S_PROBE_INTERVAL) == 0) return 1 - fastest;
+        return fastest;
+    }
+
+    bool readSlot(uint8_t replica, uint8_t slot, uint8_t *data, nvm_size_t &len) const {
+#ifndef __AVR_ARCH__
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#endif
+        bool res = (replica == 0) ? m_nvmA.readSlot(slot, data, len) : m_nvmB.readSlot(slot, data, len);
+#ifndef __AVR_ARCH__
+        if (res) {
+            uint32_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            m_readNs[replica] = (m_readNs[replica] == 0) ? ns : (m_readNs[replica] / 8 * 7 + ns / 8);
+        }
+#endif
+        return res;
+    }
+};
+
+#endif // _SLOTNVM_MIRROREDSLOTNVM_H_
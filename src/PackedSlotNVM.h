@@ -0,0 +1,241 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_PACKEDSLOTNVM_H_
+#define _SLOTNVM_PACKEDSLOTNVM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "NVMBase.h"
+
+/**
+ * Many small slots, e.g. boolean flags, packed into a few slots of a SlotNVM.
+ *
+ * Every packed slot belongs to one pack, a slot of the SlotNVM: packed slot s uses pack (s - 1) % PACK_CNT,
+ * so consecutive numbers are spread over all packs. A pack holds a mini directory with one entry per packed slot:
+ *  0       Packed slot number
+ *  1       Size of data - 1
+ *  2..     Data
+ * A pack is always read and written as a unit by the SlotNVM, so a write is as power fail safe as writeSlot().
+ * With the default PACK_SIZE a pack fits in one cluster, so 200 flags need about 200 * 3 / PACK_SIZE clusters
+ * instead of 200, and begin() reads only PACK_CNT slots.
+ *
+ * The SlotNVM slots PACK_FIRST .. PACK_FIRST + PACK_CNT - 1 are used for the packs,
+ * all other slots can be used directly, but call begin() of this class instead of SlotNVM::begin().
+ *
+ * @tparam NVM          SlotNVM class.
+ * @tparam PACK_FIRST   First SlotNVM slot used for packs.
+ * @tparam PACK_CNT     Count of SlotNVM slots used for packs.
+ * @tparam PACK_SIZE    Max. size of a pack in bytes, default is the user data of one cluster, max. 256.
+ */
+template <class NVM, uint8_t PACK_FIRST, uint8_t PACK_CNT, nvm_size_t PACK_SIZE = NVM::S_USER_DATA_PER_CLUSTER>
+class PackedSlotNVM {
+    static_assert(PACK_CNT > 0, "At least one pack is needed.");
+    static_assert((PACK_FIRST >= NVM::S_FIRST_SLOT) && (PACK_FIRST + PACK_CNT - 1 <= NVM::S_LAST_SLOT), "Packs must be valid slots of NVM.");
+    static_assert((PACK_SIZE >= 3) && (PACK_SIZE <= 256), "PACK_SIZE must be 3 .. 256.");
+
+public:
+    /// First allowed packed slot number.
+    static const uint8_t S_FIRST_SLOT = 1;
+    /// Last allowed packed slot number.
+    static const uint8_t S_LAST_SLOT = 250;
+    /// Max. data size of one packed slot.
+    static const nvm_size_t S_MAX_LEN = PACK_SIZE - 2;
+
+    /**
+     * @param nvm   SlotNVM storing the packs.
+     */
+    explicit PackedSlotNVM(NVM &nvm) : m_nvm(nvm) {
+        memset(m_slotAvail, 0, sizeof(m_slotAvail));
+    }
+
+    /**
+     * Initialize the SlotNVM and find all packed slots.
+     * See SlotNVM::begin().
+     */
+    bool begin() {
+        if (!m_nvm.begin()) return false;
+        uint8_t pack[PACK_SIZE];
+        for (uint8_t i = 0; i < PACK_CNT; ++i) {
+            nvm_size_t len = PACK_SIZE;
+            if (!m_nvm.readSlot(PACK_FIRST + i, pack, len)) continue;     // empty or invalid
+            for (nvm_size_t pos = 0; pos + 2 <= len; pos += pack[pos + 1] + 3) {
+                uint8_t slot = pack[pos];
+                if (pos + pack[pos + 1] + 3 > len) break;                   // truncated entry
+                if ((slot >= S_FIRST_SLOT) && (slot <= S_LAST_SLOT) && (packOf(slot) == i)) {
+                    setSlotBit(slot);
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Check if begin is called before and returns true.
+     * See SlotNVM::isValid().
+     */
+    bool isValid() const {
+        return m_nvm.isValid();
+    }
+
+    /**
+     * Check if data is stored for a given packed slot, no NVM access.
+     * See SlotNVM::isSlotAvailable().
+     */
+    bool isSlotAvailable(uint8_t slot) const {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        return (m_slotAvail[(slot - S_FIRST_SLOT) / 8] & (1 << ((slot - S_FIRST_SLOT) % 8))) != 0;
+    }
+
+    /**
+     * Write data of a packed slot, the whole pack is rewritten.
+     * See SlotNVM::writeSlot().
+     * @return false if the data does not fit in the pack anymore
+     */
+    bool writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        if ((data == NULL) || (len < 1) || (len > S_MAX_LEN)) return false;
+        uint8_t pack[PACK_SIZE];
+        nvm_size_t packLen;
+        if (!readPack(slot, pack, packLen)) return false;
+
+        packLen = removeEntry(slot, pack, packLen);
+        if (packLen + 2 + len > PACK_SIZE) return false;
+        pack[packLen] = slot;
+        pack[packLen + 1] = len - 1;
+        memcpy(pack + packLen + 2, data, len);
+        packLen += 2 + len;
+
+        if (!m_nvm.writeSlot(PACK_FIRST + packOf(slot), pack, packLen)) return false;
+        setSlotBit(slot);
+        return true;
+    }
+
+    /**
+     * Write data of a packed slot, the whole pack is rewritten.
+     * See SlotNVM::writeSlot().
+     */
+    template <class T>
+    bool writeSlot(uint8_t slot, T &data) {
+      return writeSlot(slot, (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Read data of a packed slot.
+     * See SlotNVM::readSlot().
+     */
+    bool readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) const {
+        if (!isSlotAvailable(slot)) return false;
+        uint8_t pack[PACK_SIZE];
+        nvm_size_t packLen;
+        if (!readPack(slot, pack, packLen)) return false;
+
+        nvm_size_t pos = findEntry(slot, pack, packLen);
+        if (pos >= packLen) return false;
+        nvm_size_t lenToCopy = pack[pos + 1] + 1;
+        if (pos + 2 + lenToCopy > packLen) return false;                    // truncated entry
+        if (lenToCopy > len) {
+            len = lenToCopy;
+            return false;
+        }
+        len = lenToCopy;
+        if (data == NULL) return false;
+        memcpy(data, pack + pos + 2, lenToCopy);
+        return true;
+    }
+
+    /**
+     * Read data of a packed slot.
+     * See SlotNVM::readSlot().
+     */
+    template <class T>
+    bool readSlot(uint8_t slot, T &data) const {
+      nvm_size_t len = sizeof(T);
+      return readSlot(slot, (uint8_t *)&data, len) && (len == sizeof(T));
+    }
+
+    /**
+     * Delete data of a packed slot, the pack is rewritten or erased if it gets empty.
+     * See SlotNVM::eraseSlot().
+     */
+    bool eraseSlot(uint8_t slot) {
+        if (!isSlotAvailable(slot)) return false;
+        uint8_t pack[PACK_SIZE];
+        nvm_size_t packLen;
+        if (!readPack(slot, pack, packLen)) return false;
+
+        packLen = removeEntry(slot, pack, packLen);
+        bool res;
+        if (packLen == 0) {
+            res = m_nvm.eraseSlot(PACK_FIRST + packOf(slot));
+        } else {
+            res = m_nvm.writeSlot(PACK_FIRST + packOf(slot), pack, packLen);
+        }
+        if (!res) return false;
+        clearSlotBit(slot);
+        return true;
+    }
+
+    /**
+     * Get amount of free bytes in the pack of a packed slot, including the 2 bytes of the directory entry.
+     */
+    nvm_size_t getFree(uint8_t slot) const {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return 0;
+        uint8_t pack[PACK_SIZE];
+        nvm_size_t packLen;
+        if (!readPack(slot, pack, packLen)) return 0;
+        return PACK_SIZE - packLen;
+    }
+
+private:
+    NVM         &m_nvm;
+    uint8_t     m_slotAvail[(S_LAST_SLOT + 7) / 8];
+
+    static inline uint8_t packOf(uint8_t slot) {
+        return (slot - S_FIRST_SLOT) % PACK_CNT;
+    }
+
+    inline void setSlotBit(uint8_t slot) {
+        m_slotAvail[(slot - S_FIRST_SLOT) / 8] |= 1 << ((slot - S_FIRST_SLOT) % 8);
+    }
+
+    inline void clearSlotBit(uint8_t slot) {
+        m_slotAvail[(slot - S_FIRST_SLOT) / 8] &= ~(1 << ((slot - S_FIRST_SLOT) % 8));
+    }
+
+    // read the pack of a slot, an empty pack is no error
+    bool readPack(uint8_t slot, uint8_t pack[PACK_SIZE], nvm_size_t &packLen) const {
+        uint8_t nvmSlot = PACK_FIRST + packOf(slot);
+        packLen = 0;
+        if (!m_nvm.isSlotAvailable(nvmSlot)) return m_nvm.isValid();
+        packLen = PACK_SIZE;
+        return m_nvm.readSlot(nvmSlot, pack, packLen);
+    }
+
+    // offset of the entry of a slot, packLen if not found
+    static nvm_size_t findEntry(uint8_t slot, const uint8_t pack[PACK_SIZE], nvm_size_t packLen) {
+        nvm_size_t pos = 0;
+        while (pos + 2 <= packLen) {
+            if (pack[pos] == slot) return pos;
+            pos += pack[pos + 1] + 3;
+        }
+        return packLen;
+    }
+
+    // remove the entry of a slot, returns the new length
+    static nvm_size_t removeEntry(uint8_t slot, uint8_t pack[PACK_SIZE], nvm_size_t packLen) {
+        nvm_size_t pos = findEntry(slot, pack, packLen);
+        if (pos >= packLen) return packLen;
+        nvm_size_t entryLen = pack[pos + 1] + 3;
+        if (pos + entryLen > packLen) return pos;           // truncated entry, drop it
+        memmove(pack + pos, pack + pos + entryLen, packLen - pos - entryLen);
+        return packLen - entryLen;
+    }
+};
+
+#endif // _SLOTNVM_PACKEDSLOTNVM_H_
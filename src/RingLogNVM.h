@@ -0,0 +1,401 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_RINGLOGNVM_H_
+#define _SLOTNVM_RINGLOGNVM_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "NVMBase.h"
+#include "SlotNVMStats.h"
+
+/*
+ * The NVM is split into S_RECORD_CNT records of fixed size, used as ring. The first record is written
+ * at position 0, every new record behind the newest one (head), after the last position again at position 0.
+ *
+ * Record
+ *  0/1     Sequence number (little endian) 0 .. 65534, increased by one for every record and wraps around to 0,
+ *          65535 is never used so an erased NVM has no valid record
+ *  2..n-2  Data
+ *  n-1     CRC-8 of byte 0..n-2 with 0xFF as start value, so a NVM full of 0x00 has no valid record
+ *
+ * Data and CRC are written first, the sequence number is written last and makes the record valid.
+ * So only the record written at a power loss can be invalid, the other records of the newest lap from
+ * position 0 to the head have increasing sequence numbers and all positions behind the head do not continue
+ * them. begin() finds the head by a binary search reading only sequence numbers.
+ */
+
+/**
+ * Ring buffer of fixed size records for high rate logging, e.g. sensor samples.
+ *
+ * Every record gets a sequence number, nothing has to be searched or allocated for a new record, it is written
+ * to the next position with two NVM writes. If all positions are used the oldest record is overwritten.
+ * begin() needs about log2(S_RECORD_CNT) reads of 2 bytes and does not read the data of all records.
+ * The latest records can be read by age or iterated from the newest to the oldest one.
+ *
+ * All of the NVM of BASE is used for records. A record position is overwritten every lap without erasing it first,
+ * so flash which needs an erase is not supported, an EEPROM or FRAM is.
+ * append() and reading a record need RECORD_SIZE + 3 bytes of stack.
+ *
+ * @tparam BASE             Base class handling NVM read and write, see NVMBase as example.
+ * @tparam RECORD_SIZE      Size of the data of one record in bytes, 1 .. 253.
+ * @tparam CRC_FUNC         Function to calculate a 8 bit CRC, see SlotNVM.
+ */
+template <class BASE, nvm_size_t RECORD_SIZE, uint8_t (*CRC_FUNC)(uint8_t crc, uint8_t data)>
+class RingLogNVM : private CountingNVM<BASE> {
+private:
+    static const uint8_t S_RECORD_OVERHEAD = 3;
+    static const nvm_size_t S_RECORD_LEN = RECORD_SIZE + S_RECORD_OVERHEAD;
+    static const uint16_t S_SEQ_CNT = 0xFFFF;                  // sequence numbers 0 .. 65534
+    static const uint8_t S_CRC_START = 0xFF;
+
+public:
+    /// Count of records, the oldest one is overwritten if all are used.
+    static const uint16_t S_RECORD_CNT = BASE::S_SIZE / S_RECORD_LEN;
+    /// Size of the data of one record.
+    static const nvm_size_t S_RECORD_SIZE = RECORD_SIZE;
+
+private:
+    static_assert(CRC_FUNC != NULL, "RingLogNVM needs a CRC_FUNC.");
+    static_assert((RECORD_SIZE >= 1) && (RECORD_SIZE <= 253), "RECORD_SIZE must be 1 .. 253.");
+    static_assert(S_RECORD_CNT >= 3, "The NVM must hold at least 3 records.");
+
+public:
+    /// One record, see records().
+    struct RecordInfo {
+        uint16_t    seq;                ///< Sequence number, 0 .. 65534 and wraps around
+        bool        valid;              ///< false if the record is corrupted, data is undefined then
+        uint8_t     data[RECORD_SIZE];  ///< Data of the record
+    };
+
+    /// Iterator over the latest records from the newest to the oldest one, see records().
+    class RecordIterator {
+    public:
+        RecordIterator(const RingLogNVM *nvm, uint16_t back, uint16_t end)
+            : m_nvm(nvm)
+            , m_back(back)
+            , m_end(end)
+            , m_info()
+        {
+            if (m_back < m_end) {
+                m_nvm->readInfo(m_back, m_info);
+            }
+        }
+
+        const RecordInfo &operator*() const { return m_info; }
+
+        const RecordInfo *operator->() const { return &m_info; }
+
+        RecordIterator &operator++() {
+            ++m_back;
+            if (m_back < m_end) {
+                m_nvm->readInfo(m_back, m_info);
+            }
+            return *this;
+        }
+
+        bool operator==(const RecordIterator &other) const { return m_back == other.m_back; }
+
+        bool operator!=(const RecordIterator &other) const { return m_back != other.m_back; }
+
+    private:
+        const RingLogNVM   *m_nvm;
+        uint16_t            m_back;
+        uint16_t            m_end;
+        RecordInfo          m_info;
+    };
+
+    /// Range of the latest records for use in a range based for loop, see records().
+    class RecordRange {
+    public:
+        RecordRange(const RingLogNVM *nvm, uint16_t cnt) : m_nvm(nvm), m_cnt(cnt) {}
+
+        RecordIterator begin() const { return RecordIterator(m_nvm, 0, m_cnt); }
+
+        RecordIterator end() const { return RecordIterator(m_nvm, m_cnt, m_cnt); }
+
+    private:
+        const RingLogNVM   *m_nvm;
+        uint16_t            m_cnt;
+    };
+
+    RingLogNVM();
+
+    /**
+     * Initialize RingLogNVM.
+     * Call this once before every other call. Finds the newest record by a binary search over the sequence numbers.
+     * @return  true if NVM data is readable, false if not or begin() is called twice.
+     */
+    bool begin();
+
+    /**
+     * Check if begin is called before and returns true.
+     * @return  true if RingLogNVM is ready for use.
+     */
+    bool isValid() const {
+        return m_initDone;
+    }
+
+    /**
+     * Get count of stored records, no NVM access.
+     * @return  0 .. S_RECORD_CNT
+     */
+    uint16_t getCount() const {
+        return m_count;
+    }
+
+    /**
+     * Append a record, if all positions are used the oldest record is overwritten.
+     * This is power fail safe, after a power loss the record is stored or not, only the oldest record may be lost.
+     * @param data  Data to write, RECORD_SIZE bytes
+     * @return      true on success else false
+     */
+    bool append(const uint8_t *data);
+
+    /**
+     * Append a record, see append().
+     */
+    template <class T>
+    bool append(const T &data) {
+      static_assert(sizeof(T) == RECORD_SIZE, "Size of T must be RECORD_SIZE.");
+      return append((const uint8_t *)&data);
+    }
+
+    /**
+     * Read a record by age.
+     * @param       back    Age of the record, 0 is the newest one, getCount() - 1 the oldest one
+     * @param[out]  data    Buffer for RECORD_SIZE bytes
+     * @param[out]  seq     Sequence number of the record if not NULL
+     * @return      true on success, false if there is no such record or it is corrupted
+     */
+    bool readRecord(uint16_t back, uint8_t *data, uint16_t *seq = NULL) const;
+
+    /**
+     * Read a record by age, see readRecord().
+     */
+    template <class T>
+    bool readRecord(uint16_t back, T &data, uint16_t *seq = NULL) const {
+      static_assert(sizeof(T) == RECORD_SIZE, "Size of T must be RECORD_SIZE.");
+      return readRecord(back, (uint8_t *)&data, seq);
+    }
+
+    /**
+     * Get the latest records from the newest to the oldest one.
+     * Every record is read by one NVM read. Do not append records while iterating.
+     *
+     *     for (auto rec : ringNVM.records(10)) {
+     *       // use rec.seq, rec.data, ... if rec.valid
+     *     }
+     *
+     * @param cnt   Max. count of records
+     * @return      Range of RecordInfo
+     */
+    RecordRange records(uint16_t cnt = S_RECORD_CNT) const {
+        return RecordRange(this, m_initDone ? ((cnt < m_count) ? cnt : m_count) : 0);
+    }
+
+#ifdef SLOTNVM_STATS
+    /**
+     * Get statistics of NVM access, see SlotNVM::getStats().
+     * Only reads, writes, bytesRead, bytesWritten and crcErrors are counted,
+     * crcErrors counts records with wrong CRC or sequence number found while reading.
+     */
+    using CountingNVM<BASE>::getStats;
+
+    /**
+     * Set all statistics to 0.
+     */
+    using CountingNVM<BASE>::resetStats;
+#endif
+
+private:
+    bool            m_initDone;
+    uint16_t        m_head;                         // position of the newest record
+    uint16_t        m_headSeq;                      // sequence number of the newest record
+    uint16_t        m_count;
+    inline static nvm_address_t recordAddr(uint16_t pos) {
+        return pos * S_RECORD_LEN;
+    }
+
+    inline static uint16_t seqAdd(uint16_t seq, uint16_t n) {
+        return ((uint32_t)seq + n) % S_SEQ_CNT;
+    }
+
+    inline static uint16_t seqSub(uint16_t seq, uint16_t n) {
+        return ((uint32_t)seq + S_SEQ_CNT - n) % S_SEQ_CNT;
+    }
+
+    inline static uint8_t crc_buf(uint8_t crc, const uint8_t *data, nvm_size_t len) {
+        for (nvm_size_t i = 0; i < len; ++i) {
+            crc = CRC_FUNC(crc, data[i]);
+        }
+        return crc;
+    }
+
+    // position of a record by age
+    inline uint16_t position(uint16_t back) const {
+        return (m_head + S_RECORD_CNT - back) % S_RECORD_CNT;
+    }
+
+    bool readSeq(uint16_t pos, uint16_t &seq) const;
+
+    bool readRecordAt(uint16_t pos, uint8_t *data, uint16_t &seq, bool &valid) const;
+
+    bool readInfo(uint16_t back, RecordInfo &info) const;
+};
+
+
+template <class BASE, nvm_size_t RECORD_SIZE, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+RingLogNVM<BASE, RECORD_SIZE, CRC_FUNC>::RingLogNVM()
+    : m_initDone(false)
+    , m_head(S_RECORD_CNT - 1)                      // so the first record is written at position 0 ...
+    , m_headSeq(S_SEQ_CNT - 1)                      // ... with sequence number 0
+    , m_count(0)
+{
+}
+
+template <class BASE, nvm_size_t RECORD_SIZE, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool RingLogNVM<BASE, RECORD_SIZE, CRC_FUNC>::begin() {
+    if (m_initDone) return false;
+
+    // a valid record at position 0 is part of the newest lap, if it was written at a power loss position 1 is
+    uint16_t anchor = 0;
+    uint16_t anchorSeq;
+    bool valid;
+    bool res = readRecordAt(anchor, NULL, anchorSeq, valid);
+    if (!res) return false;
+    if (!valid) {
+        anchor = 1;
+        res = readRecordAt(anchor, NULL, anchorSeq, valid);
+        if (!res) return false;
+    }
+
+    if (valid) {
+        // binary search for the last position continuing the sequence numbers of the anchor
+        uint16_t lo = anchor;                       // continues the sequence
+        uint16_t hi = S_RECORD_CNT;                 // does not continue the sequence
+        while (hi - lo > 1) {
+            uint16_t mid = lo + (hi - lo) / 2;
+            uint16_t seq;
+            res = readSeq(mid, seq);
+            if (!res) return false;
+            if (seq == seqAdd(anchorSeq, mid - anchor)) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+
+        // the sequence number is written last so the head is complete, but it may continue the sequence by chance
+        while (lo > anchor) {
+            uint16_t seq;
+            res = readRecordAt(lo, NULL, seq, valid);
+            if (!res) return false;
+            if (valid) break;
+            --lo;
+        }
+        m_head = lo;
+        m_headSeq = seqAdd(anchorSeq, lo - anchor);
+
+        // all positions are used if the records behind the head are the oldest ones, the first one may be lost
+        m_count = lo + 1 - anchor;
+        for (uint16_t skip = 1; skip <= 2; ++skip) {
+            uint16_t seq;
+            res = readRecordAt((m_head + skip) % S_RECORD_CNT, NULL, seq, valid);
+            if (!res) return false;
+            if (valid && (seq == seqSub(m_headSeq, S_RECORD_CNT - skip))) {
+                m_count = S_RECORD_CNT + 1 - skip;
+                break;
+            }
+        }
+    }
+
+    m_initDone = true;
+
+    return m_initDone;
+}
+
+template <class BASE, nvm_size_t RECORD_SIZE, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool RingLogNVM<BASE, RECORD_SIZE, CRC_FUNC>::append(const uint8_t *data) {
+    if (!m_initDone) return false;
+    if (data == NULL) return false;
+
+    uint16_t pos = (m_head + 1) % S_RECORD_CNT;
+    uint16_t seq = seqAdd(m_headSeq, 1);
+    nvm_address_t addr = recordAddr(pos);
+
+    uint8_t s[2];
+    s[0] = seq;
+    s[1] = seq >> 8;
+    uint8_t buf[RECORD_SIZE + 1];
+    memcpy(buf, data, RECORD_SIZE);
+    buf[RECORD_SIZE] = crc_buf(crc_buf(S_CRC_START, s, 2), data, RECORD_SIZE);
+    bool res = this->write(addr + 2, buf, RECORD_SIZE + 1);
+    if (!res) return false;
+
+    // now make record valid
+    res = this->write(addr, s, 2);
+    if (!res) return false;
+
+    m_head = pos;
+    m_headSeq = seq;
+    if (m_count < S_RECORD_CNT) ++m_count;
+    return true;
+}
+
+template <class BASE, nvm_size_t RECORD_SIZE, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool RingLogNVM<BASE, RECORD_SIZE, CRC_FUNC>::readRecord(uint16_t back, uint8_t *data, uint16_t *seq) const {
+    if (!m_initDone) return false;
+    if (back >= m_count) return false;
+    if (data == NULL) return false;
+
+    uint16_t recSeq;
+    bool valid;
+    bool res = readRecordAt(position(back), data, recSeq, valid);
+    if (!res || !valid || (recSeq != seqSub(m_headSeq, back))) return false;
+    if (seq != NULL) {
+        *seq = recSeq;
+    }
+    return true;
+}
+
+template <class BASE, nvm_size_t RECORD_SIZE, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool RingLogNVM<BASE, RECORD_SIZE, CRC_FUNC>::readSeq(uint16_t pos, uint16_t &seq) const {
+    uint8_t s[2];
+    bool res = this->read(recordAddr(pos), s, 2);
+    seq = s[0] | (s[1] << 8);
+    return res;
+}
+
+template <class BASE, nvm_size_t RECORD_SIZE, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool RingLogNVM<BASE, RECORD_SIZE, CRC_FUNC>::readRecordAt(uint16_t pos, uint8_t *data, uint16_t &seq, bool &valid) const {
+    uint8_t buf[S_RECORD_LEN];
+    bool res = this->read(recordAddr(pos), buf, S_RECORD_LEN);
+    if (!res) return false;
+    seq = buf[0] | (buf[1] << 8);
+    valid = (seq < S_SEQ_CNT) && (buf[S_RECORD_LEN - 1] == crc_buf(S_CRC_START, buf, S_RECORD_LEN - 1));
+    if (!valid) {
+        _SLOTNVM_STATS_ADD_(crcErrors, 1);
+    }
+    if (data != NULL) {
+        memcpy(data, buf + 2, RECORD_SIZE);
+    }
+    return true;
+}
+
+template <class BASE, nvm_size_t RECORD_SIZE, uint8_t (*CRC_FUNC)(uint8_t, uint8_t)>
+bool RingLogNVM<BASE, RECORD_SIZE, CRC_FUNC>::readInfo(uint16_t back, RecordInfo &info) const {
+    bool res = readRecordAt(position(back), info.data, info.seq, info.valid);
+    if (!res) {
+        info.valid = false;
+        return false;
+    }
+    info.valid = info.valid && (info.seq == seqSub(m_headSeq, back));
+    return true;
+}
+
+#endif // _SLOTNVM_RINGLOGNVM_H_
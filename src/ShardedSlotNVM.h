@@ -0,0 +1,354 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SHARDEDSLOTNVM_H_
+#define _SLOTNVM_SHARDEDSLOTNVM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "NVMBase.h"
+
+#ifndef __AVR_ARCH__
+#include <thread>
+#endif
+
+/**
+ * Range placement for ShardedSlotNVM.
+ * The first S_LAST_SLOT slots are stored in the first shard, the next ones in the second shard and so on.
+ * Because S_LAST_SLOT of a SlotNVM is its count of clusters (max. 250), every device gets a share of slot numbers
+ * which fits to its capacity. Related data with neighboring slot numbers stays on one device.
+ * @param       slot        Slot number of the sharded store, starting with 1
+ * @param       shardCnt    Count of shards
+ * @param       lastSlots   S_LAST_SLOT of every shard
+ * @param[out]  shard       Index of the shard
+ * @param[out]  localSlot   Slot number inside the shard
+ * @return      false if the slot number is out of range
+ */
+inline bool shardRangePlacement(uint16_t slot, uint8_t shardCnt, const uint8_t lastSlots[], uint8_t &shard, uint8_t &localSlot) {
+    if (slot < 1) return false;
+    for (uint8_t i = 0; i < shardCnt; ++i) {
+        if (slot <= lastSlots[i]) {
+            shard = i;
+            localSlot = slot;
+            return true;
+        }
+        slot -= lastSlots[i];
+    }
+    return false;
+}
+
+/**
+ * Interleaved placement for ShardedSlotNVM.
+ * Slot numbers are distributed round robin over all shards, so accesses to neighboring slots are spread over
+ * all devices. A shard which has no more local slot numbers is skipped, so bigger devices get more slots.
+ * @param       slot        Slot number of the sharded store, starting with 1
+ * @param       shardCnt    Count of shards
+ * @param       lastSlots   S_LAST_SLOT of every shard
+ * @param[out]  shard       Index of the shard
+ * @param[out]  localSlot   Slot number inside the shard
+ * @return      false if the slot number is out of range
+ */
+inline bool shardInterleavedPlacement(uint16_t slot, uint8_t shardCnt, const uint8_t lastSlots[], uint8_t &shard, uint8_t &localSlot) {
+    if (slot < 1) return false;
+    uint16_t idx = slot - 1;
+    for (uint16_t round = 0; round < 250; ++round) {
+        for (uint8_t i = 0; i < shardCnt; ++i) {
+            if (lastSlots[i] <= round) continue;    // shard is full
+            if (idx == 0) {
+                shard = i;
+                localSlot = round + 1;
+                return true;
+            }
+            --idx;
+        }
+    }
+    return false;
+}
+
+/// Signature of a placement function, see shardRangePlacement().
+typedef bool (*ShardPlacement)(uint16_t slot, uint8_t shardCnt, const uint8_t lastSlots[], uint8_t &shard, uint8_t &localSlot);
+
+/// Forwards calls to the n-th SlotNVM of a ShardedSlotNVM.
+template <class... NVMS>
+class SlotNVMShards {
+public:
+    static const uint8_t S_CNT = 0;
+
+    static void lastSlots(uint8_t []) {}
+    bool begin(uint8_t) { return false; }
+    bool isValid(uint8_t) const { return false; }
+    bool isSlotAvailable(uint8_t, uint8_t) const { return false; }
+    bool writeSlot(uint8_t, uint8_t, const uint8_t *, nvm_size_t) { return false; }
+    bool readSlot(uint8_t, uint8_t, uint8_t *, nvm_size_t &) const { return false; }
+    bool eraseSlot(uint8_t, uint8_t) { return false; }
+    nvm_size_t getSize(uint8_t) const { return 0; }
+    nvm_size_t getUsableSize(uint8_t) const { return 0; }
+    nvm_size_t getFree(uint8_t) const { return 0; }
+};
+
+template <class NVM, class... NVMS>
+class SlotNVMShards<NVM, NVMS...> {
+public:
+    static const uint8_t S_CNT = 1 + SlotNVMShards<NVMS...>::S_CNT;
+
+    SlotNVMShards(NVM &nvm, NVMS &...nvms) : m_nvm(nvm), m_rest(nvms...) {}
+
+    static void lastSlots(uint8_t slots[]) {
+        slots[0] = NVM::S_LAST_SLOT;
+        SlotNVMShards<NVMS...>::lastSlots(slots + 1);
+    }
+
+    bool begin(uint8_t shard) {
+        return (shard == 0) ? m_nvm.begin() : m_rest.begin(shard - 1);
+    }
+
+    bool isValid(uint8_t shard) const {
+        return (shard == 0) ? m_nvm.isValid() : m_rest.isValid(shard - 1);
+    }
+
+    bool isSlotAvailable(uint8_t shard, uint8_t slot) const {
+        return (shard == 0) ? m_nvm.isSlotAvailable(slot) : m_rest.isSlotAvailable(shard - 1, slot);
+    }
+
+    bool writeSlot(uint8_t shard, uint8_t slot, const uint8_t *data, nvm_size_t len) {
+        return (shard == 0) ? m_nvm.writeSlot(slot, data, len) : m_rest.writeSlot(shard - 1, slot, data, len);
+    }
+
+    bool readSlot(uint8_t shard, uint8_t slot, uint8_t *data, nvm_size_t &len) const {
+        return (shard == 0) ? m_nvm.readSlot(slot, data, len) : m_rest.readSlot(shard - 1, slot, data, len);
+    }
+
+    bool eraseSlot(uint8_t shard, uint8_t slot) {
+        return (shard == 0) ? m_nvm.eraseSlot(slot) : m_rest.eraseSlot(shard - 1, slot);
+    }
+
+    nvm_size_t getSize(uint8_t shard) const {
+        return (shard == 0) ? m_nvm.getSize() : m_rest.getSize(shard - 1);
+    }
+
+    nvm_size_t getUsableSize(uint8_t shard) const {
+        return (shard == 0) ? m_nvm.getUsableSize() : m_rest.getUsableSize(shard - 1);
+    }
+
+    nvm_size_t getFree(uint8_t shard) const {
+        return (shard == 0) ? m_nvm.getFree() : m_rest.getFree(shard - 1);
+    }
+
+private:
+    NVM                     &m_nvm;
+    SlotNVMShards<NVMS...>  m_rest;
+};
+
+/**
+ * One slot store over several SlotNVM instances, e.g. two EEPROM chips and a FRAM.
+ * Every SlotNVM owns one device, the slot number space of this class is the sum of the slot numbers of all shards.
+ * The placement function maps a slot number to a shard and the slot number inside this shard,
+ * it is fixed, so no directory is stored and a slot is found again after restart.
+ * The placement must not be changed as long as data is stored.
+ *
+ * Each slot is stored completely on one device, so a write is still transactional.
+ * Different shards are independent, on hosts they can be accessed by different threads
+ * if every shard is protected by its own ConcurrentSlotNVM.
+ *
+ * @tparam PLACEMENT    Placement function, shardRangePlacement() or shardInterleavedPlacement().
+ * @tparam NVMS         SlotNVM classes of all shards.
+ */
+template <ShardPlacement PLACEMENT, class... NVMS>
+class ShardedSlotNVM {
+    static_assert(sizeof...(NVMS) > 0, "At least one shard is needed.");
+    static_assert(sizeof...(NVMS) < 256, "Max. 255 shards supported.");
+
+public:
+    /// Count of shards.
+    static const uint8_t S_SHARD_CNT = sizeof...(NVMS);
+    /// First allowed slot number.
+    static const uint16_t S_FIRST_SLOT = 1;
+
+    /**
+     * @param nvms  SlotNVM instances, one for each shard.
+     */
+    explicit ShardedSlotNVM(NVMS &...nvms) : m_shards(nvms...) {
+        SlotNVMShards<NVMS...>::lastSlots(m_lastSlots);
+        m_lastSlot = 0;
+        for (uint8_t i = 0; i < S_SHARD_CNT; ++i) {
+            m_lastSlot += m_lastSlots[i];
+        }
+    }
+
+    /**
+     * Initialize all shards. On hosts every shard is initialized in its own thread.
+     * @return true if all shards are valid
+     */
+    bool begin() {
+#ifndef __AVR_ARCH__
+        bool res[S_SHARD_CNT];
+        std::thread threads[S_SHARD_CNT];
+        for (uint8_t i = 0; i < S_SHARD_CNT; ++i) {
+            threads[i] = std::thread([this, i, &res]() { res[i] = m_shards.begin(i); });
+        }
+        bool ret = true;
+        for (uint8_t i = 0; i < S_SHARD_CNT; ++i) {
+            threads[i].join();
+            if (!res[i]) ret = false;
+        }
+        return ret;
+#else
+        bool ret = true;
+        for (uint8_t i = 0; i < S_SHARD_CNT; ++i) {
+            if (!m_shards.begin(i)) ret = false;
+        }
+        return ret;
+#endif
+    }
+
+    /**
+     * Check if begin of all shards is called before and returned true.
+     */
+    bool isValid() const {
+        for (uint8_t i = 0; i < S_SHARD_CNT; ++i) {
+            if (!m_shards.isValid(i)) return false;
+        }
+        return true;
+    }
+
+    /**
+     * Last allowed slot number, the sum of S_LAST_SLOT of all shards.
+     */
+    uint16_t getLastSlot() const {
+        return m_lastSlot;
+    }
+
+    /**
+     * Get shard and slot number inside the shard.
+     * @param       slot        Slot number
+     * @param[out]  shard       Index of the shard
+     * @param[out]  localSlot   Slot number inside the shard
+     * @return      false if the slot number is out of range
+     */
+    bool getPlacement(uint16_t slot, uint8_t &shard, uint8_t &localSlot) const {
+        if ((slot < S_FIRST_SLOT) || (slot > m_lastSlot)) return false;
+        return PLACEMENT(slot, S_SHARD_CNT, m_lastSlots, shard, localSlot);
+    }
+
+    /**
+     * Check if data is stored for a given slot.
+     * @param slot  Slot number
+     * @return true if data is available
+     */
+    bool isSlotAvailable(uint16_t slot) const {
+        uint8_t shard, localSlot;
+        if (!getPlacement(slot, shard, localSlot)) return false;
+        return m_shards.isSlotAvailable(shard, localSlot);
+    }
+
+    /**
+     * Write data to the shard of the slot.
+     * See SlotNVM::writeSlot().
+     * @return false if the slot number is out of range or the shard has not enough free space
+     */
+    bool writeSlot(uint16_t slot, const uint8_t *data, nvm_size_t len) {
+        uint8_t shard, localSlot;
+        if (!getPlacement(slot, shard, localSlot)) return false;
+        return m_shards.writeSlot(shard, localSlot, data, len);
+    }
+
+    /**
+     * Write data to the shard of the slot.
+     * See SlotNVM::writeSlot().
+     */
+    template <class T>
+    bool writeSlot(uint16_t slot, T &data) {
+      return writeSlot(slot, (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Read data from the shard of the slot.
+     * See SlotNVM::readSlot().
+     */
+    bool readSlot(uint16_t slot, uint8_t *data, nvm_size_t &len) const {
+        uint8_t shard, localSlot;
+        if (!getPlacement(slot, shard, localSlot)) return false;
+        return m_shards.readSlot(shard, localSlot, data, len);
+    }
+
+    /**
+     * Read data from the shard of the slot.
+     * See SlotNVM::readSlot().
+     */
+    template <class T>
+    bool readSlot(uint16_t slot, T &data) const {
+      nvm_size_t len = 0;
+      readSlot(slot, NULL, len);
+      if (len == sizeof(T)) {
+        return readSlot(slot, (uint8_t *)&data, len);
+      } else {
+        return false;
+      }
+    }
+
+    /**
+     * Delete slot data.
+     * See SlotNVM::eraseSlot().
+     */
+    bool eraseSlot(uint16_t slot) {
+        uint8_t shard, localSlot;
+        if (!getPlacement(slot, shard, localSlot)) return false;
+        return m_shards.eraseSlot(shard, localSlot);
+    }
+
+    /**
+     * Get amount of total available user data of all shards.
+     */
+    uint32_t getSize() const {
+        uint32_t size = 0;
+        for (uint8_t i = 0; i < S_SHARD_CNT; ++i) {
+            size += m_shards.getSize(i);
+        }
+        return size;
+    }
+
+    /**
+     * Get amount of total usable user data of all shards.
+     */
+    uint32_t getUsableSize() const {
+        uint32_t size = 0;
+        for (uint8_t i = 0; i < S_SHARD_CNT; ++i) {
+            size += m_shards.getUsableSize(i);
+        }
+        return size;
+    }
+
+    /**
+     * Get amount of free user data of all shards.
+     * A slot can only use the free space of its own shard, see getFree(uint16_t).
+     */
+    uint32_t getFree() const {
+        uint32_t free = 0;
+        for (uint8_t i = 0; i < S_SHARD_CNT; ++i) {
+            free += m_shards.getFree(i);
+        }
+        return free;
+    }
+
+    /**
+     * Get amount of free user data of the shard a slot is stored in.
+     * @param slot  Slot number
+     * @return free bytes or 0 if slot number is out of range
+     */
+    nvm_size_t getFree(uint16_t slot) const {
+        uint8_t shard, localSlot;
+        if (!getPlacement(slot, shard, localSlot)) return 0;
+        return m_shards.getFree(shard);
+    }
+
+private:
+    SlotNVMShards<NVMS...>  m_shards;
+    uint8_t                 m_lastSlots[S_SHARD_CNT];
+    uint16_t                m_lastSlot;
+};
+
+#endif // _SLOTNVM_SHARDEDSLOTNVM_H_
@@ -12,6 +12,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include "NVMBase.h"
+#include "SlotNVMECC.h"
+#include "SlotNVMCompress.h"
+#include "SlotNVMStats.h"
 
 #ifdef __AVR_ARCH__
   #define _SLOTNVM_FLASHMEM_ PROGMEM
@@ -33,7 +36,11 @@
  *              0x00 or 0xFF cluster not used
  *              0x01 .. 0xFA a valid slot number
  *              0xFB .. 0xFE reserved for future use
- *  1       Bit 0-2 - unused, maybe later for extended length
+ *  1       Bit 0   - only in start cluster with EXTENTS: extent header, see below
+ *          Bit 1   - in start cluster: chain with appended runs, see below
+ *                    in other clusters: last cluster of an appended run
+ *          Bit 2   - only in start cluster: user data is compressed, see SlotNVMCompress.
+ *                    The first data byte is the uncompressed size - 1, byte 3 the stored size - 1.
  *          Bit 3   - skip CRC, 1 byte more user data, currently not supported
  *          Bit 4   - last cluster
  *          Bit 5   - start cluster
@@ -45,11 +52,29 @@
  *
  *  4..n-3  User data
  *
+ *  n-4/n-3 Only with ECC: SEC-DED code over byte 0..n-5 and the CRC, see SlotNVMECC.
+ *          Without CRC at n-3/n-2. Unused user data bytes are written with 0.
  *  n-2     CRC-8 if CRC_FUNC is not NULL else also user data
  *  n-1     End byte must be 0xA0 for SlotNVM without CRC
- *                           0xA1 for SlotNVM with CRC.
+ *                           0xA1 for SlotNVM with CRC
+ *                           0xA2 for SlotNVM without CRC but with ECC
+ *                           0xA3 for SlotNVM with CRC and ECC.
  *          Other values make this cluster invalid.
  *          The value might change with incompatible structure changes.
+ *
+ * Extent (only with EXTENTS): a start cluster with bit 0 in byte 1 and the last cluster flag is followed by
+ * raw blocks in the next clusters without any header, byte 2 is the count of raw blocks.
+ * The start cluster holds the first user data, the raw blocks the rest with CLUSTER_SIZE - 1 bytes each.
+ * Byte 0 of a raw block is always 0x00, so a raw block is never taken as cluster, even if the header is lost.
+ * The CRC of the start cluster covers byte 0..3 and all user data including the raw blocks.
+ *
+ * Appended runs (only with APPEND, see appendSlot()): the start cluster is followed by runs of clusters, the newest first.
+ * Every run but the oldest one ends with a cluster with bit 1 set, pointing to the first cluster of the next
+ * older run, the oldest one ends with the last cluster. So the user data is the data of the start cluster
+ * followed by the data of all runs from the oldest to the newest. Byte 3 of every cluster behind the start
+ * cluster is the count of used bytes. appendSlot() writes full clusters as one run and the rest as a single
+ * cluster run, so only the newest run and the oldest one may be partially used. The clusters of one run have the same age,
+ * different runs may have different ages.
  */
 
 
@@ -71,11 +96,21 @@
  * @tparam RND_TYPE         Return type of RND_FUNC.
  * @tparam RND_FUNC         Random function for wear leveling. Default is rand() from stdlib.h.
  *                          Please do not forget to call srand().
+ * @tparam ECC              true stores a 2 byte error correcting code in every cluster, see SlotNVMECC.
+ *                          One bit error per cluster is corrected by begin() and readSlot(), two bit errors are detected.
+ *                          begin() writes the corrected byte back to NVM. Reduces user data by 2 bytes per cluster.
+ * @tparam COMPRESS         true compresses slot data by writeSlot() if it gets shorter, see SlotNVMCompress.
+ *                          readSlot() and writeSlot() need up to the slot size of stack for the compressed data.
+ * @tparam EXTENTS          true writes a slot of more than one cluster as one header cluster followed by raw blocks
+ *                          if enough free clusters in a row are found, else as chain. Needs a CRC_FUNC, no ECC.
+ * @tparam APPEND           true lets appendSlot() write only the new data as appended runs, else the whole slot is
+ *                          rewritten. Appended slots can not be read by a SlotNVM without APPEND.
  */
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION = 0, uint8_t LAST_SLOT = 0,
           uint8_t (*CRC_FUNC)(uint8_t crc, uint8_t data) = (uint8_t (*)(uint8_t, uint8_t))NULL,
-          typename RND_TYPE = int, RND_TYPE (*RND_FUNC)() = &rand>
-class SlotNVM : private BASE {
+          typename RND_TYPE = int, RND_TYPE (*RND_FUNC)() = &rand, bool ECC = false, bool COMPRESS = false,
+          bool EXTENTS = false, bool APPEND = false>
+class SlotNVM : private CountingNVM<BASE> {
     static_assert(CLUSTER_SIZE <= 256, "CLUSTER_SIZE must be less or equal to 256.");
     static_assert(LAST_SLOT <= 250, "LAST_SLOT must be less or equal to 250.");
 
@@ -83,7 +118,7 @@ public:
     /// Count of clusters.
     static const uint16_t S_CLUSTER_CNT = BASE::S_SIZE / CLUSTER_SIZE;
     /// Max size of user data in one cluster.
-    static const uint8_t S_USER_DATA_PER_CLUSTER = CLUSTER_SIZE - 6 + ((CRC_FUNC == NULL) ? 1 : 0);
+    static const uint8_t S_USER_DATA_PER_CLUSTER = CLUSTER_SIZE - 6 + ((CRC_FUNC == NULL) ? 1 : 0) - (ECC ? 2 : 0);
     /// Count of reserved user bytes for overwriting slots.
     static const uint16_t S_PROVISION = ((PROVISION + S_USER_DATA_PER_CLUSTER - 1) / S_USER_DATA_PER_CLUSTER) * S_USER_DATA_PER_CLUSTER;
     /// First allowed slot number.
@@ -91,17 +126,81 @@ public:
     /// Last allowed slot number.
     static const uint8_t S_LAST_SLOT = LAST_SLOT == 0 ? (S_CLUSTER_CNT > 250 ? 250 : S_CLUSTER_CNT) : (LAST_SLOT > 250 ? 250 : LAST_SLOT);
 private:
-    static const uint8_t S_END_BYTE = 0xA0 + ((CRC_FUNC == NULL) ? 0 : 1);
+    static const uint8_t S_END_BYTE = 0xA0 + ((CRC_FUNC == NULL) ? 0 : 1) + (ECC ? 2 : 0);
+    static const uint8_t S_ECC_OFFSET = 4 + S_USER_DATA_PER_CLUSTER;                // offset of ECC in cluster
+    static const uint8_t S_ECC_CNT = S_ECC_OFFSET + ((CRC_FUNC == NULL) ? 0 : 1);   // count of bytes protected by ECC
+    static const uint8_t S_USER_DATA_PER_BLOCK = CLUSTER_SIZE - 1;                 // raw block of an extent
     static const uint8_t S_AGE_MASK = 0xC0;
     static const uint8_t S_AGE_SHIFT = 6;
     static const uint8_t S_START_CLUSTER_FLAG = 0x20;
     static const uint8_t S_LAST_CLUSTER_FLAG = 0x10;
+    static const uint8_t S_COMPRESSED_FLAG = 0x04;
+    static const uint8_t S_EXTENT_FLAG = 0x01;
+    static const uint8_t S_APPENDED_FLAG = 0x02;                                   // start cluster
+    static const uint8_t S_RUN_END_FLAG = 0x02;                                     // other clusters
     static const uint8_t S_AGE_BITS_TO_OLDEST[];
 
     static_assert(S_CLUSTER_CNT <= 256, "Max. 256 cluster supported, please increase CLUSTER_SIZE.");
+    static_assert(!ECC || (CLUSTER_SIZE >= 9), "ECC needs a CLUSTER_SIZE of at least 9.");
+    static_assert(!EXTENTS || (CRC_FUNC != NULL), "EXTENTS needs a CRC_FUNC.");
+    static_assert(!EXTENTS || !ECC, "EXTENTS can not be used with ECC.");
     static_assert((2*PROVISION) <= (S_USER_DATA_PER_CLUSTER*S_CLUSTER_CNT), "PROVISION must be less or equal to the half of available user data.");    
 
 public:
+    /// Information about one stored slot, see slots().
+    struct SlotInfo {
+        uint8_t     slot;           ///< Slot number
+        nvm_size_t  len;            ///< Size of slot data in bytes
+        uint8_t     clusterCnt;     ///< Count of clusters used by this slot
+        uint8_t     age;            ///< Age 0..3, increased every time the slot is rewritten
+    };
+
+    /// Iterator over all stored slots, see slots().
+    class SlotIterator {
+    public:
+        SlotIterator(const SlotNVM *nvm, uint16_t cluster)
+            : m_nvm(nvm)
+            , m_cluster(cluster)
+            , m_info()
+        {
+            if (m_cluster < S_CLUSTER_CNT) {
+                m_nvm->nextSlotInfo(m_cluster, m_info);
+            }
+        }
+
+        const SlotInfo &operator*() const { return m_info; }
+
+        const SlotInfo *operator->() const { return &m_info; }
+
+        SlotIterator &operator++() {
+            ++m_cluster;
+            m_nvm->nextSlotInfo(m_cluster, m_info);
+            return *this;
+        }
+
+        bool operator==(const SlotIterator &other) const { return m_cluster == other.m_cluster; }
+
+        bool operator!=(const SlotIterator &other) const { return m_cluster != other.m_cluster; }
+
+    private:
+        const SlotNVM  *m_nvm;
+        uint16_t        m_cluster;
+        SlotInfo        m_info;
+    };
+
+    /// Range of all stored slots for use in a range based for loop, see slots().
+    class SlotRange {
+    public:
+        explicit SlotRange(const SlotNVM *nvm) : m_nvm(nvm) {}
+
+        SlotIterator begin() const { return SlotIterator(m_nvm, m_nvm->isValid() ? 0 : S_CLUSTER_CNT); }
+
+        SlotIterator end() const { return SlotIterator(m_nvm, S_CLUSTER_CNT); }
+
+    private:
+        const SlotNVM  *m_nvm;
+    };
+
     SlotNVM();
 
     /**
@@ -149,6 +248,21 @@ public:
       return writeSlot(slot, (const uint8_t *)&data, sizeof(T));
     }
 
+    /**
+     * Append data to a slot, a not available slot is written like by writeSlot().
+     * With APPEND only the start cluster is rewritten, the new data is written to new clusters linked behind it,
+     * so the cost depends on the size of the new data, not of the slot.
+     * If the newest data is in a single partially used cluster, this cluster is replaced and its data is
+     * written again together with the new data, so many small appends fill up clusters.
+     * This is as power fail safe as writeSlot(), after a power loss the slot has the old or the new data.
+     * Without APPEND and for compressed slots, extents and ECC the slot is rewritten as whole by writeSlot().
+     * @param slot  Slot number
+     * @param data  Data to append
+     * @param len   Length of data to append, the slot can not exceed 256 bytes
+     * @return      true on success else false
+     */
+    bool appendSlot(uint8_t slot, const uint8_t *data, nvm_size_t len);
+
     /**
      * Read data
      * If buffer is to small, nothing is read but len is set to needed size and false is returned.
@@ -181,6 +295,43 @@ public:
       }
     }
 
+    /**
+     * Read a part of slot data.
+     * Only the clusters holding the requested bytes are read, clusters in front of them cost one read of their next
+     * cluster link, so the cost depends on len and not on the slot size.
+     * ECC and compressed slots are read as whole, because every cluster must be checked or the data decompressed.
+     * @param       slot    Slot number
+     * @param       offset  Offset of first byte to read
+     * @param[out]  data    Buffer to read in
+     * @param       len     Count of bytes to read
+     * @return      false if the slot does not store at least offset + len bytes
+     */
+    bool readSlotRange(uint8_t slot, nvm_size_t offset, uint8_t *data, nvm_size_t len) const;
+
+    /**
+     * Read a part of slot data, e.g. a member of a struct stored by writeSlot().
+     * @param       slot    Slot number
+     * @param       offset  Offset of first byte to read
+     * @param[out]  data    Data to read in
+     * @return      true on success else false
+     */
+    template <class T>
+    bool readSlotRange(uint8_t slot, nvm_size_t offset, T &data) const {
+      return readSlotRange(slot, offset, (uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Read data of several slots.
+     * All start clusters are searched in one pass over the NVM, so this is faster than calling readSlot() for each slot.
+     * Every slot is handled like in readSlot(), so you can set a buffer to NULL and its length to 0 to read the data length.
+     * @param           cnt     Count of slots to read
+     * @param           slots   Slot numbers, cnt entries
+     * @param           data    Buffers to read in, cnt entries
+     * @param[in,out]   len     Sizes of data buffers, cnt entries, see readSlot()
+     * @return      true if all slots were read successfully else false
+     */
+    bool readSlots(uint8_t cnt, const uint8_t slots[], uint8_t *data[], nvm_size_t len[]) const;
+
     /**
      * Delete slot data.
      * @param slot  Slot number
@@ -211,11 +362,64 @@ public:
      */
     nvm_size_t getFree() const;
 
+    /**
+     * Get all stored slots.
+     * All slots are found in one pass over the NVM, this is faster than calling readSlot() for each slot to get its size.
+     * Slots are not sorted by number but by position in NVM.
+     * Do not write or erase slots while iterating.
+     * 
+     *     for (auto info : slotNVM.slots()) {
+     *       // use info.slot, info.len, ...
+     *     }
+     * 
+     * @return  Range of SlotInfo for every stored slot
+     */
+    SlotRange slots() const {
+        return SlotRange(this);
+    }
+
+#ifdef SLOTNVM_STATS
+    /**
+     * Get statistics of NVM access since construction or last call of resetStats().
+     * Only available if SLOTNVM_STATS is defined.
+     */
+    using CountingNVM<BASE>::getStats;
+
+    /**
+     * Set all statistics to 0.
+     * Only available if SLOTNVM_STATS is defined.
+     */
+    using CountingNVM<BASE>::resetStats;
+#endif
+
+protected:
+    /**
+     * Write a new chain for slot without freeing the old one, used by writeSlot().
+     * Until clearClusters(oldStartCluster) is called, the old chain stays readable and its clusters are not reused.
+     * @param       slot                Slot number
+     * @param       data                User data
+     * @param       len                 Length of user data
+     * @param[out]  startCluster        Start cluster of the new chain
+     * @param[out]  overwrite           true if the slot had data before
+     * @param[out]  oldStartCluster     Start cluster of the old chain if overwrite is true
+     * @return      true on success
+     */
+    bool writeChain(uint8_t slot, const uint8_t *data, nvm_size_t len,
+                    uint8_t &startCluster, bool &overwrite, uint8_t &oldStartCluster);
+
+    bool clearClusters(uint8_t firstCluster);
+
+    bool findStartCluser(uint8_t slot, uint8_t &startCluster) const;
+
+    bool findStartClusters(uint8_t cnt, const uint8_t slots[], uint8_t startClusters[], uint8_t found[]) const;
+
+    bool readChain(uint8_t startCluster, uint8_t *data, nvm_size_t &len) const;
+
 private:
     bool    m_initDone;
     uint8_t m_slotAvail[(S_LAST_SLOT + 7) / 8];
     uint8_t m_usedCluster[S_CLUSTER_CNT / 8];
-
+    uint8_t m_extentBlock[EXTENTS ? S_CLUSTER_CNT / 8 : 1];     // raw blocks of extents, no cluster header
     inline static void setClusterBit(uint8_t usedCluster[S_CLUSTER_CNT / 8], uint8_t cluster) {
         usedCluster[cluster / 8] |= 1 << (cluster % 8);
     }
@@ -240,6 +444,31 @@ private:
         return isClusterBitSet(m_usedCluster, cluster);
     }
 
+    inline static bool isExtent(uint8_t flags) {
+        const uint8_t mask = S_START_CLUSTER_FLAG | S_LAST_CLUSTER_FLAG | S_EXTENT_FLAG;
+        return EXTENTS && ((flags & mask) == mask);
+    }
+
+    // count of raw blocks behind the header cluster for len bytes of user data
+    inline static uint8_t extentBlocks(nvm_size_t len) {
+        return (len - S_USER_DATA_PER_CLUSTER + S_USER_DATA_PER_BLOCK - 1) / S_USER_DATA_PER_BLOCK;
+    }
+
+    inline bool isExtentBlock(uint8_t cluster) const {
+        return EXTENTS && ((m_extentBlock[cluster / 8] & (1 << (cluster % 8))) != 0);
+    }
+
+    inline void setExtentBlock(uint8_t cluster, bool used) {
+        if (!EXTENTS) return;
+        if (used) {
+            setClusterBit(cluster);
+            m_extentBlock[cluster / 8] |= 1 << (cluster % 8);
+        } else {
+            clearClusterBit(cluster);
+            m_extentBlock[cluster / 8] &= ~(1 << (cluster % 8));
+        }
+    }
+
     inline static void setSlotBit(uint8_t slotAvail[(S_LAST_SLOT + 7) / 8], uint8_t slot) {
         if ((slot >= S_FIRST_SLOT) && (slot <= S_LAST_SLOT)) {
             slot -= S_FIRST_SLOT;
@@ -277,9 +506,42 @@ private:
 
     bool clearCluster(uint8_t cluster);
 
-    bool clearClusters(uint8_t firstCluster);
+    bool scrubCluster(uint8_t cluster, uint8_t &slot);
 
-    bool findStartCluser(uint8_t slot, uint8_t &startCluster) const;
+    bool readChainECC(uint8_t startCluster, uint8_t *data, nvm_size_t &len) const;
+
+    bool readChainData(uint8_t startCluster, uint8_t *data, nvm_size_t &len) const;
+
+    bool readAppendedRuns(uint8_t cluster, uint8_t *data, nvm_size_t len) const;
+
+    bool readAppendedRange(uint8_t cluster, nvm_size_t runsLen, nvm_size_t offset, uint8_t *data, nvm_size_t len) const;
+
+    bool readStartHeader(uint8_t startCluster, uint8_t header[5]) const;
+
+    bool writeChainData(uint8_t slot, const uint8_t *data, nvm_size_t len, uint8_t startFlags,
+                        uint8_t &startCluster, bool &overwrite, uint8_t &oldStartCluster);
+
+    bool allocClusters(uint8_t cnt, uint8_t clusters[]) const;
+
+    bool writeCluster(uint8_t cluster, const uint8_t header[4], const uint8_t *data, nvm_size_t len);
+
+    bool findFreeRun(uint8_t cnt, uint8_t &firstCluster) const;
+
+    bool writeExtent(uint8_t cluster, const uint8_t header[4], const uint8_t *data, nvm_size_t len);
+
+    bool readExtentCRC(uint8_t cluster, nvm_size_t len, uint8_t &crc) const;
+
+    bool readExtentBlocks(uint8_t cluster, nvm_size_t offset, uint8_t *data, nvm_size_t len) const;
+
+    bool freeExtentBlocks(uint8_t cluster);
+
+    bool writeECC(nvm_address_t cAddr, const uint8_t header[4], const uint8_t *data, nvm_size_t len, uint8_t crc);
+
+    static uint16_t eccCode(const uint8_t cluster[CLUSTER_SIZE]);
+
+    static SlotNVMECC::Result eccCorrect(uint8_t cluster[CLUSTER_SIZE], uint8_t &offset);
+
+    void nextSlotInfo(uint16_t &cluster, SlotInfo &info) const;
 
     bool nextFreeCluster(uint8_t &nextCluster) const;
 
@@ -289,6 +551,21 @@ private:
         }
         return crc;
     }
+
+    // move the last len - shift bytes to the front, by three reversals
+    static void rotate(uint8_t *data, nvm_size_t len, nvm_size_t shift) {
+        reverse(data, shift);
+        reverse(data + shift, len - shift);
+        reverse(data, len);
+    }
+
+    static void reverse(uint8_t *data, nvm_size_t len) {
+        for (nvm_size_t i = 0; i < len / 2; ++i) {
+            uint8_t d = data[i];
+            data[i] = data[len - 1 - i];
+            data[len - 1 - i] = d;
+        }
+    }
 };
 
 #if defined(__AVR_ARCH__) && defined(E2END)
@@ -384,8 +661,8 @@ private:
 #endif
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-const uint8_t SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::S_AGE_BITS_TO_OLDEST[] _SLOTNVM_FLASHMEM_ = {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+const uint8_t SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::S_AGE_BITS_TO_OLDEST[] _SLOTNVM_FLASHMEM_ = {
         0xF0,   // _ _ _ _  => 0    Error (no age)
         0x00,   // 1 _ _ _  => 0    OK
         0x01,   // _ 1 _ _  => 1    OK
@@ -405,18 +682,19 @@ const uint8_t SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TY
     };
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::SlotNVM()
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::SlotNVM()
     : m_initDone(false)
     , m_slotAvail{0}
     , m_usedCluster{0}
+    , m_extentBlock{0}
 {
     // ToDo
 }
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::begin() {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::begin() {
     if (m_initDone) return false;
 
     // first check used cluster and available slots
@@ -428,6 +706,10 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
 
         bool res = this->read(cAddr, slot);                            // read slot no.
         if (!res) return false;
+        if (ECC && (slot != 0x00)) {                                    // a cleared cluster is never corrected
+            res = scrubCluster(cluster, slot);
+            if (!res) return false;
+        }
         if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) continue;    // skip unused
         if (CRC_FUNC != NULL) {
             crc = CRC_FUNC(crc, slot);
@@ -437,22 +719,36 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
         if (!res) return false;
         if (S_END_BYTE != d) continue;                                  // skip incomplete written
 
+        uint8_t blocks = 0;
         if (CRC_FUNC != NULL) {
             res = this->read(cAddr + 1, d);                            // read flags
             if (!res) return false;
             crc = CRC_FUNC(crc, d);
             bool isFirst = (d & S_START_CLUSTER_FLAG) != 0;
+            bool extent = isExtent(d);
 
             res = this->read(cAddr + 2, d);                            // read next cluster
             if (!res) return false;
             crc = CRC_FUNC(crc, d);
+            if (extent) {
+                blocks = d;
+            }
 
             res = this->read(cAddr + 3, d);                            // read length
             if (!res) return false;
             crc = CRC_FUNC(crc, d);
 
             uint16_t len = d;
-            if (isFirst) {
+            if (extent) {
+                ++len;
+                if ((len <= S_USER_DATA_PER_CLUSTER) || (blocks != extentBlocks(len)) ||
+                    (cluster + blocks >= S_CLUSTER_CNT)) {
+                    continue;                                           // skip invalid extent
+                }
+                res = readExtentCRC(cluster, len, crc);                 // read user data of header and blocks
+                if (!res) return false;
+                len = 0;
+            } else if (isFirst) {
                 ++len;
                 if (len > S_USER_DATA_PER_CLUSTER) {
                     len = S_USER_DATA_PER_CLUSTER;
@@ -470,12 +766,19 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
             }
             res = this->read(cAddr + CLUSTER_SIZE - 2, d);             // read CRC
             if (!res) return false;
-            if (d != crc) continue;                                     // skip invalid CRC
+            if (d != crc) {                                             // skip invalid CRC
+                _SLOTNVM_STATS_ADD_(crcErrors, 1);
+                continue;
+            }
         }
 
         // we have found a valid cluster
         setClusterBit(cluster);
         setSlotBit(slot);
+        for (uint8_t i = 1; i <= blocks; ++i) {                         // raw blocks of an extent have no header
+            setExtentBlock(cluster + i, true);
+        }
+        cluster += blocks;
     }
 
     // check slot validity
@@ -490,6 +793,7 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
         // find all cluster used by current slot and all start cluster
         for (uint16_t cluster = 0; cluster < S_CLUSTER_CNT; ++cluster) {
             if (!isClusterBitSet(cluster)) continue;                    // skip unused
+            if (isExtentBlock(cluster)) continue;                       // skip raw blocks
             nvm_address_t cAddr = cluster * CLUSTER_SIZE;
             uint8_t d;
 
@@ -534,25 +838,51 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
             if (!res) return false;
             uint16_t doNotExceetLen = startLen + 1 + S_USER_DATA_PER_CLUSTER; // ToDo dynamic min length
             uint16_t curMaxDataLen = S_USER_DATA_PER_CLUSTER; // should not exceed realLen + S_USER_DATA_PER_CLUSTER
+            if (isExtent(flags)) {
+                res = this->read(cAddr + 2, curLen);                   // read count of raw blocks
+                if (!res) return false;
+                curMaxDataLen += curLen * S_USER_DATA_PER_BLOCK;        // already checked by CRC
+            }
 
             bool err = false;
+            bool appended = APPEND && ((flags & (S_START_CLUSTER_FLAG | S_APPENDED_FLAG)) == (S_START_CLUSTER_FLAG | S_APPENDED_FLAG));
+            bool runStart = appended;                                   // first cluster of a run may have another age
+            uint8_t runAge = oldes;
             uint8_t curCluster = startCluster;
             while (!err && ((flags & S_LAST_CLUSTER_FLAG) == 0)) {
                 res = this->read(cAddr + 2, curCluster);               // read next cluster number
-                setClusterBit(validCluster, curCluster);
                 if (!res) return false;
+                if (curCluster >= S_CLUSTER_CNT) {
+                    err = true;                                         // invalid next cluster
+                    break;
+                }
+                setClusterBit(validCluster, curCluster);
                 if (isClusterBitSet(clusterUsedBySlot, curCluster)) {   // next cluster belong to this slot
                     cAddr = curCluster * CLUSTER_SIZE;                 // next address
-                    res = this->read(cAddr + 1, flags);                // read flags
+                    uint8_t d[3];
+                    res = this->read(cAddr + 1, d, appended ? 3 : 1);  // read flags and for runs next and used bytes
                     if (!res) return false;
+                    flags = d[0];
 
-                    if (((flags & S_AGE_MASK) >> S_AGE_SHIFT) != oldes) {
+                    uint8_t age = (flags & S_AGE_MASK) >> S_AGE_SHIFT;
+                    if (runStart) {
+                        runAge = age;
+                    } else if (age != runAge) {
                         err = true;                                     // wrong age
                         break;
                     }
 
                     if ((flags & S_START_CLUSTER_FLAG) != 0) {          // this is also a start cluster
                         err = true;
+                    } else if (appended) {
+                        if ((d[2] == 0) || (d[2] > S_USER_DATA_PER_CLUSTER)) {
+                            err = true;                                 // invalid used bytes
+                        }
+                        curMaxDataLen += d[2];
+                        if (curMaxDataLen > (startLen + 1)) {           // more data than needed, this also stops rings
+                            err = true;
+                        }
+                        runStart = (flags & S_RUN_END_FLAG) != 0;
                     } else {
                         curMaxDataLen += S_USER_DATA_PER_CLUSTER;
                         if (curMaxDataLen >= doNotExceetLen) {          // more cluster than needed, this also stops..
@@ -579,7 +909,9 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
         for (uint16_t cluster = 0; cluster < S_CLUSTER_CNT; ++cluster) {
             if (!isClusterBitSet(clusterUsedBySlot, cluster)) continue;             // skip unused
             if (foundValid && isClusterBitSet(validCluster, cluster)) continue;     // skip valid
+            freeExtentBlocks(cluster);
             clearCluster(cluster);
+            _SLOTNVM_STATS_ADD_(repairs, 1);
         }
         if (!foundValid) {
             clearSlotBit(slot);
@@ -592,31 +924,65 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
 }
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+    uint8_t startCluster;
+    uint8_t oldStartCluster = 0;
+    bool overwrite;
+    bool res = writeChain(slot, data, len, startCluster, overwrite, oldStartCluster);
+    if (!res) return false;
+
+    if (overwrite) {
+        clearClusters(oldStartCluster); // ignore the result it's to late to say writeSlot gone wrong
+    }
+
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::writeChain(uint8_t slot, const uint8_t *data, nvm_size_t len,
+                                                                                                                uint8_t &startCluster, bool &overwrite, uint8_t &oldStartCluster) {
+    if (COMPRESS && (data != NULL) && (len > 2) && (len <= 256)) {
+        uint8_t packed[len - 1];                                        // first byte is the uncompressed size
+        nvm_size_t packedLen = SlotNVMCompress::compress(data, len, packed + 1, len - 2);
+        if (packedLen > 0) {
+            packed[0] = len - 1;
+            return writeChainData(slot, packed, packedLen + 1, S_COMPRESSED_FLAG, startCluster, overwrite, oldStartCluster);
+        }
+    }
+    return writeChainData(slot, data, len, 0x00, startCluster, overwrite, oldStartCluster);
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::writeChainData(uint8_t slot, const uint8_t *data, nvm_size_t len, uint8_t startFlags,
+                                                                                                                    uint8_t &startCluster, bool &overwrite, uint8_t &oldStartCluster) {
     if (!m_initDone) return false;
     if (data == NULL) return false;
     if (len < 1) return false;
     if (len > 256) return false;
     if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
-    uint8_t oldStartCluster;
     nvm_address_t cAddr;
     uint8_t d[4];
     uint8_t newAge = 0;
     bool res;
-    bool overwrite = findStartCluser(slot, oldStartCluster);
+    overwrite = findStartCluser(slot, oldStartCluster);
     nvm_size_t free = getFree();
 
     if (overwrite) {
         cAddr = oldStartCluster * CLUSTER_SIZE;
-        res = this->read(cAddr + 1, d[0]);                      // read old age
+        res = this->read(cAddr + 1, d, 3);                      // read old age and next cluster
         if (!res) return false;
         newAge = (d[0] & S_AGE_MASK) >> S_AGE_SHIFT;
         newAge = ((newAge + 1) << S_AGE_SHIFT) & S_AGE_MASK;
 
-        res = this->read(cAddr + 3, d[0]);                      // read old length
-        if (!res) return false;
-        nvm_size_t extraFree = ((d[0] + S_USER_DATA_PER_CLUSTER - 1) / S_USER_DATA_PER_CLUSTER) * S_USER_DATA_PER_CLUSTER;
+        nvm_size_t extraFree;
+        if (isExtent(d[0])) {
+            extraFree = (d[1] + 1) * S_USER_DATA_PER_CLUSTER;  // header and raw blocks are freed
+        } else {
+            extraFree = ((d[2] + S_USER_DATA_PER_CLUSTER - 1) / S_USER_DATA_PER_CLUSTER) * S_USER_DATA_PER_CLUSTER;
+        }
         if (extraFree > S_PROVISION) {
             free += S_PROVISION;
         } else {
@@ -627,31 +993,30 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
     if (free < len) return false;
 
     const uint8_t cntCluster = (len - 1) / S_USER_DATA_PER_CLUSTER + 1;
-    uint8_t newCluster[cntCluster];
-    uint8_t nextCluster = 255;
-    if (RND_FUNC != NULL) {
-        nextCluster = RND_FUNC() % S_CLUSTER_CNT;
-    }
-    for (uint8_t i = 0; i < cntCluster; ++i) {
-        bool ret = nextFreeCluster(nextCluster);
-        if (!ret) return false;
-        newCluster[i] = nextCluster;
+    if (EXTENTS && (cntCluster > 1)) {
+        uint8_t first;
+        d[2] = extentBlocks(len);
+        if (findFreeRun(d[2] + 1, first)) {                     // else fall back to a chain
+            d[0] = slot;
+            d[1] = newAge | S_START_CLUSTER_FLAG | S_LAST_CLUSTER_FLAG | S_EXTENT_FLAG | startFlags;
+            d[3] = len - 1;
+            res = writeExtent(first, d, data, len);
+            if (!res) return false;
+
+            startCluster = first;
+            if (!overwrite) {
+                setSlotBit(slot);
+            }
+            return true;
+        }
     }
 
+    uint8_t newCluster[cntCluster];
+    res = allocClusters(cntCluster, newCluster);
+    if (!res) return false;
+
     // write the data beginning with the last cluster
     for (int16_t i = cntCluster-1; i >= 0; --i) {
-        nextCluster = newCluster[i];
-        cAddr = nextCluster * CLUSTER_SIZE;
-
-        res = this->read(cAddr + CLUSTER_SIZE - 1, d[0]);       // at first read last byte
-        if (!res) return false;
-
-        if (d[0] == S_END_BYTE) {
-            // last byte should become valid at last, so make it invalid
-            res = this->write(cAddr + CLUSTER_SIZE - 1, 0x00);
-            if (!res) return false;
-        }
-
         // calc length of user data in this cluser
         uint16_t offset = i * S_USER_DATA_PER_CLUSTER;
         nvm_size_t toCopy = len - offset;
@@ -659,61 +1024,531 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
             toCopy = S_USER_DATA_PER_CLUSTER;
         }
 
-        // write the header
         d[0] = slot;
         d[1] = newAge
-             | ((i == 0) ? S_START_CLUSTER_FLAG : 0x00) 
+             | ((i == 0) ? (S_START_CLUSTER_FLAG | startFlags) : 0x00)
              | ((i == (cntCluster-1)) ? S_LAST_CLUSTER_FLAG : 0x00);
         d[2] = (i == (cntCluster-1)) ? slot : newCluster[i+1];
         d[3] = (i == 0) ? len - 1 : toCopy;
-        res = this->write(cAddr, d, 4);
+        res = writeCluster(newCluster[i], d, data + offset, toCopy);
         if (!res) return false;
-        uint8_t crc;
-        if (CRC_FUNC != NULL) {
-            crc = crc_buf(0, d, 4);
+    }
+
+    startCluster = newCluster[0];
+    if (!overwrite) {
+        setSlotBit(slot);
+    }
+
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::allocClusters(uint8_t cnt, uint8_t clusters[]) const {
+    uint8_t nextCluster = 0;
+    if (RND_FUNC != NULL) {
+        nextCluster = RND_FUNC() % S_CLUSTER_CNT;
+    }
+    for (uint8_t i = 0; i < cnt; ++i) {
+        if ((i > 0) || isClusterBitSet(nextCluster)) {          // nextFreeCluster() never returns the start cluster
+            bool ret = nextFreeCluster(nextCluster);
+            if (!ret) return false;
         }
+        clusters[i] = nextCluster;
+    }
+
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::writeCluster(uint8_t cluster, const uint8_t header[4], const uint8_t *data, nvm_size_t len) {
+    nvm_address_t cAddr = cluster * CLUSTER_SIZE;
+    uint8_t d;
+
+    bool res = this->read(cAddr + CLUSTER_SIZE - 1, d);        // at first read last byte
+    if (!res) return false;
 
-        // write data
-        res = this->write(cAddr + 4, data + offset, toCopy);
+    if (d == S_END_BYTE) {
+        // last byte should become valid at last, so make it invalid
+        res = this->write(cAddr + CLUSTER_SIZE - 1, 0x00);
         if (!res) return false;
+    }
 
-        if (CRC_FUNC != NULL) {
-            crc = crc_buf(crc, data + offset, toCopy);
+    // write the header
+    res = this->write(cAddr, header, 4);
+    if (!res) return false;
+    uint8_t crc = 0;
+    if (CRC_FUNC != NULL) {
+        crc = crc_buf(0, header, 4);
+    }
+
+    // write data
+    res = this->write(cAddr + 4, data, len);
+    if (!res) return false;
+
+    if (CRC_FUNC != NULL) {
+        crc = crc_buf(crc, data, len);
+    }
+
+    if (ECC) {
+        res = writeECC(cAddr, header, data, len, crc);
+        if (!res) return false;
+    }
+
+    if (CRC_FUNC != NULL) {
+        // write CRC
+        res = this->write(cAddr + CLUSTER_SIZE - 2, crc);
+        if (!res) return false;
+    }
+
+    // now make cluster valid
+    res = this->write(cAddr + CLUSTER_SIZE - 1, S_END_BYTE);
+    if (!res) return false;
+
+    setClusterBit(cluster);
+    _SLOTNVM_STATS_ADD_(clustersAllocated, 1);
+
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::appendSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+    if (!m_initDone) return false;
+    if (data == NULL) return false;
+    if (len < 1) return false;
+    uint8_t startCluster;
+    bool res = findStartCluser(slot, startCluster);
+    if (!res) return writeSlot(slot, data, len);
+
+    nvm_address_t cAddr = startCluster * CLUSTER_SIZE;
+    uint8_t d[4];
+    res = this->read(cAddr, d, 4);                              // read header
+    if (!res) return false;
+
+    if (!APPEND || ECC || isExtent(d[1]) || (COMPRESS && ((d[1] & S_COMPRESSED_FLAG) != 0))) {
+        // these have no appended runs, so rewrite the whole slot
+        nvm_size_t oldLen = 0;
+        readChain(startCluster, NULL, oldLen);                  // get length only
+        if (oldLen + len > 256) return false;
+        uint8_t buf[oldLen + len];
+        res = readChain(startCluster, buf, oldLen);
+        if (!res) return false;
+        memcpy(buf + oldLen, data, len);
+        return writeSlot(slot, buf, oldLen + len);
+    }
 
-            // write CRC
-            res = this->write(cAddr + CLUSTER_SIZE - 2, crc);
+    nvm_size_t oldLen = d[3] + 1;
+    nvm_size_t newLen = oldLen + len;
+    if (newLen > 256) return false;
+    uint8_t newAge = ((((d[1] & S_AGE_MASK) >> S_AGE_SHIFT) + 1) << S_AGE_SHIFT) & S_AGE_MASK;
+
+    // the start cluster is filled up, it is only partially used if there is no other cluster
+    uint8_t startData[S_USER_DATA_PER_CLUSTER];
+    nvm_size_t startLen = (oldLen > S_USER_DATA_PER_CLUSTER) ? S_USER_DATA_PER_CLUSTER : oldLen;
+    res = this->read(cAddr + 4, startData, startLen);
+    if (!res) return false;
+    nvm_size_t toStart = S_USER_DATA_PER_CLUSTER - startLen;
+    if (toStart > len) toStart = len;
+    memcpy(startData + startLen, data, toStart);
+    startLen += toStart;
+    data += toStart;
+    len -= toStart;
+
+    // the newest run is replaced if it is a single partially used cluster, all older runs are kept
+    uint8_t runData[S_USER_DATA_PER_CLUSTER];
+    nvm_size_t runDataLen = 0;
+    bool replace = false;
+    uint8_t replaceCluster = d[2];
+    bool keep = (d[1] & S_LAST_CLUSTER_FLAG) == 0;
+    uint8_t keepCluster = d[2];
+    if (keep) {
+        uint8_t r[3];
+        res = this->read(replaceCluster * CLUSTER_SIZE + 1, r, 3);  // read flags, next cluster and used bytes
+        if (!res) return false;
+        bool runEnd = ((d[1] & S_APPENDED_FLAG) != 0) && ((r[0] & S_RUN_END_FLAG) != 0);
+        if ((((r[0] & S_LAST_CLUSTER_FLAG) != 0) || runEnd) && (r[2] < S_USER_DATA_PER_CLUSTER)) {
+            replace = true;
+            runDataLen = r[2];
+            res = this->read(replaceCluster * CLUSTER_SIZE + 4, runData, runDataLen);
             if (!res) return false;
+            keep = runEnd;
+            keepCluster = r[1];
+        }
+    }
+
+    // the new start cluster, a run of full clusters and a single cluster run with the rest as the newest run
+    nvm_size_t runLen = runDataLen + len;
+    const uint8_t fullCnt = runLen / S_USER_DATA_PER_CLUSTER;
+    const nvm_size_t tailLen = runLen % S_USER_DATA_PER_CLUSTER;
+    const uint8_t tailCnt = (tailLen > 0) ? 1 : 0;
+    const uint8_t cntCluster = 1 + tailCnt + fullCnt;
+    nvm_size_t free = getFree();
+    nvm_size_t extraFree = (replace ? 2 : 1) * S_USER_DATA_PER_CLUSTER;
+    free += (extraFree > S_PROVISION) ? S_PROVISION : extraFree;
+    if (free < cntCluster * S_USER_DATA_PER_CLUSTER) return false;
+
+    uint8_t newCluster[cntCluster];
+    res = allocClusters(cntCluster, newCluster);
+    if (!res) return false;
+
+    // write the runs beginning with the last cluster
+    for (int16_t i = cntCluster - 1; i >= 1; --i) {
+        bool tail = (tailCnt == 1) && (i == 1);
+        nvm_size_t offset = tail ? fullCnt * S_USER_DATA_PER_CLUSTER : (i - 1 - tailCnt) * S_USER_DATA_PER_CLUSTER;
+        nvm_size_t toCopy = tail ? tailLen : S_USER_DATA_PER_CLUSTER;
+        uint8_t buf[S_USER_DATA_PER_CLUSTER];
+        for (nvm_size_t j = 0; j < toCopy; ++j) {
+            buf[j] = (offset + j < runDataLen) ? runData[offset + j] : data[offset + j - runDataLen];
         }
 
-        // now make cluster valid
-        res = this->write(cAddr + CLUSTER_SIZE - 1, S_END_BYTE);
+        bool last = (i == (cntCluster - 1));
+        uint8_t h[4];
+        h[0] = slot;
+        h[1] = newAge;
+        h[2] = newCluster[(i + 1) % cntCluster];
+        if (last && !keep) {
+            h[1] |= S_LAST_CLUSTER_FLAG;
+            h[2] = slot;
+        } else if (last) {
+            h[1] |= S_RUN_END_FLAG;
+            h[2] = keepCluster;
+        } else if (tail) {
+            h[1] |= S_RUN_END_FLAG;
+        }
+        h[3] = toCopy;
+        res = writeCluster(newCluster[i], h, buf, toCopy);
         if (!res) return false;
+    }
+
+    // the new start cluster makes all valid
+    uint8_t h[4];
+    h[0] = slot;
+    h[1] = newAge | S_START_CLUSTER_FLAG
+         | ((cntCluster == 1) ? S_LAST_CLUSTER_FLAG : 0x00)
+         | ((keep || ((tailCnt == 1) && (fullCnt > 0))) ? S_APPENDED_FLAG : 0x00);
+    h[2] = (cntCluster == 1) ? slot : newCluster[1];
+    h[3] = newLen - 1;
+    res = writeCluster(newCluster[0], h, startData, startLen);
+    if (!res) return false;
 
-        setClusterBit(nextCluster);
+    // ignore the results it's to late to say appendSlot gone wrong
+    clearCluster(startCluster);
+    _SLOTNVM_STATS_ADD_(clustersFreed, 1);
+    if (replace) {
+        clearCluster(replaceCluster);
+        _SLOTNVM_STATS_ADD_(clustersFreed, 1);
     }
 
-    if (overwrite) {
-        clearClusters(oldStartCluster); // ignore the result it's to late to say writeSlot gone wrong
-    } else {
-        setSlotBit(slot);
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::findFreeRun(uint8_t cnt, uint8_t &firstCluster) const {
+    uint16_t startCluster = 0;
+    if (RND_FUNC != NULL) {
+        startCluster = RND_FUNC() % S_CLUSTER_CNT;
+    }
+    uint16_t run = 0;
+    for (uint16_t i = 0; i < S_CLUSTER_CNT + cnt - 1; ++i) {
+        uint16_t cluster = (startCluster + i) % S_CLUSTER_CNT;
+        if (cluster == 0) run = 0;                              // a run never wraps around
+        if (isClusterBitSet(cluster)) {
+            run = 0;
+        } else if (++run == cnt) {
+            firstCluster = cluster + 1 - cnt;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::writeExtent(uint8_t cluster, const uint8_t header[4], const uint8_t *data, nvm_size_t len) {
+    nvm_address_t cAddr = cluster * CLUSTER_SIZE;
+    uint8_t blocks = header[2];
+    uint8_t d;
+
+    bool res = this->read(cAddr + CLUSTER_SIZE - 1, d);        // at first read last byte
+    if (!res) return false;
+    if (d == S_END_BYTE) {
+        // last byte should become valid at last, so make it invalid
+        res = this->write(cAddr + CLUSTER_SIZE - 1, 0x00);
+        if (!res) return false;
+    }
+
+    // the raw blocks at first, they become valid with the header
+    uint8_t buf[CLUSTER_SIZE];
+    buf[0] = 0x00;                                              // never a valid slot number
+    for (nvm_size_t offset = S_USER_DATA_PER_CLUSTER; offset < len; offset += S_USER_DATA_PER_BLOCK) {
+        nvm_size_t toWrite = (len - offset > S_USER_DATA_PER_BLOCK) ? S_USER_DATA_PER_BLOCK : len - offset;
+        memcpy(buf + 1, data + offset, toWrite);
+        cAddr += CLUSTER_SIZE;
+        res = this->write(cAddr, buf, toWrite + 1);
+        if (!res) return false;
+    }
+    cAddr = cluster * CLUSTER_SIZE;
+
+    res = this->write(cAddr, header, 4);
+    if (!res) return false;
+    res = this->write(cAddr + 4, data, S_USER_DATA_PER_CLUSTER);
+    if (!res) return false;
+
+    uint8_t crc = crc_buf(0, header, 4);
+    for (nvm_size_t offset = 0; offset < len; offset += 128) {
+        crc = crc_buf(crc, data + offset, (len - offset > 128) ? 128 : len - offset);
+    }
+    res = this->write(cAddr + CLUSTER_SIZE - 2, crc);
+    if (!res) return false;
+
+    // now make extent valid
+    res = this->write(cAddr + CLUSTER_SIZE - 1, S_END_BYTE);
+    if (!res) return false;
+
+    setClusterBit(cluster);
+    for (uint8_t i = 1; i <= blocks; ++i) {
+        setExtentBlock(cluster + i, true);
+    }
+    _SLOTNVM_STATS_ADD_(clustersAllocated, blocks + 1);
+
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readExtentCRC(uint8_t cluster, nvm_size_t len, uint8_t &crc) const {
+    nvm_address_t cAddr = cluster * CLUSTER_SIZE;
+    uint8_t buf[CLUSTER_SIZE];
+
+    bool res = this->read(cAddr + 4, buf, S_USER_DATA_PER_CLUSTER);    // user data of the header
+    if (!res) return false;
+    crc = crc_buf(crc, buf, S_USER_DATA_PER_CLUSTER);
+    len -= S_USER_DATA_PER_CLUSTER;
+
+    while (len > 0) {                                                   // user data of the raw blocks
+        cAddr += CLUSTER_SIZE;
+        nvm_size_t toRead = (len > S_USER_DATA_PER_BLOCK) ? S_USER_DATA_PER_BLOCK : len;
+        res = this->read(cAddr + 1, buf, toRead);
+        if (!res) return false;
+        crc = crc_buf(crc, buf, toRead);
+        len -= toRead;
+    }
+
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::freeExtentBlocks(uint8_t cluster) {
+    if (!EXTENTS) return true;
+    nvm_address_t cAddr = cluster * CLUSTER_SIZE;
+    uint8_t d[2];
+
+    bool res = this->read(cAddr + 1, d, 2);                    // read flags and count of raw blocks
+    if (!res) return false;
+    if (!isExtent(d[0])) return true;
+
+    for (uint16_t block = cluster + 1; (block <= cluster + d[1]) && (block < S_CLUSTER_CNT); ++block) {
+        if (!isExtentBlock(block)) continue;                    // never marked, e.g. invalid header
+        // byte 0 is already 0x00, so begin() never reads a raw block as cluster
+        setExtentBlock(block, false);
+        _SLOTNVM_STATS_ADD_(clustersFreed, 1);
+    }
+
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readExtentBlocks(uint8_t cluster, nvm_size_t offset, uint8_t *data, nvm_size_t len) const {
+    // offset is counted from the first data byte of the raw blocks, every block is read by one call
+    nvm_address_t cAddr = (cluster + 1 + offset / S_USER_DATA_PER_BLOCK) * CLUSTER_SIZE;
+    nvm_size_t blockOffset = 1 + offset % S_USER_DATA_PER_BLOCK;   // skip byte 0
+    while (len > 0) {
+        nvm_size_t toRead = CLUSTER_SIZE - blockOffset;
+        if (toRead > len) toRead = len;
+        bool res = this->read(cAddr + blockOffset, data, toRead);
+        if (!res) return false;
+        data += toRead;
+        len -= toRead;
+        cAddr += CLUSTER_SIZE;
+        blockOffset = 1;
     }
 
     return true;
 }
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) const {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) const {
+    if (!m_initDone) return false;
+
+    uint8_t startCluster;
+    bool res = findStartCluser(slot, startCluster);
+    if (!res) return false;
+
+    return readChain(startCluster, data, len);
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readSlotRange(uint8_t slot, nvm_size_t offset, uint8_t *data, nvm_size_t len) const {
+    if (!m_initDone) return false;
+    if ((data == NULL) || (len == 0)) return false;
+
+    uint8_t startCluster;
+    bool res = findStartCluser(slot, startCluster);
+    if (!res) return false;
+
+    uint8_t header[5];
+    res = readStartHeader(startCluster, header);
+    if (!res) return false;
+    const bool compressed = COMPRESS && ((header[1] & S_COMPRESSED_FLAG) != 0);
+    nvm_size_t slotLen = (compressed ? header[4] : header[3]) + 1;
+    if ((offset > slotLen) || (len > slotLen - offset)) return false;
+
+    if (ECC || compressed) {                        // every cluster must be corrected or all data decompressed
+        uint8_t buf[slotLen];
+        res = readChain(startCluster, buf, slotLen);
+        if (!res) return false;
+        memcpy(data, buf + offset, len);
+        return true;
+    }
+
+    nvm_address_t cAddr = startCluster * CLUSTER_SIZE;
+    if (EXTENTS && isExtent(header[1])) {           // header data and all raw blocks in a row
+        if (offset < S_USER_DATA_PER_CLUSTER) {
+            nvm_size_t curCopy = (len > S_USER_DATA_PER_CLUSTER - offset) ? S_USER_DATA_PER_CLUSTER - offset : len;
+            res = this->read(cAddr + 4 + offset, data, curCopy);
+            if (!res) return false;
+            data += curCopy;
+            len -= curCopy;
+            offset = S_USER_DATA_PER_CLUSTER;
+        }
+        if (len == 0) return true;
+        return readExtentBlocks(startCluster, offset - S_USER_DATA_PER_CLUSTER, data, len);
+    }
+
+    if (APPEND && ((header[1] & S_APPENDED_FLAG) != 0)) {   // start cluster is full, runs behind it
+        if (offset < S_USER_DATA_PER_CLUSTER) {
+            nvm_size_t curCopy = (len > S_USER_DATA_PER_CLUSTER - offset) ? S_USER_DATA_PER_CLUSTER - offset : len;
+            res = this->read(cAddr + 4 + offset, data, curCopy);
+            if (!res) return false;
+            data += curCopy;
+            len -= curCopy;
+            offset = S_USER_DATA_PER_CLUSTER;
+        }
+        if (len == 0) return true;
+        return readAppendedRange(header[2], slotLen - S_USER_DATA_PER_CLUSTER,
+                                 offset - S_USER_DATA_PER_CLUSTER, data, len);
+    }
+
+    uint8_t curCluster = header[2];
+    for (nvm_size_t skip = offset / S_USER_DATA_PER_CLUSTER; skip > 0; --skip) {
+        cAddr = curCluster * CLUSTER_SIZE;
+        if (skip > 1) {
+            res = this->read(cAddr + 2, curCluster);    // read next cluster
+            if (!res) return false;
+        }
+    }
+    offset %= S_USER_DATA_PER_CLUSTER;
+    while (true) {
+        nvm_size_t curCopy = (len > S_USER_DATA_PER_CLUSTER - offset) ? S_USER_DATA_PER_CLUSTER - offset : len;
+        res = this->read(cAddr + 4 + offset, data, curCopy);
+        if (!res) return false;
+        data += curCopy;
+        len -= curCopy;
+        if (len == 0) return true;
+        offset = 0;
+
+        res = this->read(cAddr + 2, curCluster);    // read next cluster
+        if (!res) return false;
+        cAddr = curCluster * CLUSTER_SIZE;
+    }
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readSlots(uint8_t cnt, const uint8_t slots[], uint8_t *data[], nvm_size_t len[]) const {
     if (!m_initDone) return false;
+    if ((slots == NULL) || (data == NULL) || (len == NULL)) return false;
+    if (cnt == 0) return true;
+
+    uint8_t startCluster[cnt];
+    uint8_t found[(cnt + 7) / 8];
+    memset(found, 0, sizeof(found));
+    bool res = findStartClusters(cnt, slots, startCluster, found);
+    if (!res) return false;
+
+    bool ret = true;
+    for (uint8_t i = 0; i < cnt; ++i) {
+        if ((found[i / 8] & (1 << (i % 8))) == 0) {         // slot not available
+            ret = false;
+            continue;
+        }
+        res = readChain(startCluster[i], data[i], len[i]);
+        if (!res) ret = false;
+    }
+
+    return ret;
+}
 
-    uint8_t curCluster;
-    bool res = findStartCluser(slot, curCluster);
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readChain(uint8_t startCluster, uint8_t *data, nvm_size_t &len) const {
+    if (!COMPRESS) return readChainData(startCluster, data, len);
+
+    uint8_t header[5];
+    bool res = readStartHeader(startCluster, header);
+    if (!res) return false;
+    if ((header[1] & S_COMPRESSED_FLAG) == 0) return readChainData(startCluster, data, len);
+
+    nvm_size_t unpackedLen = header[4] + 1;
+    nvm_size_t packedLen = header[3] + 1;
+    if ((unpackedLen > len) || (data == NULL)) {
+        len = unpackedLen;
+        return false;
+    }
+    if (packedLen >= unpackedLen) return false;                         // invalid, never written
+
+    uint8_t packed[packedLen];
+    res = readChainData(startCluster, packed, packedLen);
     if (!res) return false;
+    res = SlotNVMCompress::decompress(packed + 1, packedLen - 1, data, unpackedLen);
+    if (!res) return false;
+    len = unpackedLen;
+    return true;
+}
 
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readStartHeader(uint8_t startCluster, uint8_t header[5]) const {
+    if (ECC) {
+        uint8_t buf[CLUSTER_SIZE];
+        bool res = this->read(startCluster * CLUSTER_SIZE, buf, CLUSTER_SIZE);
+        if (!res) return false;
+        uint8_t offset;
+        if (eccCorrect(buf, offset) == SlotNVMECC::UNCORRECTABLE) return false;
+        memcpy(header, buf, 5);
+        return true;
+    }
+    return this->read(startCluster * CLUSTER_SIZE, header, 5);
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readChainData(uint8_t startCluster, uint8_t *data, nvm_size_t &len) const {
+    if (ECC) return readChainECC(startCluster, data, len);
+
+    uint8_t curCluster = startCluster;
     nvm_address_t cAddr = curCluster * CLUSTER_SIZE;
     uint8_t d;
 
-    res = this->read(cAddr + 3, d);                 // read length
+    bool res = this->read(cAddr + 3, d);            // read length
     if (!res) return false;
     nvm_size_t lenToCopy = d + 1;
     if (lenToCopy > len) {
@@ -724,9 +1559,28 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
     if (data == NULL) return false;
 
     uint8_t flags;
+    if (EXTENTS) {
+        res = this->read(cAddr + 1, flags);         // read flags
+        if (!res) return false;
+        if (isExtent(flags)) {                      // header data and all raw blocks in a row
+            res = this->read(cAddr + 4, data, S_USER_DATA_PER_CLUSTER);
+            if (!res) return false;
+            return readExtentBlocks(startCluster, 0, data + S_USER_DATA_PER_CLUSTER, lenToCopy - S_USER_DATA_PER_CLUSTER);
+        }
+    }
+
+    bool first = true;
     do {
         res = this->read(cAddr + 1, flags);         // read flags
         if (!res) return false;
+        if (APPEND && first && ((flags & S_APPENDED_FLAG) != 0)) {  // start cluster is full, runs behind it
+            res = this->read(cAddr + 4, data, S_USER_DATA_PER_CLUSTER);
+            if (!res) return false;
+            res = this->read(cAddr + 2, curCluster);        // read next cluster
+            if (!res) return false;
+            return readAppendedRuns(curCluster, data + S_USER_DATA_PER_CLUSTER, lenToCopy - S_USER_DATA_PER_CLUSTER);
+        }
+        first = false;
         nvm_size_t curCopy = (lenToCopy > S_USER_DATA_PER_CLUSTER) ? S_USER_DATA_PER_CLUSTER : lenToCopy;
         res = this->read(cAddr + 4, data, curCopy); // read data into buffer
         if (!res) return false;
@@ -742,8 +1596,83 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
 }
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::eraseSlot(uint8_t slot) {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readAppendedRuns(uint8_t cluster, uint8_t *data, nvm_size_t len) const {
+    // the runs are read in chain order, newest first, and every run is moved in front of the newer ones
+    nvm_size_t pos = 0;
+    nvm_size_t runStart = 0;
+    uint8_t flags;
+    do {
+        nvm_address_t cAddr = cluster * CLUSTER_SIZE;
+        uint8_t d[3];
+        bool res = this->read(cAddr + 1, d, 3);     // read flags, next cluster and used bytes
+        if (!res) return false;
+        flags = d[0];
+        nvm_size_t curCopy = (d[2] > len - pos) ? len - pos : d[2];
+        res = this->read(cAddr + 4, data + pos, curCopy);
+        if (!res) return false;
+        pos += curCopy;
+        if ((flags & (S_LAST_CLUSTER_FLAG | S_RUN_END_FLAG)) != 0) {
+            rotate(data, pos, runStart);
+            runStart = pos;
+        }
+        cluster = d[1];
+    } while (((flags & S_LAST_CLUSTER_FLAG) == 0) && (pos < len));
+
+    return pos == len;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readAppendedRange(uint8_t cluster, nvm_size_t runsLen, nvm_size_t offset, uint8_t *data, nvm_size_t len) const {
+    // runs are stored newest first, so the end of a run in the data is known before its length,
+    // only the headers are read until a run overlaps the requested range, then this run is walked again
+    nvm_size_t runEnd = runsLen;
+    nvm_size_t runLen = 0;
+    uint8_t runCluster = cluster;
+    uint8_t runCnt = 0;
+    uint16_t maxDeep = S_CLUSTER_CNT;
+    uint8_t d[3];
+    do {
+        bool res = this->read(cluster * CLUSTER_SIZE + 1, d, 3);   // read flags, next cluster and used bytes
+        if (!res) return false;
+        runLen += d[2];
+        ++runCnt;
+        if ((d[0] & (S_LAST_CLUSTER_FLAG | S_RUN_END_FLAG)) != 0) {
+            if (runLen > runEnd) return false;
+            nvm_size_t pos = runEnd - runLen;                       // start of this run in the data
+            if ((pos < offset + len) && (offset < runEnd)) {
+                uint8_t r[3];
+                for (uint8_t i = 0; (i < runCnt) && (pos < offset + len); ++i) {
+                    res = this->read(runCluster * CLUSTER_SIZE + 1, r, 3);
+                    if (!res) return false;
+                    nvm_size_t from = (offset > pos) ? offset : pos;
+                    nvm_size_t to = (offset + len < pos + r[2]) ? offset + len : pos + r[2];
+                    if (from < to) {
+                        res = this->read(runCluster * CLUSTER_SIZE + 4 + from - pos, data + from - offset, to - from);
+                        if (!res) return false;
+                    }
+                    pos += r[2];
+                    runCluster = r[1];
+                }
+                pos = runEnd - runLen;
+            }
+            if (pos <= offset) return true;                         // all older runs are in front of the range
+            runEnd = pos;
+            runLen = 0;
+            runCnt = 0;
+            runCluster = d[1];
+        }
+        cluster = d[1];
+        --maxDeep;
+    } while (((d[0] & S_LAST_CLUSTER_FLAG) == 0) && (maxDeep > 0));
+
+    return false;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::eraseSlot(uint8_t slot) {
     if (!m_initDone) return false;
     uint8_t firstCluster;
     bool res = findStartCluser(slot, firstCluster);
@@ -756,8 +1685,8 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
 }
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::clearCluster(uint8_t cluster) {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::clearCluster(uint8_t cluster) {
     nvm_address_t cAddr = cluster * CLUSTER_SIZE;
     if (this->write(cAddr, 0x00)) {
         clearClusterBit(cluster);
@@ -768,14 +1697,16 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
 }
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::clearClusters(uint8_t firstCluster) {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::clearClusters(uint8_t firstCluster) {
     nvm_address_t cAddr = firstCluster * CLUSTER_SIZE;
+    freeExtentBlocks(firstCluster);                     // needs the header, the last cluster flag ends the loop below
     bool res = this->write(cAddr, 0x00);
     if (!res) return false;
     clearClusterBit(firstCluster);
+    _SLOTNVM_STATS_ADD_(clustersFreed, 1);
 
-    uint8_t maxDeep = uint8_t(256 / S_USER_DATA_PER_CLUSTER);
+    uint16_t maxDeep = S_CLUSTER_CNT;                   // appended runs may have partially used clusters
     uint8_t flags;
     do {
         res = this->read(cAddr + 1, flags);             // read flags
@@ -788,6 +1719,7 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
             res = this->write(cAddr, 0x00);
             if (!res) break;
             clearClusterBit(firstCluster);
+            _SLOTNVM_STATS_ADD_(clustersFreed, 1);
         }
         --maxDeep;
     } while ((flags == 0x00) && (maxDeep > 0));
@@ -796,8 +1728,137 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
 }
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-nvm_size_t SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::getFree() const {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::scrubCluster(uint8_t cluster, uint8_t &slot) {
+    nvm_address_t cAddr = cluster * CLUSTER_SIZE;
+    uint8_t buf[CLUSTER_SIZE];
+
+    bool res = this->read(cAddr, buf, CLUSTER_SIZE);
+    if (!res) return false;
+    if (buf[CLUSTER_SIZE - 1] != S_END_BYTE) return true;              // incomplete written, skipped by begin()
+
+    uint8_t offset;
+    SlotNVMECC::Result ecc = eccCorrect(buf, offset);
+    if (ecc == SlotNVMECC::UNCORRECTABLE) {
+        _SLOTNVM_STATS_ADD_(eccErrors, 1);
+        slot = 0x00;                                                    // skip this cluster
+    } else if (ecc == SlotNVMECC::CORRECTED) {
+        _SLOTNVM_STATS_ADD_(eccCorrected, 1);
+        nvm_size_t cnt = (offset == S_ECC_OFFSET) ? 2 : 1;              // code or one data byte
+        res = this->write(cAddr + offset, buf + offset, cnt);
+        if (!res) return false;
+        slot = buf[0];
+    }
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::readChainECC(uint8_t startCluster, uint8_t *data, nvm_size_t &len) const {
+    uint8_t buf[CLUSTER_SIZE];
+    uint8_t curCluster = startCluster;
+    nvm_size_t lenToCopy = 0;
+    bool first = true;
+    uint8_t flags;
+
+    do {
+        bool res = this->read(curCluster * CLUSTER_SIZE, buf, CLUSTER_SIZE);
+        if (!res) return false;
+        uint8_t offset;
+        SlotNVMECC::Result ecc = eccCorrect(buf, offset);
+        if (ecc == SlotNVMECC::UNCORRECTABLE) {
+            _SLOTNVM_STATS_ADD_(eccErrors, 1);
+            return false;
+        } else if (ecc == SlotNVMECC::CORRECTED) {
+            _SLOTNVM_STATS_ADD_(eccCorrected, 1);
+        }
+
+        if (first) {
+            lenToCopy = buf[3] + 1;
+            if (lenToCopy > len) {
+                len = lenToCopy;
+                return false;
+            }
+            len = lenToCopy;
+            if (data == NULL) return false;
+            first = false;
+        }
+
+        nvm_size_t curCopy = (lenToCopy > S_USER_DATA_PER_CLUSTER) ? S_USER_DATA_PER_CLUSTER : lenToCopy;
+        memcpy(data, buf + 4, curCopy);
+        data += curCopy;
+        lenToCopy -= curCopy;
+        flags = buf[1];
+        curCluster = buf[2];
+    } while (((flags & S_LAST_CLUSTER_FLAG) == 0) && (lenToCopy > 0));
+
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::writeECC(nvm_address_t cAddr, const uint8_t header[4], const uint8_t *data, nvm_size_t len, uint8_t crc) {
+    // unused user data is part of the code, so make it defined
+    static const uint8_t zeros[16] = {0};
+    for (nvm_size_t i = len; i < S_USER_DATA_PER_CLUSTER; i += sizeof(zeros)) {
+        nvm_size_t cnt = S_USER_DATA_PER_CLUSTER - i;
+        if (cnt > sizeof(zeros)) cnt = sizeof(zeros);
+        bool res = this->write(cAddr + 4 + i, zeros, cnt);
+        if (!res) return false;
+    }
+
+    uint16_t code = 0;
+    for (uint8_t i = 0; i < 4; ++i) {
+        code = SlotNVMECC::update(code, i, header[i]);
+    }
+    for (nvm_size_t i = 0; i < len; ++i) {
+        code = SlotNVMECC::update(code, 4 + i, data[i]);
+    }
+    if (CRC_FUNC != NULL) {
+        code = SlotNVMECC::update(code, S_ECC_OFFSET, crc);
+    }
+    code = SlotNVMECC::finish(code);
+    uint8_t d[2] = { (uint8_t)code, (uint8_t)(code >> 8) };
+    return this->write(cAddr + S_ECC_OFFSET, d, 2);
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+uint16_t SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::eccCode(const uint8_t cluster[CLUSTER_SIZE]) {
+    uint16_t code = 0;
+    for (uint8_t i = 0; i < S_ECC_OFFSET; ++i) {
+        code = SlotNVMECC::update(code, i, cluster[i]);
+    }
+    if (CRC_FUNC != NULL) {
+        code = SlotNVMECC::update(code, S_ECC_OFFSET, cluster[CLUSTER_SIZE - 2]);
+    }
+    return code;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+SlotNVMECC::Result SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::eccCorrect(uint8_t cluster[CLUSTER_SIZE], uint8_t &offset) {
+    uint16_t code = eccCode(cluster);
+    uint16_t stored = cluster[S_ECC_OFFSET] | (cluster[S_ECC_OFFSET + 1] << 8);
+    uint8_t index, mask;
+    SlotNVMECC::Result res = SlotNVMECC::check(code, stored, S_ECC_CNT, index, mask);
+    if (res != SlotNVMECC::CORRECTED) return res;
+
+    if (mask == 0) {                                                    // stored code is wrong
+        code = SlotNVMECC::finish(code);
+        cluster[S_ECC_OFFSET] = code;
+        cluster[S_ECC_OFFSET + 1] = code >> 8;
+        offset = S_ECC_OFFSET;
+    } else {
+        offset = (index < S_ECC_OFFSET) ? index : CLUSTER_SIZE - 2;     // last protected byte is the CRC
+        cluster[offset] ^= mask;
+    }
+    return SlotNVMECC::CORRECTED;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+nvm_size_t SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::getFree() const {
     nvm_size_t free = getSize();
     for (uint16_t cluster = 0; cluster < S_CLUSTER_CNT; ++cluster) {
         if (isClusterBitSet(cluster)) {
@@ -812,10 +1873,11 @@ nvm_size_t SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE,
 }
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::findStartCluser(uint8_t slot, uint8_t &startCluster) const {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::findStartCluser(uint8_t slot, uint8_t &startCluster) const {
     for (uint16_t cluster = 0; cluster < S_CLUSTER_CNT; ++cluster) {
         if (!isClusterBitSet(cluster)) continue;                    // skip unused
+        if (isExtentBlock(cluster)) continue;                       // skip raw blocks
         nvm_address_t cAddr = cluster * CLUSTER_SIZE;
         uint8_t d;
 
@@ -837,8 +1899,91 @@ bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_F
 }
 
 template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
-          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)()>
-bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC>::nextFreeCluster(uint8_t &nextCluster) const {
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::findStartClusters(uint8_t cnt, const uint8_t slots[], uint8_t startClusters[], uint8_t found[]) const {
+    uint8_t missing = 0;
+    for (uint8_t i = 0; i < cnt; ++i) {
+        if (isSlotBitSet(slots[i])) ++missing;                  // only search for available slots
+    }
+
+    for (uint16_t cluster = 0; (cluster < S_CLUSTER_CNT) && (missing > 0); ++cluster) {
+        if (!isClusterBitSet(cluster)) continue;                // skip unused
+        if (isExtentBlock(cluster)) continue;                   // skip raw blocks
+        nvm_address_t cAddr = cluster * CLUSTER_SIZE;
+        uint8_t slot;
+        uint8_t flags = 0;
+        bool flagsRead = false;
+
+        bool res = this->read(cAddr, slot);                    // read slot no.
+        if (!res) return false;
+
+        // the same slot may be requested more than once
+        for (uint8_t i = 0; i < cnt; ++i) {
+            if (slots[i] != slot) continue;                     // skip other slots
+            if ((found[i / 8] & (1 << (i % 8))) != 0) continue; // already found
+
+            if (!flagsRead) {
+                res = this->read(cAddr + 1, flags);            // read flags
+                if (!res) return false;
+                flagsRead = true;
+            }
+            if ((flags & S_START_CLUSTER_FLAG) == 0) break;     // no start cluster
+
+            startClusters[i] = cluster;
+            found[i / 8] |= 1 << (i % 8);
+            --missing;
+        }
+    }
+
+    return true;
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+void SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::nextSlotInfo(uint16_t &cluster, SlotInfo &info) const {
+    for (; cluster < S_CLUSTER_CNT; ++cluster) {
+        if (!isClusterBitSet(cluster)) continue;                // skip unused
+        if (isExtentBlock(cluster)) continue;                   // skip raw blocks
+        nvm_address_t cAddr = cluster * CLUSTER_SIZE;
+        uint8_t d[4];
+
+        bool res = this->read(cAddr, d, 4);                    // read header
+        if (!res) break;
+        if ((d[1] & S_START_CLUSTER_FLAG) == 0) continue;       // skip all but start cluster
+
+        // we don't need to follow the chain, begin() has already checked it
+        info.slot = d[0];
+        info.len = d[3] + 1;
+        info.clusterCnt = isExtent(d[1]) ? d[2] + 1 : (info.len - 1) / S_USER_DATA_PER_CLUSTER + 1;
+        if (APPEND && ((d[1] & S_APPENDED_FLAG) != 0)) {        // runs may have partially used clusters, so count them
+            uint16_t cnt = 1;
+            uint8_t next = d[2];
+            uint8_t flags = 0;
+            while (((flags & S_LAST_CLUSTER_FLAG) == 0) && (cnt < S_CLUSTER_CNT)) {
+                uint8_t r[2];
+                res = this->read(next * CLUSTER_SIZE + 1, r, 2);   // read flags and next cluster
+                if (!res) break;
+                flags = r[0];
+                next = r[1];
+                ++cnt;
+            }
+            info.clusterCnt = cnt;
+        }
+        if (COMPRESS && ((d[1] & S_COMPRESSED_FLAG) != 0)) {
+            res = this->read(cAddr + 4, d[3]);                 // read uncompressed length
+            if (!res) break;
+            info.len = d[3] + 1;
+        }
+        info.age = (d[1] & S_AGE_MASK) >> S_AGE_SHIFT;
+        return;
+    }
+
+    cluster = S_CLUSTER_CNT;                                    // end reached or read error
+}
+
+template <class BASE, nvm_size_t CLUSTER_SIZE, nvm_size_t PROVISION, uint8_t LAST_SLOT,
+          uint8_t (*CRC_FUNC)(uint8_t, uint8_t), typename RND_TYPE, RND_TYPE (*RND_FUNC)(), bool ECC, bool COMPRESS, bool EXTENTS, bool APPEND>
+bool SlotNVM<BASE, CLUSTER_SIZE, PROVISION, LAST_SLOT, CRC_FUNC, RND_TYPE, RND_FUNC, ECC, COMPRESS, EXTENTS, APPEND>::nextFreeCluster(uint8_t &nextCluster) const {
     if (S_CLUSTER_CNT < 256) {
         if (nextCluster > S_CLUSTER_CNT) nextCluster = S_CLUSTER_CNT;
     }
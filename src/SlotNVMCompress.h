@@ -0,0 +1,171 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SLOTNVMCOMPRESS_H_
+#define _SLOTNVM_SLOTNVMCOMPRESS_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "NVMBase.h"
+
+/**
+ * Small LZ77 compression of slot data, see SlotNVM template parameter COMPRESS.
+ *
+ * The stream is a sequence of tokens:
+ *  0x00..0x7F  Literal run, token + 1 bytes (1..128) follow
+ *  0x80..0xFF  Match of (token & 0x7F) + 3 bytes (3..130), one byte with distance - 1 (1..256) follows
+ *
+ * The whole slot (max. 256 bytes) is the window. On AVR the match search is a plain search over the last
+ * S_AVR_WINDOW bytes without any table, so only the output buffer needs RAM. On hosts a hash chain over the
+ * whole slot finds longer matches faster. Both variants write the same format.
+ */
+class SlotNVMCompress {
+public:
+    /// Shortest match.
+    static const uint8_t S_MIN_MATCH = 3;
+    /// Longest match.
+    static const uint8_t S_MAX_MATCH = 130;
+    /// Longest literal run.
+    static const uint8_t S_MAX_LITERALS = 128;
+    /// Searched bytes before the current position on AVR.
+    static const uint16_t S_AVR_WINDOW = 64;
+
+    /**
+     * Compress data.
+     * @param       data    Data to compress
+     * @param       len     Length of data, 1 .. 256
+     * @param[out]  out     Compressed stream
+     * @param       maxLen  Size of out
+     * @return length of the stream, 0 if it is longer than maxLen
+     */
+    static nvm_size_t compress(const uint8_t *data, nvm_size_t len, uint8_t *out, nvm_size_t maxLen) {
+        if ((len < 1) || (len > 256)) return 0;
+#ifndef __AVR_ARCH__
+        uint8_t head[256];                              // last position + 1 of each hash, 0 for none
+        uint8_t prev[256];                              // previous position + 1 with the same hash
+        memset(head, 0, sizeof(head));
+#endif
+        nvm_size_t pos = 0;
+        nvm_size_t outLen = 0;
+        nvm_size_t literals = 0;                        // pending literal run starts at pos - literals
+
+        while (pos < len) {
+            uint8_t matchLen = 0;
+            uint16_t matchDist = 0;
+            nvm_size_t maxMatch = len - pos;
+            if (maxMatch > S_MAX_MATCH) maxMatch = S_MAX_MATCH;
+            if (maxMatch >= S_MIN_MATCH) {
+#ifdef __AVR_ARCH__
+                nvm_size_t first = (pos > S_AVR_WINDOW) ? pos - S_AVR_WINDOW : 0;
+                for (nvm_size_t cand = pos; cand-- > first;) {
+                    uint8_t l = matchLength(data, cand, pos, maxMatch);
+                    if (l > matchLen) {
+                        matchLen = l;
+                        matchDist = pos - cand;
+                        if (l == maxMatch) break;
+                    }
+                }
+#else
+                uint8_t h = hash(data + pos);
+                for (uint16_t cand = head[h]; cand != 0; cand = prev[cand - 1]) {
+                    uint8_t l = matchLength(data, cand - 1, pos, maxMatch);
+                    if (l > matchLen) {
+                        matchLen = l;
+                        matchDist = pos - (cand - 1);
+                        if (l == maxMatch) break;
+                    }
+                }
+#endif
+            }
+
+            if (matchLen < S_MIN_MATCH) {
+                matchLen = 1;
+                ++literals;
+                if (literals == S_MAX_LITERALS) {
+                    if (!flushLiterals(data + pos + 1 - literals, literals, out, outLen, maxLen)) return 0;
+                    literals = 0;
+                }
+            } else {
+                if (literals > 0) {
+                    if (!flushLiterals(data + pos - literals, literals, out, outLen, maxLen)) return 0;
+                    literals = 0;
+                }
+                if (outLen + 2 > maxLen) return 0;
+                out[outLen++] = 0x80 | (matchLen - S_MIN_MATCH);
+                out[outLen++] = matchDist - 1;
+            }
+
+#ifndef __AVR_ARCH__
+            for (uint8_t i = 0; (i < matchLen) && (pos + i + S_MIN_MATCH <= len); ++i) {
+                uint8_t h = hash(data + pos + i);
+                prev[pos + i] = head[h];
+                head[h] = pos + i + 1;
+            }
+#endif
+            pos += matchLen;
+        }
+        if (literals > 0) {
+            if (!flushLiterals(data + pos - literals, literals, out, outLen, maxLen)) return 0;
+        }
+        return outLen;
+    }
+
+    /**
+     * Decompress a stream written by compress().
+     * @param       stream      Compressed stream
+     * @param       streamLen   Length of stream
+     * @param[out]  data        Decompressed data
+     * @param       len         Expected length of decompressed data
+     * @return true if the stream is valid and has exactly len bytes decompressed
+     */
+    static bool decompress(const uint8_t *stream, nvm_size_t streamLen, uint8_t *data, nvm_size_t len) {
+        nvm_size_t in = 0;
+        nvm_size_t out = 0;
+        while (in < streamLen) {
+            uint8_t token = stream[in++];
+            if (token < 0x80) {
+                nvm_size_t cnt = token + 1;
+                if ((in + cnt > streamLen) || (out + cnt > len)) return false;
+                memcpy(data + out, stream + in, cnt);
+                in += cnt;
+                out += cnt;
+            } else {
+                if (in >= streamLen) return false;
+                nvm_size_t cnt = (token & 0x7F) + S_MIN_MATCH;
+                nvm_size_t dist = stream[in++] + 1;
+                if ((dist > out) || (out + cnt > len)) return false;
+                for (; cnt > 0; --cnt, ++out) {
+                    data[out] = data[out - dist];
+                }
+            }
+        }
+        return out == len;
+    }
+
+private:
+    static inline uint8_t matchLength(const uint8_t *data, nvm_size_t cand, nvm_size_t pos, nvm_size_t maxMatch) {
+        uint8_t l = 0;
+        while ((l < maxMatch) && (data[cand + l] == data[pos + l])) ++l;
+        return l;
+    }
+
+#ifndef __AVR_ARCH__
+    static inline uint8_t hash(const uint8_t *data) {
+        return (uint8_t)((data[0] * 33u) ^ (data[1] * 7u) ^ data[2]);
+    }
+#endif
+
+    static inline bool flushLiterals(const uint8_t *literals, nvm_size_t cnt, uint8_t *out, nvm_size_t &outLen, nvm_size_t maxLen) {
+        if (outLen + 1 + cnt > maxLen) return false;
+        out[outLen++] = cnt - 1;
+        memcpy(out + outLen, literals, cnt);
+        outLen += cnt;
+        return true;
+    }
+};
+
+#endif // _SLOTNVM_SLOTNVMCOMPRESS_H_
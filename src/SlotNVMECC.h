@@ -0,0 +1,131 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SLOTNVMECC_H_
+#define _SLOTNVM_SLOTNVMECC_H_
+
+#include <stdint.h>
+
+#ifdef __AVR_ARCH__
+  #include <avr/pgmspace.h>
+  #define _SLOTNVM_ECC_FLASHMEM_ PROGMEM
+#else
+  #define _SLOTNVM_ECC_FLASHMEM_
+#endif
+
+/**
+ * Single error correcting, double error detecting code (SEC-DED) for one cluster, see SlotNVM template parameter ECC.
+ *
+ * The code is a Hamming code with 12 check bits and one overall parity bit, stored in 2 bytes.
+ * Data bit j of byte i has the position 16 * (i + 1) + 8 + j, which is never a power of two,
+ * so an error in a check bit can not be mixed up with an error in the data. Up to 253 bytes can be protected.
+ *
+ * The decoder is table driven: one 256 byte table holds the XOR of the set bit numbers and the parity
+ * of every byte value, so each data byte costs one table lookup.
+ */
+class SlotNVMECC {
+public:
+    /// Result of check().
+    enum Result {
+        OK,                 ///< No error
+        CORRECTED,          ///< One bit error, can be corrected
+        UNCORRECTABLE       ///< Two or more bit errors
+    };
+
+    /// Max. count of protected bytes.
+    static const uint8_t S_MAX_BYTES = 253;
+
+    /**
+     * Add one byte to the code.
+     * Start with code 0, finish() calculates the code to store.
+     * @param code      Current code
+     * @param index     Index of data byte, 0 .. S_MAX_BYTES - 1
+     * @param data      Data byte
+     * @return new code
+     */
+    static inline uint16_t update(uint16_t code, uint8_t index, uint8_t data) {
+        uint8_t t = table(data);
+        code ^= t & 0x07;
+        if ((t & 0x08) != 0) {
+            code ^= ((uint16_t)(index + 1) << 4) | 0x08 | S_PARITY_BIT;
+        }
+        return code;
+    }
+
+    /**
+     * Get the code to store after all bytes are added by update().
+     */
+    static inline uint16_t finish(uint16_t code) {
+        return code ^ (parity(code & S_CHECK_MASK) ? S_PARITY_BIT : 0);
+    }
+
+    /**
+     * Compare the code of read data with the stored code.
+     * @param       code    Code of the read data calculated by update(), without finish()
+     * @param       stored  Stored code
+     * @param       cnt     Count of protected bytes
+     * @param[out]  index   Index of the wrong byte if CORRECTED is returned
+     * @param[out]  mask    Bit to toggle in the wrong byte, 0 if only the stored code is wrong
+     * @return      see Result
+     */
+    static inline Result check(uint16_t code, uint16_t stored, uint8_t cnt, uint8_t &index, uint8_t &mask) {
+        uint16_t syndrome = (code ^ stored) & S_CHECK_MASK;
+        bool oddErrors = (((code & S_PARITY_BIT) != 0) != parity(stored));
+        if (!oddErrors) {
+            return (syndrome == 0) ? OK : UNCORRECTABLE;
+        }
+
+        mask = 0;
+        if ((syndrome & (syndrome - 1)) == 0) {                         // error in stored code
+            return CORRECTED;
+        }
+        uint16_t pos = syndrome >> 4;
+        if (((syndrome & 0x08) == 0) || (pos < 1) || (pos > cnt)) {     // no valid data position
+            return UNCORRECTABLE;
+        }
+        index = pos - 1;
+        mask = 1 << (syndrome & 0x07);
+        return CORRECTED;
+    }
+
+private:
+    static const uint16_t S_CHECK_MASK = 0x0FFF;
+    static const uint16_t S_PARITY_BIT = 0x1000;
+
+    static inline bool parity(uint16_t value) {
+        return ((table(value & 0xFF) ^ table(value >> 8)) & 0x08) != 0;
+    }
+
+    /// Bit 0..2: XOR of the numbers of all set bits, bit 3: parity.
+    static inline uint8_t table(uint8_t data) {
+        static const uint8_t S_TABLE[256] _SLOTNVM_ECC_FLASHMEM_ = {
+        0x00, 0x08, 0x09, 0x01, 0x0A, 0x02, 0x03, 0x0B, 0x0B, 0x03, 0x02, 0x0A, 0x01, 0x09, 0x08, 0x00,
+        0x0C, 0x04, 0x05, 0x0D, 0x06, 0x0E, 0x0F, 0x07, 0x07, 0x0F, 0x0E, 0x06, 0x0D, 0x05, 0x04, 0x0C,
+        0x0D, 0x05, 0x04, 0x0C, 0x07, 0x0F, 0x0E, 0x06, 0x06, 0x0E, 0x0F, 0x07, 0x0C, 0x04, 0x05, 0x0D,
+        0x01, 0x09, 0x08, 0x00, 0x0B, 0x03, 0x02, 0x0A, 0x0A, 0x02, 0x03, 0x0B, 0x00, 0x08, 0x09, 0x01,
+        0x0E, 0x06, 0x07, 0x0F, 0x04, 0x0C, 0x0D, 0x05, 0x05, 0x0D, 0x0C, 0x04, 0x0F, 0x07, 0x06, 0x0E,
+        0x02, 0x0A, 0x0B, 0x03, 0x08, 0x00, 0x01, 0x09, 0x09, 0x01, 0x00, 0x08, 0x03, 0x0B, 0x0A, 0x02,
+        0x03, 0x0B, 0x0A, 0x02, 0x09, 0x01, 0x00, 0x08, 0x08, 0x00, 0x01, 0x09, 0x02, 0x0A, 0x0B, 0x03,
+        0x0F, 0x07, 0x06, 0x0E, 0x05, 0x0D, 0x0C, 0x04, 0x04, 0x0C, 0x0D, 0x05, 0x0E, 0x06, 0x07, 0x0F,
+        0x0F, 0x07, 0x06, 0x0E, 0x05, 0x0D, 0x0C, 0x04, 0x04, 0x0C, 0x0D, 0x05, 0x0E, 0x06, 0x07, 0x0F,
+        0x03, 0x0B, 0x0A, 0x02, 0x09, 0x01, 0x00, 0x08, 0x08, 0x00, 0x01, 0x09, 0x02, 0x0A, 0x0B, 0x03,
+        0x02, 0x0A, 0x0B, 0x03, 0x08, 0x00, 0x01, 0x09, 0x09, 0x01, 0x00, 0x08, 0x03, 0x0B, 0x0A, 0x02,
+        0x0E, 0x06, 0x07, 0x0F, 0x04, 0x0C, 0x0D, 0x05, 0x05, 0x0D, 0x0C, 0x04, 0x0F, 0x07, 0x06, 0x0E,
+        0x01, 0x09, 0x08, 0x00, 0x0B, 0x03, 0x02, 0x0A, 0x0A, 0x02, 0x03, 0x0B, 0x00, 0x08, 0x09, 0x01,
+        0x0D, 0x05, 0x04, 0x0C, 0x07, 0x0F, 0x0E, 0x06, 0x06, 0x0E, 0x0F, 0x07, 0x0C, 0x04, 0x05, 0x0D,
+        0x0C, 0x04, 0x05, 0x0D, 0x06, 0x0E, 0x0F, 0x07, 0x07, 0x0F, 0x0E, 0x06, 0x0D, 0x05, 0x04, 0x0C,
+        0x00, 0x08, 0x09, 0x01, 0x0A, 0x02, 0x03, 0x0B, 0x0B, 0x03, 0x02, 0x0A, 0x01, 0x09, 0x08, 0x00,
+        };
+#ifdef __AVR_ARCH__
+        return pgm_read_byte(S_TABLE + data);
+#else
+        return S_TABLE[data];
+#endif
+    }
+};
+
+#endif // _SLOTNVM_SLOTNVMECC_H_
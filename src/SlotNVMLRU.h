@@ -0,0 +1,84 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SLOTNVMLRU_H_
+#define _SLOTNVM_SLOTNVMLRU_H_
+
+#include <stdint.h>
+
+
+/**
+ * Least recently used bookkeeping of the cache entries of SlotNVMReadCache and SlotNVMWriteCache.
+ * Uses an 8 bit use counter, the entries are renumbered before it overflows.
+ *
+ * @tparam ENTRY    Entry type of the cache with the members slot (0 means unused) and lastUse.
+ * @tparam ENTRIES  Count of entries.
+ */
+template <class ENTRY, uint8_t ENTRIES>
+class SlotNVMLRU {
+public:
+    SlotNVMLRU() : m_useCnt(0) {}
+
+    /**
+     * Mark an entry as most recently used.
+     * @param entries   All entries of the cache
+     * @param entry     Entry to mark, one of entries
+     */
+    inline void touch(ENTRY *entries, ENTRY &entry) {
+        if (m_useCnt == 0xFF) renumber(entries);
+        entry.lastUse = ++m_useCnt;
+    }
+
+    /**
+     * Find the least recently used entry.
+     * @param entries   All entries of the cache
+     * @return          Index of the used entry with the oldest use or ENTRIES if no entry is used
+     */
+    uint8_t findLRU(const ENTRY *entries) const;
+
+private:
+    uint8_t     m_useCnt;
+
+    void renumber(ENTRY *entries);
+};
+
+
+template <class ENTRY, uint8_t ENTRIES>
+uint8_t SlotNVMLRU<ENTRY, ENTRIES>::findLRU(const ENTRY *entries) const {
+    uint8_t victim = ENTRIES;
+    uint8_t victimAge = 0;
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        if (entries[i].slot == 0) continue;
+        uint8_t age = m_useCnt - entries[i].lastUse;            // no overflow, see renumber()
+        if ((victim == ENTRIES) || (age > victimAge)) {
+            victim = i;
+            victimAge = age;
+        }
+    }
+    return victim;
+}
+
+template <class ENTRY, uint8_t ENTRIES>
+void SlotNVMLRU<ENTRY, ENTRIES>::renumber(ENTRY *entries) {
+    // m_useCnt is about to overflow, replace lastUse by the rank of the entries, so the order is kept
+    uint8_t rank[ENTRIES];
+    uint8_t cnt = 0;
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        rank[i] = 0;
+        if (entries[i].slot == 0) continue;
+        ++cnt;
+        for (uint8_t j = 0; j < ENTRIES; ++j) {
+            if ((entries[j].slot != 0) && (entries[j].lastUse < entries[i].lastUse)) ++rank[i];
+        }
+    }
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        entries[i].lastUse = rank[i];
+    }
+    m_useCnt = (cnt > 0) ? cnt - 1 : 0;
+}
+
+#endif // _SLOTNVM_SLOTNVMLRU_H_
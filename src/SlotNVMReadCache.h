@@ -0,0 +1,277 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SLOTNVMREADCACHE_H_
+#define _SLOTNVM_SLOTNVMREADCACHE_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NVMBase.h"
+#include "SlotNVMLRU.h"
+
+
+/**
+ * Read-through RAM cache for often read slots.
+ * Slot data read from NVM is stored in a fixed size arena, so the next read is only a memcpy.
+ * If the arena or the entry table is full the least recently used slot is removed.
+ * writeSlot() and eraseSlot() of this class remove the slot from cache.
+ * Do not write to the SlotNVM directly while using this cache or call invalidate() afterwards.
+ *
+ * @tparam NVM          SlotNVM class to cache.
+ * @tparam ARENA_SIZE   Bytes of RAM for cached slot data.
+ * @tparam ENTRIES      Max. count of cached slots.
+ */
+template <class NVM, nvm_size_t ARENA_SIZE, uint8_t ENTRIES>
+class SlotNVMReadCache {
+    static_assert(ARENA_SIZE > 0, "ARENA_SIZE must be greater than 0.");
+    static_assert(ENTRIES > 0, "ENTRIES must be greater than 0.");
+
+public:
+    /**
+     * @param nvm   SlotNVM to cache, begin() must be called before using the cache.
+     */
+    explicit SlotNVMReadCache(NVM &nvm);
+
+    /**
+     * Check if data is stored for a given slot.
+     * See SlotNVM::isSlotAvailable().
+     */
+    bool isSlotAvailable(uint8_t slot) const {
+        return m_nvm.isSlotAvailable(slot);
+    }
+
+    /**
+     * Write data to NVM and remove the slot from cache.
+     * See SlotNVM::writeSlot().
+     */
+    bool writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+        invalidate(slot);
+        return m_nvm.writeSlot(slot, data, len);
+    }
+
+    /**
+     * Write data to NVM and remove the slot from cache.
+     * See SlotNVM::writeSlot().
+     */
+    template <class T>
+    bool writeSlot(uint8_t slot, T &data) {
+      return writeSlot(slot, (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Read data from cache or NVM.
+     * See SlotNVM::readSlot().
+     */
+    bool readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len);
+
+    /**
+     * Read data from cache or NVM.
+     * See SlotNVM::readSlot().
+     */
+    template <class T>
+    bool readSlot(uint8_t slot, T &data) {
+      nvm_size_t len = 0;
+      readSlot(slot, NULL, len);
+      if (len == sizeof(T)) {
+        return readSlot(slot, (uint8_t *)&data, len);
+      } else {
+        return false;
+      }
+    }
+
+    /**
+     * Delete slot data from NVM and cache.
+     * See SlotNVM::eraseSlot().
+     */
+    bool eraseSlot(uint8_t slot) {
+        invalidate(slot);
+        return m_nvm.eraseSlot(slot);
+    }
+
+    /**
+     * Remove one slot from cache.
+     * @param slot  Slot number
+     */
+    void invalidate(uint8_t slot);
+
+    /// Remove all slots from cache.
+    void clear();
+
+    /// Count of readSlot() calls served from cache.
+    uint32_t getHits() const { return m_hits; }
+
+    /// Count of readSlot() calls that needed to read from NVM.
+    uint32_t getMisses() const { return m_misses; }
+
+    /// Set all counters to 0.
+    void resetCounters() {
+        m_hits = m_misses = 0;
+    }
+
+private:
+    struct Entry {
+        uint8_t     slot;           // 0 means unused
+        uint8_t     lastUse;
+        nvm_size_t  offset;         // position in m_arena
+        nvm_size_t  len;
+    };
+
+    NVM        &m_nvm;
+    nvm_size_t  m_top;              // first unused byte at the end of m_arena
+    uint32_t    m_hits;
+    uint32_t    m_misses;
+    Entry       m_entries[ENTRIES];
+    SlotNVMLRU<Entry, ENTRIES> m_lru;
+    uint8_t     m_arena[ARENA_SIZE];
+
+    uint8_t findEntry(uint8_t slot) const;
+
+    void insert(uint8_t slot, const uint8_t *data, nvm_size_t len);
+
+    void evictLRU();
+
+    void compact();
+
+    inline void touch(Entry &entry) {
+        m_lru.touch(m_entries, entry);
+    }
+};
+
+
+template <class NVM, nvm_size_t ARENA_SIZE, uint8_t ENTRIES>
+SlotNVMReadCache<NVM, ARENA_SIZE, ENTRIES>::SlotNVMReadCache(NVM &nvm)
+    : m_nvm(nvm)
+    , m_top(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+    clear();
+}
+
+template <class NVM, nvm_size_t ARENA_SIZE, uint8_t ENTRIES>
+bool SlotNVMReadCache<NVM, ARENA_SIZE, ENTRIES>::readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) {
+    uint8_t i = findEntry(slot);
+    if (i >= ENTRIES) {
+        ++m_misses;
+        bool res = m_nvm.readSlot(slot, data, len);
+        if (res && (len <= ARENA_SIZE)) {
+            insert(slot, data, len);
+        }
+        return res;
+    }
+
+    ++m_hits;
+    Entry &entry = m_entries[i];
+    touch(entry);
+    if (entry.len > len) {
+        len = entry.len;
+        return false;
+    }
+    len = entry.len;
+    if (data == NULL) return false;
+    memcpy(data, m_arena + entry.offset, entry.len);
+
+    return true;
+}
+
+template <class NVM, nvm_size_t ARENA_SIZE, uint8_t ENTRIES>
+void SlotNVMReadCache<NVM, ARENA_SIZE, ENTRIES>::invalidate(uint8_t slot) {
+    uint8_t i = findEntry(slot);
+    if (i < ENTRIES) {
+        m_entries[i].slot = 0;
+    }
+}
+
+template <class NVM, nvm_size_t ARENA_SIZE, uint8_t ENTRIES>
+void SlotNVMReadCache<NVM, ARENA_SIZE, ENTRIES>::clear() {
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        m_entries[i].slot = 0;
+    }
+    m_top = 0;
+}
+
+template <class NVM, nvm_size_t ARENA_SIZE, uint8_t ENTRIES>
+uint8_t SlotNVMReadCache<NVM, ARENA_SIZE, ENTRIES>::findEntry(uint8_t slot) const {
+    if (slot == 0) return ENTRIES;
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        if (m_entries[i].slot == slot) return i;
+    }
+    return ENTRIES;
+}
+
+template <class NVM, nvm_size_t ARENA_SIZE, uint8_t ENTRIES>
+void SlotNVMReadCache<NVM, ARENA_SIZE, ENTRIES>::insert(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+    uint8_t freeEntry;
+    nvm_size_t used;
+
+    // make room in entry table and arena
+    for (;;) {
+        freeEntry = ENTRIES;
+        used = 0;
+        for (uint8_t i = 0; i < ENTRIES; ++i) {
+            if (m_entries[i].slot == 0) {
+                freeEntry = i;
+            } else {
+                used += m_entries[i].len;
+            }
+        }
+        if ((freeEntry < ENTRIES) && ((ARENA_SIZE - used) >= len)) break;
+        evictLRU();
+    }
+
+    if ((ARENA_SIZE - m_top) < len) {
+        compact();                                              // now m_top == used
+    }
+
+    Entry &entry = m_entries[freeEntry];
+    entry.slot = slot;
+    entry.offset = m_top;
+    entry.len = len;
+    touch(entry);
+    memcpy(m_arena + m_top, data, len);
+    m_top += len;
+}
+
+template <class NVM, nvm_size_t ARENA_SIZE, uint8_t ENTRIES>
+void SlotNVMReadCache<NVM, ARENA_SIZE, ENTRIES>::evictLRU() {
+    uint8_t victim = m_lru.findLRU(m_entries);
+    if (victim < ENTRIES) {
+        m_entries[victim].slot = 0;
+    }
+}
+
+template <class NVM, nvm_size_t ARENA_SIZE, uint8_t ENTRIES>
+void SlotNVMReadCache<NVM, ARENA_SIZE, ENTRIES>::compact() {
+    // move all entries down in order of their position
+    nvm_size_t newTop = 0;
+    nvm_size_t lastOffset = 0;
+    bool first = true;
+    for (;;) {
+        uint8_t next = ENTRIES;
+        for (uint8_t i = 0; i < ENTRIES; ++i) {
+            if (m_entries[i].slot == 0) continue;
+            if (!first && (m_entries[i].offset <= lastOffset)) continue;
+            if ((next == ENTRIES) || (m_entries[i].offset < m_entries[next].offset)) {
+                next = i;
+            }
+        }
+        if (next == ENTRIES) break;
+
+        Entry &entry = m_entries[next];
+        lastOffset = entry.offset;
+        first = false;
+        if (entry.offset != newTop) {
+            memmove(m_arena + newTop, m_arena + entry.offset, entry.len);
+            entry.offset = newTop;
+        }
+        newTop += entry.len;
+    }
+    m_top = newTop;
+}
+
+#endif // _SLOTNVM_SLOTNVMREADCACHE_H_
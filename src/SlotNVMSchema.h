@@ -0,0 +1,225 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SLOTNVMSCHEMA_H_
+#define _SLOTNVM_SLOTNVMSCHEMA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "NVMBase.h"
+
+/**
+ * Field descriptor of a SlotNVMSchema, a member of struct S stored since schema version SINCE.
+ * The member is stored with its size and byte order, without padding, so use SLOTNVM_FIELD() to create it.
+ * @tparam S        Struct type
+ * @tparam T        Type of the member, must be copyable by memcpy()
+ * @tparam MEMBER   Pointer to the member
+ * @tparam SINCE    Schema version this field was added
+ */
+template <class S, class T, T S::*MEMBER, uint8_t SINCE>
+struct SlotNVMField {
+    static const nvm_size_t S_SIZE = sizeof(T);
+    static const uint8_t    S_SINCE = SINCE;
+    static const uint16_t   S_UNTIL = 256;
+
+    static void encode(const S &obj, uint8_t *buf) {
+        memcpy(buf, &(obj.*MEMBER), S_SIZE);
+    }
+
+    static void decode(S &obj, const uint8_t *buf) {
+        memcpy(&(obj.*MEMBER), buf, S_SIZE);
+    }
+};
+
+/**
+ * Field descriptor of a SlotNVMSchema for a removed member.
+ * SIZE bytes stored from schema version SINCE to version UNTIL - 1 are skipped while reading and no longer written.
+ * @tparam SIZE     Size of the removed member
+ * @tparam SINCE    Schema version this field was added
+ * @tparam UNTIL    Schema version this field was removed
+ */
+template <nvm_size_t SIZE, uint8_t SINCE, uint8_t UNTIL>
+struct SlotNVMRemovedField {
+    static_assert(SINCE < UNTIL, "A field must be removed after it was added.");
+
+    static const nvm_size_t S_SIZE = SIZE;
+    static const uint8_t    S_SINCE = SINCE;
+    static const uint16_t   S_UNTIL = UNTIL;
+
+    template <class S>
+    static void encode(const S &, uint8_t *) {}
+
+    template <class S>
+    static void decode(S &, const uint8_t *) {}
+};
+
+/**
+ * Create a SlotNVMField for member of struct S added in schema version since.
+ */
+#define SLOTNVM_FIELD(S, member, since) SlotNVMField<S, decltype(S::member), &S::member, since>
+
+/// Encodes and decodes the fields of a SlotNVMSchema one after the other.
+template <class S, uint8_t VERSION, class... FIELDS>
+class SlotNVMFields {
+public:
+    static const nvm_size_t S_SIZE = 0;
+    static const nvm_size_t S_MAX_SIZE = 0;
+
+    static nvm_size_t getSize(uint8_t) { return 0; }
+    static void encode(const S &, uint8_t *) {}
+    static void decode(S &, const uint8_t *, uint8_t) {}
+};
+
+template <class S, uint8_t VERSION, class FIELD, class... FIELDS>
+class SlotNVMFields<S, VERSION, FIELD, FIELDS...> {
+    static_assert(FIELD::S_SINCE <= VERSION, "Field is newer than the schema version.");
+
+    typedef SlotNVMFields<S, VERSION, FIELDS...> Rest;
+
+    static bool isStored(uint8_t version) {
+        return (version >= FIELD::S_SINCE) && (version < FIELD::S_UNTIL);
+    }
+
+public:
+    /// Size of all fields of VERSION
+    static const nvm_size_t S_SIZE = ((VERSION < FIELD::S_UNTIL) ? FIELD::S_SIZE : 0) + Rest::S_SIZE;
+    /// Size of all fields of all versions
+    static const nvm_size_t S_MAX_SIZE = FIELD::S_SIZE + Rest::S_MAX_SIZE;
+
+    static nvm_size_t getSize(uint8_t version) {
+        return (isStored(version) ? FIELD::S_SIZE : 0) + Rest::getSize(version);
+    }
+
+    static void encode(const S &obj, uint8_t *buf) {
+        if (isStored(VERSION)) {
+            FIELD::encode(obj, buf);
+            buf += FIELD::S_SIZE;
+        }
+        Rest::encode(obj, buf);
+    }
+
+    static void decode(S &obj, const uint8_t *buf, uint8_t version) {
+        if (isStored(version)) {
+            FIELD::decode(obj, buf);
+            buf += FIELD::S_SIZE;
+        }
+        Rest::decode(obj, buf, version);
+    }
+};
+
+/**
+ * Versioned layout of a struct stored in a slot.
+ *
+ * The templated readSlot() and writeSlot() of SlotNVM copy all bytes of an object including padding and
+ * fail if the size of the struct changes. A schema stores a version byte followed by the listed fields without
+ * padding. If a field is added, list it with the new version and increase VERSION. Data of older versions is
+ * still read, fields not stored in this version keep their value, so set defaults before reading.
+ * A removed member is replaced by a SlotNVMRemovedField. Stored data is not rewritten, the next write
+ * uses the current version.
+ *
+ *     struct Config { uint8_t mode; uint32_t baud; uint16_t timeout; };
+ *     typedef SlotNVMSchema<Config, 2,
+ *                           SLOTNVM_FIELD(Config, mode, 1),
+ *                           SLOTNVM_FIELD(Config, baud, 1),
+ *                           SLOTNVM_FIELD(Config, timeout, 2)> ConfigSchema;   // timeout added in version 2
+ *     ConfigSchema::writeSlot(slotNVM, 1, config);                             // 8 bytes instead of 12
+ *
+ * @tparam S        Struct type
+ * @tparam VERSION  Current schema version, 1 to 255
+ * @tparam FIELDS   Field descriptors, SlotNVMField or SlotNVMRemovedField, never change their order
+ */
+template <class S, uint8_t VERSION, class... FIELDS>
+class SlotNVMSchema {
+    static_assert(VERSION >= 1, "Schema version starts with 1.");
+
+    typedef SlotNVMFields<S, VERSION, FIELDS...> Fields;
+
+public:
+    typedef S Type;
+
+    /// Current schema version
+    static const uint8_t S_VERSION = VERSION;
+    /// Size of stored data of current version including version byte
+    static const nvm_size_t S_SIZE = 1 + Fields::S_SIZE;
+    /// Upper bound of stored data of all versions including version byte
+    static const nvm_size_t S_MAX_SIZE = 1 + Fields::S_MAX_SIZE;
+
+    static_assert(S_MAX_SIZE <= 256, "A slot can not store more than 256 bytes.");
+
+    /**
+     * Get the size of stored data of a version.
+     * @param version   Schema version
+     * @return      Size including version byte, 0 for an unknown version
+     */
+    static nvm_size_t getSize(uint8_t version) {
+        if ((version < 1) || (version > VERSION)) return 0;
+        return 1 + Fields::getSize(version);
+    }
+
+    /**
+     * Encode an object with the current version.
+     * @param       obj     Object
+     * @param[out]  buf     Buffer of at least S_SIZE bytes
+     * @return      Count of bytes written to buf, always S_SIZE
+     */
+    static nvm_size_t encode(const S &obj, uint8_t *buf) {
+        buf[0] = VERSION;
+        Fields::encode(obj, buf + 1);
+        return S_SIZE;
+    }
+
+    /**
+     * Decode an object of the current or an older version.
+     * On error obj is untouched.
+     * @param       obj     Object, fields not stored in the read version keep their value
+     * @param       buf     Stored data
+     * @param       len     Length of stored data
+     * @param[out]  version Version of stored data, may be NULL
+     * @return      false on unknown version or a length not matching this version
+     */
+    static bool decode(S &obj, const uint8_t *buf, nvm_size_t len, uint8_t *version = NULL) {
+        if ((buf == NULL) || (len < 1)) return false;
+        if (len != getSize(buf[0])) return false;
+        Fields::decode(obj, buf + 1, buf[0]);
+        if (version != NULL) *version = buf[0];
+        return true;
+    }
+
+    /**
+     * Write an object with the current version to a slot.
+     * @param nvm   SlotNVM or any other class with writeSlot() like SlotNVM
+     * @param slot  Slot number
+     * @param obj   Object
+     * @return      true on success else false
+     */
+    template <class NVM>
+    static bool writeSlot(NVM &nvm, uint8_t slot, const S &obj) {
+        uint8_t buf[S_SIZE];
+        return nvm.writeSlot(slot, buf, encode(obj, buf));
+    }
+
+    /**
+     * Read an object of the current or an older version from a slot.
+     * Data of an older version is not rewritten, call writeSlot() to do so.
+     * On error obj is untouched.
+     * @param       nvm     SlotNVM or any other class with readSlot() like SlotNVM
+     * @param       slot    Slot number
+     * @param       obj     Object, fields not stored in the read version keep their value
+     * @param[out]  version Version of stored data, may be NULL
+     * @return      true on success else false
+     */
+    template <class NVM>
+    static bool readSlot(NVM &nvm, uint8_t slot, S &obj, uint8_t *version = NULL) {
+        uint8_t buf[S_MAX_SIZE];
+        nvm_size_t len = S_MAX_SIZE;
+        if (!nvm.readSlot(slot, buf, len)) return false;
+        return decode(obj, buf, len, version);
+    }
+};
+
+#endif // _SLOTNVM_SLOTNVMSCHEMA_H_
@@ -0,0 +1,114 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SLOTNVMSTATS_H_
+#define _SLOTNVM_SLOTNVMSTATS_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "NVMBase.h"
+
+/*
+ * Define SLOTNVM_STATS before including SlotNVM.h or one of the other storage classes to count NVM access,
+ * see SlotNVM::getStats(). Without this define there is no extra RAM or code used.
+ */
+#ifdef SLOTNVM_STATS
+  // atomic where available, so concurrent readers (see ConcurrentSlotNVM) do not race
+  #if defined(__AVR_ARCH__)
+    #define _SLOTNVM_STATS_ADD_(member, value)  (this->m_stats.member += (value))
+  #elif defined(__GNUC__) || defined(__clang__)
+    #define _SLOTNVM_STATS_ADD_(member, value)  __atomic_fetch_add(&this->m_stats.member, (value), __ATOMIC_RELAXED)
+  #elif defined(_MSC_VER)
+    #include <intrin.h>
+    #define _SLOTNVM_STATS_ADD_(member, value)  _InterlockedExchangeAdd((volatile long *)&this->m_stats.member, (long)(value))
+  #else
+    #define _SLOTNVM_STATS_ADD_(member, value)  (this->m_stats.member += (value))
+  #endif
+
+  /// Statistics of NVM access, see SlotNVM::getStats().
+  struct SlotNVMStats {
+      uint32_t    reads;              ///< Count of read calls to NVM
+      uint32_t    writes;             ///< Count of write calls to NVM
+      uint32_t    bytesRead;          ///< Count of bytes read from NVM
+      uint32_t    bytesWritten;       ///< Count of bytes written to NVM
+      uint32_t    clustersAllocated;  ///< Count of clusters written by writeSlot()
+      uint32_t    clustersFreed;      ///< Count of clusters freed by writeSlot() and eraseSlot()
+      uint32_t    repairs;            ///< Count of invalid or old clusters freed by begin()
+      uint32_t    crcErrors;          ///< Count of clusters with wrong CRC found by begin()
+      uint32_t    eccCorrected;       ///< Count of bit errors corrected by begin() and readSlot() (ECC only)
+      uint32_t    eccErrors;          ///< Count of clusters with uncorrectable bit errors (ECC only)
+  };
+#else
+  #define _SLOTNVM_STATS_ADD_(member, value)
+#endif
+
+
+/**
+ * NVM access class counting the reads and writes of an other access class in a SlotNVMStats.
+ * SlotNVM, LogSlotNVM, RingLogNVM and CounterNVM derive from it instead of BASE,
+ * the other members of SlotNVMStats are counted by these classes with _SLOTNVM_STATS_ADD_().
+ * Without SLOTNVM_STATS it only passes all access to BASE.
+ *
+ * @tparam BASE     NVM access class, see NVMBase.
+ */
+template <class BASE>
+class CountingNVM : public BASE {
+public:
+    static const nvm_size_t S_SIZE = BASE::S_SIZE;
+
+#ifdef SLOTNVM_STATS
+    CountingNVM() {
+        resetStats();
+    }
+
+    bool read(nvm_address_t addr, uint8_t &data) const {
+        _SLOTNVM_STATS_ADD_(reads, 1);
+        _SLOTNVM_STATS_ADD_(bytesRead, 1);
+        return BASE::read(addr, data);
+    }
+
+    bool read(nvm_address_t addr, uint8_t *data, nvm_size_t len) const {
+        _SLOTNVM_STATS_ADD_(reads, 1);
+        _SLOTNVM_STATS_ADD_(bytesRead, len);
+        return BASE::read(addr, data, len);
+    }
+
+    bool write(nvm_address_t addr, uint8_t data) {
+        _SLOTNVM_STATS_ADD_(writes, 1);
+        _SLOTNVM_STATS_ADD_(bytesWritten, 1);
+        return BASE::write(addr, data);
+    }
+
+    bool write(nvm_address_t addr, const uint8_t *data, nvm_size_t len) {
+        _SLOTNVM_STATS_ADD_(writes, 1);
+        _SLOTNVM_STATS_ADD_(bytesWritten, len);
+        return BASE::write(addr, data, len);
+    }
+
+    /**
+     * Get statistics of NVM access since construction or last call of resetStats().
+     * Only available if SLOTNVM_STATS is defined.
+     * @return  Statistics
+     */
+    const SlotNVMStats &getStats() const {
+        return m_stats;
+    }
+
+    /**
+     * Set all statistics to 0.
+     * Only available if SLOTNVM_STATS is defined.
+     */
+    void resetStats() {
+        memset(&m_stats, 0, sizeof(m_stats));
+    }
+
+protected:
+    mutable SlotNVMStats m_stats;
+#endif
+};
+
+#endif // _SLOTNVM_SLOTNVMSTATS_H_
@@ -0,0 +1,347 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SLOTNVMWRITECACHE_H_
+#define _SLOTNVM_SLOTNVMWRITECACHE_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NVMBase.h"
+#include "SlotNVMLRU.h"
+
+
+/**
+ * Write-back RAM cache for often rewritten slots like counters.
+ * Writes are collected in RAM and only the last one is written to NVM when the cache is flushed.
+ * A flush is done
+ *  - by calling flush(),
+ *  - by calling onLowVoltage(), e.g. from your brown-out detection,
+ *  - if a slot was written MAX_WRITES times since the last flush,
+ *  - by poll() if a slot is dirty for more than MAX_AGE time units (needs TIME_FUNC),
+ *  - if a cache entry is needed for an other slot.
+ * Data not flushed is lost on power loss, so use this only for data where this is acceptable.
+ *
+ * @tparam NVM          SlotNVM class to cache.
+ * @tparam ENTRIES      Count of slots hold in RAM.
+ * @tparam MAX_LEN      Max. size of slot data that can be cached. Bigger slots are written directly.
+ * @tparam TIME_TYPE    Return type of TIME_FUNC.
+ * @tparam TIME_FUNC    Function returning the current time, e.g. millis().
+ *                      NULL disables the time based flush.
+ */
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN,
+          typename TIME_TYPE = unsigned long, TIME_TYPE (*TIME_FUNC)() = (TIME_TYPE (*)())NULL>
+class SlotNVMWriteCache {
+    static_assert(ENTRIES > 0, "ENTRIES must be greater than 0.");
+    static_assert((MAX_LEN > 0) && (MAX_LEN <= 256), "MAX_LEN must be in range 1 to 256.");
+
+public:
+    /**
+     * @param nvm           SlotNVM to cache, begin() must be called before using the cache.
+     * @param maxWrites     Flush a slot after this count of writes, 0 means no limit.
+     * @param maxAge        Flush a slot in poll() if it is dirty for at least this time, 0 means no limit.
+     */
+    explicit SlotNVMWriteCache(NVM &nvm, uint8_t maxWrites = 0, TIME_TYPE maxAge = 0);
+
+    /**
+     * Check if data is stored for a given slot, in cache or in NVM.
+     * @param slot  Slot number to check,
+     * @return      true if there is data for this slot.
+     */
+    bool isSlotAvailable(uint8_t slot) const {
+        return (findEntry(slot) < ENTRIES) || m_nvm.isSlotAvailable(slot);
+    }
+
+    /**
+     * Write data into cache.
+     * See SlotNVM::writeSlot().
+     */
+    bool writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len);
+
+    /**
+     * Write data into cache.
+     * See SlotNVM::writeSlot().
+     */
+    template <class T>
+    bool writeSlot(uint8_t slot, T &data) {
+      return writeSlot(slot, (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Read data from cache or NVM.
+     * See SlotNVM::readSlot().
+     */
+    bool readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len);
+
+    /**
+     * Read data from cache or NVM.
+     * See SlotNVM::readSlot().
+     */
+    template <class T>
+    bool readSlot(uint8_t slot, T &data) {
+      nvm_size_t len = 0;
+      readSlot(slot, NULL, len);
+      if (len == sizeof(T)) {
+        return readSlot(slot, (uint8_t *)&data, len);
+      } else {
+        return false;
+      }
+    }
+
+    /**
+     * Delete slot data from cache and NVM.
+     * See SlotNVM::eraseSlot().
+     */
+    bool eraseSlot(uint8_t slot);
+
+    /**
+     * Write all dirty slots to NVM.
+     * @return  true on success else false
+     */
+    bool flush();
+
+    /**
+     * Write one slot to NVM if it is dirty.
+     * @param slot  Slot number
+     * @return      true on success or if the slot is not dirty else false
+     */
+    bool flush(uint8_t slot);
+
+    /**
+     * Write all dirty slots to NVM, call this if power is going down.
+     * @return  true on success else false
+     */
+    bool onLowVoltage() {
+        return flush();
+    }
+
+    /**
+     * Call this regularly to flush slots that are dirty for at least maxAge.
+     * Does nothing if TIME_FUNC is NULL or maxAge is 0.
+     * @return  true on success else false
+     */
+    bool poll();
+
+    /// Count of readSlot() calls served from cache.
+    uint32_t getHits() const { return m_hits; }
+
+    /// Count of readSlot() calls that needed to read from NVM.
+    uint32_t getMisses() const { return m_misses; }
+
+    /// Count of user data bytes not written to NVM because writes where combined in cache.
+    uint32_t getSavedBytes() const { return m_savedBytes; }
+
+    /// Set all counters to 0.
+    void resetCounters() {
+        m_hits = m_misses = m_savedBytes = 0;
+    }
+
+private:
+    struct Entry {
+        uint8_t     slot;           // 0 means unused
+        bool        dirty;
+        uint8_t     writes;         // writes since last flush
+        uint8_t     lastUse;
+        nvm_size_t  len;
+        TIME_TYPE   dirtySince;
+        uint8_t     data[MAX_LEN];
+    };
+
+    NVM        &m_nvm;
+    uint8_t     m_maxWrites;
+    TIME_TYPE   m_maxAge;
+    uint32_t    m_hits;
+    uint32_t    m_misses;
+    uint32_t    m_savedBytes;
+    Entry       m_entries[ENTRIES];
+    SlotNVMLRU<Entry, ENTRIES> m_lru;
+
+    uint8_t findEntry(uint8_t slot) const;
+
+    uint8_t allocEntry();
+
+    bool flushEntry(Entry &entry);
+
+    inline void touch(Entry &entry) {
+        m_lru.touch(m_entries, entry);
+    }
+};
+
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::SlotNVMWriteCache(NVM &nvm, uint8_t maxWrites, TIME_TYPE maxAge)
+    : m_nvm(nvm)
+    , m_maxWrites(maxWrites)
+    , m_maxAge(maxAge)
+    , m_hits(0)
+    , m_misses(0)
+    , m_savedBytes(0)
+{
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        m_entries[i].slot = 0;
+        m_entries[i].dirty = false;
+    }
+}
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+bool SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+    if (!m_nvm.isValid()) return false;
+    if (data == NULL) return false;
+    if ((slot < NVM::S_FIRST_SLOT) || (slot > NVM::S_LAST_SLOT)) return false;
+
+    uint8_t i = findEntry(slot);
+    if (len > MAX_LEN) {
+        // to big for cache, write directly and forget cached data
+        if (i < ENTRIES) {
+            m_entries[i].slot = 0;
+            m_entries[i].dirty = false;
+        }
+        return m_nvm.writeSlot(slot, data, len);
+    }
+    if (len < 1) return false;
+
+    if (i < ENTRIES) {
+        Entry &entry = m_entries[i];
+        if ((entry.len == len) && (memcmp(entry.data, data, len) == 0)) {
+            m_savedBytes += len;                                // nothing changed
+            touch(entry);
+            return true;
+        }
+        if (entry.dirty) {
+            m_savedBytes += entry.len;                          // last write never reaches NVM
+        }
+    } else {
+        i = allocEntry();
+        if (i >= ENTRIES) return false;                         // flushing evicted entry failed
+        m_entries[i].slot = slot;
+        m_entries[i].dirty = false;
+    }
+
+    Entry &entry = m_entries[i];
+    memcpy(entry.data, data, len);
+    entry.len = len;
+    if (!entry.dirty) {
+        entry.dirty = true;
+        entry.writes = 0;
+        if (TIME_FUNC != NULL) {
+            entry.dirtySince = TIME_FUNC();
+        }
+    }
+    ++entry.writes;
+    touch(entry);
+
+    if ((m_maxWrites > 0) && (entry.writes >= m_maxWrites)) {
+        return flushEntry(entry);
+    }
+
+    return true;
+}
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+bool SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) {
+    uint8_t i = findEntry(slot);
+    if (i >= ENTRIES) {
+        ++m_misses;
+        return m_nvm.readSlot(slot, data, len);
+    }
+
+    ++m_hits;
+    Entry &entry = m_entries[i];
+    touch(entry);
+    if (entry.len > len) {
+        len = entry.len;
+        return false;
+    }
+    len = entry.len;
+    if (data == NULL) return false;
+    memcpy(data, entry.data, entry.len);
+
+    return true;
+}
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+bool SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::eraseSlot(uint8_t slot) {
+    uint8_t i = findEntry(slot);
+    bool wasCached = false;
+    if (i < ENTRIES) {
+        wasCached = true;
+        m_entries[i].slot = 0;
+        m_entries[i].dirty = false;
+    }
+
+    if (m_nvm.isSlotAvailable(slot)) {
+        return m_nvm.eraseSlot(slot);
+    } else {
+        return wasCached;
+    }
+}
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+bool SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::flush() {
+    bool ret = true;
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        if (!flushEntry(m_entries[i])) ret = false;
+    }
+    return ret;
+}
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+bool SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::flush(uint8_t slot) {
+    uint8_t i = findEntry(slot);
+    if (i >= ENTRIES) return true;
+    return flushEntry(m_entries[i]);
+}
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+bool SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::poll() {
+    if ((TIME_FUNC == NULL) || (m_maxAge == 0)) return true;
+
+    TIME_TYPE now = TIME_FUNC();
+    bool ret = true;
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        Entry &entry = m_entries[i];
+        if (!entry.dirty) continue;
+        if ((TIME_TYPE)(now - entry.dirtySince) < m_maxAge) continue;   // works also with overflow
+        if (!flushEntry(entry)) ret = false;
+    }
+    return ret;
+}
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+uint8_t SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::findEntry(uint8_t slot) const {
+    if (slot == 0) return ENTRIES;
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        if (m_entries[i].slot == slot) return i;
+    }
+    return ENTRIES;
+}
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+uint8_t SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::allocEntry() {
+    for (uint8_t i = 0; i < ENTRIES; ++i) {
+        if (m_entries[i].slot == 0) return i;                   // unused entry
+    }
+
+    // evict least recently used entry
+    uint8_t victim = m_lru.findLRU(m_entries);
+    if (!flushEntry(m_entries[victim])) return ENTRIES;
+    m_entries[victim].slot = 0;
+    return victim;
+}
+
+template <class NVM, uint8_t ENTRIES, nvm_size_t MAX_LEN, typename TIME_TYPE, TIME_TYPE (*TIME_FUNC)()>
+bool SlotNVMWriteCache<NVM, ENTRIES, MAX_LEN, TIME_TYPE, TIME_FUNC>::flushEntry(Entry &entry) {
+    if (!entry.dirty) return true;
+    bool res = m_nvm.writeSlot(entry.slot, entry.data, entry.len);
+    if (res) {
+        entry.dirty = false;
+        entry.writes = 0;
+    }
+    return res;
+}
+
+#endif // _SLOTNVM_SLOTNVMWRITECACHE_H_
@@ -0,0 +1,268 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SNAPSHOTSLOTNVM_H_
+#define _SLOTNVM_SNAPSHOTSLOTNVM_H_
+
+#ifndef __AVR_ARCH__
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "NVMBase.h"
+
+/**
+ * SlotNVM with lock-free readers for hosts like a Linux gateway (needs C++11).
+ *
+ * The start cluster of every slot is kept in RAM. Readers load it atomically and read the chain
+ * without taking a lock. A writer writes the new chain, publishes its start cluster and then waits
+ * until all readers which could still see the old start cluster are done (epoch based, like RCU),
+ * before the old chain is freed. So a slow writeSlot() never blocks a reader, a reader gets either
+ * the old or the new data. Writers are serialized by a mutex.
+ *
+ * The NVM access class must allow reads parallel to writes to other addresses, e.g. use pread() and pwrite() for a file.
+ * begin() must be called before other threads access the NVM.
+ * Statistics (SLOTNVM_STATS) are counted atomically, resetStats() must not be called while other threads access the NVM.
+ *
+ * @tparam NVM      SlotNVM class, e.g. SnapshotSlotNVM< SlotNVM<NVMFile, 64> >.
+ */
+template <class NVM>
+class SnapshotSlotNVM : private NVM {
+public:
+    using NVM::S_CLUSTER_CNT;
+    using NVM::S_USER_DATA_PER_CLUSTER;
+    using NVM::S_PROVISION;
+    using NVM::S_FIRST_SLOT;
+    using NVM::S_LAST_SLOT;
+    typedef typename NVM::SlotInfo SlotInfo;
+
+    SnapshotSlotNVM() : m_epoch(0) {
+        m_readers[0] = 0;
+        m_readers[1] = 0;
+        for (uint16_t i = 0; i <= S_LAST_SLOT; ++i) {
+            m_startCluster[i] = S_NO_CLUSTER;
+        }
+    }
+
+    /**
+     * Initialize SlotNVM and build the start cluster index.
+     * See SlotNVM::begin().
+     */
+    bool begin() {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        bool res = NVM::begin();
+        if (!res) return false;
+
+        const uint8_t cnt = S_LAST_SLOT - S_FIRST_SLOT + 1;
+        uint8_t slots[cnt];
+        uint8_t startClusters[cnt];
+        uint8_t found[(cnt + 7) / 8];
+        memset(found, 0, sizeof(found));
+        for (uint8_t i = 0; i < cnt; ++i) {
+            slots[i] = S_FIRST_SLOT + i;
+        }
+        res = NVM::findStartClusters(cnt, slots, startClusters, found);
+        if (!res) return false;
+        for (uint8_t i = 0; i < cnt; ++i) {
+            bool avail = (found[i / 8] & (1 << (i % 8))) != 0;
+            m_startCluster[slots[i]] = avail ? startClusters[i] : S_NO_CLUSTER;
+        }
+        return true;
+    }
+
+    /**
+     * Check if begin is called before and returns true.
+     * See SlotNVM::isValid().
+     */
+    bool isValid() const {
+        return NVM::isValid();
+    }
+
+    /**
+     * Check if data is stored for a given slot, lock-free.
+     * See SlotNVM::isSlotAvailable().
+     */
+    bool isSlotAvailable(uint8_t slot) const {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        return m_startCluster[slot] != S_NO_CLUSTER;
+    }
+
+    /**
+     * Write data, readers continue to read the old data until the new one is complete.
+     * Returns after the old data is freed, other writers wait until then.
+     * See SlotNVM::writeSlot().
+     */
+    bool writeSlot(uint8_t slot, const uint8_t *data, nvm_size_t len) {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        uint8_t startCluster;
+        uint8_t oldStartCluster;
+        bool overwrite;
+        bool res = NVM::writeChain(slot, data, len, startCluster, overwrite, oldStartCluster);
+        if (!res) return false;
+
+        m_startCluster[slot] = startCluster;
+        if (overwrite) {
+            synchronize();
+            NVM::clearClusters(oldStartCluster); // ignore the result it's to late to say writeSlot gone wrong
+        }
+        return true;
+    }
+
+    /**
+     * Write data, readers continue to read the old data until the new one is complete.
+     * See SlotNVM::writeSlot().
+     */
+    template <class T>
+    bool writeSlot(uint8_t slot, T &data) {
+      return writeSlot(slot, (const uint8_t *)&data, sizeof(T));
+    }
+
+    /**
+     * Read data without lock, also during a write of the same slot.
+     * See SlotNVM::readSlot().
+     */
+    bool readSlot(uint8_t slot, uint8_t *data, nvm_size_t &len) const {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        ReadGuard guard(*this);
+        int16_t startCluster = m_startCluster[slot];
+        if (startCluster == S_NO_CLUSTER) return false;
+        return NVM::readChain(startCluster, data, len);
+    }
+
+    /**
+     * Read data without lock, size check and read are done on the same snapshot.
+     * See SlotNVM::readSlot().
+     */
+    template <class T>
+    bool readSlot(uint8_t slot, T &data) const {
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        ReadGuard guard(*this);
+        int16_t startCluster = m_startCluster[slot];
+        if (startCluster == S_NO_CLUSTER) return false;
+        nvm_size_t len = 0;
+        NVM::readChain(startCluster, NULL, len);
+        if (len != sizeof(T)) return false;
+        return NVM::readChain(startCluster, (uint8_t *)&data, len);
+    }
+
+    /**
+     * Read data of several slots without lock.
+     * See SlotNVM::readSlots().
+     */
+    bool readSlots(uint8_t cnt, const uint8_t slots[], uint8_t *data[], nvm_size_t len[]) const {
+        if ((slots == NULL) || (data == NULL) || (len == NULL)) return false;
+        bool ret = true;
+        for (uint8_t i = 0; i < cnt; ++i) {
+            if (!readSlot(slots[i], data[i], len[i])) ret = false;
+        }
+        return ret;
+    }
+
+    /**
+     * Delete slot data, returns after all readers of the slot are done.
+     * See SlotNVM::eraseSlot().
+     */
+    bool eraseSlot(uint8_t slot) {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        if ((slot < S_FIRST_SLOT) || (slot > S_LAST_SLOT)) return false;
+        int16_t startCluster = m_startCluster[slot].exchange(S_NO_CLUSTER);
+        if (startCluster == S_NO_CLUSTER) return false;
+
+        synchronize();
+        bool res = NVM::eraseSlot(slot);
+        if (!res) {
+            m_startCluster[slot] = startCluster;
+        }
+        return res;
+    }
+
+    /**
+     * Get amount of total available user data.
+     * See SlotNVM::getSize().
+     */
+    nvm_size_t getSize() const {
+        return NVM::getSize();
+    }
+
+    /**
+     * Get amount of total usable user data.
+     * See SlotNVM::getUsableSize().
+     */
+    nvm_size_t getUsableSize() const {
+        return NVM::getUsableSize();
+    }
+
+    /**
+     * Get amount of free user data, waits for running writers.
+     * See SlotNVM::getFree().
+     */
+    nvm_size_t getFree() const {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        return NVM::getFree();
+    }
+
+    /**
+     * Call func for every stored slot, writers wait until all slots are visited.
+     * @param func  Function or lambda called with a const SlotInfo &, see SlotNVM::slots().
+     */
+    template <class FUNC>
+    void forEachSlot(FUNC func) const {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        for (const SlotInfo &info : NVM::slots()) {
+            func(info);
+        }
+    }
+
+#ifdef SLOTNVM_STATS
+    using NVM::getStats;
+    using NVM::resetStats;
+#endif
+
+private:
+    static const int16_t S_NO_CLUSTER = -1;
+
+    /// Registers a reader in the current epoch for its lifetime.
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const SnapshotSlotNVM &nvm)
+            : m_readers(nvm.m_readers[nvm.m_epoch.load() & 1]) {
+            ++m_readers;
+        }
+
+        ~ReadGuard() {
+            --m_readers;
+        }
+
+    private:
+        std::atomic<uint32_t> &m_readers;
+    };
+
+    /**
+     * Wait until all readers which started before are done.
+     * The epoch is flipped twice, so a reader is waited for even if it registered
+     * with the parity of an epoch which was already flipped.
+     */
+    void synchronize() {
+        for (uint8_t i = 0; i < 2; ++i) {
+            uint32_t epoch = m_epoch++;
+            while (m_readers[epoch & 1] != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::atomic<int16_t>            m_startCluster[S_LAST_SLOT + 1];
+    mutable std::atomic<uint32_t>   m_epoch;
+    mutable std::atomic<uint32_t>   m_readers[2];
+    mutable std::mutex              m_writeMutex;
+};
+
+#endif // __AVR_ARCH__
+
+#endif // _SLOTNVM_SNAPSHOTSLOTNVM_H_
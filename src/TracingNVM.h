@@ -0,0 +1,194 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_TRACINGNVM_H_
+#define _SLOTNVM_TRACINGNVM_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "NVMBase.h"
+
+#ifndef __AVR_ARCH__
+  #include <stdio.h>
+#endif
+
+
+/// One recorded NVM access, see TracingNVM.
+struct NVMTraceEntry {
+    enum Operation {
+        READ  = 'R',
+        WRITE = 'W',
+        ERASE = 'E'
+    };
+
+    uint8_t         op;         ///< One of Operation
+    nvm_address_t   addr;       ///< First accessed address
+    nvm_size_t      len;        ///< Count of accessed bytes
+    uint32_t        time;       ///< Time stamp from TIME_FUNC of TracingNVM or a sequence number
+};
+
+
+/**
+ * NVM access class that records every access of an other access class.
+ * Use it as BASE of SlotNVM to see which reads and writes are done.
+ * Every access is passed to TRACE_FUNC, this function can store it into a NVMTraceBuffer, print it or write it to a file.
+ *
+ * @tparam BASE         NVM access class to trace, see NVMBase.
+ * @tparam TRACE_FUNC   Function called for every access.
+ * @tparam TIME_TYPE    Return type of TIME_FUNC.
+ * @tparam TIME_FUNC    Function returning the current time, e.g. micros().
+ *                      NULL means a sequence number is used as time stamp.
+ */
+template <class BASE, void (*TRACE_FUNC)(const NVMTraceEntry &entry),
+          typename TIME_TYPE = unsigned long, TIME_TYPE (*TIME_FUNC)() = (TIME_TYPE (*)())NULL>
+class TracingNVM : public BASE {
+public:
+    static const nvm_size_t S_SIZE = BASE::S_SIZE;
+
+    TracingNVM() : m_seqNo(0) {}
+
+    bool erase(nvm_address_t start, nvm_size_t len) {
+        trace(NVMTraceEntry::ERASE, start, len);
+        return BASE::erase(start, len);
+    }
+
+    bool read(nvm_address_t addr, uint8_t &data) const {
+        trace(NVMTraceEntry::READ, addr, 1);
+        return BASE::read(addr, data);
+    }
+
+    bool read(nvm_address_t addr, uint8_t *data, nvm_size_t len) const {
+        trace(NVMTraceEntry::READ, addr, len);
+        return BASE::read(addr, data, len);
+    }
+
+    bool write(nvm_address_t addr, uint8_t data) {
+        trace(NVMTraceEntry::WRITE, addr, 1);
+        return BASE::write(addr, data);
+    }
+
+    bool write(nvm_address_t addr, const uint8_t *data, nvm_size_t len) {
+        trace(NVMTraceEntry::WRITE, addr, len);
+        return BASE::write(addr, data, len);
+    }
+
+private:
+    mutable uint32_t m_seqNo;
+
+    void trace(uint8_t op, nvm_address_t addr, nvm_size_t len) const {
+        NVMTraceEntry entry;
+        entry.op = op;
+        entry.addr = addr;
+        entry.len = len;
+        if (TIME_FUNC != NULL) {
+            entry.time = (uint32_t)TIME_FUNC();
+        } else {
+            entry.time = m_seqNo++;
+        }
+        TRACE_FUNC(entry);
+    }
+};
+
+
+/**
+ * Ring buffer for NVMTraceEntry, if it is full the oldest entry is overwritten.
+ *
+ * @tparam ENTRIES  Count of entries.
+ */
+template <uint16_t ENTRIES>
+class NVMTraceBuffer {
+    static_assert(ENTRIES > 0, "ENTRIES must be greater than 0.");
+
+public:
+    NVMTraceBuffer() {
+        clear();
+    }
+
+    /// Add an entry.
+    void add(const NVMTraceEntry &entry) {
+        m_entries[m_next] = entry;
+        ++m_next;
+        if (m_next >= ENTRIES) m_next = 0;
+        if (m_cnt < ENTRIES) {
+            ++m_cnt;
+        } else {
+            ++m_lost;
+        }
+    }
+
+    /// Count of stored entries.
+    uint16_t size() const {
+        return m_cnt;
+    }
+
+    /**
+     * Get a stored entry.
+     * @param       i       Index, 0 is the oldest entry
+     * @param[out]  entry   The entry
+     * @return      true on success, false if index is out of range
+     */
+    bool get(uint16_t i, NVMTraceEntry &entry) const {
+        if (i >= m_cnt) return false;
+        uint16_t pos = (m_next + ENTRIES - m_cnt + i) % ENTRIES;
+        entry = m_entries[pos];
+        return true;
+    }
+
+    /// Count of overwritten entries.
+    uint32_t lost() const {
+        return m_lost;
+    }
+
+    /// Remove all entries.
+    void clear() {
+        m_next = 0;
+        m_cnt = 0;
+        m_lost = 0;
+    }
+
+private:
+    uint16_t        m_next;
+    uint16_t        m_cnt;
+    uint32_t        m_lost;
+    NVMTraceEntry   m_entries[ENTRIES];
+};
+
+
+#ifndef __AVR_ARCH__
+/**
+ * Write an entry as one text line like "W 0x0040 4 1234" (operation, address, length, time).
+ * This format is read by tools/TraceReplay.
+ * @param file  File to write to
+ * @param entry Entry to write
+ * @return      true on success else false
+ */
+inline bool printNVMTraceEntry(FILE *file, const NVMTraceEntry &entry) {
+    return fprintf(file, "%c 0x%04x %u %lu\n", entry.op, (unsigned)entry.addr, (unsigned)entry.len,
+                   (unsigned long)entry.time) > 0;
+}
+
+/**
+ * Parse one line written by printNVMTraceEntry().
+ * @param       line    Text line
+ * @param[out]  entry   Parsed entry
+ * @return      true on success, false if line is not a valid entry, e.g. an empty line or a comment
+ */
+inline bool parseNVMTraceEntry(const char *line, NVMTraceEntry &entry) {
+    char op;
+    unsigned addr, len;
+    unsigned long time;
+    if (sscanf(line, " %c %x %u %lu", &op, &addr, &len, &time) != 4) return false;
+    if ((op != NVMTraceEntry::READ) && (op != NVMTraceEntry::WRITE) && (op != NVMTraceEntry::ERASE)) return false;
+    entry.op = op;
+    entry.addr = addr;
+    entry.len = len;
+    entry.time = time;
+    return true;
+}
+#endif
+
+#endif // _SLOTNVM_TRACINGNVM_H_
@@ -0,0 +1,144 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <atomic>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "ConcurrentSlotNVM.h"
+#include "NVMRAMMock.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ConcurrentSlotNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( ConcurrentSlotNVMTest );
+
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_threads_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<1024>, 32>   NVM_t;
+    typedef ConcurrentSlotNVM<NVM_t>        Concurrent_t;
+    NVM_t           *nvm;
+    Concurrent_t    *concurrent;
+
+public:
+    void setUp() {
+        nvm = new NVM_t;
+        concurrent = new Concurrent_t(*nvm);
+    }
+
+    void tearDown()  {
+        delete concurrent;
+        delete nvm;
+    }
+
+    void test_access_00() {
+        CPPUNIT_ASSERT( !concurrent->isValid() );
+        CPPUNIT_ASSERT( concurrent->begin() );
+        CPPUNIT_ASSERT( concurrent->isValid() );
+
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( concurrent->writeSlot(1, value) );
+        CPPUNIT_ASSERT( concurrent->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( concurrent->getFree() == nvm->getFree() );
+
+        uint32_t valueR = 0;
+        CPPUNIT_ASSERT( concurrent->readSlot(1, valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+
+        uint8_t data[4];
+        nvm_size_t len = sizeof(data);
+        CPPUNIT_ASSERT( concurrent->readSlot(1, data, len) );
+        CPPUNIT_ASSERT( len == 4 );
+
+        unsigned cnt = 0;
+        concurrent->forEachSlot([&cnt](const NVM_t::SlotInfo &info) {
+            CPPUNIT_ASSERT( info.slot == 1 );
+            CPPUNIT_ASSERT( info.len == 4 );
+            ++cnt;
+        });
+        CPPUNIT_ASSERT( cnt == 1 );
+
+        CPPUNIT_ASSERT( concurrent->eraseSlot(1) );
+        CPPUNIT_ASSERT( !concurrent->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !concurrent->readSlot(1, valueR) );
+    }
+
+    void test_threads_00() {
+        CPPUNIT_ASSERT( concurrent->begin() );
+
+        // every slot is filled with its slot number and a counter, readers must never see mixed data
+        const uint8_t SLOTS = 4;
+        uint8_t data[40];
+        for (uint8_t slot = 1; slot <= SLOTS; ++slot) {
+            memset(data, slot, sizeof(data));
+            CPPUNIT_ASSERT( concurrent->writeSlot(slot, data, sizeof(data)) );
+        }
+
+        std::atomic<bool> stop(false);
+        std::atomic<unsigned> errors(0);
+        std::atomic<unsigned> reads(0);
+        auto reader = [&]() {
+            uint8_t buf[40];
+            while (!stop) {
+                for (uint8_t slot = 1; slot <= SLOTS; ++slot) {
+                    nvm_size_t len = sizeof(buf);
+                    if (!concurrent->readSlot(slot, buf, len) || (len != sizeof(buf))) {
+                        ++errors;
+                        continue;
+                    }
+                    for (nvm_size_t i = 1; i < len; ++i) {
+                        if (buf[i] != buf[0]) ++errors;
+                    }
+                    ++reads;
+                }
+            }
+        };
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.push_back(std::thread(reader));
+        }
+        for (unsigned i = 0; i < 500; ++i) {
+            uint8_t slot = 1 + i % SLOTS;
+            memset(data, (uint8_t)(slot + 16 * i), sizeof(data));
+            CPPUNIT_ASSERT( concurrent->writeSlot(slot, data, sizeof(data)) );
+            if ((i % 50) == 0) std::this_thread::yield();
+        }
+        stop = true;
+        for (size_t t = 0; t < readers.size(); ++t) {
+            readers[t].join();
+        }
+
+        CPPUNIT_ASSERT( errors == 0 );
+        CPPUNIT_ASSERT( reads > 0 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ConcurrentSlotNVMTest );
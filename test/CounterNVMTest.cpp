@@ -0,0 +1,207 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "CounterNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CounterNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( CounterNVMTest );
+
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_set_00 );
+CPPUNIT_TEST( test_wear_00 );
+CPPUNIT_TEST( test_powerFail_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef CounterNVM<NVMRAMMock<1024>, 32, 4, &testCRC8>   NVM_t;      // 8 blocks per counter
+    typedef CounterNVM<NVMRAMMock<64>, 16, 2, &testCRC8>     Small_t;    // 2 blocks per counter
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_access_00() {
+        NVM_t nvm;
+        uint32_t value = 5;
+        CPPUNIT_ASSERT( !nvm.increment(0) );            // begin() not called
+        CPPUNIT_ASSERT( !nvm.get(0, value) );
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( !nvm.begin() );
+        CPPUNIT_ASSERT( nvm.get(0, value) );
+        CPPUNIT_ASSERT( value == 0 );
+        CPPUNIT_ASSERT( !nvm.get(4, value) );
+        CPPUNIT_ASSERT( !nvm.increment(4) );
+        CPPUNIT_ASSERT( !nvm.set(4, 1) );
+
+        // the first increment writes a block, the next ones a single byte
+        CPPUNIT_ASSERT( nvm.increment(1) );
+        CPPUNIT_ASSERT( nvm.get(1, value) );
+        CPPUNIT_ASSERT( value == 1 );
+        for (uint16_t i = 0; i < 20; ++i) {
+            nvm.resetStats();
+            CPPUNIT_ASSERT( nvm.increment(1) );
+            CPPUNIT_ASSERT( (nvm.getStats().writes == 1) && (nvm.getStats().bytesWritten == 1) );
+            CPPUNIT_ASSERT( nvm.get(1, value) );
+            CPPUNIT_ASSERT( value == 22u + i - 20 );
+            CPPUNIT_ASSERT( nvm.getStats().reads == 0 );
+        }
+        CPPUNIT_ASSERT( nvm.m_memory[NVM_t::blockAddr(1, 0) + 8] == 0x00 );
+        CPPUNIT_ASSERT( nvm.m_memory[NVM_t::blockAddr(1, 0) + 9] == 0x00 );
+        CPPUNIT_ASSERT( nvm.m_memory[NVM_t::blockAddr(1, 0) + 10] == 0xF0 );
+
+        // other counters untouched
+        CPPUNIT_ASSERT( nvm.get(0, value) );
+        CPPUNIT_ASSERT( value == 0 );
+        CPPUNIT_ASSERT( nvm.get(3, value) );
+        CPPUNIT_ASSERT( value == 0 );
+    }
+
+    void test_begin_00() {
+        // restart after every increment, also across several blocks and the wrap around of blocks
+        Small_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        for (uint32_t i = 1; i <= 5 * Small_t::S_STEPS_PER_BLOCK; ++i) {
+            CPPUNIT_ASSERT( nvm.increment(i % 3 == 0) );
+            Small_t restarted;
+            restarted.m_memory = nvm.m_memory;
+            CPPUNIT_ASSERT( restarted.begin() );
+            for (uint8_t counter = 0; counter < 2; ++counter) {
+                uint32_t value, valueR;
+                CPPUNIT_ASSERT( nvm.get(counter, value) );
+                CPPUNIT_ASSERT( restarted.get(counter, valueR) );
+                CPPUNIT_ASSERT( value == valueR );
+            }
+        }
+        uint32_t value;
+        CPPUNIT_ASSERT( nvm.get(1, value) );
+        CPPUNIT_ASSERT( value == 5 * Small_t::S_STEPS_PER_BLOCK / 3 );
+        CPPUNIT_ASSERT( nvm.get(0, value) );
+        CPPUNIT_ASSERT( value == 5 * Small_t::S_STEPS_PER_BLOCK - 5 * Small_t::S_STEPS_PER_BLOCK / 3 );
+    }
+
+    void test_set_00() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( nvm.set(2, 0xFFFFFFFE) );
+        CPPUNIT_ASSERT( nvm.increment(2) );
+        uint32_t value;
+        CPPUNIT_ASSERT( nvm.get(2, value) );
+        CPPUNIT_ASSERT( value == 0xFFFFFFFF );
+        CPPUNIT_ASSERT( nvm.increment(2) );
+        CPPUNIT_ASSERT( nvm.get(2, value) );
+        CPPUNIT_ASSERT( value == 0 );
+
+        // reset to a lower value
+        for (uint16_t i = 0; i < 300; ++i) {
+            CPPUNIT_ASSERT( nvm.increment(2) );
+        }
+        CPPUNIT_ASSERT( nvm.set(2, 7) );
+        NVM_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( restarted.get(2, value) );
+        CPPUNIT_ASSERT( value == 7 );
+
+        // a corrupted header is not used, the counter falls back to an older block
+        nvm.m_memory[NVM_t::blockAddr(2, nvm.m_counters[2].block) + 4] ^= 0x01;
+        NVM_t corrupted;
+        corrupted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( corrupted.begin() );
+        CPPUNIT_ASSERT( corrupted.getStats().crcErrors == 1 );
+        CPPUNIT_ASSERT( corrupted.get(2, value) );
+        CPPUNIT_ASSERT( value == 300 );
+    }
+
+    void test_wear_00() {
+        // the writes are spread over all blocks of a counter
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        const uint32_t cnt = 20 * NVM_t::S_STEPS_PER_BLOCK;
+        for (uint32_t i = 0; i < cnt; ++i) {
+            CPPUNIT_ASSERT( nvm.increment(0) );
+        }
+        size_t maxWrites = 0;
+        for (nvm_address_t addr = 0; addr < NVM_t::S_BLOCKS_PER_COUNTER * 32; ++addr) {
+            if (nvm.m_writeCount[addr] > maxWrites) maxWrites = nvm.m_writeCount[addr];
+        }
+        CPPUNIT_ASSERT( maxWrites <= 3 * 9 );          // 20 blocks over 8 positions, every byte 9 times per block
+        CPPUNIT_ASSERT( nvm.getWriteCnt() < cnt * 3 / 2 );
+    }
+
+    void test_powerFail_00() {
+        // cut the power before every written byte, also while writing the next block
+        Small_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        for (uint32_t op = 0; op < 2 * Small_t::S_STEPS_PER_BLOCK + 10; ++op) {
+            uint32_t value;
+            CPPUNIT_ASSERT( nvm.get(0, value) );
+            bool set = (op % 50 == 49);
+            uint32_t newValue = set ? 1000 + op : value + 1;
+
+            std::vector<uint8_t> memory = nvm.m_memory;
+            for (uint16_t cut = 1; ; ++cut) {
+                Small_t cutNVM;
+                cutNVM.m_memory = memory;
+                CPPUNIT_ASSERT( cutNVM.begin() );
+                cutNVM.setWriteErrorAfterXbytes(cut);
+                bool lost = false;
+                try {
+                    CPPUNIT_ASSERT( set ? cutNVM.set(0, newValue) : cutNVM.increment(0) );
+                } catch (PowerLostException &) {
+                    lost = true;
+                }
+                if (!lost) break;
+
+                Small_t restarted;
+                restarted.m_memory = cutNVM.m_memory;
+                CPPUNIT_ASSERT( restarted.begin() );
+                uint32_t valueR;
+                CPPUNIT_ASSERT( restarted.get(0, valueR) );
+                CPPUNIT_ASSERT( (valueR == value) || (valueR == newValue) );
+
+                // and it goes on
+                CPPUNIT_ASSERT( restarted.increment(0) );
+                Small_t again;
+                again.m_memory = restarted.m_memory;
+                CPPUNIT_ASSERT( again.begin() );
+                uint32_t valueA;
+                CPPUNIT_ASSERT( again.get(0, valueA) );
+                CPPUNIT_ASSERT( valueA == valueR + 1 );
+            }
+            CPPUNIT_ASSERT( set ? nvm.set(0, newValue) : nvm.increment(0) );
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CounterNVMTest );
@@ -0,0 +1,325 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "KeyValueNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+// fails reads of more than one byte at m_failAddr, like a broken cell while reading the user data
+class ReadFailMock : public NVMRAMMock<2048> {
+public:
+    ReadFailMock() : m_failAddr(0xFFFF) {}
+
+    using NVMRAMMock<2048>::read;
+
+    bool read(nvm_address_t addr, uint8_t *data, nvm_size_t len) const {
+        if ((len > 1) && (addr <= m_failAddr) && (m_failAddr < addr + len)) return false;
+        return NVMRAMMock<2048>::read(addr, data, len);
+    }
+
+    nvm_address_t   m_failAddr;
+};
+
+class KeyValueNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( KeyValueNVMTest );
+
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_begin_01 );
+CPPUNIT_TEST( test_erase_00 );
+CPPUNIT_TEST( test_full_00 );
+CPPUNIT_TEST( test_powerFail_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<2048>, 32, 0, 0, &testCRC8>    NVM_t;      // slots 1 .. 64
+    typedef KeyValueNVM<NVM_t, 1, 2, 3, 40>                 KV_t;
+    typedef SlotNVM<ReadFailMock, 32, 0, 0, &testCRC8>        Fail_t;
+    typedef KeyValueNVM<Fail_t, 1, 2, 3, 40>                FailKV_t;
+    typedef SlotNVM<NVMRAMMock<512>, 16, 0, 0, &testCRC8>     Small_t;    // slots 1 .. 32
+    typedef KeyValueNVM<Small_t, 30, 1, 1, 4>               SmallKV_t;
+
+    static std::string keyName(unsigned i) {
+        return std::string("module") + std::to_string(i % 7) + ".param" + std::to_string(i);
+    }
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_access_00() {
+        NVM_t nvm;
+        KV_t kv(nvm);
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( !kv.writeValue("speed", value) );          // begin() not called
+        CPPUNIT_ASSERT( kv.begin() );
+        CPPUNIT_ASSERT( !kv.isKeyAvailable("speed") );
+        CPPUNIT_ASSERT( kv.getKeyCount() == 0 );
+
+        CPPUNIT_ASSERT( kv.writeValue("speed", value) );
+        CPPUNIT_ASSERT( kv.isKeyAvailable("speed") );
+        CPPUNIT_ASSERT( kv.isKeyAvailable(KV_t::hashKey("speed")) );
+        CPPUNIT_ASSERT( !kv.isKeyAvailable("Speed") );
+        CPPUNIT_ASSERT( kv.getKeyCount() == 1 );
+        uint32_t valueR = 0;
+        CPPUNIT_ASSERT( kv.readValue("speed", valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+
+        // a known key rewrites only its data slot, reading needs no directory access
+        nvm.resetStats();
+        value = 0x9ABCDEF0;
+        CPPUNIT_ASSERT( kv.writeValue("speed", value) );
+        CPPUNIT_ASSERT( nvm.getStats().clustersAllocated == 1 );
+        nvm.resetStats();
+        CPPUNIT_ASSERT( kv.readValue("speed", valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+        uint32_t reads = nvm.getStats().reads;             // no more than a direct read of the slot
+        nvm.resetStats();
+        CPPUNIT_ASSERT( nvm.readSlot(3, valueR) );
+        CPPUNIT_ASSERT( reads <= nvm.getStats().reads );
+
+        // 32 bit keys and other sizes
+        const char text[] = "hello world";
+        CPPUNIT_ASSERT( kv.writeValue(42, (const uint8_t *)text, sizeof(text)) );
+        char textR[20];
+        nvm_size_t len = sizeof(textR);
+        CPPUNIT_ASSERT( kv.readValue(42, (uint8_t *)textR, len) );
+        CPPUNIT_ASSERT( (len == sizeof(text)) && (strcmp(text, textR) == 0) );
+        len = 0;
+        CPPUNIT_ASSERT( !kv.readValue(42, NULL, len) );
+        CPPUNIT_ASSERT( len == sizeof(text) );
+        CPPUNIT_ASSERT( !kv.writeValue(43, (const uint8_t *)NULL, 1) );
+        CPPUNIT_ASSERT( !kv.writeValue(43, (const uint8_t *)text, 0) );
+        CPPUNIT_ASSERT( !kv.readValue(43, (uint8_t *)textR, len) );
+        uint16_t wrongSize;
+        CPPUNIT_ASSERT( !kv.readValue("speed", wrongSize) );
+
+        // other slots can be used directly
+        CPPUNIT_ASSERT( nvm.writeSlot(50, value) );
+        CPPUNIT_ASSERT( kv.getKeyCount() == 2 );
+    }
+
+    void test_begin_00() {
+        NVM_t nvm;
+        KV_t kv(nvm);
+        CPPUNIT_ASSERT( kv.begin() );
+        for (uint32_t i = 0; i < KV_t::S_MAX_KEYS; ++i) {
+            CPPUNIT_ASSERT( kv.writeValue(keyName(i).c_str(), i) );
+        }
+
+        NVM_t nvmR;
+        nvmR.m_memory = nvm.m_memory;
+        KV_t kvR(nvmR);
+        nvmR.resetStats();
+        CPPUNIT_ASSERT( kvR.begin() );
+        CPPUNIT_ASSERT( kvR.getKeyCount() == KV_t::S_MAX_KEYS );
+        for (uint32_t i = 0; i < KV_t::S_MAX_KEYS; ++i) {
+            uint32_t value;
+            CPPUNIT_ASSERT( kvR.readValue(keyName(i).c_str(), value) );
+            CPPUNIT_ASSERT( value == i );
+        }
+        CPPUNIT_ASSERT( !kvR.isKeyAvailable(keyName(KV_t::S_MAX_KEYS).c_str()) );
+
+        // keys with the same position in the hash table
+        NVM_t nvm2;
+        KV_t kv2(nvm2);
+        CPPUNIT_ASSERT( kv2.begin() );
+        for (uint32_t i = 0; i < 10; ++i) {
+            uint32_t key = i * KV_t::S_TABLE_SIZE + 3;
+            CPPUNIT_ASSERT( kv2.writeValue(key, i) );
+        }
+        CPPUNIT_ASSERT( kv2.eraseKey(3 + 4 * KV_t::S_TABLE_SIZE) );
+        for (uint32_t i = 0; i < 10; ++i) {
+            uint32_t value;
+            uint32_t key = i * KV_t::S_TABLE_SIZE + 3;
+            CPPUNIT_ASSERT( kv2.readValue(key, value) == (i != 4) );
+            if (i != 4) {
+                CPPUNIT_ASSERT( value == i );
+            }
+        }
+    }
+
+    void test_begin_01() {
+        // a directory which can not be read keeps its data slots
+        NVM_t nvm;
+        KV_t kv(nvm);
+        CPPUNIT_ASSERT( kv.begin() );
+        uint32_t value = 5;
+        CPPUNIT_ASSERT( kv.writeValue(10, value) );                 // directory slot 1
+        CPPUNIT_ASSERT( kv.writeValue(20, value) );
+        CPPUNIT_ASSERT( kv.writeValue(11, value) );                 // directory slot 2
+
+        Fail_t nvmF;
+        nvmF.m_memory = nvm.m_memory;
+        uint8_t startCluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, startCluster) );
+        nvmF.m_failAddr = startCluster * 32 + 4;
+        FailKV_t kvF(nvmF);
+        CPPUNIT_ASSERT( !kvF.begin() );
+        CPPUNIT_ASSERT( nvmF.m_memory == nvm.m_memory );          // nothing erased
+
+        NVM_t nvmR;
+        nvmR.m_memory = nvmF.m_memory;
+        KV_t kvR(nvmR);
+        CPPUNIT_ASSERT( kvR.begin() );
+        CPPUNIT_ASSERT( kvR.getKeyCount() == 3 );
+        uint32_t valueR;
+        CPPUNIT_ASSERT( kvR.readValue(20, valueR) && (valueR == 5) );
+    }
+
+    void test_erase_00() {
+        NVM_t nvm;
+        KV_t kv(nvm);
+        CPPUNIT_ASSERT( kv.begin() );
+        for (uint32_t i = 0; i < 20; ++i) {
+            CPPUNIT_ASSERT( kv.writeValue(keyName(i).c_str(), i) );
+        }
+        for (uint32_t i = 0; i < 20; i += 2) {
+            CPPUNIT_ASSERT( kv.eraseKey(keyName(i).c_str()) );
+        }
+        CPPUNIT_ASSERT( !kv.eraseKey(keyName(0).c_str()) );
+        CPPUNIT_ASSERT( kv.getKeyCount() == 10 );
+
+        // free data slots are used again
+        for (uint32_t i = 100; i < 130; ++i) {
+            CPPUNIT_ASSERT( kv.writeValue(keyName(i).c_str(), i) );
+        }
+        CPPUNIT_ASSERT( kv.getKeyCount() == KV_t::S_MAX_KEYS );
+
+        NVM_t nvmR;
+        nvmR.m_memory = nvm.m_memory;
+        KV_t kvR(nvmR);
+        CPPUNIT_ASSERT( kvR.begin() );
+        for (uint32_t i = 0; i < 130; ++i) {
+            bool expected = ((i < 20) && (i % 2 == 1)) || (i >= 100);
+            uint32_t value;
+            CPPUNIT_ASSERT( kvR.readValue(keyName(i).c_str(), value) == expected );
+            if (expected) {
+                CPPUNIT_ASSERT( value == i );
+            }
+        }
+
+        // an empty directory slot is erased
+        for (uint32_t i = 0; i < 130; ++i) {
+            kvR.eraseKey(keyName(i).c_str());
+        }
+        CPPUNIT_ASSERT( kvR.getKeyCount() == 0 );
+        CPPUNIT_ASSERT( !nvmR.isSlotAvailable(1) && !nvmR.isSlotAvailable(2) );
+        CPPUNIT_ASSERT( nvmR.getFree() == nvmR.getSize() );
+    }
+
+    void test_full_00() {
+        NVM_t nvm;
+        KV_t kv(nvm);
+        CPPUNIT_ASSERT( kv.begin() );
+        for (uint32_t i = 0; i < KV_t::S_MAX_KEYS; ++i) {
+            CPPUNIT_ASSERT( kv.writeValue(keyName(i).c_str(), i) );
+        }
+        uint32_t value = 1;
+        CPPUNIT_ASSERT( !kv.writeValue("one more", value) );
+        CPPUNIT_ASSERT( kv.writeValue(keyName(0).c_str(), value) );   // known keys are still writable
+
+        // a full directory slot
+        Small_t small;
+        SmallKV_t smallKV(small);
+        CPPUNIT_ASSERT( smallKV.begin() );
+        uint8_t data[60];
+        memset(data, 0x55, sizeof(data));
+        CPPUNIT_ASSERT( smallKV.writeValue(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( smallKV.writeValue(2, data, sizeof(data)) );
+        CPPUNIT_ASSERT( smallKV.writeValue(3, data, sizeof(data)) );
+        CPPUNIT_ASSERT( smallKV.writeValue(4, data, sizeof(data)) );
+        CPPUNIT_ASSERT( !smallKV.writeValue(5, data, 1) );
+        CPPUNIT_ASSERT( smallKV.getKeyCount() == 4 );
+    }
+
+    void test_powerFail_00() {
+        // cut the power before every written byte of a new key and of erase, no data slot is lost
+        Small_t nvm;
+        SmallKV_t kv(nvm);
+        CPPUNIT_ASSERT( kv.begin() );
+        uint32_t value = 7;
+        CPPUNIT_ASSERT( kv.writeValue(100, value) );
+        for (uint8_t op = 0; op < 2; ++op) {
+            std::vector<uint8_t> memory = nvm.m_memory;
+            for (uint16_t cut = 1; ; ++cut) {
+                Small_t cutNVM;
+                cutNVM.m_memory = memory;
+                SmallKV_t cutKV(cutNVM);
+                CPPUNIT_ASSERT( cutKV.begin() );
+                cutNVM.setWriteErrorAfterXbytes(cut);
+                bool lost = false;
+                try {
+                    if (op == 0) {
+                        CPPUNIT_ASSERT( cutKV.writeValue(200, value) );
+                    } else {
+                        CPPUNIT_ASSERT( cutKV.eraseKey(100) );
+                    }
+                } catch (PowerLostException &) {
+                    lost = true;
+                }
+                if (!lost) break;
+
+                Small_t nvmR;
+                nvmR.m_memory = cutNVM.m_memory;
+                SmallKV_t kvR(nvmR);
+                CPPUNIT_ASSERT( kvR.begin() );
+                uint32_t valueR;
+                if (op == 0) {
+                    CPPUNIT_ASSERT( kvR.readValue(100, valueR) && (valueR == 7) );
+                    CPPUNIT_ASSERT( !kvR.isKeyAvailable(200) || (kvR.readValue(200, valueR) && (valueR == 7)) );
+                } else {
+                    CPPUNIT_ASSERT( !kvR.isKeyAvailable(100) || (kvR.readValue(100, valueR) && (valueR == 7)) );
+                    CPPUNIT_ASSERT( kvR.readValue(200, valueR) && (valueR == 7) );
+                }
+
+                // every data slot not in the directory is erased
+                for (uint8_t slot = 1; slot <= 4; ++slot) {
+                    bool used = false;
+                    for (uint32_t key = 100; key <= 200; key += 100) {
+                        uint8_t idx;
+                        used = used || (kvR.findKey(key, idx) && (idx + 1 == slot));
+                    }
+                    CPPUNIT_ASSERT( nvmR.isSlotAvailable(slot) == used );
+                }
+            }
+            if (op == 0) {
+                CPPUNIT_ASSERT( kv.writeValue(200, value) );
+            } else {
+                CPPUNIT_ASSERT( kv.eraseKey(100) );
+            }
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( KeyValueNVMTest );
@@ -0,0 +1,279 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "LogSlotNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class LogSlotNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( LogSlotNVMTest );
+
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_erase_00 );
+CPPUNIT_TEST( test_compact_00 );
+CPPUNIT_TEST( test_full_00 );
+CPPUNIT_TEST( test_powerFail_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef LogSlotNVM<NVMRAMMock<1024>, 128, 16, &testCRC8>     NVM_t;      // 8 segments
+    typedef LogSlotNVM<NVMRAMMock<256>, 64, 8, &testCRC8>        Small_t;    // 4 segments
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_access_00() {
+        NVM_t nvm;
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( !nvm.writeSlot(1, value) );     // begin() not called
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( !nvm.begin() );
+        CPPUNIT_ASSERT( !nvm.isSlotAvailable(1) );
+
+        CPPUNIT_ASSERT( nvm.writeSlot(1, value) );
+        CPPUNIT_ASSERT( nvm.isSlotAvailable(1) );
+        uint32_t valueR = 0;
+        CPPUNIT_ASSERT( nvm.readSlot(1, valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+        uint8_t version;
+        CPPUNIT_ASSERT( nvm.getVersion(1, version) );
+        CPPUNIT_ASSERT( version == 0 );
+
+        // append only, the first record stays untouched
+        value = 0x9ABCDEF0;
+        uint32_t writeCnt = nvm.getWriteCnt();
+        CPPUNIT_ASSERT( nvm.writeSlot(1, value) );
+        CPPUNIT_ASSERT( nvm.getWriteCnt() - writeCnt == sizeof(value) + 4 + 1 );   // record and end marker
+        CPPUNIT_ASSERT( nvm.m_memory[4 + 3] == 0x78 );
+        CPPUNIT_ASSERT( nvm.readSlot(1, valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+        CPPUNIT_ASSERT( nvm.getVersion(1, version) );
+        CPPUNIT_ASSERT( version == 1 );
+
+        // size query and invalid parameters
+        nvm_size_t len = 0;
+        CPPUNIT_ASSERT( !nvm.readSlot(1, NULL, len) );
+        CPPUNIT_ASSERT( len == sizeof(value) );
+        uint8_t data[NVM_t::S_MAX_LEN + 1];
+        memset(data, 0x5A, sizeof(data));
+        CPPUNIT_ASSERT( !nvm.writeSlot(0, data, 1) );
+        CPPUNIT_ASSERT( !nvm.writeSlot(17, data, 1) );
+        CPPUNIT_ASSERT( !nvm.writeSlot(2, data, 0) );
+        CPPUNIT_ASSERT( !nvm.writeSlot(2, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvm.writeSlot(2, data, sizeof(data) - 1) );
+        CPPUNIT_ASSERT( !nvm.readSlot(3, data, len) );
+    }
+
+    void test_begin_00() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        for (uint16_t i = 0; i < 300; ++i) {
+            uint16_t value = i;
+            CPPUNIT_ASSERT( nvm.writeSlot(1 + i % 5, value) );
+        }
+
+        NVM_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( restarted.m_tail == nvm.m_tail );
+        CPPUNIT_ASSERT( restarted.m_head == nvm.m_head );
+        CPPUNIT_ASSERT( restarted.m_headOffset == nvm.m_headOffset );
+        CPPUNIT_ASSERT( memcmp(restarted.m_index, nvm.m_index, sizeof(nvm.m_index)) == 0 );
+        for (uint8_t slot = 1; slot <= 5; ++slot) {
+            uint16_t value;
+            CPPUNIT_ASSERT( restarted.readSlot(slot, value) );
+            CPPUNIT_ASSERT( value == 295 + slot - 1 );
+        }
+        CPPUNIT_ASSERT( !restarted.isSlotAvailable(6) );
+
+        // continue writing after restart
+        uint16_t value = 1000;
+        CPPUNIT_ASSERT( restarted.writeSlot(6, value) );
+        NVM_t restarted2;
+        restarted2.m_memory = restarted.m_memory;
+        CPPUNIT_ASSERT( restarted2.begin() );
+        CPPUNIT_ASSERT( restarted2.readSlot(6, value) );
+        CPPUNIT_ASSERT( value == 1000 );
+    }
+
+    void test_erase_00() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( !nvm.eraseSlot(1) );
+        uint8_t value = 1;
+        CPPUNIT_ASSERT( nvm.writeSlot(1, value) );
+        CPPUNIT_ASSERT( nvm.writeSlot(2, value) );
+        CPPUNIT_ASSERT( nvm.eraseSlot(1) );
+        CPPUNIT_ASSERT( !nvm.isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !nvm.readSlot(1, value) );
+
+        NVM_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( !restarted.isSlotAvailable(1) );
+        CPPUNIT_ASSERT( restarted.isSlotAvailable(2) );
+
+        // erased slots are dropped by compaction
+        for (uint16_t i = 0; i < 500; ++i) {
+            CPPUNIT_ASSERT( restarted.writeSlot(2, value) );
+        }
+        NVM_t restarted2;
+        restarted2.m_memory = restarted.m_memory;
+        CPPUNIT_ASSERT( restarted2.begin() );
+        CPPUNIT_ASSERT( !restarted2.isSlotAvailable(1) );
+        CPPUNIT_ASSERT( restarted2.readSlot(2, value) );
+    }
+
+    void test_compact_00() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+
+        // a slot never written again survives many compactions
+        uint8_t data[40];
+        for (uint8_t i = 0; i < sizeof(data); ++i) data[i] = i;
+        CPPUNIT_ASSERT( nvm.writeSlot(16, data, sizeof(data)) );
+        for (uint32_t i = 0; i < 2000; ++i) {
+            CPPUNIT_ASSERT( nvm.writeSlot(1, i) );
+            CPPUNIT_ASSERT( nvm.m_usedSegments < NVM_t::S_SEGMENT_CNT );
+        }
+        uint8_t buf[40];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm.readSlot(16, buf, len) );
+        CPPUNIT_ASSERT( memcmp(buf, data, sizeof(data)) == 0 );
+        uint32_t value;
+        CPPUNIT_ASSERT( nvm.readSlot(1, value) );
+        CPPUNIT_ASSERT( value == 1999 );
+
+        // writes are spread over all segments
+        size_t minCnt = nvm.m_writeCount[0];
+        size_t maxCnt = 0;
+        for (uint16_t segment = 0; segment < NVM_t::S_SEGMENT_CNT; ++segment) {
+            size_t cnt = nvm.m_writeCount[segment * 128 + 4];
+            if (cnt < minCnt) minCnt = cnt;
+            if (cnt > maxCnt) maxCnt = cnt;
+        }
+        CPPUNIT_ASSERT( minCnt > 0 );
+        CPPUNIT_ASSERT( maxCnt <= minCnt + 2 );
+    }
+
+    void test_full_00() {
+        Small_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( Small_t::S_MAX_LEN == 56 );
+
+        // 3 of 4 segments can hold latest records
+        uint8_t data[56];
+        memset(data, 0x11, sizeof(data));
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvm.writeSlot(2, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvm.writeSlot(3, data, sizeof(data)) );
+        CPPUNIT_ASSERT( !nvm.writeSlot(4, data, sizeof(data)) );
+
+        // still all readable, a rewrite needs the free segment too
+        for (uint8_t slot = 1; slot <= 3; ++slot) {
+            uint8_t buf[56];
+            nvm_size_t len = sizeof(buf);
+            CPPUNIT_ASSERT( nvm.readSlot(slot, buf, len) );
+            CPPUNIT_ASSERT( memcmp(buf, data, sizeof(data)) == 0 );
+        }
+        memset(data, 0x22, sizeof(data));
+        CPPUNIT_ASSERT( !nvm.writeSlot(2, data, sizeof(data)) );
+
+        // erase needs no space and frees it
+        CPPUNIT_ASSERT( nvm.eraseSlot(3) );
+        CPPUNIT_ASSERT( nvm.writeSlot(4, data, sizeof(data)) );
+        CPPUNIT_ASSERT( !nvm.writeSlot(2, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvm.eraseSlot(1) );
+        CPPUNIT_ASSERT( nvm.writeSlot(2, data, sizeof(data)) );
+
+        Small_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( !restarted.isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !restarted.isSlotAvailable(3) );
+        CPPUNIT_ASSERT( restarted.isSlotAvailable(4) );
+        uint8_t buf[56];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( restarted.readSlot(2, buf, len) );
+        CPPUNIT_ASSERT( memcmp(buf, data, sizeof(data)) == 0 );
+    }
+
+    void test_powerFail_00() {
+        // cut the power before every written byte, also while compacting
+        Small_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[30];
+        for (uint16_t op = 0; op < 60; ++op) {
+            for (uint8_t i = 0; i < sizeof(data); ++i) data[i] = op + i;
+            uint8_t slot = 1 + op % 3;
+            nvm_size_t len = 5 + op % 13;        // 2 records per segment
+
+            std::vector<uint8_t> memory = nvm.m_memory;
+            for (uint16_t cut = 1; ; ++cut) {
+                Small_t cutNVM;
+                cutNVM.m_memory = memory;
+                CPPUNIT_ASSERT( cutNVM.begin() );
+                cutNVM.setWriteErrorAfterXbytes(cut);
+                bool lost = false;
+                try {
+                    CPPUNIT_ASSERT( cutNVM.writeSlot(slot, data, len) );
+                } catch (PowerLostException &) {
+                    lost = true;
+                }
+                if (!lost) break;
+
+                // old or new data, other slots untouched
+                Small_t restarted;
+                restarted.m_memory = cutNVM.m_memory;
+                CPPUNIT_ASSERT( restarted.begin() );
+                for (uint8_t s = 1; s <= 3; ++s) {
+                    uint8_t buf[30];
+                    uint8_t expected[30];
+                    nvm_size_t expectedLen = sizeof(expected);
+                    bool avail = nvm.readSlot(s, expected, expectedLen);
+                    nvm_size_t bufLen = sizeof(buf);
+                    bool availR = restarted.readSlot(s, buf, bufLen);
+                    if ((s == slot) && availR && (bufLen == len) && (memcmp(buf, data, len) == 0)) continue;
+                    CPPUNIT_ASSERT( avail == availR );
+                    if (avail) {
+                        CPPUNIT_ASSERT( bufLen == expectedLen );
+                        CPPUNIT_ASSERT( memcmp(buf, expected, bufLen) == 0 );
+                    }
+                }
+            }
+            CPPUNIT_ASSERT( nvm.writeSlot(slot, data, len) );
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LogSlotNVMTest );
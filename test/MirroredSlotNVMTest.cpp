@@ -0,0 +1,275 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "MirroredSlotNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class MirroredSlotNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( MirroredSlotNVMTest );
+
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_fallback_00 );
+CPPUNIT_TEST( test_repair_00 );
+CPPUNIT_TEST( test_repair_01 );
+CPPUNIT_TEST( test_powerFail_00 );
+CPPUNIT_TEST( test_fastest_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<1024>, 32, 0, 0, &testXorCRC>  NVM_A_t;
+    typedef SlotNVM<NVMRAMMock<2048>, 64, 0, 0, &testXorCRC>  NVM_B_t;
+    typedef MirroredSlotNVM<NVM_A_t, NVM_B_t>               Mirror_t;
+
+    NVM_A_t     *nvmA;
+    NVM_B_t     *nvmB;
+    Mirror_t    *mirror;
+
+public:
+    void setUp() {
+        nvmA = new NVM_A_t;
+        nvmB = new NVM_B_t;
+        mirror = new Mirror_t(*nvmA, *nvmB);
+    }
+
+    void tearDown()  {
+        delete mirror;
+        delete nvmA;
+        delete nvmB;
+    }
+
+    void test_access_00() {
+        CPPUNIT_ASSERT( Mirror_t::S_LAST_SLOT == 31 );      // slot 32 of A is the erase slot
+        CPPUNIT_ASSERT( !mirror->isValid() );
+        CPPUNIT_ASSERT( mirror->begin() );
+        CPPUNIT_ASSERT( mirror->isValid() );
+        CPPUNIT_ASSERT( mirror->getRepairs() == 0 );
+
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( mirror->writeSlot(1, value) );
+        CPPUNIT_ASSERT( nvmA->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( mirror->isSlotAvailable(1) );
+        mirror->flush();
+        CPPUNIT_ASSERT( nvmB->isSlotAvailable(1) );
+
+        // pipelined writes of several slots
+        uint8_t data[100];
+        for (uint8_t slot = 2; slot <= 6; ++slot) {
+            memset(data, slot, sizeof(data));
+            CPPUNIT_ASSERT( mirror->writeSlot(slot, data, sizeof(data)) );
+        }
+        mirror->flush();
+        for (uint8_t slot = 2; slot <= 6; ++slot) {
+            uint8_t buf[100];
+            nvm_size_t len = sizeof(buf);
+            CPPUNIT_ASSERT( nvmB->readSlot(slot, buf, len) );
+            CPPUNIT_ASSERT( len == sizeof(buf) );
+            CPPUNIT_ASSERT( buf[0] == slot );
+            CPPUNIT_ASSERT( buf[99] == slot );
+        }
+        CPPUNIT_ASSERT( mirror->isReplicaHealthy(0) );
+        CPPUNIT_ASSERT( mirror->isReplicaHealthy(1) );
+
+        uint32_t valueR = 0;
+        CPPUNIT_ASSERT( mirror->readSlot(1, valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+        CPPUNIT_ASSERT( !mirror->writeSlot(33, value) );
+        CPPUNIT_ASSERT( mirror->getFree() == nvmA->getFree() );
+
+        CPPUNIT_ASSERT( mirror->eraseSlot(1) );
+        CPPUNIT_ASSERT( !nvmA->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !nvmB->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !mirror->readSlot(1, valueR) );
+        CPPUNIT_ASSERT( !mirror->eraseSlot(1) );
+    }
+
+    void test_fallback_00() {
+        CPPUNIT_ASSERT( mirror->begin() );
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( mirror->writeSlot(1, value) );
+        mirror->flush();
+
+        // slot is lost in replica A, read it from B
+        CPPUNIT_ASSERT( nvmA->eraseSlot(1) );
+        for (int i = 0; i < 20; ++i) {
+            uint32_t valueR = 0;
+            CPPUNIT_ASSERT( mirror->readSlot(1, valueR) );
+            CPPUNIT_ASSERT( valueR == value );
+        }
+
+        // buffer too small is no reason to fall back
+        uint8_t buf[2];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( !mirror->readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( len == 4 );
+    }
+
+    void test_repair_00() {
+        CPPUNIT_ASSERT( mirror->begin() );
+        uint8_t data[40];
+        memset(data, 0x11, sizeof(data));
+        CPPUNIT_ASSERT( mirror->writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( mirror->writeSlot(2, data, sizeof(data)) );
+        mirror->flush();
+
+        // CRC error in first cluster of slot 1 in replica A
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvmA->findStartCluser(1, cluster) );
+        nvmA->m_memory[cluster * 32 + 10] ^= 0xFF;
+
+        NVM_A_t restartedA;
+        NVM_B_t restartedB;
+        restartedA.m_memory = nvmA->m_memory;
+        restartedB.m_memory = nvmB->m_memory;
+        Mirror_t restarted(restartedA, restartedB);
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( restarted.getRepairs() == 1 );
+
+        uint8_t buf[40];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( restartedA.readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( memcmp(buf, data, sizeof(buf)) == 0 );
+    }
+
+    void test_repair_01() {
+        CPPUNIT_ASSERT( mirror->begin() );
+        uint8_t data[40];
+        memset(data, 0x11, sizeof(data));
+        CPPUNIT_ASSERT( mirror->writeSlot(1, data, sizeof(data)) );
+        mirror->flush();
+
+        // power lost before replica B was written, A is newer
+        memset(data, 0x22, sizeof(data));
+        CPPUNIT_ASSERT( nvmA->writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvmA->writeSlot(2, data, sizeof(data)) );
+
+        NVM_A_t restartedA;
+        NVM_B_t restartedB;
+        restartedA.m_memory = nvmA->m_memory;
+        restartedB.m_memory = nvmB->m_memory;
+        Mirror_t restarted(restartedA, restartedB);
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( restarted.getRepairs() == 2 );
+        uint8_t buf[40];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( restartedB.readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( memcmp(buf, data, sizeof(buf)) == 0 );
+        CPPUNIT_ASSERT( restartedB.isSlotAvailable(2) );
+
+        // nothing to repair anymore
+        NVM_A_t restartedA2;
+        NVM_B_t restartedB2;
+        restartedA2.m_memory = restartedA.m_memory;
+        restartedB2.m_memory = restartedB.m_memory;
+        Mirror_t restarted2(restartedA2, restartedB2);
+        CPPUNIT_ASSERT( restarted2.begin() );
+        CPPUNIT_ASSERT( restarted2.getRepairs() == 0 );
+    }
+
+    void test_powerFail_00() {
+        // cut the power before every written byte of eraseSlot(), the slot never comes back
+        CPPUNIT_ASSERT( mirror->begin() );
+        uint8_t data[40];
+        memset(data, 0x33, sizeof(data));
+        CPPUNIT_ASSERT( mirror->writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( mirror->writeSlot(2, data, sizeof(data)) );
+        mirror->flush();
+
+        for (uint8_t replica = 0; replica < 2; ++replica) {
+            for (uint16_t cut = 1; ; ++cut) {
+                NVM_A_t cutA;
+                NVM_B_t cutB;
+                cutA.m_memory = nvmA->m_memory;
+                cutB.m_memory = nvmB->m_memory;
+                Mirror_t cutMirror(cutA, cutB);
+                CPPUNIT_ASSERT( cutMirror.begin() );
+                if (replica == 0) {
+                    cutA.setWriteErrorAfterXbytes(cut);
+                } else {
+                    cutB.setWriteErrorAfterXbytes(cut);
+                }
+                bool lost = false;
+                try {
+                    CPPUNIT_ASSERT( cutMirror.eraseSlot(1) );
+                } catch (PowerLostException &) {
+                    lost = true;
+                }
+                if (!lost) break;
+
+                NVM_A_t restartedA;
+                NVM_B_t restartedB;
+                restartedA.m_memory = cutA.m_memory;
+                restartedB.m_memory = cutB.m_memory;
+                bool erasedA = !restartedA.begin() || !restartedA.isSlotAvailable(1);
+                NVM_A_t restartedA2;
+                restartedA2.m_memory = cutA.m_memory;
+                Mirror_t restarted(restartedA2, restartedB);
+                CPPUNIT_ASSERT( restarted.begin() );
+                CPPUNIT_ASSERT( restartedA2.isSlotAvailable(1) == restartedB.isSlotAvailable(1) );
+                if (erasedA || (replica == 1)) {
+                    CPPUNIT_ASSERT( !restarted.isSlotAvailable(1) );            // A was erased, B must follow
+                }
+                nvm_size_t len = sizeof(data);
+                uint8_t buf[40];
+                CPPUNIT_ASSERT( restarted.readSlot(2, buf, len) && (memcmp(buf, data, sizeof(buf)) == 0) );
+            }
+        }
+    }
+
+    void test_fastest_00() {
+        CPPUNIT_ASSERT( mirror->begin() );
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( mirror->writeSlot(1, value) );
+        mirror->flush();
+
+        // replica B is measured as much faster, so most reads go to B
+        mirror->m_readNs[0] = 1000000;
+        mirror->m_readNs[1] = 1;
+        nvmA->resetStats();
+        nvmB->resetStats();
+        for (int i = 0; i < 32; ++i) {
+            uint32_t valueR = 0;
+            CPPUNIT_ASSERT( mirror->readSlot(1, valueR) );
+            CPPUNIT_ASSERT( valueR == value );
+        }
+        CPPUNIT_ASSERT( nvmB->getStats().reads > 8 * nvmA->getStats().reads );
+        CPPUNIT_ASSERT( nvmA->getStats().reads > 0 );   // probing reads
+
+        // an unhealthy replica is not used
+        mirror->m_healthy[1] = false;
+        nvmB->resetStats();
+        uint32_t valueR = 0;
+        CPPUNIT_ASSERT( mirror->readSlot(1, valueR) );
+        CPPUNIT_ASSERT( nvmB->getStats().reads == 0 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( MirroredSlotNVMTest );
@@ -0,0 +1,185 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_NVMLATENCYMODEL_H_
+#define _SLOTNVM_NVMLATENCYMODEL_H_
+
+#include <cstdint>
+#include "NVMBase.h"
+
+/*
+ * Timing models to estimate how long an NVM access takes on real hardware.
+ * All times are in nanoseconds.
+ * A model has the members readTime(), writeTime() and eraseTime() with the same arguments as the access class
+ * and eraseSize(), the size of an erase block or 0 if bytes can be overwritten without erase.
+ */
+
+/// Fixed time per call plus time per byte.
+class LinearLatencyModel {
+public:
+    LinearLatencyModel(uint32_t readCallNs, uint32_t readByteNs,
+                       uint32_t writeCallNs, uint32_t writeByteNs,
+                       uint32_t eraseCallNs = 0, uint32_t eraseByteNs = 0)
+        : m_readCallNs(readCallNs)
+        , m_readByteNs(readByteNs)
+        , m_writeCallNs(writeCallNs)
+        , m_writeByteNs(writeByteNs)
+        , m_eraseCallNs(eraseCallNs)
+        , m_eraseByteNs(eraseByteNs)
+    {}
+
+    /// AVR integrated EEPROM, 3.3 ms per written byte.
+    static LinearLatencyModel avrEEPROM() {
+        return LinearLatencyModel(0, 500, 0, 3300000);
+    }
+
+    /// SPI FRAM at 8 MHz, 1 byte opcode and 2 bytes address per call, no write delay.
+    static LinearLatencyModel spiFRAM() {
+        return LinearLatencyModel(3 * 1000 + 500, 1000, 2 * 1000 + 3 * 1000 + 500, 1000);
+    }
+
+    uint64_t readTime(nvm_address_t addr, nvm_size_t len) const {
+        return m_readCallNs + (uint64_t)len * m_readByteNs;
+    }
+
+    uint64_t writeTime(nvm_address_t addr, nvm_size_t len) const {
+        return m_writeCallNs + (uint64_t)len * m_writeByteNs;
+    }
+
+    uint64_t eraseTime(nvm_address_t addr, nvm_size_t len) const {
+        return m_eraseCallNs + (uint64_t)len * m_eraseByteNs;
+    }
+
+    nvm_size_t eraseSize() const {
+        return 0;
+    }
+
+private:
+    uint32_t m_readCallNs;
+    uint32_t m_readByteNs;
+    uint32_t m_writeCallNs;
+    uint32_t m_writeByteNs;
+    uint32_t m_eraseCallNs;
+    uint32_t m_eraseByteNs;
+};
+
+/**
+ * I2C EEPROM like 24LCxx.
+ * Every transfer sends the device address and the memory address.
+ * A write is split at page boundaries and every page needs a write cycle.
+ */
+class PageLatencyModel {
+public:
+    PageLatencyModel(uint32_t byteNs, uint8_t addrBytes, nvm_size_t pageSize, uint32_t writeCycleNs)
+        : m_byteNs(byteNs)
+        , m_addrBytes(addrBytes)
+        , m_pageSize(pageSize)
+        , m_writeCycleNs(writeCycleNs)
+    {}
+
+    /// 24LC256 at 400 kHz, 64 byte pages, 5 ms write cycle.
+    static PageLatencyModel i2cEEPROM24LC256() {
+        return PageLatencyModel(9 * 2500, 2, 64, 5000000);
+    }
+
+    uint64_t readTime(nvm_address_t addr, nvm_size_t len) const {
+        // device address, memory address, device address again, data
+        return (uint64_t)(1 + m_addrBytes + 1 + len) * m_byteNs;
+    }
+
+    uint64_t writeTime(nvm_address_t addr, nvm_size_t len) const {
+        uint64_t time = 0;
+        uint32_t pos = addr;
+        uint32_t end = (uint32_t)addr + len;
+        while (pos < end) {
+            uint32_t pageEnd = (pos / m_pageSize + 1) * m_pageSize;
+            uint32_t chunk = ((pageEnd < end) ? pageEnd : end) - pos;
+            time += (uint64_t)(1 + m_addrBytes + chunk) * m_byteNs + m_writeCycleNs;
+            pos += chunk;
+        }
+        return time;
+    }
+
+    uint64_t eraseTime(nvm_address_t addr, nvm_size_t len) const {
+        return 0;
+    }
+
+    nvm_size_t eraseSize() const {
+        return 0;
+    }
+
+private:
+    uint32_t    m_byteNs;
+    uint8_t     m_addrBytes;
+    nvm_size_t  m_pageSize;
+    uint32_t    m_writeCycleNs;
+};
+
+/**
+ * SPI NOR flash like 25Qxx.
+ * Bits can only be cleared by programming, setting a bit needs an erase of the whole sector.
+ * Every transfer sends one opcode byte and the memory address, a write is split at page
+ * boundaries, needs a write enable command and a page program cycle.
+ */
+class NORFlashModel {
+public:
+    NORFlashModel(uint32_t byteNs, uint8_t addrBytes, nvm_size_t pageSize, uint32_t pageProgramNs,
+                  nvm_size_t sectorSize, uint32_t sectorEraseNs)
+        : m_byteNs(byteNs)
+        , m_addrBytes(addrBytes)
+        , m_pageSize(pageSize)
+        , m_pageProgramNs(pageProgramNs)
+        , m_sectorSize(sectorSize)
+        , m_sectorEraseNs(sectorEraseNs)
+    {}
+
+    /// 25Q series at 8 MHz, 256 byte pages with 0.7 ms program time, 4 KiB sectors with 45 ms erase time.
+    static NORFlashModel spiNOR25Q() {
+        return NORFlashModel(1000, 3, 256, 700000, 4096, 45000000);
+    }
+
+    uint64_t readTime(nvm_address_t addr, nvm_size_t len) const {
+        return (uint64_t)(1 + m_addrBytes + len) * m_byteNs;
+    }
+
+    uint64_t writeTime(nvm_address_t addr, nvm_size_t len) const {
+        return blockTime(addr, len, m_pageSize, 1 + m_addrBytes, m_pageProgramNs, true);
+    }
+
+    uint64_t eraseTime(nvm_address_t addr, nvm_size_t len) const {
+        return blockTime(addr, len, m_sectorSize, 1 + m_addrBytes, m_sectorEraseNs, false);
+    }
+
+    nvm_size_t eraseSize() const {
+        return m_sectorSize;
+    }
+
+private:
+    uint32_t    m_byteNs;
+    uint8_t     m_addrBytes;
+    nvm_size_t  m_pageSize;
+    uint32_t    m_pageProgramNs;
+    nvm_size_t  m_sectorSize;
+    uint32_t    m_sectorEraseNs;
+
+    // every touched block needs write enable, command with address, optional data and the cycle time
+    uint64_t blockTime(nvm_address_t addr, nvm_size_t len, nvm_size_t blockSize, uint8_t cmdBytes,
+                       uint32_t cycleNs, bool withData) const {
+        uint64_t time = 0;
+        uint32_t pos = addr;
+        uint32_t end = (uint32_t)addr + len;
+        while (pos < end) {
+            uint32_t blockEnd = (pos / blockSize + 1) * blockSize;
+            uint32_t chunk = ((blockEnd < end) ? blockEnd : end) - pos;
+            time += (uint64_t)(1 + cmdBytes + (withData ? chunk : 0)) * m_byteNs + cycleNs;
+            pos += chunk;
+        }
+        return time;
+    }
+};
+
+#endif // _SLOTNVM_NVMLATENCYMODEL_H_
@@ -45,6 +45,11 @@ public:
         m_writeErrorAfterXbytes = bytes;
     }
 
+    /// Count of all written bytes.
+    uint32_t getWriteCnt() const {
+        return m_writeCnt;
+    }
+
     void dump() const;
 
     void dumpWriteCounts() const;
@@ -53,6 +58,7 @@ private:
     std::vector<uint8_t>    m_memory;
     std::vector<size_t>     m_writeCount;
     uint16_t                m_writeErrorAfterXbytes;
+    uint32_t                m_writeCnt;
 };
 
 
@@ -61,6 +67,7 @@ NVMRAMMock<SIZE, NEED_ERASE, DEFAULT_VALUE, PAGE_SIZE>::NVMRAMMock()
     : m_memory(SIZE, DEFAULT_VALUE)
     , m_writeCount(SIZE)
     , m_writeErrorAfterXbytes(0)
+    , m_writeCnt(0)
 {}
 
 template <nvm_size_t SIZE, bool NEED_ERASE, uint8_t DEFAULT_VALUE, nvm_size_t PAGE_SIZE>
@@ -113,6 +120,7 @@ bool NVMRAMMock<SIZE, NEED_ERASE, DEFAULT_VALUE, PAGE_SIZE>::write(nvm_address_t
                 return false;
             }
         }
+        ++m_writeCnt;
         if (NEED_ERASE) {
             if (DEFAULT_VALUE == 0xFF) {
                 m_memory[addr] &= data;
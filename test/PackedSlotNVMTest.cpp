@@ -0,0 +1,176 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "PackedSlotNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class PackedSlotNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( PackedSlotNVMTest );
+
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_flags_00 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_full_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<4096>, 32, 0, 0, &testXorCRC>    NVM_t;          // 26 bytes per cluster
+    typedef PackedSlotNVM<NVM_t, 100, 28>                       Packed_t;
+
+    NVM_t       *nvm;
+    Packed_t    *packed;
+
+public:
+    void setUp() {
+        nvm = new NVM_t;
+        packed = new Packed_t(*nvm);
+    }
+
+    void tearDown()  {
+        delete packed;
+        delete nvm;
+    }
+
+    void test_access_00() {
+        CPPUNIT_ASSERT( Packed_t::S_MAX_LEN == 24 );
+        CPPUNIT_ASSERT( !packed->isValid() );
+        CPPUNIT_ASSERT( packed->begin() );
+        CPPUNIT_ASSERT( packed->isValid() );
+
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( packed->writeSlot(1, value) );
+        CPPUNIT_ASSERT( packed->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !packed->isSlotAvailable(29) );
+        CPPUNIT_ASSERT( nvm->isSlotAvailable(100) );
+        uint8_t flag = 1;
+        CPPUNIT_ASSERT( packed->writeSlot(29, flag) );          // same pack as slot 1
+        CPPUNIT_ASSERT( nvm->getFree() == nvm->getSize() - NVM_t::S_USER_DATA_PER_CLUSTER );
+
+        uint32_t valueR = 0;
+        CPPUNIT_ASSERT( packed->readSlot(1, valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+        uint8_t flagR = 0;
+        CPPUNIT_ASSERT( packed->readSlot(29, flagR) );
+        CPPUNIT_ASSERT( flagR == 1 );
+        CPPUNIT_ASSERT( !packed->readSlot(29, valueR) );        // wrong size
+
+        // size query
+        nvm_size_t len = 0;
+        CPPUNIT_ASSERT( !packed->readSlot(1, NULL, len) );
+        CPPUNIT_ASSERT( len == 4 );
+
+        // rewrite with another size
+        uint16_t small = 0xABCD;
+        CPPUNIT_ASSERT( packed->writeSlot(1, small) );
+        uint16_t smallR = 0;
+        CPPUNIT_ASSERT( packed->readSlot(1, smallR) );
+        CPPUNIT_ASSERT( smallR == small );
+        CPPUNIT_ASSERT( packed->readSlot(29, flagR) );
+
+        CPPUNIT_ASSERT( !packed->writeSlot(0, value) );
+        CPPUNIT_ASSERT( !packed->writeSlot(251, value) );
+
+        // pack is erased with the last packed slot
+        CPPUNIT_ASSERT( packed->eraseSlot(1) );
+        CPPUNIT_ASSERT( !packed->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !packed->eraseSlot(1) );
+        CPPUNIT_ASSERT( nvm->isSlotAvailable(100) );
+        CPPUNIT_ASSERT( packed->eraseSlot(29) );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(100) );
+    }
+
+    void test_flags_00() {
+        CPPUNIT_ASSERT( packed->begin() );
+        for (uint8_t slot = 1; slot <= 200; ++slot) {
+            bool flag = (slot % 3) == 0;
+            CPPUNIT_ASSERT( packed->writeSlot(slot, flag) );
+        }
+
+        // 8 flags per cluster instead of one
+        uint16_t usedClusters = (nvm->getSize() - nvm->getFree()) / NVM_t::S_USER_DATA_PER_CLUSTER;
+        CPPUNIT_ASSERT( usedClusters == 28 );
+
+        for (uint8_t slot = 1; slot <= 200; ++slot) {
+            bool flag = false;
+            CPPUNIT_ASSERT( packed->readSlot(slot, flag) );
+            CPPUNIT_ASSERT( flag == ((slot % 3) == 0) );
+        }
+
+        // other slots can be used directly
+        uint32_t value = 7;
+        CPPUNIT_ASSERT( nvm->writeSlot(1, value) );
+        bool flag = true;
+        CPPUNIT_ASSERT( packed->readSlot(1, flag) );
+        CPPUNIT_ASSERT( !flag );
+    }
+
+    void test_begin_00() {
+        CPPUNIT_ASSERT( packed->begin() );
+        for (uint8_t slot = 1; slot <= 100; ++slot) {
+            CPPUNIT_ASSERT( packed->writeSlot(slot, slot) );
+        }
+        CPPUNIT_ASSERT( packed->eraseSlot(50) );
+
+        NVM_t restartedNVM;
+        restartedNVM.m_memory = nvm->m_memory;
+        Packed_t restarted(restartedNVM);
+        CPPUNIT_ASSERT( restarted.begin() );
+        restartedNVM.resetStats();
+        for (uint8_t slot = 1; slot <= 100; ++slot) {
+            CPPUNIT_ASSERT( restarted.isSlotAvailable(slot) == (slot != 50) );
+            if (slot == 50) continue;
+            uint8_t value = 0;
+            CPPUNIT_ASSERT( restarted.readSlot(slot, value) );
+            CPPUNIT_ASSERT( value == slot );
+        }
+        CPPUNIT_ASSERT( !restarted.isSlotAvailable(101) );
+    }
+
+    void test_full_00() {
+        CPPUNIT_ASSERT( packed->begin() );
+        CPPUNIT_ASSERT( packed->getFree(1) == 26 );
+        uint8_t data[25];
+        memset(data, 0x11, sizeof(data));
+        CPPUNIT_ASSERT( !packed->writeSlot(1, data, 25) );      // more than S_MAX_LEN
+        CPPUNIT_ASSERT( packed->writeSlot(1, data, 20) );
+        CPPUNIT_ASSERT( packed->getFree(29) == 4 );
+        CPPUNIT_ASSERT( !packed->writeSlot(29, data, 3) );      // pack full
+        CPPUNIT_ASSERT( packed->writeSlot(29, data, 2) );
+        CPPUNIT_ASSERT( packed->getFree(57) == 0 );
+        CPPUNIT_ASSERT( !packed->isSlotAvailable(57) );
+
+        // a smaller rewrite still fits
+        CPPUNIT_ASSERT( packed->writeSlot(1, data, 10) );
+        CPPUNIT_ASSERT( packed->getFree(1) == 10 );
+        CPPUNIT_ASSERT( packed->writeSlot(2, data, 24) );       // another pack
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PackedSlotNVMTest );
@@ -0,0 +1,400 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_POWERFAILHARNESS_H_
+#define _SLOTNVM_POWERFAILHARNESS_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "NVMRAMMock.h"
+
+/*
+ * Helpers to check SlotNVM against power loss.
+ *
+ * PowerFailHarness replays a sequence of NVMOperation and cuts the power before every single written byte.
+ * After every cut a new SlotNVM instance is started with begin() and compared with a SlotNVMReference.
+ *
+ * Classes under test must be SlotNVM<NVMRAMMock<...>, ...> using powerFailRandom as RND_FUNC
+ * so every replay of an operation takes the same path. This header needs access to private members,
+ * include it like SlotNVM.h with private and protected defined as public.
+ */
+
+/// One operation of a test sequence.
+struct NVMOperation {
+    enum Type {
+        WRITE,
+        ERASE,
+        APPEND
+    };
+
+    uint8_t                 type;
+    uint8_t                 slot;
+    std::vector<uint8_t>    data;   ///< data to write or append, empty for ERASE
+};
+
+/// Random state of powerFailRandom(), every thread has its own.
+inline uint32_t &powerFailRandomState() {
+    static thread_local uint32_t state = 1;
+    return state;
+}
+
+inline void seedPowerFailRandom(uint32_t seed) {
+    powerFailRandomState() = (seed != 0) ? seed : 0x9E3779B9;
+}
+
+/// Deterministic replacement of rand() for RND_FUNC of SlotNVM (xorshift32).
+inline int powerFailRandom() {
+    uint32_t &x = powerFailRandomState();
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return (int)(x & 0x7FFFFFFF);
+}
+
+/**
+ * Generate a random operation sequence.
+ * @param       seed        Seed, the same seed gives the same sequence
+ * @param       cnt         Count of operations
+ * @param       firstSlot   Lowest used slot number
+ * @param       lastSlot    Highest used slot number
+ * @param       maxLen      Maximum data length of a write
+ * @param[out]  ops         Generated operations
+ * @param       appends     true turns half of the writes into appends
+ */
+inline void generateNVMOperations(uint32_t seed, unsigned cnt, uint8_t firstSlot, uint8_t lastSlot,
+                                  nvm_size_t maxLen, std::vector<NVMOperation> &ops, bool appends = false) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> slotDist(firstSlot, lastSlot);
+    std::uniform_int_distribution<> lenDist(1, maxLen);
+    std::uniform_int_distribution<> byteDist(0, 255);
+
+    ops.resize(cnt);
+    for (unsigned i = 0; i < cnt; ++i) {
+        NVMOperation &op = ops[i];
+        op.type = (byteDist(gen) < 192) ? NVMOperation::WRITE : NVMOperation::ERASE;
+        op.slot = slotDist(gen);
+        op.data.clear();
+        if (op.type == NVMOperation::WRITE) {
+            op.data.resize(lenDist(gen));
+            for (size_t d = 0; d < op.data.size(); ++d) {
+                op.data[d] = byteDist(gen);
+            }
+            if (appends && (byteDist(gen) < 128)) {
+                op.type = NVMOperation::APPEND;
+            }
+        }
+    }
+}
+
+/**
+ * Decode an operation sequence from a byte stream, e.g. fuzzer input.
+ * Every operation starts with a command byte (bit 0 set means erase, else bit 1 set means append) and a slot byte,
+ * a write or append continues with a length byte (length - 1) and the data bytes.
+ * A truncated last operation is ignored.
+ * @param       stream      Byte stream
+ * @param       len         Length of stream
+ * @param       lastSlot    Highest slot number, slot bytes are mapped to 1..lastSlot
+ * @param       maxLen      Maximum data length of a write
+ * @param       maxOps      Maximum count of operations
+ * @param[out]  ops         Decoded operations
+ */
+inline void decodeNVMOperations(const uint8_t *stream, size_t len, uint8_t lastSlot, nvm_size_t maxLen,
+                                size_t maxOps, std::vector<NVMOperation> &ops) {
+    ops.clear();
+    size_t pos = 0;
+    while (((pos + 2) <= len) && (ops.size() < maxOps)) {
+        NVMOperation op;
+        op.type = (stream[pos] & 0x01) ? NVMOperation::ERASE
+                                       : ((stream[pos] & 0x02) ? NVMOperation::APPEND : NVMOperation::WRITE);
+        op.slot = stream[pos + 1] % lastSlot + 1;
+        pos += 2;
+        if (op.type != NVMOperation::ERASE) {
+            if (pos >= len) break;
+            size_t dataLen = (size_t)stream[pos] % maxLen + 1;
+            ++pos;
+            if ((pos + dataLen) > len) break;
+            op.data.assign(stream + pos, stream + pos + dataLen);
+            pos += dataLen;
+        }
+        ops.push_back(op);
+    }
+}
+
+/// Expected content of all slots.
+class SlotNVMReference {
+public:
+    SlotNVMReference() : m_slots(256) {}
+
+    void apply(const NVMOperation &op) {
+        if (op.type == NVMOperation::WRITE) {
+            m_slots[op.slot] = op.data;
+        } else if (op.type == NVMOperation::APPEND) {
+            m_slots[op.slot].insert(m_slots[op.slot].end(), op.data.begin(), op.data.end());
+        } else {
+            m_slots[op.slot].clear();
+        }
+    }
+
+    const std::vector<uint8_t> &get(uint8_t slot) const {
+        return m_slots[slot];
+    }
+
+    /**
+     * Compare all slots of nvm with the expected content.
+     * @param       nvm     Initialized SlotNVM
+     * @param       pending Operation interrupted by power loss or NULL, its slot may have the old or the new content
+     * @param[out]  err     Description of the first difference
+     * @return      true if content is as expected
+     */
+    template <class NVM_T>
+    bool check(const NVM_T &nvm, const NVMOperation *pending, std::string &err) const {
+        std::vector<uint8_t> data(256);
+        for (uint16_t slot = NVM_T::S_FIRST_SLOT; slot <= NVM_T::S_LAST_SLOT; ++slot) {
+            nvm_size_t len = data.size();
+            bool avail = nvm.readSlot(slot, &data[0], len);
+            bool match = avail ? ((len == m_slots[slot].size()) && (memcmp(&data[0], m_slots[slot].data(), len) == 0))
+                               : m_slots[slot].empty();
+            if (match) continue;
+
+            if ((pending != NULL) && (pending->slot == slot)) {
+                std::vector<uint8_t> expected = pending->data;
+                if (pending->type == NVMOperation::APPEND) {
+                    expected.insert(expected.begin(), m_slots[slot].begin(), m_slots[slot].end());
+                }
+                if (avail && (pending->type != NVMOperation::ERASE) &&
+                    (len == expected.size()) && (memcmp(&data[0], expected.data(), len) == 0)) continue;
+                if (!avail && (pending->type == NVMOperation::ERASE)) continue;
+            }
+
+            err = "slot " + std::to_string(slot) + (avail ? " has " + std::to_string(len) + " unexpected bytes"
+                                                          : " is missing");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::vector<uint8_t>> m_slots;
+};
+
+/**
+ * Check that every used cluster belongs to a slot.
+ * @param       nvm     Initialized SlotNVM
+ * @param[out]  err     Description of the error
+ * @return      true if no cluster is lost
+ */
+template <class NVM_T>
+bool checkClusterUsage(const NVM_T &nvm, std::string &err) {
+    unsigned slotClusters = 0;
+    for (auto info : nvm.slots()) {
+        slotClusters += info.clusterCnt;
+    }
+    unsigned usedClusters = 0;
+    for (uint16_t cluster = 0; cluster < NVM_T::S_CLUSTER_CNT; ++cluster) {
+        if (nvm.isClusterBitSet(cluster)) ++usedClusters;
+    }
+    if (slotClusters != usedClusters) {
+        err = std::to_string(usedClusters) + " clusters used but slots need " + std::to_string(slotClusters);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Replay an operation sequence with a power cut before every written byte.
+ * The cut points are checked in parallel by all cores.
+ *
+ * @tparam NVM_T    SlotNVM class to test, see header description.
+ */
+template <class NVM_T>
+class PowerFailHarness {
+public:
+    /// First found failure.
+    struct Failure {
+        size_t      op;     ///< Index of the operation
+        unsigned    cut;    ///< Cut before this byte of the operation (1..n), 0 means without power cut
+        std::string msg;
+    };
+
+    /// @param threads  Count of worker threads, 0 means one per core.
+    explicit PowerFailHarness(unsigned threads = 0)
+        : m_threads(threads)
+        , m_checkedCuts(0)
+    {
+        if (m_threads == 0) m_threads = std::thread::hardware_concurrency();
+        if (m_threads == 0) m_threads = 1;
+    }
+
+    /**
+     * Run all operations and all power cuts.
+     * @param ops   Operations, e.g. from generateNVMOperations()
+     * @return      true if no failure was found, else see getFailure()
+     */
+    bool run(const std::vector<NVMOperation> &ops) {
+        m_failed = false;
+        m_checkedCuts = 0;
+        m_ops = &ops;
+
+        if (!runSequential()) return false;
+
+        std::vector<std::thread> workers;
+        m_nextWork = 0;
+        for (unsigned t = 1; t < m_threads; ++t) {
+            workers.push_back(std::thread(&PowerFailHarness::worker, this));
+        }
+        worker();
+        for (size_t t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+
+        return !m_failed;
+    }
+
+    const Failure &getFailure() const {
+        return m_failure;
+    }
+
+    /// Count of checked power cuts of last run().
+    unsigned getCheckedCuts() const {
+        return m_checkedCuts;
+    }
+
+private:
+    struct Step {
+        std::vector<uint8_t>    memory;     // memory before the operation
+        SlotNVMReference        ref;        // expected content before the operation
+        uint32_t                writes;     // count of bytes written by the operation
+    };
+
+    struct Work {
+        size_t      op;
+        unsigned    cut;
+    };
+
+    unsigned                        m_threads;
+    const std::vector<NVMOperation> *m_ops;
+    std::vector<Step>               m_steps;
+    std::vector<Work>               m_work;
+    std::atomic<size_t>             m_nextWork;
+    std::atomic<unsigned>           m_checkedCuts;
+    std::atomic<bool>               m_failed;
+    std::mutex                      m_failureMutex;
+    Failure                         m_failure;
+
+    static bool execute(NVM_T &nvm, const NVMOperation &op) {
+        if (op.type == NVMOperation::WRITE) {
+            return nvm.writeSlot(op.slot, op.data.data(), op.data.size());
+        } else if (op.type == NVMOperation::APPEND) {
+            return nvm.appendSlot(op.slot, op.data.data(), op.data.size());
+        } else {
+            return nvm.eraseSlot(op.slot);
+        }
+    }
+
+    // run without power cut, remember state before every operation and count written bytes
+    bool runSequential() {
+        const std::vector<NVMOperation> &ops = *m_ops;
+        NVM_T nvm;
+        SlotNVMReference ref;
+        std::string err;
+
+        nvm.begin();
+        m_steps.resize(ops.size());
+        m_work.clear();
+        for (size_t i = 0; i < ops.size(); ++i) {
+            Step &step = m_steps[i];
+            step.memory = nvm.m_memory;
+            step.ref = ref;
+            uint32_t writeCnt = nvm.getWriteCnt();
+            seedPowerFailRandom(i + 1);
+            if (execute(nvm, ops[i])) {
+                ref.apply(ops[i]);
+            }
+            step.writes = nvm.getWriteCnt() - writeCnt;
+            for (unsigned cut = 1; cut <= step.writes; ++cut) {
+                Work work = { i, cut };
+                m_work.push_back(work);
+            }
+
+            if (!ref.check(nvm, NULL, err) || !checkRestart(nvm.m_memory, ref, NULL, err)) {
+                fail(i, 0, err);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void worker() {
+        std::string err;
+        while (!m_failed) {
+            size_t w = m_nextWork++;
+            if (w >= m_work.size()) break;
+            const Work &work = m_work[w];
+            if (!checkCut(work.op, work.cut, err)) {
+                fail(work.op, work.cut, err);
+            }
+            ++m_checkedCuts;
+        }
+    }
+
+    bool checkCut(size_t i, unsigned cut, std::string &err) {
+        const Step &step = m_steps[i];
+        const NVMOperation &op = (*m_ops)[i];
+        NVM_T nvm;
+        nvm.m_memory = step.memory;
+        nvm.begin();
+        seedPowerFailRandom(i + 1);
+        nvm.setWriteErrorAfterXbytes(cut);
+        try {
+            execute(nvm, op);
+            err = "power cut not reached, operation is not deterministic";
+            return false;
+        } catch (PowerLostException &) {
+            // expected
+        }
+        return checkRestart(nvm.m_memory, step.ref, &op, err);
+    }
+
+    // start a new instance on memory and check content, a second start must not change anything
+    static bool checkRestart(const std::vector<uint8_t> &memory, const SlotNVMReference &ref,
+                             const NVMOperation *pending, std::string &err) {
+        NVM_T nvm;
+        nvm.m_memory = memory;
+        if (!nvm.begin()) {
+            err = "begin() failed";
+            return false;
+        }
+        if (!ref.check(nvm, pending, err)) return false;
+        if (!checkClusterUsage(nvm, err)) return false;
+
+        NVM_T nvm2;
+        nvm2.m_memory = nvm.m_memory;
+        nvm2.begin();
+        if (nvm2.m_memory != nvm.m_memory) {
+            err = "second begin() changed memory";
+            return false;
+        }
+        return true;
+    }
+
+    void fail(size_t op, unsigned cut, const std::string &msg) {
+        std::lock_guard<std::mutex> lock(m_failureMutex);
+        if (m_failed) return;
+        m_failure.op = op;
+        m_failure.cut = cut;
+        m_failure.msg = msg;
+        m_failed = true;
+    }
+};
+
+#endif // _SLOTNVM_POWERFAILHARNESS_H_
@@ -0,0 +1,165 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <string>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+#include "PowerFailHarness.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class PowerFailTest : public CppUnit::TestFixture {
+
+CPPUNIT_TEST_SUITE( PowerFailTest );
+
+CPPUNIT_TEST( test_decode_00 );
+CPPUNIT_TEST( test_noCrc_00 );
+CPPUNIT_TEST( test_crc_00 );
+CPPUNIT_TEST( test_full_00 );
+CPPUNIT_TEST( test_extent_00 );
+CPPUNIT_TEST( test_extent_01 );
+CPPUNIT_TEST( test_append_00 );
+CPPUNIT_TEST( test_append_01 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    template <class T>
+    void runHarness(uint32_t seed, unsigned cnt, uint8_t lastSlot, nvm_size_t maxLen, bool appends = false) {
+        std::vector<NVMOperation> ops;
+        generateNVMOperations(seed, cnt, 1, lastSlot, maxLen, ops, appends);
+        runOps<T>(ops);
+    }
+
+    template <class T>
+    void runOps(const std::vector<NVMOperation> &ops) {
+        PowerFailHarness<T> harness;
+        bool res = harness.run(ops);
+        if (!res) {
+            std::cout << "Power fail at operation " << std::dec << harness.getFailure().op
+                      << " cut " << harness.getFailure().cut << ": " << harness.getFailure().msg << std::endl;
+        }
+        CPPUNIT_ASSERT( res );
+        CPPUNIT_ASSERT( harness.getCheckedCuts() > ops.size() );
+    }
+
+    static NVMOperation makeOperation(uint8_t type, uint8_t slot, const std::vector<uint8_t> &data) {
+        NVMOperation op;
+        op.type = type;
+        op.slot = slot;
+        op.data = data;
+        return op;
+    }
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_decode_00() {
+        const uint8_t stream[] = { 0x00, 2, 2, 0xA, 0xB, 0xC,   // write slot 3, 3 bytes
+                                   0x01, 9,                     // erase slot 2
+                                   0x02, 4, 0, 0xD,             // append slot 5, 1 byte
+                                   0x00, 0, 200, 1, 2 };        // truncated write
+        std::vector<NVMOperation> ops;
+        decodeNVMOperations(stream, sizeof(stream), 8, 16, 10, ops);
+        CPPUNIT_ASSERT( ops.size() == 3 );
+        CPPUNIT_ASSERT( ops[0].type == NVMOperation::WRITE );
+        CPPUNIT_ASSERT( ops[0].slot == 3 );
+        CPPUNIT_ASSERT( ops[0].data.size() == 3 );
+        CPPUNIT_ASSERT( ops[0].data[2] == 0xC );
+        CPPUNIT_ASSERT( ops[1].type == NVMOperation::ERASE );
+        CPPUNIT_ASSERT( ops[1].slot == 2 );
+        CPPUNIT_ASSERT( ops[2].type == NVMOperation::APPEND );
+        CPPUNIT_ASSERT( ops[2].slot == 5 );
+        CPPUNIT_ASSERT( ops[2].data.size() == 1 );
+
+        decodeNVMOperations(stream, sizeof(stream), 8, 16, 1, ops);
+        CPPUNIT_ASSERT( ops.size() == 1 );
+    }
+
+    void test_noCrc_00() {
+        runHarness< SlotNVM<NVMRAMMock<1024>, 32, 0, 0, (uint8_t (*)(uint8_t, uint8_t))NULL, int, &powerFailRandom> >(1, 60, 12, 100);
+    }
+
+    void test_crc_00() {
+        runHarness< SlotNVM<NVMRAMMock<1024>, 32, 0, 0, &testCRC8, int, &powerFailRandom> >(2, 60, 12, 100);
+    }
+
+    void test_full_00() {
+        // small NVM, many writes fail because there is no free cluster
+        runHarness< SlotNVM<NVMRAMMock<256>, 16, 0, 0, &testCRC8, int, &powerFailRandom> >(3, 80, 6, 60);
+    }
+
+    void test_extent_00() {
+        runHarness< SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &powerFailRandom, false, false, true> >(4, 60, 12, 120);
+    }
+
+    void test_extent_01() {
+        // the data of an extent contains images of a valid cluster of slot 2 at the position of its raw blocks,
+        // they must never become a slot while the extent is written or erased
+        typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &powerFailRandom, false, false, true> NVM_t;
+        uint8_t image[16] = { 2, 0x30, 0, 3, 'E', 'V', 'I', 'L' };     // start and last cluster, 4 bytes
+        uint8_t crc = 0;
+        for (uint8_t i = 0; i < 8; ++i) {
+            crc = testCRC8(crc, image[i]);
+        }
+        image[14] = crc;
+        image[15] = NVM_t::S_END_BYTE;
+
+        std::vector<uint8_t> data(50, 0x55);
+        for (nvm_size_t offset = NVM_t::S_USER_DATA_PER_CLUSTER; offset + 16 <= (nvm_size_t)data.size(); offset += 16) {
+            memcpy(&data[offset], image, sizeof(image));
+        }
+        std::vector<uint8_t> shifted(data.begin() + 1, data.end());     // and one byte in front
+        shifted.push_back(0x55);
+
+        std::vector<NVMOperation> ops;
+        ops.push_back(makeOperation(NVMOperation::WRITE, 1, data));
+        ops.push_back(makeOperation(NVMOperation::ERASE, 1, std::vector<uint8_t>()));
+        ops.push_back(makeOperation(NVMOperation::WRITE, 1, shifted));
+        ops.push_back(makeOperation(NVMOperation::WRITE, 3, std::vector<uint8_t>(5, 0x33)));
+        ops.push_back(makeOperation(NVMOperation::WRITE, 1, data));
+        ops.push_back(makeOperation(NVMOperation::ERASE, 1, std::vector<uint8_t>()));
+        runOps<NVM_t>(ops);
+    }
+
+    void test_append_00() {
+        runHarness< SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &powerFailRandom, false, false, false, true> >(5, 80, 4, 30, true);
+    }
+
+    void test_append_01() {
+        runHarness< SlotNVM<NVMRAMMock<1024>, 32, 0, 0, (uint8_t (*)(uint8_t, uint8_t))NULL, int, &powerFailRandom,
+                             false, false, false, true> >(6, 80, 6, 40, true);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PowerFailTest );
@@ -0,0 +1,269 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "RingLogNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class RingLogNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( RingLogNVMTest );
+
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_records_00 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_begin_01 );
+CPPUNIT_TEST( test_powerFail_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef RingLogNVM<NVMRAMMock<1024>, 8, &testCRC8>          NVM_t;      // 93 records
+    typedef RingLogNVM<NVMRAMMock<64>, 5, &testCRC8>            Small_t;    // 8 records
+    typedef RingLogNVM<NVMRAMMock<64, false, 0x00>, 5, &testCRC8> Zero_t;
+
+    struct Sample {
+        uint32_t    time;
+        int16_t     value;
+        uint16_t    flags;
+    };
+
+    template <class T>
+    static void fill(uint8_t *data, uint32_t seed) {
+        for (nvm_size_t i = 0; i < T::S_RECORD_SIZE; ++i) {
+            data[i] = seed * 3 + i;
+        }
+    }
+
+    // records written so far are the newest ones
+    template <class T>
+    static void check(const T &nvm, uint32_t written) {
+        uint16_t cnt = (written < T::S_RECORD_CNT) ? written : T::S_RECORD_CNT;
+        CPPUNIT_ASSERT( nvm.getCount() == cnt );
+        for (uint16_t back = 0; back < cnt; ++back) {
+            uint8_t data[T::S_RECORD_SIZE];
+            uint8_t expected[T::S_RECORD_SIZE];
+            uint16_t seq;
+            fill<T>(expected, written - 1 - back);
+            CPPUNIT_ASSERT( nvm.readRecord(back, data, &seq) );
+            CPPUNIT_ASSERT( seq == (written - 1 - back) % 0xFFFF );
+            CPPUNIT_ASSERT( memcmp(data, expected, sizeof(data)) == 0 );
+        }
+        uint8_t data[T::S_RECORD_SIZE];
+        CPPUNIT_ASSERT( !nvm.readRecord(cnt, data) );
+    }
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_access_00() {
+        RingLogNVM<NVMRAMMock<1024>, sizeof(Sample), &testCRC8> nvm;
+        Sample sample = { 1000, -5, 0x8001 };
+        CPPUNIT_ASSERT( !nvm.append(sample) );         // begin() not called
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( !nvm.begin() );
+        CPPUNIT_ASSERT( nvm.getCount() == 0 );
+        Sample sampleR;
+        CPPUNIT_ASSERT( !nvm.readRecord(0, sampleR) );
+
+        // two writes, data and CRC, then sequence number
+        uint32_t writeCnt = nvm.getWriteCnt();
+        CPPUNIT_ASSERT( nvm.append(sample) );
+        CPPUNIT_ASSERT( nvm.getWriteCnt() - writeCnt == sizeof(Sample) + 3 );
+        CPPUNIT_ASSERT( nvm.getCount() == 1 );
+        uint16_t seq = 0xAAAA;
+        CPPUNIT_ASSERT( nvm.readRecord(0, sampleR, &seq) );
+        CPPUNIT_ASSERT( seq == 0 );
+        CPPUNIT_ASSERT( memcmp(&sample, &sampleR, sizeof(Sample)) == 0 );
+
+        sample.time = 2000;
+        CPPUNIT_ASSERT( nvm.append(sample) );
+        CPPUNIT_ASSERT( nvm.readRecord(0, sampleR, &seq) );
+        CPPUNIT_ASSERT( (seq == 1) && (sampleR.time == 2000) );
+        CPPUNIT_ASSERT( nvm.readRecord(1, sampleR, &seq) );
+        CPPUNIT_ASSERT( (seq == 0) && (sampleR.time == 1000) );
+        CPPUNIT_ASSERT( !nvm.readRecord(2, sampleR) );
+        CPPUNIT_ASSERT( !nvm.append((const uint8_t *)NULL) );
+
+        // a corrupted record is not read
+        nvm.m_memory[3] ^= 0x01;
+        CPPUNIT_ASSERT( !nvm.readRecord(1, sampleR) );
+        CPPUNIT_ASSERT( nvm.readRecord(0, sampleR) );
+    }
+
+    void test_records_00() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint16_t cnt = 0;
+        for (auto rec : nvm.records()) {
+            (void)rec;
+            ++cnt;
+        }
+        CPPUNIT_ASSERT( cnt == 0 );
+
+        uint8_t data[NVM_t::S_RECORD_SIZE];
+        for (uint32_t i = 0; i < 150; ++i) {
+            fill<NVM_t>(data, i);
+            CPPUNIT_ASSERT( nvm.append(data) );
+        }
+        check(nvm, 150);
+
+        // the newest ones, one read per record
+        nvm.resetStats();
+        uint32_t expectedSeq = 149;
+        for (auto rec : nvm.records(10)) {
+            uint8_t expected[NVM_t::S_RECORD_SIZE];
+            fill<NVM_t>(expected, expectedSeq);
+            CPPUNIT_ASSERT( rec.valid );
+            CPPUNIT_ASSERT( rec.seq == expectedSeq );
+            CPPUNIT_ASSERT( memcmp(rec.data, expected, sizeof(expected)) == 0 );
+            --expectedSeq;
+        }
+        CPPUNIT_ASSERT( expectedSeq == 139 );
+        CPPUNIT_ASSERT( nvm.getStats().reads == 10 );
+
+        // all stored ones, a corrupted one is marked
+        nvm.m_memory[nvm.recordAddr(nvm.position(5)) + 4] ^= 0x10;
+        cnt = 0;
+        for (auto rec : nvm.records(1000)) {
+            CPPUNIT_ASSERT( rec.valid == (cnt != 5) );
+            ++cnt;
+        }
+        CPPUNIT_ASSERT( cnt == NVM_t::S_RECORD_CNT );
+    }
+
+    void test_begin_00() {
+        // restart after every record, also across wrap around of positions
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[NVM_t::S_RECORD_SIZE];
+        for (uint32_t i = 0; i < 3 * NVM_t::S_RECORD_CNT + 7; ++i) {
+            fill<NVM_t>(data, i);
+            CPPUNIT_ASSERT( nvm.append(data) );
+
+            NVM_t restarted;
+            restarted.m_memory = nvm.m_memory;
+            restarted.resetStats();
+            CPPUNIT_ASSERT( restarted.begin() );
+            CPPUNIT_ASSERT( restarted.m_head == nvm.m_head );
+            CPPUNIT_ASSERT( restarted.m_headSeq == nvm.m_headSeq );
+            CPPUNIT_ASSERT( restarted.getStats().reads <= 14 );    // 7 for the search, 5 records
+            check(restarted, i + 1);
+        }
+    }
+
+    void test_begin_01() {
+        // erased NVM with 0xFF or 0x00 has no records
+        Small_t ff;
+        Zero_t zero;
+        CPPUNIT_ASSERT( ff.begin() );
+        CPPUNIT_ASSERT( zero.begin() );
+        CPPUNIT_ASSERT( ff.getCount() == 0 );
+        CPPUNIT_ASSERT( zero.getCount() == 0 );
+
+        // wrap around of the sequence numbers
+        Small_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        nvm.m_headSeq = 0xFFFE - 20;
+        uint8_t data[Small_t::S_RECORD_SIZE];
+        for (uint32_t i = 0; i < 40; ++i) {
+            fill<Small_t>(data, i);
+            CPPUNIT_ASSERT( nvm.append(data) );
+            Small_t restarted;
+            restarted.m_memory = nvm.m_memory;
+            CPPUNIT_ASSERT( restarted.begin() );
+            CPPUNIT_ASSERT( restarted.m_head == nvm.m_head );
+            CPPUNIT_ASSERT( restarted.m_headSeq == nvm.m_headSeq );
+            CPPUNIT_ASSERT( restarted.getCount() == nvm.getCount() );
+        }
+        CPPUNIT_ASSERT( nvm.m_headSeq == 19 );
+    }
+
+    void test_powerFail_00() {
+        // cut the power before every written byte, the new record is stored or not, only the oldest one may be lost
+        Small_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[Small_t::S_RECORD_SIZE];
+        for (uint32_t op = 0; op < 3 * Small_t::S_RECORD_CNT; ++op) {
+            fill<Small_t>(data, op);
+
+            std::vector<uint8_t> memory = nvm.m_memory;
+            for (uint16_t cut = 1; ; ++cut) {
+                Small_t cutNVM;
+                cutNVM.m_memory = memory;
+                CPPUNIT_ASSERT( cutNVM.begin() );
+                cutNVM.setWriteErrorAfterXbytes(cut);
+                bool lost = false;
+                try {
+                    CPPUNIT_ASSERT( cutNVM.append(data) );
+                } catch (PowerLostException &) {
+                    lost = true;
+                }
+                if (!lost) break;
+
+                Small_t restarted;
+                restarted.m_memory = cutNVM.m_memory;
+                CPPUNIT_ASSERT( restarted.begin() );
+                uint16_t seq;
+                uint8_t buf[Small_t::S_RECORD_SIZE];
+                if (restarted.getCount() == 0) {                    // first record not stored
+                    CPPUNIT_ASSERT( op == 0 );
+                    continue;
+                }
+                CPPUNIT_ASSERT( restarted.readRecord(0, buf, &seq) );
+                if (seq == op) {                                    // new record
+                    CPPUNIT_ASSERT( memcmp(buf, data, sizeof(buf)) == 0 );
+                    check(restarted, op + 1);
+                } else {                                            // old records, the oldest may be lost
+                    CPPUNIT_ASSERT( seq == op - 1 );
+                    uint16_t cnt = (op < Small_t::S_RECORD_CNT) ? op : Small_t::S_RECORD_CNT;
+                    CPPUNIT_ASSERT( (restarted.getCount() == cnt) || (restarted.getCount() == cnt - 1) );
+                    for (uint16_t back = 0; back < restarted.getCount(); ++back) {
+                        uint8_t expected[Small_t::S_RECORD_SIZE];
+                        fill<Small_t>(expected, op - 1 - back);
+                        CPPUNIT_ASSERT( restarted.readRecord(back, buf) );
+                        CPPUNIT_ASSERT( memcmp(buf, expected, sizeof(buf)) == 0 );
+                    }
+
+                    // and it goes on
+                    CPPUNIT_ASSERT( restarted.append(data) );
+                    Small_t again;
+                    again.m_memory = restarted.m_memory;
+                    CPPUNIT_ASSERT( again.begin() );
+                    CPPUNIT_ASSERT( again.readRecord(0, buf, &seq) );
+                    CPPUNIT_ASSERT( seq == op );
+                }
+            }
+            CPPUNIT_ASSERT( nvm.append(data) );
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( RingLogNVMTest );
@@ -0,0 +1,208 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <thread>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "ShardedSlotNVM.h"
+#include "NVMRAMMock.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ShardedSlotNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( ShardedSlotNVMTest );
+
+CPPUNIT_TEST( test_placement_00 );
+CPPUNIT_TEST( test_placement_01 );
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_capacity_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<256>, 16>        EEPROM1_t;  // 16 slots
+    typedef SlotNVM<NVMRAMMock<1024>, 32>       EEPROM2_t;  // 32 slots
+    typedef SlotNVM<NVMRAMMock<512>, 64, 0, 4>  FRAM_t;     // 4 slots
+    typedef ShardedSlotNVM<&shardRangePlacement, EEPROM1_t, EEPROM2_t, FRAM_t>          Range_t;
+    typedef ShardedSlotNVM<&shardInterleavedPlacement, EEPROM1_t, EEPROM2_t, FRAM_t>    Interleaved_t;
+
+    EEPROM1_t   *eeprom1;
+    EEPROM2_t   *eeprom2;
+    FRAM_t      *fram;
+
+public:
+    void setUp() {
+        eeprom1 = new EEPROM1_t;
+        eeprom2 = new EEPROM2_t;
+        fram = new FRAM_t;
+    }
+
+    void tearDown()  {
+        delete eeprom1;
+        delete eeprom2;
+        delete fram;
+    }
+
+    void test_placement_00() {
+        Range_t sharded(*eeprom1, *eeprom2, *fram);
+        CPPUNIT_ASSERT( Range_t::S_SHARD_CNT == 3 );
+        CPPUNIT_ASSERT( sharded.getLastSlot() == 52 );
+
+        uint8_t shard = 0xFF, localSlot = 0;
+        CPPUNIT_ASSERT( !sharded.getPlacement(0, shard, localSlot) );
+        CPPUNIT_ASSERT( sharded.getPlacement(1, shard, localSlot) );
+        CPPUNIT_ASSERT( (shard == 0) && (localSlot == 1) );
+        CPPUNIT_ASSERT( sharded.getPlacement(16, shard, localSlot) );
+        CPPUNIT_ASSERT( (shard == 0) && (localSlot == 16) );
+        CPPUNIT_ASSERT( sharded.getPlacement(17, shard, localSlot) );
+        CPPUNIT_ASSERT( (shard == 1) && (localSlot == 1) );
+        CPPUNIT_ASSERT( sharded.getPlacement(48, shard, localSlot) );
+        CPPUNIT_ASSERT( (shard == 1) && (localSlot == 32) );
+        CPPUNIT_ASSERT( sharded.getPlacement(52, shard, localSlot) );
+        CPPUNIT_ASSERT( (shard == 2) && (localSlot == 4) );
+        CPPUNIT_ASSERT( !sharded.getPlacement(53, shard, localSlot) );
+    }
+
+    void test_placement_01() {
+        Interleaved_t sharded(*eeprom1, *eeprom2, *fram);
+        CPPUNIT_ASSERT( sharded.getLastSlot() == 52 );
+
+        // every local slot is used exactly once
+        uint8_t used[3][33];
+        memset(used, 0, sizeof(used));
+        uint8_t shard = 0xFF, localSlot = 0;
+        for (uint16_t slot = 1; slot <= 52; ++slot) {
+            CPPUNIT_ASSERT( sharded.getPlacement(slot, shard, localSlot) );
+            CPPUNIT_ASSERT( shard < 3 );
+            CPPUNIT_ASSERT( localSlot >= 1 );
+            ++used[shard][localSlot];
+        }
+        for (uint8_t s = 1; s <= 32; ++s) {
+            CPPUNIT_ASSERT( used[0][s] == ((s <= 16) ? 1 : 0) );
+            CPPUNIT_ASSERT( used[1][s] == 1 );
+            CPPUNIT_ASSERT( used[2][s] == ((s <= 4) ? 1 : 0) );
+        }
+
+        // round robin, full shards are skipped
+        CPPUNIT_ASSERT( sharded.getPlacement(1, shard, localSlot) );
+        CPPUNIT_ASSERT( (shard == 0) && (localSlot == 1) );
+        CPPUNIT_ASSERT( sharded.getPlacement(3, shard, localSlot) );
+        CPPUNIT_ASSERT( (shard == 2) && (localSlot == 1) );
+        CPPUNIT_ASSERT( sharded.getPlacement(13, shard, localSlot) );
+        CPPUNIT_ASSERT( (shard == 0) && (localSlot == 5) );
+        CPPUNIT_ASSERT( sharded.getPlacement(52, shard, localSlot) );
+        CPPUNIT_ASSERT( (shard == 1) && (localSlot == 32) );
+        CPPUNIT_ASSERT( !sharded.getPlacement(53, shard, localSlot) );
+    }
+
+    void test_access_00() {
+        Range_t sharded(*eeprom1, *eeprom2, *fram);
+        CPPUNIT_ASSERT( !sharded.isValid() );
+        CPPUNIT_ASSERT( sharded.begin() );
+        CPPUNIT_ASSERT( sharded.isValid() );
+
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( sharded.writeSlot(20, value) );
+        CPPUNIT_ASSERT( sharded.isSlotAvailable(20) );
+        CPPUNIT_ASSERT( !sharded.isSlotAvailable(4) );
+        CPPUNIT_ASSERT( eeprom2->isSlotAvailable(4) );
+        CPPUNIT_ASSERT( !eeprom1->isSlotAvailable(4) );
+
+        uint32_t valueR = 0;
+        CPPUNIT_ASSERT( sharded.readSlot(20, valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+
+        uint8_t data[100];
+        memset(data, 0xAB, sizeof(data));
+        CPPUNIT_ASSERT( sharded.writeSlot(50, data, sizeof(data)) );
+        CPPUNIT_ASSERT( fram->isSlotAvailable(2) );
+        uint8_t buf[100];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( sharded.readSlot(50, buf, len) );
+        CPPUNIT_ASSERT( len == sizeof(data) );
+        CPPUNIT_ASSERT( memcmp(buf, data, len) == 0 );
+
+        CPPUNIT_ASSERT( !sharded.writeSlot(53, value) );
+        CPPUNIT_ASSERT( !sharded.writeSlot(0, value) );
+        CPPUNIT_ASSERT( !sharded.readSlot(53, valueR) );
+
+        CPPUNIT_ASSERT( sharded.eraseSlot(20) );
+        CPPUNIT_ASSERT( !sharded.isSlotAvailable(20) );
+        CPPUNIT_ASSERT( !eeprom2->isSlotAvailable(4) );
+        CPPUNIT_ASSERT( !sharded.eraseSlot(20) );
+    }
+
+    void test_begin_00() {
+        Interleaved_t sharded(*eeprom1, *eeprom2, *fram);
+        CPPUNIT_ASSERT( sharded.begin() );
+        uint8_t data[10];
+        for (uint16_t slot = 1; slot <= 52; ++slot) {
+            memset(data, (uint8_t)slot, sizeof(data));
+            CPPUNIT_ASSERT( sharded.writeSlot(slot, data, sizeof(data)) );
+        }
+
+        // restart all devices
+        EEPROM1_t eeprom1R;
+        EEPROM2_t eeprom2R;
+        FRAM_t framR;
+        eeprom1R.m_memory = eeprom1->m_memory;
+        eeprom2R.m_memory = eeprom2->m_memory;
+        framR.m_memory = fram->m_memory;
+        Interleaved_t restarted(eeprom1R, eeprom2R, framR);
+        CPPUNIT_ASSERT( restarted.begin() );
+        for (uint16_t slot = 1; slot <= 52; ++slot) {
+            nvm_size_t len = sizeof(data);
+            CPPUNIT_ASSERT( restarted.readSlot(slot, data, len) );
+            CPPUNIT_ASSERT( len == sizeof(data) );
+            CPPUNIT_ASSERT( data[0] == (uint8_t)slot );
+        }
+
+        CPPUNIT_ASSERT( eeprom1R.isValid() );
+        CPPUNIT_ASSERT( eeprom2R.isValid() );
+        CPPUNIT_ASSERT( framR.isValid() );
+    }
+
+    void test_capacity_00() {
+        Range_t sharded(*eeprom1, *eeprom2, *fram);
+        CPPUNIT_ASSERT( sharded.begin() );
+        CPPUNIT_ASSERT( sharded.getSize() == (uint32_t)eeprom1->getSize() + eeprom2->getSize() + fram->getSize() );
+        CPPUNIT_ASSERT( sharded.getUsableSize() == sharded.getSize() );
+        CPPUNIT_ASSERT( sharded.getFree() == sharded.getSize() );
+        CPPUNIT_ASSERT( sharded.getFree(1) == eeprom1->getSize() );
+        CPPUNIT_ASSERT( sharded.getFree(49) == fram->getSize() );
+        CPPUNIT_ASSERT( sharded.getFree(53) == 0 );
+
+        uint8_t data[200];
+        memset(data, 0x11, sizeof(data));
+        CPPUNIT_ASSERT( sharded.writeSlot(17, data, sizeof(data)) );
+        CPPUNIT_ASSERT( sharded.getFree() == sharded.getSize() - 8 * EEPROM2_t::S_USER_DATA_PER_CLUSTER );
+
+        // the small device is full even if the other ones have space left
+        CPPUNIT_ASSERT( !sharded.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( sharded.getFree() > sizeof(data) );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ShardedSlotNVMTest );
@@ -0,0 +1,115 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_SIMULATEDNVM_H_
+#define _SLOTNVM_SIMULATEDNVM_H_
+
+#include <cstdint>
+#include "NVMRAMMock.h"
+#include "NVMLatencyModel.h"
+
+/**
+ * NVMRAMMock with a virtual clock.
+ * Every access advances the clock by the time the access would take on real hardware, see NVMLatencyModel.h.
+ * Use it as BASE of SlotNVM to compare configurations by device time instead of host CPU time.
+ *
+ * If the model needs an erase (eraseSize() > 0), a write that sets any bit is charged like a driver
+ * doing read, erase and write back of all touched erase blocks. The data itself is always stored
+ * like in NVMRAMMock, so SlotNVM works as with an EEPROM.
+ *
+ * @tparam SIZE         Size of the NVM in bytes.
+ * @tparam MODEL        Timing model class, e.g. LinearLatencyModel.
+ * @tparam MODEL_FUNC   Function returning the model, e.g. &LinearLatencyModel::avrEEPROM.
+ */
+template <nvm_size_t SIZE, class MODEL, MODEL (*MODEL_FUNC)()>
+class SimulatedNVM : public NVMRAMMock<SIZE> {
+public:
+    typedef NVMRAMMock<SIZE> Mock_t;
+
+    SimulatedNVM()
+        : m_model(MODEL_FUNC())
+        , m_timeNs(0)
+        , m_rewrites(0)
+    {}
+
+    bool erase(nvm_address_t start, nvm_size_t len) {
+        m_timeNs += m_model.eraseTime(start, len);
+        return Mock_t::erase(start, len);
+    }
+
+    bool read(nvm_address_t addr, uint8_t &data) const {
+        m_timeNs += m_model.readTime(addr, 1);
+        return Mock_t::read(addr, data);
+    }
+
+    bool read(nvm_address_t addr, uint8_t *data, nvm_size_t len) const {
+        m_timeNs += m_model.readTime(addr, len);
+        return Mock_t::read(addr, data, len);
+    }
+
+    bool write(nvm_address_t addr, uint8_t data) {
+        chargeWrite(addr, &data, 1);
+        return Mock_t::write(addr, data);
+    }
+
+    bool write(nvm_address_t addr, const uint8_t *data, nvm_size_t len) {
+        if (data != NULL) chargeWrite(addr, data, len);
+        return Mock_t::write(addr, data, len);
+    }
+
+    /// Simulated time since construction or last resetTime() in ns.
+    uint64_t getTime() const {
+        return m_timeNs;
+    }
+
+    /// Count of writes that needed an erase.
+    uint32_t getRewrites() const {
+        return m_rewrites;
+    }
+
+    void resetTime() {
+        m_timeNs = 0;
+        m_rewrites = 0;
+    }
+
+    const MODEL &getModel() const {
+        return m_model;
+    }
+
+private:
+    MODEL               m_model;
+    mutable uint64_t    m_timeNs;
+    uint32_t            m_rewrites;
+
+    void chargeWrite(nvm_address_t addr, const uint8_t *data, nvm_size_t len) {
+        nvm_size_t eraseSize = m_model.eraseSize();
+        if ((eraseSize == 0) || !needErase(addr, data, len)) {
+            m_timeNs += m_model.writeTime(addr, len);
+            return;
+        }
+
+        ++m_rewrites;
+        uint32_t end = (uint32_t)addr + len;
+        for (uint32_t block = addr / eraseSize * eraseSize; block < end; block += eraseSize) {
+            m_timeNs += m_model.readTime(block, eraseSize);
+            m_timeNs += m_model.eraseTime(block, eraseSize);
+            m_timeNs += m_model.writeTime(block, eraseSize);
+        }
+    }
+
+    // true if a bit changes from 0 to 1
+    bool needErase(nvm_address_t addr, const uint8_t *data, nvm_size_t len) const {
+        for (nvm_size_t i = 0; i < len; ++i) {
+            uint8_t old;
+            if (!Mock_t::read(addr + i, old)) return false;
+            if ((data[i] & ~old) != 0) return true;
+        }
+        return false;
+    }
+};
+
+#endif // _SLOTNVM_SIMULATEDNVM_H_
@@ -0,0 +1,141 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "SimulatedNVM.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+static LinearLatencyModel testModel() {
+    return LinearLatencyModel(100, 10, 1000, 50, 7, 1);
+}
+
+class SimulatedNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SimulatedNVMTest );
+
+CPPUNIT_TEST( test_linear_00 );
+CPPUNIT_TEST( test_page_00 );
+CPPUNIT_TEST( test_nor_00 );
+CPPUNIT_TEST( test_slotNVM_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_linear_00() {
+        SimulatedNVM<256, LinearLatencyModel, &testModel> nvm;
+        uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+        CPPUNIT_ASSERT( nvm.getTime() == 0 );
+        CPPUNIT_ASSERT( nvm.write(0x10, data, 8) );
+        CPPUNIT_ASSERT( nvm.getTime() == 1000 + 8 * 50 );
+        CPPUNIT_ASSERT( nvm.write(0x20, 0x55) );
+        CPPUNIT_ASSERT( nvm.getTime() == 2 * 1000 + 9 * 50 );
+
+        nvm.resetTime();
+        uint8_t d;
+        CPPUNIT_ASSERT( nvm.read(0x20, d) );
+        CPPUNIT_ASSERT( d == 0x55 );
+        CPPUNIT_ASSERT( nvm.read(0x10, data, 4) );
+        CPPUNIT_ASSERT( nvm.getTime() == 2 * 100 + 5 * 10 );
+
+        nvm.resetTime();
+        nvm.erase(0, 16);
+        CPPUNIT_ASSERT( nvm.getTime() == 7 + 16 );
+        CPPUNIT_ASSERT( nvm.getRewrites() == 0 );
+    }
+
+    void test_page_00() {
+        SimulatedNVM<256, PageLatencyModel, &PageLatencyModel::i2cEEPROM24LC256> nvm;
+        uint8_t data[8] = { 0 };
+
+        // inside one page
+        CPPUNIT_ASSERT( nvm.write(0, data, 8) );
+        CPPUNIT_ASSERT( nvm.getTime() == (1 + 2 + 8) * 22500 + 5000000 );
+
+        // split into two pages
+        nvm.resetTime();
+        CPPUNIT_ASSERT( nvm.write(60, data, 8) );
+        CPPUNIT_ASSERT( nvm.getTime() == (2 * (1 + 2) + 8) * 22500 + 2 * 5000000 );
+    }
+
+    void test_nor_00() {
+        typedef SimulatedNVM<8192, NORFlashModel, &NORFlashModel::spiNOR25Q> NVM_t;
+        NVM_t nvm;
+        const NORFlashModel &model = nvm.getModel();
+        uint8_t data[4] = { 0xF0, 0x0F, 0xFF, 0x00 };
+
+        // erased memory, no erase needed
+        CPPUNIT_ASSERT( nvm.write(0x100, data, 4) );
+        CPPUNIT_ASSERT( nvm.getRewrites() == 0 );
+        CPPUNIT_ASSERT( nvm.getTime() == model.writeTime(0x100, 4) );
+
+        // only clear bits
+        nvm.resetTime();
+        uint8_t clear[4] = { 0x00, 0x00, 0xFF, 0x00 };
+        CPPUNIT_ASSERT( nvm.write(0x100, clear, 3) );
+        CPPUNIT_ASSERT( nvm.getRewrites() == 0 );
+
+        // set bits, whole sector must be rewritten
+        nvm.resetTime();
+        CPPUNIT_ASSERT( nvm.write(0x100, data, 4) );
+        CPPUNIT_ASSERT( nvm.getRewrites() == 1 );
+        CPPUNIT_ASSERT( nvm.getTime() == model.readTime(0, 4096) + model.eraseTime(0, 4096) + model.writeTime(0, 4096) );
+
+        // data is stored like in EEPROM
+        uint8_t dataR[4];
+        CPPUNIT_ASSERT( nvm.read(0x100, dataR, 4) );
+        CPPUNIT_ASSERT( memcmp(data, dataR, 4) == 0 );
+
+        // crossing sector boundary
+        nvm.resetTime();
+        CPPUNIT_ASSERT( nvm.write(0x1000 - 2, clear, 3) );
+        CPPUNIT_ASSERT( nvm.write(0x1000 - 2, data, 4) );
+        CPPUNIT_ASSERT( nvm.getRewrites() == 1 );
+        CPPUNIT_ASSERT( nvm.getTime() == model.writeTime(0x1000 - 2, 3)
+                                         + 2 * (model.readTime(0, 4096) + model.eraseTime(0, 4096) + model.writeTime(0, 4096)) );
+    }
+
+    void test_slotNVM_00() {
+        SlotNVM<SimulatedNVM<256, LinearLatencyModel, &LinearLatencyModel::avrEEPROM>, 16> nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint64_t beginTime = nvm.getTime();
+        CPPUNIT_ASSERT( beginTime == 16 * 500 );    // one read per cluster
+
+        nvm.resetTime();
+        uint8_t data[4] = { 1, 2, 3, 4 };
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, 4) );
+        // 4 header bytes + 4 data bytes + end byte, every byte 3.3 ms
+        CPPUNIT_ASSERT( nvm.getTime() >= 9 * 3300000ull );
+        CPPUNIT_ASSERT( nvm.getTime() < 10 * 3300000ull );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SimulatedNVMTest );
@@ -0,0 +1,313 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SlotNVMAppendTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SlotNVMAppendTest );
+
+CPPUNIT_TEST( test_append_00 );
+CPPUNIT_TEST( test_append_01 );
+CPPUNIT_TEST( test_append_02 );
+CPPUNIT_TEST( test_append_03 );
+CPPUNIT_TEST( test_cost_00 );
+CPPUNIT_TEST( test_rewrite_00 );
+CPPUNIT_TEST( test_formats_00 );
+CPPUNIT_TEST( test_noAppend_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, false, false, false, true> NVM_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 32, 0, 0, (uint8_t (*)(uint8_t, uint8_t))NULL, int, &rand,
+                    false, false, false, true>                                                  NoCRC_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8>                                     NoAppend_t;
+
+    static void fill(uint8_t *data, nvm_size_t len, uint8_t seed) {
+        for (nvm_size_t i = 0; i < len; ++i) {
+            data[i] = seed + i * 7;
+        }
+    }
+
+    template <class T>
+    static bool check(const T &nvm, uint8_t slot, const std::vector<uint8_t> &expected) {
+        if (expected.empty()) return !nvm.isSlotAvailable(slot);
+        uint8_t buf[256];
+        nvm_size_t len = sizeof(buf);
+        if (!nvm.readSlot(slot, buf, len)) return false;
+        return (len == expected.size()) && (memcmp(buf, expected.data(), len) == 0);
+    }
+
+    template <class T>
+    static unsigned countUsedClusters(const T &nvm) {
+        unsigned cnt = 0;
+        for (uint16_t cluster = 0; cluster < T::S_CLUSTER_CNT; ++cluster) {
+            if (nvm.isClusterBitSet(cluster)) ++cnt;
+        }
+        return cnt;
+    }
+
+    template <class T>
+    static unsigned countSlotClusters(const T &nvm) {
+        unsigned cnt = 0;
+        for (auto info : nvm.slots()) {
+            cnt += info.clusterCnt;
+        }
+        return cnt;
+    }
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_append_00() {
+        // small appends to a new slot fill up the start cluster and then one cluster after the other
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        std::vector<uint8_t> expected;
+        uint8_t data[3];
+        for (uint8_t i = 0; i < 40; ++i) {
+            fill(data, sizeof(data), i);
+            CPPUNIT_ASSERT( nvm.appendSlot(1, data, sizeof(data)) );
+            expected.insert(expected.end(), data, data + sizeof(data));
+            CPPUNIT_ASSERT( check(nvm, 1, expected) );
+            CPPUNIT_ASSERT( countUsedClusters(nvm) == countSlotClusters(nvm) );
+        }
+
+        // only the last cluster of every run is partially used
+        CPPUNIT_ASSERT( countUsedClusters(nvm) <= (expected.size() + NVM_t::S_USER_DATA_PER_CLUSTER - 1) / NVM_t::S_USER_DATA_PER_CLUSTER + 2 );
+
+        NVM_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( check(restarted, 1, expected) );
+        CPPUNIT_ASSERT( countUsedClusters(restarted) == countUsedClusters(nvm) );
+    }
+
+    void test_append_01() {
+        // appends of different sizes to several slots, also to slots written by writeSlot()
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        std::vector<uint8_t> expected[4];
+        uint8_t data[40];
+        for (uint8_t slot = 1; slot <= 2; ++slot) {
+            fill(data, 25, slot);
+            CPPUNIT_ASSERT( nvm.writeSlot(slot, data, 25) );
+            expected[slot].assign(data, data + 25);
+        }
+        for (uint16_t i = 0; i < 60; ++i) {
+            uint8_t slot = 1 + i % 3;
+            nvm_size_t len = 1 + (i * 7) % sizeof(data);
+            fill(data, len, i);
+            if (expected[slot].size() + len > 120) {
+                CPPUNIT_ASSERT( nvm.writeSlot(slot, data, len) );
+                expected[slot].assign(data, data + len);
+            } else {
+                CPPUNIT_ASSERT( nvm.appendSlot(slot, data, len) );
+                expected[slot].insert(expected[slot].end(), data, data + len);
+            }
+            for (uint8_t s = 1; s <= 3; ++s) {
+                CPPUNIT_ASSERT( check(nvm, s, expected[s]) );
+            }
+            CPPUNIT_ASSERT( countUsedClusters(nvm) == countSlotClusters(nvm) );
+
+            if (i % 10 == 9) {
+                NVM_t restarted;
+                restarted.m_memory = nvm.m_memory;
+                CPPUNIT_ASSERT( restarted.begin() );
+                CPPUNIT_ASSERT( restarted.getStats().repairs == 0 );
+                for (uint8_t s = 1; s <= 3; ++s) {
+                    CPPUNIT_ASSERT( check(restarted, s, expected[s]) );
+                }
+            }
+        }
+
+        // readSlots() and erase of appended slots
+        uint8_t buf1[256], buf2[256];
+        uint8_t slots[2] = { 1, 2 };
+        uint8_t *bufs[2] = { buf1, buf2 };
+        nvm_size_t lens[2] = { sizeof(buf1), sizeof(buf2) };
+        CPPUNIT_ASSERT( nvm.readSlots(2, slots, bufs, lens) );
+        CPPUNIT_ASSERT( (lens[1] == expected[2].size()) && (memcmp(buf2, expected[2].data(), lens[1]) == 0) );
+        nvm_size_t free = nvm.getFree();
+        CPPUNIT_ASSERT( nvm.eraseSlot(1) );
+        CPPUNIT_ASSERT( !nvm.isSlotAvailable(1) );
+        CPPUNIT_ASSERT( nvm.getFree() > free );
+        CPPUNIT_ASSERT( countUsedClusters(nvm) == countSlotClusters(nvm) );
+    }
+
+    void test_append_02() {
+        // a not available slot is written, a slot never exceeds 256 bytes
+        NoCRC_t nvm;
+        uint8_t data[200];
+        fill(data, sizeof(data), 1);
+        CPPUNIT_ASSERT( !nvm.appendSlot(1, data, 10) );
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( !nvm.appendSlot(0, data, 10) );
+        CPPUNIT_ASSERT( !nvm.appendSlot(1, data, 0) );
+        CPPUNIT_ASSERT( !nvm.appendSlot(1, NULL, 10) );
+        CPPUNIT_ASSERT( nvm.appendSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( check(nvm, 1, std::vector<uint8_t>(data, data + sizeof(data))) );
+        CPPUNIT_ASSERT( !nvm.appendSlot(1, data, 57) );
+        CPPUNIT_ASSERT( nvm.appendSlot(1, data, 56) );
+        std::vector<uint8_t> expected(data, data + sizeof(data));
+        expected.insert(expected.end(), data, data + 56);
+        CPPUNIT_ASSERT( check(nvm, 1, expected) );
+
+        NoCRC_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( check(restarted, 1, expected) );
+    }
+
+    void test_append_03() {
+        // appends until the NVM is full, the replaced clusters are freed after the append
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[250];
+        fill(data, sizeof(data), 3);
+        for (uint8_t slot = 1; nvm.getFree() >= sizeof(data); ++slot) {
+            CPPUNIT_ASSERT( nvm.writeSlot(slot, data, sizeof(data)) );
+        }
+        uint8_t slot = 20;
+        std::vector<uint8_t> expected;
+        while (nvm.appendSlot(slot, data, 1)) {
+            expected.push_back(data[0]);
+        }
+        CPPUNIT_ASSERT( nvm.getFree() < 2 * NVM_t::S_USER_DATA_PER_CLUSTER );   // like writeSlot() without provision
+        CPPUNIT_ASSERT( check(nvm, slot, expected) );
+        CPPUNIT_ASSERT( countUsedClusters(nvm) == countSlotClusters(nvm) );
+    }
+
+    void test_cost_00() {
+        // an append writes the start cluster and the new data, not the whole slot
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[245];
+        fill(data, sizeof(data), 5);
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, 200) );
+
+        nvm.resetStats();
+        CPPUNIT_ASSERT( nvm.appendSlot(1, data, 20) );
+        CPPUNIT_ASSERT( nvm.getStats().clustersAllocated == 3 );   // start and 2 new
+        CPPUNIT_ASSERT( nvm.getStats().clustersFreed == 1 );
+        CPPUNIT_ASSERT( nvm.getStats().bytesWritten < 3 * 16 + 8 );
+
+        nvm.resetStats();
+        CPPUNIT_ASSERT( nvm.appendSlot(1, data, 5) );
+        CPPUNIT_ASSERT( nvm.getStats().clustersAllocated == 2 );   // start and a partially used one
+        CPPUNIT_ASSERT( nvm.getStats().clustersFreed == 1 );
+
+        nvm.resetStats();
+        CPPUNIT_ASSERT( nvm.appendSlot(1, data, 13) );
+        CPPUNIT_ASSERT( nvm.getStats().clustersAllocated == 3 );   // start, 1 full and 1 partially used
+        CPPUNIT_ASSERT( nvm.getStats().clustersFreed == 2 );       // old start and the replaced one
+
+        nvm.resetStats();
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvm.getStats().clustersAllocated == 25 );
+    }
+
+    void test_rewrite_00() {
+        // writeSlot() replaces an appended slot by a normal chain
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[60];
+        fill(data, sizeof(data), 7);
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, 30) );
+        CPPUNIT_ASSERT( nvm.appendSlot(1, data, 30) );
+        CPPUNIT_ASSERT( nvm.appendSlot(1, data, 30) );
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( check(nvm, 1, std::vector<uint8_t>(data, data + sizeof(data))) );
+        CPPUNIT_ASSERT( countUsedClusters(nvm) == 6 );
+
+        NVM_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( check(restarted, 1, std::vector<uint8_t>(data, data + sizeof(data))) );
+        CPPUNIT_ASSERT( countUsedClusters(restarted) == 6 );
+    }
+
+    void test_formats_00() {
+        // ECC, compressed slots and extents are rewritten as whole
+        SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, true> ecc;
+        SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, false, true> compress;
+        SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, false, false, true> extents;
+        CPPUNIT_ASSERT( ecc.begin() );
+        CPPUNIT_ASSERT( compress.begin() );
+        CPPUNIT_ASSERT( extents.begin() );
+
+        uint8_t data[40];
+        memset(data, 'a', sizeof(data));                            // compressible
+        std::vector<uint8_t> expected(data, data + sizeof(data));
+        expected.insert(expected.end(), data, data + sizeof(data));
+        CPPUNIT_ASSERT( ecc.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( ecc.appendSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( check(ecc, 1, expected) );
+        CPPUNIT_ASSERT( compress.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( compress.appendSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( check(compress, 1, expected) );
+        CPPUNIT_ASSERT( extents.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( extents.appendSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( check(extents, 1, expected) );
+        uint8_t blocks = 0;
+        for (uint16_t cluster = 0; cluster < extents.S_CLUSTER_CNT; ++cluster) {
+            if (extents.isExtentBlock(cluster)) ++blocks;
+        }
+        CPPUNIT_ASSERT( blocks == 5 );                              // 80 bytes in one extent
+    }
+
+    void test_noAppend_00() {
+        // without APPEND the slot is rewritten as whole in the chain layout known by every SlotNVM
+        NoAppend_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[100];
+        fill(data, sizeof(data), 3);
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, 30) );
+        CPPUNIT_ASSERT( nvm.appendSlot(1, data + 30, 30) );
+        CPPUNIT_ASSERT( nvm.appendSlot(1, data + 60, 40) );
+        CPPUNIT_ASSERT( nvm.appendSlot(2, data, 5) );              // not available
+        CPPUNIT_ASSERT( check(nvm, 1, std::vector<uint8_t>(data, data + sizeof(data))) );
+        CPPUNIT_ASSERT( check(nvm, 2, std::vector<uint8_t>(data, data + 5)) );
+        uint8_t startCluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, startCluster) );
+        CPPUNIT_ASSERT( (nvm.m_memory[startCluster * 16 + 1] & NoAppend_t::S_APPENDED_FLAG) == 0 );
+        CPPUNIT_ASSERT( countUsedClusters(nvm) == 10 + 1 );        // 10 byte per cluster and slot 2
+
+        NVM_t appending;
+        appending.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( appending.begin() );
+        CPPUNIT_ASSERT( check(appending, 1, std::vector<uint8_t>(data, data + sizeof(data))) );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SlotNVMAppendTest );
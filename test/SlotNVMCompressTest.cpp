@@ -0,0 +1,229 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "SlotNVMCompress.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+static const char S_CONFIG[] = "{\"ssid\":\"office\",\"dhcp\":true,\"ip\":\"0.0.0.0\",\"mask\":\"0.0.0.0\","
+                               "\"gw\":\"0.0.0.0\",\"dns\":\"0.0.0.0\",\"ntp\":\"pool.ntp.org\",\"tz\":\"CET\"}";
+
+class SlotNVMCompressTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SlotNVMCompressTest );
+
+CPPUNIT_TEST( test_compress_00 );
+CPPUNIT_TEST( test_compress_01 );
+CPPUNIT_TEST( test_decompress_00 );
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_access_01 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_ecc_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testXorCRC, int, &rand, false, true>     NVM_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testXorCRC>                               Plain_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 32, 0, 0, &testXorCRC, int, &rand, true, true>      ECC_t;
+
+    // compress and decompress
+    static bool roundTrip(const uint8_t *data, nvm_size_t len, nvm_size_t &packedLen) {
+        uint8_t packed[256];
+        packedLen = SlotNVMCompress::compress(data, len, packed, len - 1);
+        if (packedLen == 0) return true;
+        uint8_t buf[256];
+        if (!SlotNVMCompress::decompress(packed, packedLen, buf, len)) return false;
+        return memcmp(buf, data, len) == 0;
+    }
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_compress_00() {
+        nvm_size_t packedLen;
+        CPPUNIT_ASSERT( roundTrip((const uint8_t *)S_CONFIG, sizeof(S_CONFIG), packedLen) );
+        CPPUNIT_ASSERT( packedLen > 0 );
+        CPPUNIT_ASSERT( packedLen < sizeof(S_CONFIG) * 3 / 4 );
+
+        uint8_t data[256];
+        memset(data, 0x55, sizeof(data));
+        CPPUNIT_ASSERT( roundTrip(data, sizeof(data), packedLen) );
+        CPPUNIT_ASSERT( packedLen == 6 );               // literal, 2 max. matches
+
+        // random data can not be compressed
+        srand(11);
+        for (uint16_t i = 0; i < sizeof(data); ++i) {
+            data[i] = rand();
+        }
+        CPPUNIT_ASSERT( roundTrip(data, sizeof(data), packedLen) );
+        CPPUNIT_ASSERT( packedLen == 0 );
+    }
+
+    void test_compress_01() {
+        // all lengths with data of different entropy
+        uint8_t data[256];
+        srand(5);
+        for (uint8_t symbols = 2; symbols <= 32; symbols *= 2) {
+            for (uint16_t len = 1; len <= 256; ++len) {
+                for (uint16_t i = 0; i < len; ++i) {
+                    data[i] = 'a' + rand() % symbols;
+                }
+                nvm_size_t packedLen;
+                CPPUNIT_ASSERT( roundTrip(data, len, packedLen) );
+                CPPUNIT_ASSERT( packedLen < len );
+            }
+        }
+    }
+
+    void test_decompress_00() {
+        uint8_t buf[16];
+        const uint8_t literals[] = {0x02, 'a', 'b', 'c'};
+        CPPUNIT_ASSERT( SlotNVMCompress::decompress(literals, sizeof(literals), buf, 3) );
+        CPPUNIT_ASSERT( memcmp(buf, "abc", 3) == 0 );
+        CPPUNIT_ASSERT( !SlotNVMCompress::decompress(literals, sizeof(literals), buf, 4) );     // too short
+        CPPUNIT_ASSERT( !SlotNVMCompress::decompress(literals, sizeof(literals), buf, 2) );     // too long
+        CPPUNIT_ASSERT( !SlotNVMCompress::decompress(literals, 3, buf, 3) );                   // stream truncated
+
+        const uint8_t match[] = {0x00, 'x', 0x82, 0x00};
+        CPPUNIT_ASSERT( SlotNVMCompress::decompress(match, sizeof(match), buf, 6) );
+        CPPUNIT_ASSERT( memcmp(buf, "xxxxxx", 6) == 0 );
+        const uint8_t badDist[] = {0x00, 'x', 0x80, 0x01};
+        CPPUNIT_ASSERT( !SlotNVMCompress::decompress(badDist, sizeof(badDist), buf, 4) );
+        CPPUNIT_ASSERT( !SlotNVMCompress::decompress(match, 3, buf, 6) );
+    }
+
+    void test_access_00() {
+        NVM_t nvm;
+        Plain_t plain;
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( plain.begin() );
+        CPPUNIT_ASSERT( nvm.writeSlot(1, (const uint8_t *)S_CONFIG, sizeof(S_CONFIG)) );
+        CPPUNIT_ASSERT( plain.writeSlot(1, (const uint8_t *)S_CONFIG, sizeof(S_CONFIG)) );
+
+        // fewer clusters are used and written
+        CPPUNIT_ASSERT( nvm.getFree() >= plain.getFree() + 3 * NVM_t::S_USER_DATA_PER_CLUSTER );
+        CPPUNIT_ASSERT( nvm.getStats().bytesWritten < plain.getStats().bytesWritten );
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, cluster) );
+        CPPUNIT_ASSERT( (nvm.m_memory[cluster * 16 + 1] & NVM_t::S_COMPRESSED_FLAG) != 0 );
+
+        // size query returns the uncompressed size
+        nvm_size_t len = 0;
+        CPPUNIT_ASSERT( !nvm.readSlot(1, NULL, len) );
+        CPPUNIT_ASSERT( len == sizeof(S_CONFIG) );
+        char buf[sizeof(S_CONFIG)];
+        len = sizeof(buf) - 1;
+        CPPUNIT_ASSERT( !nvm.readSlot(1, (uint8_t *)buf, len) );
+        CPPUNIT_ASSERT( len == sizeof(S_CONFIG) );
+        CPPUNIT_ASSERT( nvm.readSlot(1, (uint8_t *)buf, len) );
+        CPPUNIT_ASSERT( strcmp(buf, S_CONFIG) == 0 );
+
+        for (const NVM_t::SlotInfo &info : nvm.slots()) {
+            CPPUNIT_ASSERT( info.slot == 1 );
+            CPPUNIT_ASSERT( info.len == sizeof(S_CONFIG) );
+            CPPUNIT_ASSERT( info.clusterCnt < (sizeof(S_CONFIG) - 1) / NVM_t::S_USER_DATA_PER_CLUSTER + 1 );
+        }
+    }
+
+    void test_access_01() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+
+        // incompressible data is stored as it is
+        uint8_t data[40];
+        srand(3);
+        for (uint8_t i = 0; i < sizeof(data); ++i) {
+            data[i] = rand();
+        }
+        CPPUNIT_ASSERT( nvm.writeSlot(2, data, sizeof(data)) );
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(2, cluster) );
+        CPPUNIT_ASSERT( (nvm.m_memory[cluster * 16 + 1] & NVM_t::S_COMPRESSED_FLAG) == 0 );
+        uint8_t buf[40];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm.readSlot(2, buf, len) );
+        CPPUNIT_ASSERT( memcmp(buf, data, sizeof(data)) == 0 );
+
+        uint32_t value = 0;
+        CPPUNIT_ASSERT( nvm.writeSlot(3, value) );
+        uint32_t valueR = 1;
+        CPPUNIT_ASSERT( nvm.readSlot(3, valueR) );
+        CPPUNIT_ASSERT( valueR == 0 );
+
+        // rewrite a compressed slot with uncompressed data and back
+        memset(data, 0x00, sizeof(data));
+        CPPUNIT_ASSERT( nvm.writeSlot(2, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvm.findStartCluser(2, cluster) );
+        CPPUNIT_ASSERT( (nvm.m_memory[cluster * 16 + 1] & NVM_t::S_COMPRESSED_FLAG) != 0 );
+        len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm.readSlot(2, buf, len) );
+        CPPUNIT_ASSERT( memcmp(buf, data, sizeof(data)) == 0 );
+    }
+
+    void test_begin_00() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        for (uint8_t slot = 1; slot <= 5; ++slot) {
+            CPPUNIT_ASSERT( nvm.writeSlot(slot, (const uint8_t *)S_CONFIG, sizeof(S_CONFIG) - slot) );
+        }
+
+        NVM_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( restarted.getStats().repairs == 0 );
+        for (uint8_t slot = 1; slot <= 5; ++slot) {
+            uint8_t buf[sizeof(S_CONFIG)];
+            nvm_size_t len = sizeof(buf);
+            CPPUNIT_ASSERT( restarted.readSlot(slot, buf, len) );
+            CPPUNIT_ASSERT( len == sizeof(S_CONFIG) - slot );
+            CPPUNIT_ASSERT( memcmp(buf, S_CONFIG, len) == 0 );
+        }
+    }
+
+    void test_ecc_00() {
+        ECC_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( nvm.writeSlot(1, (const uint8_t *)S_CONFIG, sizeof(S_CONFIG)) );
+
+        // bit error in the flags of the start cluster is corrected
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, cluster) );
+        nvm.m_memory[cluster * 32 + 1] ^= ECC_t::S_COMPRESSED_FLAG;
+        char buf[sizeof(S_CONFIG)];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm.readSlot(1, (uint8_t *)buf, len) );
+        CPPUNIT_ASSERT( len == sizeof(S_CONFIG) );
+        CPPUNIT_ASSERT( strcmp(buf, S_CONFIG) == 0 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SlotNVMCompressTest );
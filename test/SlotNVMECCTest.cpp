@@ -0,0 +1,275 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "SlotNVMECC.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+static int eccRandom() {
+    return 1;
+}
+
+// bitwise reference of the code calculated by SlotNVMECC::update() and SlotNVMECC::finish()
+static uint16_t naiveECC(const uint8_t *data, uint8_t cnt) {
+    uint16_t syndrome = 0;
+    bool parity = false;
+    for (uint16_t i = 0; i < cnt; ++i) {
+        for (uint8_t j = 0; j < 8; ++j) {
+            if ((data[i] & (1 << j)) == 0) continue;
+            syndrome ^= 16 * (i + 1) + 8 + j;
+            parity = !parity;
+        }
+    }
+    for (uint8_t j = 0; j < 12; ++j) {
+        if ((syndrome & (1 << j)) != 0) parity = !parity;
+    }
+    return syndrome | (parity ? 0x1000 : 0);
+}
+
+class SlotNVMECCTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SlotNVMECCTest );
+
+CPPUNIT_TEST( test_code_00 );
+CPPUNIT_TEST( test_code_01 );
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_begin_01 );
+CPPUNIT_TEST( test_read_00 );
+CPPUNIT_TEST( test_read_01 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<512>, 32, 0, 0, &testXorCRC, int, &eccRandom, true>             ECC_t;
+    typedef SlotNVM<NVMRAMMock<512>, 16, 0, 0, (uint8_t(*)(uint8_t,uint8_t))NULL, int, &eccRandom, true> ECCNoCRC_t;
+
+    static uint16_t code(const uint8_t *data, uint8_t cnt) {
+        uint16_t c = 0;
+        for (uint8_t i = 0; i < cnt; ++i) {
+            c = SlotNVMECC::update(c, i, data[i]);
+        }
+        return c;
+    }
+
+    // write a slot, flip bits and read it by a restarted instance
+    template <class NVM>
+    bool flipAndRestart(const uint8_t data[], nvm_size_t len, const uint16_t bits[], uint8_t cnt,
+                        uint8_t *buf, nvm_size_t &bufLen, SlotNVMStats &stats) {
+        NVM nvm;
+        if (!nvm.begin()) return false;
+        if (!nvm.writeSlot(1, data, len)) return false;
+        uint8_t cluster;
+        if (!nvm.findStartCluser(1, cluster)) return false;
+        for (uint8_t i = 0; i < cnt; ++i) {
+            nvm.m_memory[cluster * (nvm.m_memory.size() / NVM::S_CLUSTER_CNT) + bits[i] / 8] ^= 1 << (bits[i] % 8);
+        }
+
+        NVM restarted;
+        restarted.m_memory = nvm.m_memory;
+        if (!restarted.begin()) return false;
+        bool res = restarted.readSlot(1, buf, bufLen);
+        stats = restarted.getStats();
+        return res;
+    }
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_code_00() {
+        uint8_t data[SlotNVMECC::S_MAX_BYTES];
+        srand(7);
+        for (uint16_t cnt = 1; cnt <= SlotNVMECC::S_MAX_BYTES; cnt += 9) {
+            for (uint16_t i = 0; i < cnt; ++i) {
+                data[i] = rand();
+            }
+            CPPUNIT_ASSERT( SlotNVMECC::finish(code(data, cnt)) == naiveECC(data, cnt) );
+        }
+        memset(data, 0xFF, sizeof(data));
+        CPPUNIT_ASSERT( SlotNVMECC::finish(code(data, sizeof(data))) == naiveECC(data, sizeof(data)) );
+    }
+
+    void test_code_01() {
+        uint8_t data[30];
+        for (uint8_t i = 0; i < sizeof(data); ++i) {
+            data[i] = i * 37 + 5;
+        }
+        uint16_t stored = SlotNVMECC::finish(code(data, sizeof(data)));
+        uint8_t index = 0, mask = 0;
+        CPPUNIT_ASSERT( SlotNVMECC::check(code(data, sizeof(data)), stored, sizeof(data), index, mask) == SlotNVMECC::OK );
+
+        // every single bit error in the data is found
+        for (uint16_t bit = 0; bit < sizeof(data) * 8; ++bit) {
+            data[bit / 8] ^= 1 << (bit % 8);
+            CPPUNIT_ASSERT( SlotNVMECC::check(code(data, sizeof(data)), stored, sizeof(data), index, mask) == SlotNVMECC::CORRECTED );
+            CPPUNIT_ASSERT( index == bit / 8 );
+            CPPUNIT_ASSERT( mask == (1 << (bit % 8)) );
+            data[bit / 8] ^= 1 << (bit % 8);
+        }
+
+        // every single bit error in the code is found
+        for (uint8_t bit = 0; bit < 13; ++bit) {
+            CPPUNIT_ASSERT( SlotNVMECC::check(code(data, sizeof(data)), stored ^ (1 << bit), sizeof(data), index, mask) == SlotNVMECC::CORRECTED );
+            CPPUNIT_ASSERT( mask == 0 );
+        }
+
+        // every double bit error is detected
+        for (uint16_t bit1 = 0; bit1 < sizeof(data) * 8 + 13; ++bit1) {
+            for (uint16_t bit2 = bit1 + 1; bit2 < sizeof(data) * 8 + 13; ++bit2) {
+                uint16_t s = stored;
+                uint8_t d[sizeof(data)];
+                memcpy(d, data, sizeof(data));
+                if (bit1 < sizeof(data) * 8) d[bit1 / 8] ^= 1 << (bit1 % 8); else s ^= 1 << (bit1 - sizeof(data) * 8);
+                if (bit2 < sizeof(data) * 8) d[bit2 / 8] ^= 1 << (bit2 % 8); else s ^= 1 << (bit2 - sizeof(data) * 8);
+                CPPUNIT_ASSERT( SlotNVMECC::check(code(d, sizeof(d)), s, sizeof(d), index, mask) == SlotNVMECC::UNCORRECTABLE );
+            }
+        }
+    }
+
+    void test_access_00() {
+        CPPUNIT_ASSERT( ECC_t::S_USER_DATA_PER_CLUSTER == 24 );
+        CPPUNIT_ASSERT( ECC_t::S_END_BYTE == 0xA3 );
+        CPPUNIT_ASSERT( ECCNoCRC_t::S_USER_DATA_PER_CLUSTER == 9 );
+        CPPUNIT_ASSERT( ECCNoCRC_t::S_END_BYTE == 0xA2 );
+
+        ECC_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[60];
+        for (uint8_t i = 0; i < sizeof(data); ++i) {
+            data[i] = i;
+        }
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+        uint8_t buf[60];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm.readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( len == sizeof(data) );
+        CPPUNIT_ASSERT( memcmp(buf, data, len) == 0 );
+
+        // size query
+        len = 0;
+        CPPUNIT_ASSERT( !nvm.readSlot(1, NULL, len) );
+        CPPUNIT_ASSERT( len == sizeof(data) );
+
+        // the stored code matches the reference, unused data is padded with 0
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, cluster) );
+        uint8_t last = nvm.m_memory[nvm.m_memory[cluster * 32 + 2] * 32 + 2];
+        CPPUNIT_ASSERT( (nvm.m_memory[last * 32 + 1] & ECC_t::S_LAST_CLUSTER_FLAG) != 0 );
+        const uint8_t *c = &nvm.m_memory[last * 32];
+        uint8_t prot[ECC_t::S_ECC_CNT];
+        memcpy(prot, c, ECC_t::S_ECC_OFFSET);
+        prot[ECC_t::S_ECC_OFFSET] = c[30];
+        CPPUNIT_ASSERT( (c[ECC_t::S_ECC_OFFSET] | (c[ECC_t::S_ECC_OFFSET + 1] << 8)) == naiveECC(prot, sizeof(prot)) );
+        CPPUNIT_ASSERT( c[4 + 12] == 0 );
+        CPPUNIT_ASSERT( c[4 + 23] == 0 );
+    }
+
+    void test_begin_00() {
+        uint8_t data[20];
+        for (uint8_t i = 0; i < sizeof(data); ++i) {
+            data[i] = 0xA5 ^ i;
+        }
+
+        // single bit error in each bit of the cluster, except end byte and a slot number of 0
+        for (uint16_t bit = 0; bit < 31 * 8; ++bit) {
+            if (bit == 0) continue;
+            uint8_t buf[20];
+            nvm_size_t len = sizeof(buf);
+            SlotNVMStats stats;
+            CPPUNIT_ASSERT( flipAndRestart<ECC_t>(data, sizeof(data), &bit, 1, buf, len, stats) );
+            CPPUNIT_ASSERT( len == sizeof(data) );
+            CPPUNIT_ASSERT( memcmp(buf, data, len) == 0 );
+            CPPUNIT_ASSERT( stats.eccCorrected == 1 );
+            CPPUNIT_ASSERT( stats.crcErrors == 0 );
+        }
+    }
+
+    void test_begin_01() {
+        uint8_t data[9];
+        memset(data, 0x3C, sizeof(data));
+        for (uint16_t bit = 1; bit < 15 * 8; ++bit) {
+            uint8_t buf[9];
+            nvm_size_t len = sizeof(buf);
+            SlotNVMStats stats;
+            CPPUNIT_ASSERT( flipAndRestart<ECCNoCRC_t>(data, sizeof(data), &bit, 1, buf, len, stats) );
+            CPPUNIT_ASSERT( memcmp(buf, data, sizeof(data)) == 0 );
+            CPPUNIT_ASSERT( stats.eccCorrected == 1 );
+        }
+
+        // double bit errors are detected, the cluster is dropped
+        uint16_t bits[2] = {4 * 8 + 1, 6 * 8 + 7};
+        uint8_t buf[9];
+        nvm_size_t len = sizeof(buf);
+        SlotNVMStats stats;
+        CPPUNIT_ASSERT( !flipAndRestart<ECCNoCRC_t>(data, sizeof(data), bits, 2, buf, len, stats) );
+        CPPUNIT_ASSERT( stats.eccErrors == 1 );
+    }
+
+    void test_read_00() {
+        ECC_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[50];
+        memset(data, 0x5A, sizeof(data));
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+
+        // bit flip after begin, corrected while reading, but not written back
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, cluster) );
+        uint8_t next = nvm.m_memory[cluster * 32 + 2];
+        nvm.m_memory[next * 32 + 10] ^= 0x10;
+        nvm.resetStats();
+        uint8_t buf[50];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm.readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( memcmp(buf, data, sizeof(data)) == 0 );
+        CPPUNIT_ASSERT( nvm.getStats().eccCorrected == 1 );
+        CPPUNIT_ASSERT( nvm.m_memory[next * 32 + 10] == (0x5A ^ 0x10) );
+    }
+
+    void test_read_01() {
+        ECC_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[50];
+        memset(data, 0x5A, sizeof(data));
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, cluster) );
+        nvm.m_memory[cluster * 32 + 10] ^= 0x11;
+        nvm.resetStats();
+        uint8_t buf[50];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( !nvm.readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( nvm.getStats().eccErrors == 1 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SlotNVMECCTest );
@@ -0,0 +1,276 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SlotNVMExtentTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SlotNVMExtentTest );
+
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_access_01 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_begin_01 );
+CPPUNIT_TEST( test_fragmented_00 );
+CPPUNIT_TEST( test_erase_00 );
+CPPUNIT_TEST( test_compress_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, false, false, true>   NVM_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8>                                     Plain_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, false, true, true>    Compress_t;
+
+    static void fill(uint8_t *data, nvm_size_t len, uint8_t seed) {
+        for (nvm_size_t i = 0; i < len; ++i) {
+            data[i] = seed + i * 7;
+        }
+    }
+
+    static unsigned countExtentBlocks(const NVM_t &nvm) {
+        unsigned cnt = 0;
+        for (uint16_t cluster = 0; cluster < NVM_t::S_CLUSTER_CNT; ++cluster) {
+            if (nvm.isExtentBlock(cluster)) ++cnt;
+        }
+        return cnt;
+    }
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_access_00() {
+        NVM_t nvm;
+        Plain_t plain;
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( plain.begin() );
+        uint8_t data[100];
+        fill(data, sizeof(data), 1);
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( plain.writeSlot(1, data, sizeof(data)) );
+
+        // one header cluster and 6 raw blocks instead of 10 clusters
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, cluster) );
+        CPPUNIT_ASSERT( NVM_t::isExtent(nvm.m_memory[cluster * 16 + 1]) );
+        CPPUNIT_ASSERT( nvm.m_memory[cluster * 16 + 2] == 6 );
+        CPPUNIT_ASSERT( countExtentBlocks(nvm) == 6 );
+        CPPUNIT_ASSERT( nvm.getStats().clustersAllocated == 7 );
+        CPPUNIT_ASSERT( plain.getStats().clustersAllocated == 10 );
+        CPPUNIT_ASSERT( nvm.getWriteCnt() < plain.getWriteCnt() );
+        for (const NVM_t::SlotInfo &info : nvm.slots()) {
+            CPPUNIT_ASSERT( info.slot == 1 );
+            CPPUNIT_ASSERT( info.len == sizeof(data) );
+            CPPUNIT_ASSERT( info.clusterCnt == 7 );
+        }
+
+        // read needs fewer NVM calls
+        nvm.resetStats();
+        plain.resetStats();
+        uint8_t buf[100];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm.readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( len == sizeof(data) );
+        CPPUNIT_ASSERT( memcmp(buf, data, sizeof(data)) == 0 );
+        len = sizeof(buf);
+        CPPUNIT_ASSERT( plain.readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( nvm.getStats().reads < plain.getStats().reads );
+
+        // too small buffer returns the size
+        len = 10;
+        CPPUNIT_ASSERT( !nvm.readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( len == sizeof(data) );
+    }
+
+    void test_access_01() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+
+        // a slot fitting in one cluster is never an extent
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( nvm.writeSlot(2, value) );
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(2, cluster) );
+        CPPUNIT_ASSERT( !NVM_t::isExtent(nvm.m_memory[cluster * 16 + 1]) );
+        CPPUNIT_ASSERT( countExtentBlocks(nvm) == 0 );
+
+        // all lengths, the raw blocks are full or not
+        uint8_t data[256];
+        uint8_t buf[256];
+        for (uint16_t l = 1; l <= 256; l += 5) {
+            fill(data, l, l);
+            CPPUNIT_ASSERT( nvm.writeSlot(3, data, l) );
+            nvm_size_t len = sizeof(buf);
+            CPPUNIT_ASSERT( nvm.readSlot(3, buf, len) );
+            CPPUNIT_ASSERT( len == l );
+            CPPUNIT_ASSERT( memcmp(buf, data, l) == 0 );
+        }
+        uint32_t valueR = 0;
+        CPPUNIT_ASSERT( nvm.readSlot(2, valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+    }
+
+    void test_begin_00() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[120];
+        for (uint8_t slot = 1; slot <= 5; ++slot) {
+            fill(data, sizeof(data), slot);
+            CPPUNIT_ASSERT( nvm.writeSlot(slot, data, slot * 20) );
+        }
+
+        NVM_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( restarted.getStats().repairs == 0 );
+        CPPUNIT_ASSERT( memcmp(restarted.m_usedCluster, nvm.m_usedCluster, sizeof(nvm.m_usedCluster)) == 0 );
+        CPPUNIT_ASSERT( memcmp(restarted.m_extentBlock, nvm.m_extentBlock, sizeof(nvm.m_extentBlock)) == 0 );
+        for (uint8_t slot = 1; slot <= 5; ++slot) {
+            uint8_t buf[120];
+            nvm_size_t len = sizeof(buf);
+            fill(data, sizeof(data), slot);
+            CPPUNIT_ASSERT( restarted.readSlot(slot, buf, len) );
+            CPPUNIT_ASSERT( len == slot * 20 );
+            CPPUNIT_ASSERT( memcmp(buf, data, len) == 0 );
+        }
+    }
+
+    void test_begin_01() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[60];
+        fill(data, sizeof(data), 9);
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+
+        // a bit error in a raw block invalidates the whole extent
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, cluster) );
+        nvm.m_memory[(cluster + 2) * 16 + 3] ^= 0x01;
+        NVM_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( !restarted.isSlotAvailable(1) );
+        CPPUNIT_ASSERT( restarted.getStats().crcErrors >= 1 );
+        CPPUNIT_ASSERT( countExtentBlocks(restarted) == 0 );
+    }
+
+    void test_fragmented_00() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+
+        // every second cluster is used, no run of free clusters is left
+        for (uint8_t slot = 1; slot <= NVM_t::S_CLUSTER_CNT / 2; ++slot) {
+            CPPUNIT_ASSERT( nvm.writeSlot(slot, slot) );
+        }
+        for (uint8_t slot = 1; slot <= NVM_t::S_CLUSTER_CNT / 2; ++slot) {
+            uint8_t cluster;
+            CPPUNIT_ASSERT( nvm.findStartCluser(slot, cluster) );
+            if ((cluster % 2) == 0) continue;
+            CPPUNIT_ASSERT( nvm.eraseSlot(slot) );
+        }
+        for (uint16_t cluster = 0; cluster < NVM_t::S_CLUSTER_CNT; cluster += 2) {
+            if (nvm.isClusterBitSet(cluster)) continue;
+            nvm.setClusterBit(cluster);             // stands for a cluster of another slot
+        }
+        for (uint16_t cluster = 1; cluster < NVM_t::S_CLUSTER_CNT; cluster += 2) {
+            CPPUNIT_ASSERT( !nvm.isClusterBitSet(cluster) );
+        }
+
+        // written as chain
+        uint8_t data[40];
+        fill(data, sizeof(data), 3);
+        CPPUNIT_ASSERT( nvm.writeSlot(60, data, sizeof(data)) );
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(60, cluster) );
+        CPPUNIT_ASSERT( !NVM_t::isExtent(nvm.m_memory[cluster * 16 + 1]) );
+        CPPUNIT_ASSERT( countExtentBlocks(nvm) == 0 );
+        uint8_t buf[40];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm.readSlot(60, buf, len) );
+        CPPUNIT_ASSERT( memcmp(buf, data, sizeof(data)) == 0 );
+    }
+
+    void test_erase_00() {
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        nvm_size_t free = nvm.getFree();
+        uint8_t data[100];
+        fill(data, sizeof(data), 5);
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvm.getFree() == free - 7 * NVM_t::S_USER_DATA_PER_CLUSTER );
+
+        // overwrite frees the old extent
+        fill(data, sizeof(data), 6);
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvm.getFree() == free - 7 * NVM_t::S_USER_DATA_PER_CLUSTER );
+        CPPUNIT_ASSERT( countExtentBlocks(nvm) == 6 );
+
+        // shorter data as chain of one cluster
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, 8) );
+        CPPUNIT_ASSERT( countExtentBlocks(nvm) == 0 );
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+
+        CPPUNIT_ASSERT( nvm.eraseSlot(1) );
+        CPPUNIT_ASSERT( nvm.getFree() == free );
+        CPPUNIT_ASSERT( countExtentBlocks(nvm) == 0 );
+
+        // freed raw blocks are not found as clusters after restart
+        NVM_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( restarted.getFree() == free );
+        CPPUNIT_ASSERT( !restarted.isSlotAvailable(1) );
+    }
+
+    void test_compress_00() {
+        Compress_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        char text[200];
+        for (uint8_t i = 0; i < sizeof(text); ++i) {
+            text[i] = "extent"[i % 6] + (i / 50);
+        }
+        CPPUNIT_ASSERT( nvm.writeSlot(7, text) );
+        uint8_t cluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(7, cluster) );
+        CPPUNIT_ASSERT( (nvm.m_memory[cluster * 16 + 1] & Compress_t::S_COMPRESSED_FLAG) != 0 );
+        CPPUNIT_ASSERT( Compress_t::isExtent(nvm.m_memory[cluster * 16 + 1]) );
+
+        Compress_t restarted;
+        restarted.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        char buf[200];
+        CPPUNIT_ASSERT( restarted.readSlot(7, buf) );
+        CPPUNIT_ASSERT( memcmp(buf, text, sizeof(text)) == 0 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SlotNVMExtentTest );
@@ -0,0 +1,223 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SlotNVMRangeTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SlotNVMRangeTest );
+
+CPPUNIT_TEST( test_range_00 );
+CPPUNIT_TEST( test_range_01 );
+CPPUNIT_TEST( test_append_00 );
+CPPUNIT_TEST( test_formats_00 );
+CPPUNIT_TEST( test_cost_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8>                                      NVM_t;
+    typedef SlotNVM<NVMRAMMock<2048>, 32>                                                       NoCRC_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, true>                   ECC_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, false, true>            Compress_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, false, false, true>     Extent_t;
+    typedef SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &testCRC8, int, &rand, false, false, false, true> Append_t;
+
+    static void fill(uint8_t *data, nvm_size_t len, uint8_t seed) {
+        for (nvm_size_t i = 0; i < len; ++i) {
+            data[i] = seed + i * 7;
+        }
+    }
+
+    // every range of the slot is read like by readSlot()
+    template <class T>
+    static bool checkRanges(const T &nvm, uint8_t slot) {
+        uint8_t all[256];
+        nvm_size_t slotLen = sizeof(all);
+        if (!nvm.readSlot(slot, all, slotLen)) return false;
+        for (nvm_size_t offset = 0; offset < slotLen; ++offset) {
+            for (nvm_size_t len = 1; offset + len <= slotLen; len += (len < 20) ? 1 : 13) {
+                uint8_t buf[256];
+                memset(buf, 0xAA, sizeof(buf));
+                if (!nvm.readSlotRange(slot, offset, buf, len)) return false;
+                if (memcmp(buf, all + offset, len) != 0) return false;
+                if (buf[len] != 0xAA) return false;
+            }
+        }
+        uint8_t buf[256];
+        return !nvm.readSlotRange(slot, slotLen, buf, 1) && !nvm.readSlotRange(slot, 0, buf, slotLen + 1);
+    }
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_range_00() {
+        NVM_t nvm;
+        uint8_t data[256];
+        fill(data, sizeof(data), 3);
+        uint8_t buf[4];
+        CPPUNIT_ASSERT( !nvm.readSlotRange(1, 0, buf, 1) );     // begin() not called
+        CPPUNIT_ASSERT( nvm.begin() );
+        CPPUNIT_ASSERT( !nvm.readSlotRange(1, 0, buf, 1) );     // not available
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, 1) );
+        CPPUNIT_ASSERT( nvm.writeSlot(2, data, 10) );           // one full cluster
+        CPPUNIT_ASSERT( nvm.writeSlot(3, data, 11) );
+        CPPUNIT_ASSERT( nvm.writeSlot(4, data, 256) );
+        CPPUNIT_ASSERT( !nvm.readSlotRange(1, 0, NULL, 1) );
+        CPPUNIT_ASSERT( !nvm.readSlotRange(1, 0, buf, 0) );
+        for (uint8_t slot = 1; slot <= 4; ++slot) {
+            CPPUNIT_ASSERT( checkRanges(nvm, slot) );
+        }
+
+        // a struct member
+        struct Cfg {
+            uint8_t     name[200];
+            uint32_t    value;
+        } cfg;
+        memset(cfg.name, 'x', sizeof(cfg.name));
+        cfg.value = 0xDEADBEEF;
+        CPPUNIT_ASSERT( nvm.writeSlot(5, cfg) );
+        uint32_t value = 0;
+        CPPUNIT_ASSERT( nvm.readSlotRange(5, offsetof(Cfg, value), value) );
+        CPPUNIT_ASSERT( value == 0xDEADBEEF );
+        CPPUNIT_ASSERT( !nvm.readSlotRange(5, sizeof(Cfg) - 3, value) );
+    }
+
+    void test_range_01() {
+        // different cluster sizes and a fragmented NVM
+        NoCRC_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[256];
+        for (uint8_t slot = 1; slot <= 10; ++slot) {
+            fill(data, sizeof(data), slot);
+            CPPUNIT_ASSERT( nvm.writeSlot(slot, data, 20 * slot) );
+        }
+        for (uint8_t slot = 1; slot <= 10; slot += 2) {
+            CPPUNIT_ASSERT( nvm.eraseSlot(slot) );
+        }
+        fill(data, sizeof(data), 99);
+        CPPUNIT_ASSERT( nvm.writeSlot(20, data, 256) );
+        CPPUNIT_ASSERT( checkRanges(nvm, 20) );
+        CPPUNIT_ASSERT( checkRanges(nvm, 4) );
+    }
+
+    void test_append_00() {
+        // appended runs are stored newest first
+        Append_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[256];
+        fill(data, sizeof(data), 1);
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, 7) );
+        const nvm_size_t appends[] = { 1, 3, 12, 2, 25, 9, 10, 1, 40, 5 };
+        nvm_size_t pos = 7;
+        for (nvm_size_t len : appends) {
+            CPPUNIT_ASSERT( nvm.appendSlot(1, data + pos, len) );
+            pos += len;
+            CPPUNIT_ASSERT( checkRanges(nvm, 1) );
+        }
+        uint8_t startCluster;
+        CPPUNIT_ASSERT( nvm.findStartCluser(1, startCluster) );
+        CPPUNIT_ASSERT( nvm.m_memory[startCluster * 16 + 1] & Append_t::S_APPENDED_FLAG );
+        uint8_t buf[256];
+        CPPUNIT_ASSERT( nvm.readSlotRange(1, 0, buf, pos) );
+        CPPUNIT_ASSERT( memcmp(buf, data, pos) == 0 );
+
+        // only the runs up to the requested range are visited
+        nvm.resetStats();
+        CPPUNIT_ASSERT( nvm.readSlotRange(1, pos - 5, buf, 5) );
+        uint32_t tailReads = nvm.getStats().reads;
+        nvm.resetStats();
+        CPPUNIT_ASSERT( nvm.readSlotRange(1, 10, buf, 5) );
+        CPPUNIT_ASSERT( tailReads < nvm.getStats().reads );
+    }
+
+    void test_formats_00() {
+        uint8_t data[256];
+        fill(data, sizeof(data), 5);
+
+        ECC_t ecc;
+        CPPUNIT_ASSERT( ecc.begin() );
+        CPPUNIT_ASSERT( ecc.writeSlot(1, data, 100) );
+        CPPUNIT_ASSERT( checkRanges(ecc, 1) );
+        ecc.m_memory[ecc.m_memory.size() / 2] ^= 0x04;           // corrected while reading
+        CPPUNIT_ASSERT( checkRanges(ecc, 1) );
+
+        Compress_t compress;
+        CPPUNIT_ASSERT( compress.begin() );
+        uint8_t packable[200];
+        memset(packable, 'a', sizeof(packable));
+        memcpy(packable + 50, data, 30);
+        CPPUNIT_ASSERT( compress.writeSlot(1, packable, sizeof(packable)) );
+        CPPUNIT_ASSERT( compress.writeSlot(2, data, 100) );     // not compressible
+        uint8_t startCluster;
+        CPPUNIT_ASSERT( compress.findStartCluser(1, startCluster) );
+        CPPUNIT_ASSERT( compress.m_memory[startCluster * 16 + 1] & Compress_t::S_COMPRESSED_FLAG );
+        CPPUNIT_ASSERT( checkRanges(compress, 1) );
+        CPPUNIT_ASSERT( checkRanges(compress, 2) );
+
+        Extent_t extent;
+        CPPUNIT_ASSERT( extent.begin() );
+        CPPUNIT_ASSERT( extent.writeSlot(1, data, 200) );
+        CPPUNIT_ASSERT( extent.writeSlot(2, data, 5) );
+        CPPUNIT_ASSERT( extent.findStartCluser(1, startCluster) );
+        CPPUNIT_ASSERT( Extent_t::isExtent(extent.m_memory[startCluster * 16 + 1]) );
+        CPPUNIT_ASSERT( checkRanges(extent, 1) );
+        CPPUNIT_ASSERT( checkRanges(extent, 2) );
+    }
+
+    void test_cost_00() {
+        // 4 bytes at offset 200 of a 256 byte slot, S_USER_DATA_PER_CLUSTER is 27
+        NoCRC_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        uint8_t data[256];
+        fill(data, sizeof(data), 7);
+        CPPUNIT_ASSERT( nvm.writeSlot(1, data, sizeof(data)) );
+
+        nvm.resetStats();
+        uint8_t buf[256];
+        CPPUNIT_ASSERT( nvm.readSlotRange(1, 0, buf, 1) );
+        SlotNVMStats first = nvm.getStats();
+
+        nvm.resetStats();
+        CPPUNIT_ASSERT( nvm.readSlotRange(1, 200, buf, 4) );
+        CPPUNIT_ASSERT( memcmp(buf, data + 200, 4) == 0 );
+        CPPUNIT_ASSERT( nvm.getStats().reads == first.reads + 6 );            // next link of cluster 2 to 7
+        CPPUNIT_ASSERT( nvm.getStats().bytesRead == first.bytesRead + 6 + 3 );
+
+        nvm.resetStats();
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm.readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( nvm.getStats().bytesRead > first.bytesRead + 250 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SlotNVMRangeTest );
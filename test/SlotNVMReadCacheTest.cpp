@@ -0,0 +1,206 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "SlotNVMReadCache.h"
+#include "NVMRAMMock.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SlotNVMReadCacheTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SlotNVMReadCacheTest );
+
+CPPUNIT_TEST( test_read_00 );
+CPPUNIT_TEST( test_invalidate_00 );
+CPPUNIT_TEST( test_lru_00 );
+CPPUNIT_TEST( test_lru_01 );
+CPPUNIT_TEST( test_lru_02 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<1024>, 32>   NVM_t;
+    typedef SlotNVMReadCache<NVM_t, 16, 3>  Cache_t;
+    NVM_t   *nvm;
+    Cache_t *cache;
+
+    void writeTestData(uint8_t slot, nvm_size_t len) {
+        uint8_t data[64];
+        for (nvm_size_t i = 0; i < len; ++i) {
+            data[i] = slot + i;
+        }
+        bool ret = nvm->writeSlot(slot, data, len);
+        CPPUNIT_ASSERT( ret );
+    }
+
+    bool checkRead(uint8_t slot, nvm_size_t expLen) {
+        uint8_t data[64] = { 0 };
+        nvm_size_t len = sizeof(data);
+        if (!cache->readSlot(slot, data, len)) return false;
+        if (len != expLen) return false;
+        for (nvm_size_t i = 0; i < len; ++i) {
+            if (data[i] != (uint8_t)(slot + i)) return false;
+        }
+        return true;
+    }
+
+public:
+    void setUp() {
+        nvm = new NVM_t;
+        nvm->begin();
+        cache = new Cache_t(*nvm);
+    }
+
+    void tearDown()  {
+        delete cache;
+        delete nvm;
+    }
+
+    void test_read_00() {
+        writeTestData(1, 4);
+
+        CPPUNIT_ASSERT( checkRead(1, 4) );
+        CPPUNIT_ASSERT( cache->getMisses() == 1 );
+        CPPUNIT_ASSERT( cache->getHits() == 0 );
+
+        // data is served from cache, even if NVM is changed behind the cache
+        nvm->eraseSlot(1);
+        CPPUNIT_ASSERT( checkRead(1, 4) );
+        CPPUNIT_ASSERT( cache->getMisses() == 1 );
+        CPPUNIT_ASSERT( cache->getHits() == 1 );
+
+        // size query
+        nvm_size_t len = 0;
+        bool ret = cache->readSlot(1, NULL, len);
+        CPPUNIT_ASSERT( !ret );
+        CPPUNIT_ASSERT( len == 4 );
+
+        // to big for cache
+        writeTestData(2, 20);
+        CPPUNIT_ASSERT( checkRead(2, 20) );
+        CPPUNIT_ASSERT( checkRead(2, 20) );
+        CPPUNIT_ASSERT( cache->getMisses() == 3 );
+
+        // not available
+        CPPUNIT_ASSERT( !checkRead(3, 1) );
+
+        cache->resetCounters();
+        CPPUNIT_ASSERT( cache->getMisses() == 0 );
+        CPPUNIT_ASSERT( cache->getHits() == 0 );
+    }
+
+    void test_invalidate_00() {
+        uint16_t value = 0x1234;
+        bool ret = cache->writeSlot(1, value);
+        CPPUNIT_ASSERT( ret );
+        uint16_t valueR = 0;
+        ret = cache->readSlot(1, valueR);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( valueR == value );
+
+        value = 0x5678;
+        ret = cache->writeSlot(1, value);
+        CPPUNIT_ASSERT( ret );
+        ret = cache->readSlot(1, valueR);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( valueR == value );
+
+        ret = cache->eraseSlot(1);
+        CPPUNIT_ASSERT( ret );
+        ret = cache->readSlot(1, valueR);
+        CPPUNIT_ASSERT( !ret );
+    }
+
+    void test_lru_00() {
+        // entry table full
+        writeTestData(1, 2);
+        writeTestData(2, 2);
+        writeTestData(3, 2);
+        writeTestData(4, 2);
+        CPPUNIT_ASSERT( checkRead(1, 2) );
+        CPPUNIT_ASSERT( checkRead(2, 2) );
+        CPPUNIT_ASSERT( checkRead(3, 2) );
+        CPPUNIT_ASSERT( checkRead(1, 2) );  // now slot 2 is the least recently used
+        CPPUNIT_ASSERT( checkRead(4, 2) );
+        CPPUNIT_ASSERT( cache->getMisses() == 4 );
+
+        CPPUNIT_ASSERT( checkRead(1, 2) );
+        CPPUNIT_ASSERT( checkRead(3, 2) );
+        CPPUNIT_ASSERT( checkRead(4, 2) );
+        CPPUNIT_ASSERT( cache->getMisses() == 4 );
+        CPPUNIT_ASSERT( checkRead(2, 2) );
+        CPPUNIT_ASSERT( cache->getMisses() == 5 );
+    }
+
+    void test_lru_01() {
+        // arena full, needs compaction
+        writeTestData(1, 6);
+        writeTestData(2, 4);
+        writeTestData(3, 6);
+        writeTestData(4, 8);
+        CPPUNIT_ASSERT( checkRead(1, 6) );
+        CPPUNIT_ASSERT( checkRead(2, 4) );
+        CPPUNIT_ASSERT( checkRead(3, 6) );
+        CPPUNIT_ASSERT( checkRead(3, 6) );
+        CPPUNIT_ASSERT( checkRead(2, 4) );
+        // 16 bytes used, slot 1 and 3 must be evicted
+        CPPUNIT_ASSERT( checkRead(4, 8) );
+        CPPUNIT_ASSERT( cache->getMisses() == 4 );
+        CPPUNIT_ASSERT( checkRead(2, 4) );
+        CPPUNIT_ASSERT( checkRead(4, 8) );
+        CPPUNIT_ASSERT( cache->getMisses() == 4 );
+
+        // slot 2 is evicted, slot 4 is moved to make room at the end
+        CPPUNIT_ASSERT( checkRead(3, 6) );
+        CPPUNIT_ASSERT( cache->getMisses() == 5 );
+        CPPUNIT_ASSERT( checkRead(3, 6) );
+        CPPUNIT_ASSERT( checkRead(4, 8) );
+        CPPUNIT_ASSERT( cache->getMisses() == 5 );
+    }
+
+    void test_lru_02() {
+        // slot 1 stays least recently used, also after 256 reads of other slots
+        writeTestData(1, 2);
+        writeTestData(2, 2);
+        writeTestData(3, 2);
+        writeTestData(4, 2);
+        CPPUNIT_ASSERT( checkRead(1, 2) );
+        for (uint16_t i = 0; i < 256; ++i) {
+            CPPUNIT_ASSERT( checkRead(2 + i % 2, 2) );
+        }
+        CPPUNIT_ASSERT( cache->getMisses() == 3 );
+        CPPUNIT_ASSERT( checkRead(4, 2) );
+        CPPUNIT_ASSERT( cache->getMisses() == 4 );
+
+        CPPUNIT_ASSERT( checkRead(2, 2) );
+        CPPUNIT_ASSERT( checkRead(3, 2) );
+        CPPUNIT_ASSERT( checkRead(4, 2) );
+        CPPUNIT_ASSERT( cache->getMisses() == 4 );
+        CPPUNIT_ASSERT( checkRead(1, 2) );
+        CPPUNIT_ASSERT( cache->getMisses() == 5 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SlotNVMReadCacheTest );
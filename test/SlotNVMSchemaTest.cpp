@@ -0,0 +1,216 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "PackedSlotNVM.h"
+#include "SlotNVMSchema.h"
+#include "NVMRAMMock.h"
+#include "TestCRC.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+// first firmware
+struct ConfigV1 {
+    uint8_t     mode;
+    uint32_t    baud;
+    char        name[6];
+};
+
+typedef SlotNVMSchema<ConfigV1, 1,
+                      SLOTNVM_FIELD(ConfigV1, mode, 1),
+                      SLOTNVM_FIELD(ConfigV1, baud, 1),
+                      SLOTNVM_FIELD(ConfigV1, name, 1)> ConfigV1Schema;
+
+// next firmware adds timeout
+struct ConfigV2 {
+    uint8_t     mode;
+    uint32_t    baud;
+    char        name[6];
+    uint16_t    timeout;
+};
+
+typedef SlotNVMSchema<ConfigV2, 2,
+                      SLOTNVM_FIELD(ConfigV2, mode, 1),
+                      SLOTNVM_FIELD(ConfigV2, baud, 1),
+                      SLOTNVM_FIELD(ConfigV2, name, 1),
+                      SLOTNVM_FIELD(ConfigV2, timeout, 2)> ConfigV2Schema;
+
+// and the next one removes baud and adds retries
+struct ConfigV3 {
+    uint8_t     mode;
+    char        name[6];
+    uint16_t    timeout;
+    uint8_t     retries;
+};
+
+typedef SlotNVMSchema<ConfigV3, 3,
+                      SLOTNVM_FIELD(ConfigV3, mode, 1),
+                      SlotNVMRemovedField<sizeof(uint32_t), 1, 3>,
+                      SLOTNVM_FIELD(ConfigV3, name, 1),
+                      SLOTNVM_FIELD(ConfigV3, timeout, 2),
+                      SLOTNVM_FIELD(ConfigV3, retries, 3)> ConfigV3Schema;
+
+class SlotNVMSchemaTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SlotNVMSchemaTest );
+
+CPPUNIT_TEST( test_encode_00 );
+CPPUNIT_TEST( test_decode_00 );
+CPPUNIT_TEST( test_slot_00 );
+CPPUNIT_TEST( test_slot_01 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<1024>, 32, 0, 0, &testCRC8>  NVM_t;
+
+public:
+    void setUp() {
+    }
+
+    void tearDown()  {
+    }
+
+    void test_encode_00() {
+        // no padding bytes
+        CPPUNIT_ASSERT( sizeof(ConfigV1) == 16 );
+        CPPUNIT_ASSERT( ConfigV1Schema::S_SIZE == 1 + 1 + 4 + 6 );
+        CPPUNIT_ASSERT( ConfigV2Schema::S_SIZE == 1 + 1 + 4 + 6 + 2 );
+        CPPUNIT_ASSERT( ConfigV3Schema::S_SIZE == 1 + 1 + 6 + 2 + 1 );
+        CPPUNIT_ASSERT( ConfigV3Schema::S_MAX_SIZE == 1 + 1 + 4 + 6 + 2 + 1 );
+        CPPUNIT_ASSERT( ConfigV3Schema::getSize(1) == ConfigV1Schema::S_SIZE );
+        CPPUNIT_ASSERT( ConfigV3Schema::getSize(2) == ConfigV2Schema::S_SIZE );
+        CPPUNIT_ASSERT( ConfigV3Schema::getSize(0) == 0 );
+        CPPUNIT_ASSERT( ConfigV3Schema::getSize(4) == 0 );
+
+        ConfigV1 cfg = { 3, 0x11223344, "abcde" };
+        uint8_t buf[ConfigV1Schema::S_SIZE];
+        CPPUNIT_ASSERT( ConfigV1Schema::encode(cfg, buf) == sizeof(buf) );
+        CPPUNIT_ASSERT( buf[0] == 1 );
+        CPPUNIT_ASSERT( buf[1] == 3 );
+        uint32_t baud;
+        memcpy(&baud, buf + 2, sizeof(baud));
+        CPPUNIT_ASSERT( baud == 0x11223344 );
+        CPPUNIT_ASSERT( memcmp(buf + 6, "abcde", 6) == 0 );
+
+        ConfigV3 cfg3 = { 1, "xyz", 500, 7 };
+        uint8_t buf3[ConfigV3Schema::S_SIZE];
+        CPPUNIT_ASSERT( ConfigV3Schema::encode(cfg3, buf3) == sizeof(buf3) );
+        CPPUNIT_ASSERT( (buf3[0] == 3) && (buf3[1] == 1) && (memcmp(buf3 + 2, "xyz", 4) == 0) && (buf3[10] == 7) );
+    }
+
+    void test_decode_00() {
+        ConfigV1 cfg = { 3, 115200, "abcde" };
+        uint8_t buf[ConfigV3Schema::S_MAX_SIZE];
+        nvm_size_t len = ConfigV1Schema::encode(cfg, buf);
+
+        // older version, new fields keep their default
+        ConfigV2 cfg2 = { 0, 0, "", 1000 };
+        uint8_t version = 0;
+        CPPUNIT_ASSERT( ConfigV2Schema::decode(cfg2, buf, len, &version) );
+        CPPUNIT_ASSERT( version == 1 );
+        CPPUNIT_ASSERT( (cfg2.mode == 3) && (cfg2.baud == 115200) && (strcmp(cfg2.name, "abcde") == 0) );
+        CPPUNIT_ASSERT( cfg2.timeout == 1000 );
+
+        // removed field is skipped
+        cfg2.timeout = 250;
+        len = ConfigV2Schema::encode(cfg2, buf);
+        ConfigV3 cfg3 = { 0, "", 0, 5 };
+        CPPUNIT_ASSERT( ConfigV3Schema::decode(cfg3, buf, len, &version) );
+        CPPUNIT_ASSERT( version == 2 );
+        CPPUNIT_ASSERT( (cfg3.mode == 3) && (strcmp(cfg3.name, "abcde") == 0) && (cfg3.timeout == 250) );
+        CPPUNIT_ASSERT( cfg3.retries == 5 );
+
+        // newer version, wrong length or no data is rejected and nothing changed
+        len = ConfigV3Schema::encode(cfg3, buf);
+        ConfigV2 untouched = { 9, 9, "9", 9 };
+        CPPUNIT_ASSERT( !ConfigV2Schema::decode(untouched, buf, len) );
+        len = ConfigV2Schema::encode(cfg2, buf);
+        CPPUNIT_ASSERT( !ConfigV2Schema::decode(untouched, buf, len - 1) );
+        CPPUNIT_ASSERT( !ConfigV2Schema::decode(untouched, buf, len + 1) );
+        CPPUNIT_ASSERT( !ConfigV2Schema::decode(untouched, buf, 0) );
+        CPPUNIT_ASSERT( !ConfigV2Schema::decode(untouched, NULL, len) );
+        buf[0] = 0;
+        CPPUNIT_ASSERT( !ConfigV2Schema::decode(untouched, buf, 1) );
+        CPPUNIT_ASSERT( (untouched.mode == 9) && (untouched.baud == 9) && (untouched.timeout == 9) );
+    }
+
+    void test_slot_00() {
+        // firmware update without rewriting stored data
+        NVM_t nvm;
+        CPPUNIT_ASSERT( nvm.begin() );
+        ConfigV1 cfg = { 2, 9600, "uart" };
+        CPPUNIT_ASSERT( ConfigV1Schema::writeSlot(nvm, 5, cfg) );
+        nvm_size_t len = 0;
+        nvm.readSlot(5, NULL, len);
+        CPPUNIT_ASSERT( len == ConfigV1Schema::S_SIZE );
+
+        NVM_t nvmR;
+        nvmR.m_memory = nvm.m_memory;
+        CPPUNIT_ASSERT( nvmR.begin() );
+        nvmR.resetStats();
+        ConfigV3 cfg3 = { 0, "", 100, 3 };
+        uint8_t version = 0;
+        CPPUNIT_ASSERT( ConfigV3Schema::readSlot(nvmR, 5, cfg3, &version) );
+        CPPUNIT_ASSERT( version == 1 );
+        CPPUNIT_ASSERT( (cfg3.mode == 2) && (strcmp(cfg3.name, "uart") == 0) );
+        CPPUNIT_ASSERT( (cfg3.timeout == 100) && (cfg3.retries == 3) );
+        CPPUNIT_ASSERT( nvmR.getStats().writes == 0 );
+
+        // the next write uses the current version
+        cfg3.retries = 4;
+        CPPUNIT_ASSERT( ConfigV3Schema::writeSlot(nvmR, 5, cfg3) );
+        ConfigV3 cfgR = { 0, "", 0, 0 };
+        CPPUNIT_ASSERT( ConfigV3Schema::readSlot(nvmR, 5, cfgR, &version) );
+        CPPUNIT_ASSERT( version == 3 );
+        CPPUNIT_ASSERT( (cfgR.mode == 2) && (strcmp(cfgR.name, "uart") == 0) );
+        CPPUNIT_ASSERT( (cfgR.timeout == 100) && (cfgR.retries == 4) );
+
+        // older firmware can not read it
+        ConfigV1 cfg1 = { 0, 0, "" };
+        CPPUNIT_ASSERT( !ConfigV1Schema::readSlot(nvmR, 5, cfg1) );
+        CPPUNIT_ASSERT( !ConfigV1Schema::readSlot(nvmR, 6, cfg1) );
+
+        // memcpy based readSlot() does not fit
+        CPPUNIT_ASSERT( !nvmR.readSlot(5, cfgR) );
+    }
+
+    void test_slot_01() {
+        // other classes with readSlot() and writeSlot()
+        NVM_t nvm;
+        PackedSlotNVM<NVM_t, 1, 2> packed(nvm);
+        CPPUNIT_ASSERT( packed.begin() );
+        ConfigV2 cfg = { 1, 57600, "spi", 20 };
+        CPPUNIT_ASSERT( ConfigV2Schema::writeSlot(packed, 100, cfg) );
+        ConfigV2 cfgR = { 0, 0, "", 0 };
+        CPPUNIT_ASSERT( ConfigV2Schema::readSlot(packed, 100, cfgR) );
+        CPPUNIT_ASSERT( (cfgR.mode == 1) && (cfgR.baud == 57600) && (strcmp(cfgR.name, "spi") == 0) && (cfgR.timeout == 20) );
+
+        const NVM_t &constNVM = nvm;
+        CPPUNIT_ASSERT( ConfigV2Schema::writeSlot(nvm, 10, cfg) );
+        CPPUNIT_ASSERT( ConfigV2Schema::readSlot(constNVM, 10, cfgR) );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SlotNVMSchemaTest );
@@ -37,6 +37,11 @@ static uint8_t dummyCRCbuf(const uint8_t *data, nvm_size_t len) {
     for (; len > 0; --len,++data) {
         crc = dummyCRC(crc, *data);
     }
+    return crc;
+}
+
+static int fixedRandom() {
+    return 3;
 }
 
 
@@ -54,11 +59,14 @@ CPPUNIT_TEST( test_begin_07 );
 CPPUNIT_TEST( test_begin_08 );
 CPPUNIT_TEST( test_begin_09 );
 CPPUNIT_TEST( test_begin_10 );
+CPPUNIT_TEST( test_begin_11 );
 
 CPPUNIT_TEST( test_readSlot_01 );
 CPPUNIT_TEST( test_readSlot_02 );
 CPPUNIT_TEST( test_readSlot_03 );
 
+CPPUNIT_TEST( test_readSlots_00 );
+
 CPPUNIT_TEST( test_writeSlot_00 );
 CPPUNIT_TEST( test_writeSlot_01 );
 CPPUNIT_TEST( test_writeSlot_02 );
@@ -68,7 +76,10 @@ CPPUNIT_TEST( test_eraseSlot_01 );
 
 CPPUNIT_TEST( test_getFree_00 );
 
+CPPUNIT_TEST( test_slots_00 );
+
 CPPUNIT_TEST( test_nextFreeCluster_00 );
+CPPUNIT_TEST( test_nextFreeCluster_01 );
 
 CPPUNIT_TEST( test_provision_00 );
 
@@ -78,6 +89,10 @@ CPPUNIT_TEST( test_maxSlots_00 );
 
 CPPUNIT_TEST( test_maxCluser_00 );
 
+#ifdef SLOTNVM_STATS
+CPPUNIT_TEST( test_stats_00 );
+#endif
+
 CPPUNIT_TEST_SUITE_END();
 
 private:
@@ -270,6 +285,21 @@ public:
         CPPUNIT_ASSERT( tinyNVM->isSlotAvailable(1) );
     }
 
+    void test_begin_11() {
+        // next cluster behind the last cluster
+        setTinyCluster(0, 1, 2, 4, true, TinyNVM_t::S_CLUSTER_CNT);
+        setTinyCluster(1, 1, 2, 2, false);
+        setTinyCluster(2, 2);                   // other slot not affected
+        bool ret = tinyNVM->begin();
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( tinyNVM->m_memory[0*8 + 0] == 0 );
+        CPPUNIT_ASSERT( tinyNVM->m_memory[1*8 + 0] == 0 );
+        CPPUNIT_ASSERT( tinyNVM->m_memory[2*8 + 0] == 2 );
+        CPPUNIT_ASSERT( tinyNVM->m_usedCluster[0] == 0x04 );
+        CPPUNIT_ASSERT( !tinyNVM->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( tinyNVM->isSlotAvailable(2) );
+    }
+
     void test_readSlot_01() {
         // simple data
         setTinyCluster(0, 1);
@@ -331,6 +361,53 @@ public:
         CPPUNIT_ASSERT( !ret );
     }
 
+    void test_readSlots_00() {
+        setTinyCluster(0, 1, 0, 2, true, -1, 0xA1, 0xA2);
+        setTinyCluster(1, 2, 0, 5, true, 3, 0xB1, 0xB2);
+        setTinyCluster(3, 2, 0, 2, false, 4, 0xB3, 0xB4);
+        setTinyCluster(4, 2, 0, 1, false, -1, 0xB5);
+        setTinyCluster(6, 3, 0, 1, true, -1, 0xC1);
+
+        uint8_t slots[] = { 3, 1, 2 };
+        uint8_t data1[2] = {0};
+        uint8_t data2[5] = {0};
+        uint8_t data3[1] = {0};
+        uint8_t *data[] = { data3, data1, data2 };
+        nvm_size_t size[] = { sizeof(data3), sizeof(data1), sizeof(data2) };
+
+        bool ret = tinyNVM->readSlots(3, slots, data, size);   // called before begin()
+        CPPUNIT_ASSERT( !ret );
+
+        ret = tinyNVM->begin();
+        CPPUNIT_ASSERT( ret );
+
+        ret = tinyNVM->readSlots(3, slots, data, size);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( size[0] == 1 );
+        CPPUNIT_ASSERT( size[1] == 2 );
+        CPPUNIT_ASSERT( size[2] == 5 );
+        CPPUNIT_ASSERT( data3[0] == 0xC1 );
+        CPPUNIT_ASSERT( data1[0] == 0xA1 );
+        CPPUNIT_ASSERT( data1[1] == 0xA2 );
+        CPPUNIT_ASSERT( data2[0] == 0xB1 );
+        CPPUNIT_ASSERT( data2[1] == 0xB2 );
+        CPPUNIT_ASSERT( data2[2] == 0xB3 );
+        CPPUNIT_ASSERT( data2[3] == 0xB4 );
+        CPPUNIT_ASSERT( data2[4] == 0xB5 );
+
+        // unused slot and too small buffer, other slots are still read
+        uint8_t slots2[] = { 4, 2, 1 };
+        uint8_t *data2nd[] = { data3, NULL, data1 };
+        nvm_size_t size2[] = { sizeof(data3), 0, sizeof(data1) };
+        data1[0] = data1[1] = 0;
+        ret = tinyNVM->readSlots(3, slots2, data2nd, size2);
+        CPPUNIT_ASSERT( !ret );
+        CPPUNIT_ASSERT( size2[1] == 5 );
+        CPPUNIT_ASSERT( size2[2] == 2 );
+        CPPUNIT_ASSERT( data1[0] == 0xA1 );
+        CPPUNIT_ASSERT( data1[1] == 0xA2 );
+    }
+
     void test_writeSlot_00() {
         bool ret = tinyNVM->begin();
         CPPUNIT_ASSERT( ret );
@@ -474,6 +551,50 @@ public:
         CPPUNIT_ASSERT( free == total-(8-6) );
     }
 
+    void test_slots_00() {
+        // not initialized => no slots
+        unsigned cnt = 0;
+        for (TinyNVM_t::SlotInfo info : tinyNVM->slots()) {
+            (void)info;
+            ++cnt;
+        }
+        CPPUNIT_ASSERT( cnt == 0 );
+
+        setTinyCluster(1, 2, 1, 5, true, 3);
+        setTinyCluster(3, 2, 1, 2, false, 4);
+        setTinyCluster(4, 2, 1, 1, false);
+        setTinyCluster(6, 7, 3, 1, true);
+        bool ret = tinyNVM->begin();
+        CPPUNIT_ASSERT( ret );
+
+        TinyNVM_t::SlotIterator it = tinyNVM->slots().begin();
+        CPPUNIT_ASSERT( it != tinyNVM->slots().end() );
+        CPPUNIT_ASSERT( it->slot == 2 );
+        CPPUNIT_ASSERT( it->len == 5 );
+        CPPUNIT_ASSERT( it->clusterCnt == 3 );
+        CPPUNIT_ASSERT( it->age == 1 );
+        ++it;
+        CPPUNIT_ASSERT( it != tinyNVM->slots().end() );
+        CPPUNIT_ASSERT( (*it).slot == 7 );
+        CPPUNIT_ASSERT( (*it).len == 1 );
+        CPPUNIT_ASSERT( (*it).clusterCnt == 1 );
+        CPPUNIT_ASSERT( (*it).age == 3 );
+        ++it;
+        CPPUNIT_ASSERT( it == tinyNVM->slots().end() );
+
+        uint8_t data[] = { 0xB1, 0xB2 };
+        ret = tinyNVM->writeSlot(1, data, sizeof(data));
+        CPPUNIT_ASSERT( ret );
+        ret = tinyNVM->eraseSlot(7);
+        CPPUNIT_ASSERT( ret );
+
+        uint8_t slotMask = 0;
+        for (TinyNVM_t::SlotInfo info : tinyNVM->slots()) {
+            slotMask |= 1 << info.slot;
+        }
+        CPPUNIT_ASSERT( slotMask == 0x06 );
+    }
+
     void test_nextFreeCluster_00() {
         uint8_t nextCluster = 0;
         bool ret = tinyNVM->nextFreeCluster(nextCluster);
@@ -520,6 +641,28 @@ public:
         CPPUNIT_ASSERT( nextCluster == 2 );
     }
 
+    void test_nextFreeCluster_01() {
+        // the random start cluster is the only free cluster
+        SlotNVM<NVMRAMMock<64>, 8, 0, 0, &dummyCRC, int, &fixedRandom> nvm;
+        bool ret = nvm.begin();
+        CPPUNIT_ASSERT( ret );
+        uint8_t data = 0x55;
+        for (uint8_t slot = 1; slot <= 8; ++slot) {
+            ret = nvm.writeSlot(slot, &data, 1);
+            CPPUNIT_ASSERT( ret );
+        }
+        uint8_t startCluster;
+        ret = nvm.findStartCluser(1, startCluster);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( startCluster == 3 );
+
+        ret = nvm.eraseSlot(1);
+        CPPUNIT_ASSERT( ret );
+        ret = nvm.writeSlot(1, &data, 1);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( nvm.isClusterBitSet(3) );
+    }
+
     void test_provision_00() {
         // no provision
         bool ret = tinyNVM->begin();
@@ -656,6 +799,47 @@ public:
         ret = maxClusterNVM.writeSlot(100, data, 1);
         CPPUNIT_ASSERT( !ret );
     }
+
+#ifdef SLOTNVM_STATS
+    void test_stats_00() {
+        setTinyCluster(0, 1, 0);            // old
+        setTinyCluster(2, 1, 1);            // new
+        setTinyCluster(3, 2);
+        tinyNVM->m_memory[3*8 + 6]++;       // crash the CRC
+        bool ret = tinyNVM->begin();
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( tinyNVM->getStats().crcErrors == 1 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().repairs == 1 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().reads > 0 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().writes == 1 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().bytesWritten == 1 );
+
+        tinyNVM->resetStats();
+        CPPUNIT_ASSERT( tinyNVM->getStats().reads == 0 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().writes == 0 );
+
+        // overwrite with 2 clusters
+        uint8_t data[] = { 0xC1, 0xC2, 0xC3, 0xC4 };
+        ret = tinyNVM->writeSlot(1, data, sizeof(data));
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( tinyNVM->getStats().clustersAllocated == 2 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().clustersFreed == 1 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().bytesWritten >= 2*8 );
+
+        tinyNVM->resetStats();
+        nvm_size_t len = sizeof(data);
+        ret = tinyNVM->readSlot(1, data, len);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( tinyNVM->getStats().writes == 0 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().bytesWritten == 0 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().reads > 0 );
+        CPPUNIT_ASSERT( tinyNVM->getStats().bytesRead >= sizeof(data) );
+
+        ret = tinyNVM->eraseSlot(1);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( tinyNVM->getStats().clustersFreed == 2 );
+    }
+#endif
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( SlotNVMTest );
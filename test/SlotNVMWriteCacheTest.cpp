@@ -0,0 +1,267 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "SlotNVMWriteCache.h"
+#include "NVMRAMMock.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+static unsigned long fakeTime = 0;
+
+static unsigned long fakeMillis() {
+    return fakeTime;
+}
+
+class SlotNVMWriteCacheTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SlotNVMWriteCacheTest );
+
+CPPUNIT_TEST( test_write_00 );
+CPPUNIT_TEST( test_write_01 );
+CPPUNIT_TEST( test_read_00 );
+CPPUNIT_TEST( test_erase_00 );
+CPPUNIT_TEST( test_evict_00 );
+CPPUNIT_TEST( test_evict_01 );
+CPPUNIT_TEST( test_maxWrites_00 );
+CPPUNIT_TEST( test_poll_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<256>, 16>                    NVM_t;
+    typedef SlotNVMWriteCache<NVM_t, 2, 8>                  Cache_t;
+    typedef SlotNVMWriteCache<NVM_t, 2, 8, unsigned long, &fakeMillis> TimedCache_t;
+    NVM_t   *nvm;
+
+    size_t nvmWrites() const {
+        size_t sum = 0;
+        for (size_t cnt : nvm->m_writeCount) {
+            sum += cnt;
+        }
+        return sum;
+    }
+
+public:
+    void setUp() {
+        nvm = new NVM_t;
+        nvm->begin();
+        fakeTime = 0;
+    }
+
+    void tearDown()  {
+        delete nvm;
+    }
+
+    void test_write_00() {
+        Cache_t cache(*nvm);
+
+        // writes stay in RAM until flush
+        for (uint16_t i = 0; i < 10; ++i) {
+            bool ret = cache.writeSlot(1, i);
+            CPPUNIT_ASSERT( ret );
+        }
+        CPPUNIT_ASSERT( nvmWrites() == 0 );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( cache.isSlotAvailable(1) );
+        CPPUNIT_ASSERT( cache.getSavedBytes() == 9 * sizeof(uint16_t) );
+
+        bool ret = cache.flush();
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( nvmWrites() > 0 );
+
+        uint16_t value = 0;
+        ret = nvm->readSlot(1, value);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( value == 9 );
+
+        // nothing to do for clean entries
+        size_t writes = nvmWrites();
+        ret = cache.flush();
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( nvmWrites() == writes );
+
+        // writing the same data again is not needed
+        ret = cache.writeSlot(1, value);
+        CPPUNIT_ASSERT( ret );
+        ret = cache.onLowVoltage();
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( nvmWrites() == writes );
+    }
+
+    void test_write_01() {
+        Cache_t cache(*nvm);
+        uint8_t data[10] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+        // to big for cache => direct write
+        bool ret = cache.writeSlot(2, data, sizeof(data));
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( nvm->isSlotAvailable(2) );
+
+        // invalid parameter
+        ret = cache.writeSlot(0, data, 2);
+        CPPUNIT_ASSERT( !ret );
+        ret = cache.writeSlot(1, data, 0);
+        CPPUNIT_ASSERT( !ret );
+        ret = cache.writeSlot(1, NULL, 2);
+        CPPUNIT_ASSERT( !ret );
+
+        // not usable before begin()
+        NVM_t nvm2;
+        Cache_t cache2(nvm2);
+        ret = cache2.writeSlot(1, data, 2);
+        CPPUNIT_ASSERT( !ret );
+    }
+
+    void test_read_00() {
+        Cache_t cache(*nvm);
+        uint8_t data[] = { 0xA1, 0xA2, 0xA3 };
+        uint8_t dataR[4] = { 0 };
+        nvm->writeSlot(1, data, 2);
+
+        // miss
+        nvm_size_t len = sizeof(dataR);
+        bool ret = cache.readSlot(1, dataR, len);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( len == 2 );
+        CPPUNIT_ASSERT( cache.getMisses() == 1 );
+        CPPUNIT_ASSERT( cache.getHits() == 0 );
+
+        // hit
+        ret = cache.writeSlot(1, data, 3);
+        CPPUNIT_ASSERT( ret );
+        len = 0;
+        ret = cache.readSlot(1, NULL, len);
+        CPPUNIT_ASSERT( !ret );
+        CPPUNIT_ASSERT( len == 3 );
+        len = sizeof(dataR);
+        ret = cache.readSlot(1, dataR, len);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( len == 3 );
+        CPPUNIT_ASSERT( memcmp(data, dataR, 3) == 0 );
+        CPPUNIT_ASSERT( cache.getHits() == 2 );
+
+        cache.resetCounters();
+        CPPUNIT_ASSERT( cache.getHits() == 0 );
+        CPPUNIT_ASSERT( cache.getMisses() == 0 );
+    }
+
+    void test_erase_00() {
+        Cache_t cache(*nvm);
+        uint8_t data[] = { 0xA1, 0xA2 };
+
+        // only in cache
+        bool ret = cache.writeSlot(1, data, 2);
+        CPPUNIT_ASSERT( ret );
+        ret = cache.eraseSlot(1);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( !cache.isSlotAvailable(1) );
+        ret = cache.flush();
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(1) );
+
+        // in cache and NVM
+        ret = cache.writeSlot(1, data, 2);
+        CPPUNIT_ASSERT( ret );
+        ret = cache.flush();
+        CPPUNIT_ASSERT( ret );
+        ret = cache.eraseSlot(1);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(1) );
+
+        // nowhere
+        ret = cache.eraseSlot(1);
+        CPPUNIT_ASSERT( !ret );
+    }
+
+    void test_evict_00() {
+        Cache_t cache(*nvm);
+        uint8_t a = 1, b = 2, c = 3;
+
+        cache.writeSlot(1, a);
+        cache.writeSlot(2, b);
+        cache.writeSlot(1, a);      // slot 2 is now least recently used
+        CPPUNIT_ASSERT( nvmWrites() == 0 );
+
+        bool ret = cache.writeSlot(3, c);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( nvm->isSlotAvailable(2) );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(3) );
+    }
+
+    void test_evict_01() {
+        // slot 1 stays least recently used, also after 256 accesses to slot 2
+        Cache_t cache(*nvm);
+        uint8_t a = 1, b = 2, c = 3;
+
+        cache.writeSlot(1, a);
+        for (uint16_t i = 0; i < 256; ++i) {
+            cache.writeSlot(2, b);
+        }
+        CPPUNIT_ASSERT( nvmWrites() == 0 );
+
+        bool ret = cache.writeSlot(3, c);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( nvm->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(2) );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(3) );
+    }
+
+    void test_maxWrites_00() {
+        Cache_t cache(*nvm, 3);
+
+        for (uint8_t i = 1; i <= 3; ++i) {
+            CPPUNIT_ASSERT( !nvm->isSlotAvailable(1) );
+            bool ret = cache.writeSlot(1, i);
+            CPPUNIT_ASSERT( ret );
+        }
+        CPPUNIT_ASSERT( nvm->isSlotAvailable(1) );
+        uint8_t value = 0;
+        bool ret = nvm->readSlot(1, value);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( value == 3 );
+    }
+
+    void test_poll_00() {
+        TimedCache_t cache(*nvm, 0, 1000);
+        uint8_t value = 1;
+
+        fakeTime = 500;
+        cache.writeSlot(1, value);
+        fakeTime = 1000;
+        cache.writeSlot(1, ++value);    // dirty since 500
+        fakeTime = 1499;
+        bool ret = cache.poll();
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(1) );
+
+        fakeTime = 1500;
+        ret = cache.poll();
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( nvm->isSlotAvailable(1) );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SlotNVMWriteCacheTest );
@@ -0,0 +1,220 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "SnapshotSlotNVM.h"
+#include "NVMRAMMock.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SnapshotSlotNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( SnapshotSlotNVMTest );
+
+CPPUNIT_TEST( test_access_00 );
+CPPUNIT_TEST( test_begin_00 );
+CPPUNIT_TEST( test_deferred_00 );
+CPPUNIT_TEST( test_threads_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef SlotNVM<NVMRAMMock<1024>, 32>   NVM_t;
+    typedef SnapshotSlotNVM<NVM_t>          Snapshot_t;
+    Snapshot_t  *nvm;
+
+public:
+    void setUp() {
+        nvm = new Snapshot_t;
+    }
+
+    void tearDown()  {
+        delete nvm;
+    }
+
+    void test_access_00() {
+        CPPUNIT_ASSERT( !nvm->isValid() );
+        CPPUNIT_ASSERT( nvm->begin() );
+        CPPUNIT_ASSERT( nvm->isValid() );
+
+        uint32_t value = 0x12345678;
+        CPPUNIT_ASSERT( nvm->writeSlot(1, value) );
+        CPPUNIT_ASSERT( nvm->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(2) );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(0) );
+
+        uint32_t valueR = 0;
+        CPPUNIT_ASSERT( nvm->readSlot(1, valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+        uint16_t wrongSize;
+        CPPUNIT_ASSERT( !nvm->readSlot(1, wrongSize) );
+
+        uint8_t data[4];
+        nvm_size_t len = 2;
+        CPPUNIT_ASSERT( !nvm->readSlot(1, data, len) );
+        CPPUNIT_ASSERT( len == 4 );
+        CPPUNIT_ASSERT( nvm->readSlot(1, data, len) );
+
+        // overwrite frees the old chain
+        nvm_size_t free = nvm->getFree();
+        value = 0x87654321;
+        CPPUNIT_ASSERT( nvm->writeSlot(1, value) );
+        CPPUNIT_ASSERT( nvm->getFree() == free );
+        CPPUNIT_ASSERT( nvm->readSlot(1, valueR) );
+        CPPUNIT_ASSERT( valueR == value );
+
+        unsigned cnt = 0;
+        nvm->forEachSlot([&cnt](const Snapshot_t::SlotInfo &info) {
+            CPPUNIT_ASSERT( info.slot == 1 );
+            CPPUNIT_ASSERT( info.len == 4 );
+            ++cnt;
+        });
+        CPPUNIT_ASSERT( cnt == 1 );
+
+        CPPUNIT_ASSERT( nvm->eraseSlot(1) );
+        CPPUNIT_ASSERT( !nvm->eraseSlot(1) );
+        CPPUNIT_ASSERT( !nvm->isSlotAvailable(1) );
+        CPPUNIT_ASSERT( !nvm->readSlot(1, valueR) );
+        CPPUNIT_ASSERT( nvm->getFree() == nvm->getSize() );
+    }
+
+    void test_begin_00() {
+        CPPUNIT_ASSERT( nvm->begin() );
+        uint8_t data[100];
+        memset(data, 0x55, sizeof(data));
+        CPPUNIT_ASSERT( nvm->writeSlot(3, data, sizeof(data)) );
+        CPPUNIT_ASSERT( nvm->writeSlot(7, data, 10) );
+
+        // index is rebuilt from the NVM content
+        Snapshot_t restarted;
+        restarted.m_memory = nvm->m_memory;
+        CPPUNIT_ASSERT( restarted.begin() );
+        CPPUNIT_ASSERT( restarted.m_startCluster[3] == nvm->m_startCluster[3] );
+        CPPUNIT_ASSERT( restarted.m_startCluster[7] == nvm->m_startCluster[7] );
+        CPPUNIT_ASSERT( !restarted.isSlotAvailable(1) );
+
+        uint8_t buf[100];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( restarted.readSlot(3, buf, len) );
+        CPPUNIT_ASSERT( len == sizeof(data) );
+        CPPUNIT_ASSERT( memcmp(buf, data, len) == 0 );
+    }
+
+    void test_deferred_00() {
+        CPPUNIT_ASSERT( nvm->begin() );
+        uint8_t data[60];
+        memset(data, 0x11, sizeof(data));
+        CPPUNIT_ASSERT( nvm->writeSlot(1, data, sizeof(data)) );
+        int16_t oldStart = nvm->m_startCluster[1];
+
+        std::atomic<bool> done(false);
+        std::thread writer;
+        {
+            // a registered reader keeps the old chain alive
+            Snapshot_t::ReadGuard guard(*nvm);
+            writer = std::thread([&]() {
+                uint8_t newData[60];
+                memset(newData, 0x22, sizeof(newData));
+                nvm->writeSlot(1, newData, sizeof(newData));
+                done = true;
+            });
+            while (nvm->m_startCluster[1] == oldStart) {
+                std::this_thread::yield();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            CPPUNIT_ASSERT( !done );
+            CPPUNIT_ASSERT( nvm->isClusterBitSet(oldStart) );
+
+            uint8_t buf[60];
+            nvm_size_t len = sizeof(buf);
+            CPPUNIT_ASSERT( nvm->readChain(oldStart, buf, len) );
+            CPPUNIT_ASSERT( memcmp(buf, data, sizeof(buf)) == 0 );
+        }
+        writer.join();
+        CPPUNIT_ASSERT( done );
+        CPPUNIT_ASSERT( !nvm->isClusterBitSet(oldStart) );
+
+        uint8_t buf[60];
+        nvm_size_t len = sizeof(buf);
+        CPPUNIT_ASSERT( nvm->readSlot(1, buf, len) );
+        CPPUNIT_ASSERT( buf[0] == 0x22 );
+    }
+
+    void test_threads_00() {
+        CPPUNIT_ASSERT( nvm->begin() );
+
+        // every slot is filled with one value, readers must never see mixed or missing data
+        const uint8_t SLOTS = 4;
+        uint8_t data[40];
+        for (uint8_t slot = 1; slot <= SLOTS; ++slot) {
+            memset(data, slot, sizeof(data));
+            CPPUNIT_ASSERT( nvm->writeSlot(slot, data, sizeof(data)) );
+        }
+
+        std::atomic<bool> stop(false);
+        std::atomic<unsigned> errors(0);
+        std::atomic<unsigned> reads(0);
+        auto reader = [&]() {
+            uint8_t buf[40];
+            while (!stop) {
+                for (uint8_t slot = 1; slot <= SLOTS; ++slot) {
+                    nvm_size_t len = sizeof(buf);
+                    if (!nvm->readSlot(slot, buf, len) || (len != sizeof(buf))) {
+                        ++errors;
+                        continue;
+                    }
+                    for (nvm_size_t i = 1; i < len; ++i) {
+                        if (buf[i] != buf[0]) ++errors;
+                    }
+                    ++reads;
+                }
+            }
+        };
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.push_back(std::thread(reader));
+        }
+        for (unsigned i = 0; i < 500; ++i) {
+            uint8_t slot = 1 + i % SLOTS;
+            memset(data, (uint8_t)(slot + 16 * i), sizeof(data));
+            CPPUNIT_ASSERT( nvm->writeSlot(slot, data, sizeof(data)) );
+            if ((i % 50) == 0) std::this_thread::yield();
+        }
+        stop = true;
+        for (size_t t = 0; t < readers.size(); ++t) {
+            readers[t].join();
+        }
+
+        CPPUNIT_ASSERT( errors == 0 );
+        CPPUNIT_ASSERT( reads > 0 );
+        CPPUNIT_ASSERT( nvm->getFree() == nvm->getSize() - SLOTS * 2 * NVM_t::S_USER_DATA_PER_CLUSTER );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SnapshotSlotNVMTest );
@@ -0,0 +1,27 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _SLOTNVM_TESTCRC_H_
+#define _SLOTNVM_TESTCRC_H_
+
+#include <stdint.h>
+
+/// CRC-8 with polynomial 0x07 as CRC_FUNC, detects all bit errors the tests inject.
+inline uint8_t testCRC8(uint8_t crc, uint8_t data) {
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; ++i) {
+        crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+    }
+    return crc;
+}
+
+/// Cheap XOR checksum as CRC_FUNC for tests that do not depend on the CRC quality.
+inline uint8_t testXorCRC(uint8_t crc, uint8_t data) {
+    return crc ^ data;
+}
+
+#endif // _SLOTNVM_TESTCRC_H_
@@ -0,0 +1,135 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <iomanip>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "TracingNVM.h"
+#include "NVMRAMMock.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <cppunit/extensions/HelperMacros.h>
+
+static NVMTraceBuffer<8> traceBuffer;
+
+static void traceToBuffer(const NVMTraceEntry &entry) {
+    traceBuffer.add(entry);
+}
+
+class TracingNVMTest : public CppUnit::TestFixture  {
+
+CPPUNIT_TEST_SUITE( TracingNVMTest );
+
+CPPUNIT_TEST( test_trace_00 );
+CPPUNIT_TEST( test_buffer_00 );
+CPPUNIT_TEST( test_format_00 );
+
+CPPUNIT_TEST_SUITE_END();
+
+private:
+    typedef TracingNVM<NVMRAMMock<64>, &traceToBuffer> TracedMock_t;
+
+public:
+    void setUp() {
+        traceBuffer.clear();
+    }
+
+    void test_trace_00() {
+        TracedMock_t nvm;
+        uint8_t data[3] = { 1, 2, 3 };
+        uint8_t d;
+
+        bool ret = nvm.write(0x10, data, sizeof(data));
+        CPPUNIT_ASSERT( ret );
+        ret = nvm.read(0x11, d);
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( d == 2 );
+        ret = nvm.write(0x20, 0x42);
+        CPPUNIT_ASSERT( ret );
+        ret = nvm.read(0x10, data, 2);
+        CPPUNIT_ASSERT( ret );
+
+        CPPUNIT_ASSERT( traceBuffer.size() == 4 );
+        NVMTraceEntry entry;
+        CPPUNIT_ASSERT( traceBuffer.get(0, entry) );
+        CPPUNIT_ASSERT( entry.op == NVMTraceEntry::WRITE );
+        CPPUNIT_ASSERT( entry.addr == 0x10 );
+        CPPUNIT_ASSERT( entry.len == 3 );
+        CPPUNIT_ASSERT( entry.time == 0 );
+        CPPUNIT_ASSERT( traceBuffer.get(1, entry) );
+        CPPUNIT_ASSERT( entry.op == NVMTraceEntry::READ );
+        CPPUNIT_ASSERT( entry.addr == 0x11 );
+        CPPUNIT_ASSERT( entry.len == 1 );
+        CPPUNIT_ASSERT( entry.time == 1 );
+        CPPUNIT_ASSERT( traceBuffer.get(3, entry) );
+        CPPUNIT_ASSERT( entry.op == NVMTraceEntry::READ );
+        CPPUNIT_ASSERT( entry.len == 2 );
+        CPPUNIT_ASSERT( !traceBuffer.get(4, entry) );
+
+        // as base of SlotNVM
+        traceBuffer.clear();
+        SlotNVM<TracedMock_t, 8> slotNVM;
+        ret = slotNVM.begin();
+        CPPUNIT_ASSERT( ret );
+        CPPUNIT_ASSERT( traceBuffer.size() == 8 );  // one read per cluster
+        CPPUNIT_ASSERT( traceBuffer.lost() == 0 );
+    }
+
+    void test_buffer_00() {
+        NVMTraceBuffer<3> buf;
+        NVMTraceEntry entry = { NVMTraceEntry::READ, 0, 1, 0 };
+        for (uint32_t i = 0; i < 5; ++i) {
+            entry.time = i;
+            buf.add(entry);
+        }
+        CPPUNIT_ASSERT( buf.size() == 3 );
+        CPPUNIT_ASSERT( buf.lost() == 2 );
+        CPPUNIT_ASSERT( buf.get(0, entry) );
+        CPPUNIT_ASSERT( entry.time == 2 );
+        CPPUNIT_ASSERT( buf.get(2, entry) );
+        CPPUNIT_ASSERT( entry.time == 4 );
+    }
+
+    void test_format_00() {
+        NVMTraceEntry entry = { NVMTraceEntry::WRITE, 0x1234, 17, 123456 };
+        char line[64];
+        FILE *file = tmpfile();
+        CPPUNIT_ASSERT( file != NULL );
+        CPPUNIT_ASSERT( printNVMTraceEntry(file, entry) );
+        rewind(file);
+        CPPUNIT_ASSERT( fgets(line, sizeof(line), file) != NULL );
+        fclose(file);
+        CPPUNIT_ASSERT( strcmp(line, "W 0x1234 17 123456\n") == 0 );
+
+        NVMTraceEntry parsed;
+        CPPUNIT_ASSERT( parseNVMTraceEntry(line, parsed) );
+        CPPUNIT_ASSERT( parsed.op == entry.op );
+        CPPUNIT_ASSERT( parsed.addr == entry.addr );
+        CPPUNIT_ASSERT( parsed.len == entry.len );
+        CPPUNIT_ASSERT( parsed.time == entry.time );
+
+        CPPUNIT_ASSERT( !parseNVMTraceEntry("# begin\n", parsed) );
+        CPPUNIT_ASSERT( !parseNVMTraceEntry("X 0x0 1 2\n", parsed) );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TracingNVMTest );
@@ -15,6 +15,5 @@ int main()
     CppUnit::TextUi::TestRunner runner;
     CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
     runner.addTest( registry.makeTest() );
-    runner.run();
-    return 0;
+    return runner.run() ? 0 : 1;
 }
@@ -0,0 +1,246 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Randomized stress test of many independent SlotNVM instances in parallel.
+ *
+ * Every job runs random writes and erases with random power cuts on one configuration,
+ * the content is compared with SlotNVMReference. A job is fully defined by configuration,
+ * seed and count of operations, so every failure can be reproduced with -c, --seed and -n.
+ *
+ * Usage: StressRunner [-j threads] [-s seeds per configuration] [-n operations per job]
+ *                     [-c configuration] [--seed first seed] [-l]
+ */
+
+// include all headers needed by classes under test before define private and protected as public
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <string>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// make all public just for testing
+#define private public
+#define protected public
+
+#include "SlotNVM.h"
+#include "NVMRAMMock.h"
+#include "PowerFailHarness.h"
+
+// and reset defines
+#undef private
+#undef protected
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+uint8_t crc8(uint8_t crc, uint8_t data) {
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; ++i) {
+        crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+    }
+    return crc;
+}
+
+typedef uint8_t (*CRC_t)(uint8_t, uint8_t);
+
+const unsigned FULL_CHECK_INTERVAL = 64;    // compare all slots every x operations
+
+/**
+ * Run one job.
+ * @param       seed    Seed of operations and RND_FUNC
+ * @param       cnt     Count of operations
+ * @param[out]  err     Description of the first error
+ * @return      true on success
+ */
+template <class T>
+bool runJob(uint32_t seed, unsigned cnt, std::string &err) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> slotDist(T::S_FIRST_SLOT, T::S_LAST_SLOT);
+    std::uniform_int_distribution<> lenDist(1, 256);
+    std::uniform_int_distribution<> byteDist(0, 255);
+    std::uniform_int_distribution<> cutDist(1, 400);
+
+    T *nvm = new T;
+    SlotNVMReference ref;
+    NVMOperation op;
+    bool res = true;
+
+    seedPowerFailRandom(seed);
+    nvm->begin();
+
+    for (unsigned i = 0; (i < cnt) && res; ++i) {
+        op.type = (byteDist(gen) < 170) ? NVMOperation::WRITE : NVMOperation::ERASE;
+        op.slot = slotDist(gen);
+        op.data.clear();
+        if (op.type == NVMOperation::WRITE) {
+            op.data.resize(lenDist(gen));
+            for (size_t d = 0; d < op.data.size(); ++d) {
+                op.data[d] = byteDist(gen);
+            }
+        }
+        bool cut = byteDist(gen) < 3;
+        if (cut) nvm->setWriteErrorAfterXbytes(cutDist(gen));
+
+        try {
+            bool done = (op.type == NVMOperation::WRITE) ? nvm->writeSlot(op.slot, op.data.data(), op.data.size())
+                                                          : nvm->eraseSlot(op.slot);
+            if (done) ref.apply(op);
+            nvm->setWriteErrorAfterXbytes(0);
+            if (((i + 1) % FULL_CHECK_INTERVAL) == 0) {
+                res = ref.check(*nvm, NULL, err) && checkClusterUsage(*nvm, err);
+            }
+        } catch (PowerLostException &) {
+            // restart with a new instance
+            T *restarted = new T;
+            restarted->m_memory = nvm->m_memory;
+            delete nvm;
+            nvm = restarted;
+            res = nvm->begin();
+            if (!res) {
+                err = "begin() failed";
+                break;
+            }
+            res = ref.check(*nvm, &op, err) && checkClusterUsage(*nvm, err);
+
+            // take over the result of the interrupted operation
+            std::vector<uint8_t> data(256);
+            nvm_size_t len = data.size();
+            bool avail = nvm->readSlot(op.slot, &data[0], len);
+            data.resize(len);
+            if (avail ? (data == op.data) : (op.type == NVMOperation::ERASE)) {
+                ref.apply(op);
+            }
+        }
+        if (!res) err = "operation " + std::to_string(i) + ": " + err;
+    }
+
+    delete nvm;
+    return res;
+}
+
+struct Config {
+    const char  *name;
+    bool        (*run)(uint32_t seed, unsigned cnt, std::string &err);
+};
+
+const Config CONFIGS[] = {
+    { "c16",            &runJob< SlotNVM<NVMRAMMock<1024>, 16, 0, 0, (CRC_t)NULL, int, &powerFailRandom> > },
+    { "c16crc",         &runJob< SlotNVM<NVMRAMMock<1024>, 16, 0, 0, &crc8, int, &powerFailRandom> > },
+    { "c32",            &runJob< SlotNVM<NVMRAMMock<1024>, 32, 0, 0, (CRC_t)NULL, int, &powerFailRandom> > },
+    { "c32crc",         &runJob< SlotNVM<NVMRAMMock<1024>, 32, 0, 0, &crc8, int, &powerFailRandom> > },
+    { "c32crc_prov64",  &runJob< SlotNVM<NVMRAMMock<1024>, 32, 64, 0, &crc8, int, &powerFailRandom> > },
+    { "c64crc_slots8",  &runJob< SlotNVM<NVMRAMMock<1024>, 64, 0, 8, &crc8, int, &powerFailRandom> > },
+    { "c64_prov256",    &runJob< SlotNVM<NVMRAMMock<4096>, 64, 256, 0, (CRC_t)NULL, int, &powerFailRandom> > },
+    { "c128crc_4k",     &runJob< SlotNVM<NVMRAMMock<4096>, 128, 0, 0, &crc8, int, &powerFailRandom> > },
+    { "c256_32k",       &runJob< SlotNVM<NVMRAMMock<32*1024>, 256, 0, 0, (CRC_t)NULL, int, &powerFailRandom> > },
+};
+const size_t CONFIG_CNT = sizeof(CONFIGS) / sizeof(CONFIGS[0]);
+
+struct Job {
+    const Config    *config;
+    uint32_t        seed;
+    bool            ok;
+    std::string     err;
+};
+
+void usage() {
+    fprintf(stderr, "Usage: StressRunner [-j threads] [-s seeds per configuration] [-n operations per job]\n"
+                    "                    [-c configuration] [--seed first seed] [-l]\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    unsigned threads = std::thread::hardware_concurrency();
+    unsigned seeds = 16;
+    unsigned ops = 20000;
+    uint32_t firstSeed = 1;
+    const char *configName = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasArg = (i + 1) < argc;
+        if ((strcmp(argv[i], "-j") == 0) && hasArg) {
+            threads = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-s") == 0) && hasArg) {
+            seeds = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-n") == 0) && hasArg) {
+            ops = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-c") == 0) && hasArg) {
+            configName = argv[++i];
+        } else if ((strcmp(argv[i], "--seed") == 0) && hasArg) {
+            firstSeed = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            for (size_t c = 0; c < CONFIG_CNT; ++c) {
+                printf("%s\n", CONFIGS[c].name);
+            }
+            return 0;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (threads == 0) threads = 1;
+
+    std::vector<Job> jobs;
+    for (size_t c = 0; c < CONFIG_CNT; ++c) {
+        if ((configName != NULL) && (strcmp(configName, CONFIGS[c].name) != 0)) continue;
+        for (unsigned s = 0; s < seeds; ++s) {
+            Job job;
+            job.config = &CONFIGS[c];
+            job.seed = firstSeed + s;
+            job.ok = false;
+            jobs.push_back(job);
+        }
+    }
+    if (jobs.empty()) {
+        fprintf(stderr, "unknown configuration %s, see -l\n", configName);
+        return 1;
+    }
+
+    printf("%u jobs with %u operations on %u threads\n", (unsigned)jobs.size(), ops, threads);
+
+    std::atomic<size_t> nextJob(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    auto worker = [&]() {
+        for (size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+            jobs[j].ok = jobs[j].config->run(jobs[j].seed, ops, jobs[j].err);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.push_back(std::thread(worker));
+    }
+    for (size_t t = 0; t < pool.size(); ++t) {
+        pool[t].join();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned failures = 0;
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        if (jobs[j].ok) continue;
+        ++failures;
+        printf("FAIL %s seed %u: %s\n", jobs[j].config->name, (unsigned)jobs[j].seed, jobs[j].err.c_str());
+        printf("     reproduce: StressRunner -j 1 -s 1 -n %u -c %s --seed %u\n", ops, jobs[j].config->name,
+               (unsigned)jobs[j].seed);
+    }
+    double totalOps = (double)jobs.size() * ops;
+    printf("%.0f operations in %.1f s (%.0f ops/s), %u of %u jobs failed\n", totalOps, sec, totalOps / sec,
+           failures, (unsigned)jobs.size());
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+/*
+ * SlotNVM
+ * Copyright (C) 2020 Frank Mueller
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Replay a trace recorded with TracingNVM against NVMRAMMock and estimate
+ * how long it takes on a given NVM.
+ *
+ * Trace lines are written by printNVMTraceEntry(), e.g. "W 0x0040 4 1234".
+ * A line starting with '#' starts a new section, e.g. "# begin", so you
+ * can see the time of every SlotNVM call.
+ *
+ * Usage: TraceReplay [-m eeprom|i2c|fram|nor] [-l readCall,readByte,writeCall,writeByte] [trace file]
+ *        Times of -l are in ns. Without trace file stdin is read.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "TracingNVM.h"
+#include "NVMRAMMock.h"
+#include "NVMLatencyModel.h"
+
+namespace {
+
+struct Section {
+    std::string name;
+    unsigned    reads;
+    unsigned    writes;
+    unsigned    erases;
+    unsigned    bytesRead;
+    unsigned    bytesWritten;
+    unsigned    errors;
+    uint64_t    timeNs;
+};
+
+typedef NVMRAMMock<0xFFFF> ReplayNVM_t;
+
+template <class MODEL>
+bool replay(FILE *file, const MODEL &model, std::vector<Section> &sections) {
+    ReplayNVM_t *nvm = new ReplayNVM_t;
+    std::vector<uint8_t> buf;
+    char line[256];
+    unsigned lineNo = 0;
+
+    sections.clear();
+    sections.push_back(Section());
+    sections.back().name = "-";
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        ++lineNo;
+        char *p = line;
+        while ((*p == ' ') || (*p == '\t')) ++p;
+        if ((*p == '\n') || (*p == '\r') || (*p == '\0')) continue;
+
+        if (*p == '#') {
+            ++p;
+            while (*p == ' ') ++p;
+            p[strcspn(p, "\r\n")] = '\0';
+            if ((sections.back().reads + sections.back().writes + sections.back().erases) == 0) {
+                sections.pop_back();                                    // drop empty section
+            }
+            sections.push_back(Section());
+            sections.back().name = p;
+            continue;
+        }
+
+        NVMTraceEntry entry;
+        if (!parseNVMTraceEntry(p, entry)) {
+            fprintf(stderr, "line %u: invalid trace entry\n", lineNo);
+            delete nvm;
+            return false;
+        }
+
+        Section &sec = sections.back();
+        if (buf.size() < entry.len) buf.resize(entry.len, 0xFF);
+        bool res = ((uint32_t)entry.addr + entry.len) <= ReplayNVM_t::S_SIZE;
+        if (!res) {
+            ++sec.errors;                                               // address out of range
+            continue;
+        }
+        switch (entry.op) {
+        case NVMTraceEntry::READ:
+            ++sec.reads;
+            sec.bytesRead += entry.len;
+            sec.timeNs += model.readTime(entry.addr, entry.len);
+            if (entry.len > 0) res = nvm->read(entry.addr, &buf[0], entry.len);
+            break;
+        case NVMTraceEntry::WRITE:
+            ++sec.writes;
+            sec.bytesWritten += entry.len;
+            sec.timeNs += model.writeTime(entry.addr, entry.len);
+            if (entry.len > 0) res = nvm->write(entry.addr, &buf[0], entry.len);
+            break;
+        case NVMTraceEntry::ERASE:
+            ++sec.erases;
+            sec.timeNs += model.eraseTime(entry.addr, entry.len);
+            res = nvm->erase(entry.addr, entry.len);
+            break;
+        }
+        if (!res && (entry.op != NVMTraceEntry::ERASE)) {
+            ++sec.errors;
+        }
+    }
+
+    delete nvm;
+    return true;
+}
+
+void printSections(const std::vector<Section> &sections) {
+    Section total = Section();
+    total.name = "total";
+
+    printf("%-20s %8s %10s %8s %10s %7s %7s %14s\n",
+           "section", "reads", "bytes", "writes", "bytes", "erases", "errors", "time/ms");
+    for (size_t i = 0; i <= sections.size(); ++i) {
+        const Section &sec = (i < sections.size()) ? sections[i] : total;
+        printf("%-20s %8u %10u %8u %10u %7u %7u %14.3f\n",
+               sec.name.c_str(), sec.reads, sec.bytesRead, sec.writes, sec.bytesWritten,
+               sec.erases, sec.errors, sec.timeNs / 1e6);
+        if (i < sections.size()) {
+            total.reads += sec.reads;
+            total.writes += sec.writes;
+            total.erases += sec.erases;
+            total.bytesRead += sec.bytesRead;
+            total.bytesWritten += sec.bytesWritten;
+            total.errors += sec.errors;
+            total.timeNs += sec.timeNs;
+        }
+    }
+}
+
+void usage() {
+    fprintf(stderr, "Usage: TraceReplay [-m eeprom|i2c|fram|nor] [-l readCall,readByte,writeCall,writeByte] [trace file]\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::string modelName = "eeprom";
+    unsigned lin[4] = { 0 };
+    bool useLinear = false;
+    const char *fileName = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((strcmp(argv[i], "-m") == 0) && (i + 1 < argc)) {
+            modelName = argv[++i];
+        } else if ((strcmp(argv[i], "-l") == 0) && (i + 1 < argc)) {
+            if (sscanf(argv[++i], "%u,%u,%u,%u", &lin[0], &lin[1], &lin[2], &lin[3]) != 4) {
+                usage();
+                return 1;
+            }
+            useLinear = true;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 1;
+        } else {
+            fileName = argv[i];
+        }
+    }
+
+    FILE *file = stdin;
+    if (fileName != NULL) {
+        file = fopen(fileName, "r");
+        if (file == NULL) {
+            fprintf(stderr, "can not open %s\n", fileName);
+            return 1;
+        }
+    }
+
+    std::vector<Section> sections;
+    bool res;
+    if (useLinear) {
+        res = replay(file, LinearLatencyModel(lin[0], lin[1], lin[2], lin[3]), sections);
+    } else if (modelName == "eeprom") {
+        res = replay(file, LinearLatencyModel::avrEEPROM(), sections);
+    } else if (modelName == "i2c") {
+        res = replay(file, PageLatencyModel::i2cEEPROM24LC256(), sections);
+    } else if (modelName == "fram") {
+        res = replay(file, LinearLatencyModel::spiFRAM(), sections);
+    } else if (modelName == "nor") {
+        res = replay(file, NORFlashModel::spiNOR25Q(), sections);
+    } else {
+        usage();
+        res = false;
+    }
+
+    if (file != stdin) fclose(file);
+    if (!res) return 1;
+
+    printSections(sections);
+    return 0;
+}